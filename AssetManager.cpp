@@ -0,0 +1,911 @@
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include "AssetManager.h"
+
+#include "DeviceManager.h"
+#include "UploadManager.h"
+#include "DeletionQueue.h"
+#include "Tracer.h"
+#include "Utils.h"
+
+#include <glm/gtx/hash.hpp>
+#include <stb_image.h>
+#include <tiny_obj_loader.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace std
+{
+    template<> struct hash<Vertex>
+    {
+        size_t operator()(Vertex const& vertex) const
+        {
+            return ((hash<glm::vec3>()(vertex.pos) ^
+                    (hash<glm::vec3>()(vertex.color) << 1)) >> 1) ^
+                    (hash<glm::vec2>()(vertex.texCoord) << 1);
+        }
+    };
+}
+
+namespace
+{
+    // Decoding is CPU bound, more threads than this mostly compete with the render thread
+    const uint32_t MAX_DECODE_THREADS = 4;
+
+    double elapsedMs(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Next mip of RGBA8 pixels, each texel the average of the two by two it covers
+    std::vector<unsigned char> downsample(const std::vector<unsigned char>& pixels, uint32_t width, uint32_t height)
+    {
+        uint32_t halfWidth = std::max(width / 2, 1u);
+        uint32_t halfHeight = std::max(height / 2, 1u);
+
+        std::vector<unsigned char> half(halfWidth * halfHeight * 4);
+
+        for (uint32_t y = 0; y < halfHeight; y++)
+        {
+            // A side of one texel is averaged with itself
+            uint32_t y0 = std::min(y * 2, height - 1) * width;
+            uint32_t y1 = std::min(y * 2 + 1, height - 1) * width;
+
+            for (uint32_t x = 0; x < halfWidth; x++)
+            {
+                uint32_t x0 = std::min(x * 2, width - 1);
+                uint32_t x1 = std::min(x * 2 + 1, width - 1);
+
+                for (uint32_t c = 0; c < 4; c++)
+                {
+                    uint32_t sum = pixels[(y0 + x0) * 4 + c] + pixels[(y0 + x1) * 4 + c] + pixels[(y1 + x0) * 4 + c] + pixels[(y1 + x1) * 4 + c];
+                    half[(y * halfWidth + x) * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+                }
+            }
+        }
+
+        return half;
+    }
+}
+
+AssetManager::Handle::Handle(uint32_t id)
+    : id(id)
+{
+    AssetManager::instance().addReference(id);
+}
+
+AssetManager::Handle::Handle(const Handle& other)
+    : id(other.id)
+{
+    AssetManager::instance().addReference(id);
+}
+
+AssetManager::Handle& AssetManager::Handle::operator=(const Handle& other)
+{
+    AssetManager::instance().addReference(other.id);
+    AssetManager::instance().removeReference(id);
+    id = other.id;
+
+    return *this;
+}
+
+AssetManager::Handle::~Handle()
+{
+    AssetManager::instance().removeReference(id);
+}
+
+bool AssetManager::Handle::isValid() const
+{
+    return id != 0;
+}
+
+AssetManager::State AssetManager::Handle::getState() const
+{
+    return AssetManager::instance().getAsset(id).state;
+}
+
+const std::string& AssetManager::Handle::getPath() const
+{
+    return AssetManager::instance().getAsset(id).path;
+}
+
+const std::string& AssetManager::Handle::getError() const
+{
+    return AssetManager::instance().getAsset(id).error;
+}
+
+const AssetManager::Mesh& AssetManager::Handle::getMesh() const
+{
+    return AssetManager::instance().getAsset(id).mesh;
+}
+
+const AssetManager::Texture& AssetManager::Handle::getTexture() const
+{
+    return AssetManager::instance().getAsset(id).texture;
+}
+
+SyncTicket AssetManager::Handle::getTicket() const
+{
+    return AssetManager::instance().getAsset(id).ticket;
+}
+
+bool AssetManager::Handle::request() const
+{
+    return AssetManager::instance().request(id);
+}
+
+void AssetManager::Handle::then(const std::function<void(const Handle&)>& continuation) const
+{
+    AssetManager::instance().then(id, continuation);
+}
+
+AssetManager& AssetManager::instance()
+{
+    static AssetManager instance;
+
+    return instance;
+}
+
+void AssetManager::init()
+{
+    running = true;
+
+    uint32_t threadCount = std::min(std::max(std::thread::hardware_concurrency(), 2u) - 1, MAX_DECODE_THREADS);
+
+    ioThread = std::thread(&AssetManager::readLoop, this);
+
+    for (uint32_t i = 0; i < threadCount; i++)
+    {
+        decodeThreads.push_back(std::thread(&AssetManager::decodeLoop, this));
+    }
+
+    std::cout << "Asset loading: 1 I/O thread, " << threadCount << " decode threads" << std::endl;
+}
+
+AssetManager::Handle AssetManager::loadMesh(const std::string& path, bool keepGeometry)
+{
+    return Handle(load(path, MESH, keepGeometry));
+}
+
+AssetManager::Handle AssetManager::loadTexture(const std::string& path)
+{
+    return Handle(load(path, TEXTURE, false));
+}
+
+uint32_t AssetManager::load(const std::string& path, Type type, bool keepGeometry)
+{
+    stats.requests++;
+
+    auto found = assetsByPath.find(path);
+
+    if (found != assetsByPath.end())
+    {
+        if (getAsset(found->second).type != type)
+        {
+            throw std::runtime_error("Error: Asset " + path + " is already loaded as another type");
+        }
+
+        stats.cacheHits++;
+
+        return found->second;
+    }
+
+    uint32_t id;
+
+    if (!freeSlots.empty())
+    {
+        id = freeSlots.back();
+        freeSlots.pop_back();
+    }
+    else
+    {
+        assets.push_back(Asset());
+        id = static_cast<uint32_t>(assets.size());
+    }
+
+    Asset& asset = assets[id - 1];
+    asset = Asset();
+    asset.path = path;
+    asset.type = type;
+    asset.state = LOADING;
+
+    assetsByPath[path] = id;
+
+    stream(id, keepGeometry);
+
+    return id;
+}
+
+void AssetManager::stream(uint32_t id, bool keepGeometry)
+{
+    Asset& asset = getAsset(id);
+    asset.stream = ++nextStream;
+
+    Job job = {};
+    job.id = id;
+    job.type = asset.type;
+    job.path = asset.path;
+    job.keepGeometry = keepGeometry;
+    job.stream = asset.stream;
+    job.firstLevel = asset.firstLevel;
+
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        readJobs.push_back(std::move(job));
+    }
+
+    readCondition.notify_one();
+}
+
+AssetManager::Asset& AssetManager::getAsset(uint32_t id)
+{
+    return assets[id - 1];
+}
+
+const AssetManager::Asset& AssetManager::getAsset(uint32_t id) const
+{
+    return assets[id - 1];
+}
+
+void AssetManager::addReference(uint32_t id)
+{
+    if (id != 0)
+    {
+        getAsset(id).references++;
+    }
+}
+
+void AssetManager::removeReference(uint32_t id)
+{
+    // Handles may outlive cleanup
+    if (id != 0 && id <= assets.size())
+    {
+        getAsset(id).references--;
+    }
+}
+
+void AssetManager::then(uint32_t id, const std::function<void(const Handle&)>& continuation)
+{
+    if (getAsset(id).state == LOADING)
+    {
+        getAsset(id).continuations.push_back(continuation);
+    }
+    else
+    {
+        continuation(Handle(id));
+    }
+}
+
+bool AssetManager::request(uint32_t id)
+{
+    // May start a read, which changes the state
+    if (getAsset(id).resource != 0)
+    {
+        ResidencyManager::instance().request(getAsset(id).resource);
+    }
+
+    return getAsset(id).state == READY;
+}
+
+void AssetManager::readLoop()
+{
+    TRACE_THREAD_NAME("Asset I/O");
+
+    while (true)
+    {
+        Job job;
+
+        {
+            std::unique_lock<std::mutex> lock(jobMutex);
+            readCondition.wait(lock, [this] { return !running || !readJobs.empty(); });
+
+            if (!running)
+            {
+                return;
+            }
+
+            job = std::move(readJobs.front());
+            readJobs.pop_front();
+        }
+
+        TRACE_ZONE("readAsset");
+
+        auto start = std::chrono::steady_clock::now();
+
+        std::ifstream file(job.path, std::ios::ate | std::ios::binary);
+
+        if (file.is_open())
+        {
+            job.data.resize(static_cast<size_t>(file.tellg()));
+            file.seekg(0);
+            file.read(job.data.data(), job.data.size());
+
+            job.fileSize = job.data.size();
+        }
+        else
+        {
+            job.error = "failed to open file";
+        }
+
+        job.readMs = elapsedMs(start);
+
+        {
+            std::lock_guard<std::mutex> lock(jobMutex);
+
+            if (job.error.empty())
+            {
+                decodeJobs.push_back(std::move(job));
+            }
+            else
+            {
+                finishedJobs.push_back(std::move(job));
+            }
+        }
+
+        decodeCondition.notify_one();
+        finishedCondition.notify_all();
+    }
+}
+
+void AssetManager::decodeLoop()
+{
+    TRACE_THREAD_NAME("Asset decode");
+
+    while (true)
+    {
+        Job job;
+
+        {
+            std::unique_lock<std::mutex> lock(jobMutex);
+            decodeCondition.wait(lock, [this] { return !running || !decodeJobs.empty(); });
+
+            if (!running)
+            {
+                return;
+            }
+
+            job = std::move(decodeJobs.front());
+            decodeJobs.pop_front();
+        }
+
+        auto start = std::chrono::steady_clock::now();
+
+        if (job.type == MESH)
+        {
+            decodeMesh(job);
+        }
+        else
+        {
+            decodeTexture(job);
+        }
+
+        job.decodeMs = elapsedMs(start);
+
+        std::vector<char>().swap(job.data);
+
+        {
+            std::lock_guard<std::mutex> lock(jobMutex);
+            finishedJobs.push_back(std::move(job));
+        }
+
+        finishedCondition.notify_all();
+    }
+}
+
+void AssetManager::decodeMesh(Job& job)
+{
+    TRACE_ZONE("decodeMesh");
+
+    // Load using tinyobj containers
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string err;
+
+    std::istringstream stream(std::string(job.data.begin(), job.data.end()));
+
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, &stream))
+    {
+        job.error = err;
+        return;
+    }
+
+    // Map vertex to index
+    std::unordered_map<Vertex, uint32_t> uniqueVertices = {};
+
+    job.radius = 0.0f;
+
+    for (const auto& shape : shapes)
+    {
+        for (const auto& index : shape.mesh.indices)
+        {
+            Vertex vertex = {};
+
+            vertex.pos = { attrib.vertices[3 * index.vertex_index + 0], // Single strip values - index * 3
+                           attrib.vertices[3 * index.vertex_index + 1],
+                           attrib.vertices[3 * index.vertex_index + 2] };
+
+            vertex.normal = {attrib.normals[3 * index.normal_index + 0],
+                             attrib.normals[3 * index.normal_index + 1],
+                             attrib.normals[3 * index.normal_index + 2]};
+
+            vertex.texCoord = { attrib.texcoords.at(2 * index.texcoord_index + 0),
+                                1.0f - attrib.texcoords.at(2 * index.texcoord_index + 1) };
+
+            vertex.color = { 1.0f, 1.0f, 1.0f };
+
+            if (uniqueVertices.count(vertex) == 0)
+            {
+                // Push current vector size (ie index) to uniqueVertices and push vertex to vertex array
+                uniqueVertices[vertex] = static_cast<uint32_t>(job.vertices.size());
+                job.vertices.push_back(vertex);
+
+                job.radius = std::max(job.radius, glm::length(vertex.pos));
+            }
+
+            // Retrieve unique vertex index from map
+            job.indices.push_back(uniqueVertices[vertex]);
+        }
+    }
+
+    if (job.indices.empty())
+    {
+        job.error = "no triangles";
+    }
+}
+
+void AssetManager::decodeTexture(Job& job)
+{
+    TRACE_ZONE("decodeTexture");
+
+    int texWidth, texHeight, texChannels;
+    stbi_uc* pixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(job.data.data()), static_cast<int>(job.data.size()),
+                                            &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+
+    if (!pixels)
+    {
+        job.error = stbi_failure_reason();
+        return;
+    }
+
+    job.width = static_cast<uint32_t>(texWidth);
+    job.height = static_cast<uint32_t>(texHeight);
+
+    std::vector<unsigned char> level(pixels, pixels + job.width * job.height * 4);
+    stbi_image_free(pixels);
+
+    job.levelCount = 1;
+
+    while ((std::max(job.width, job.height) >> job.levelCount) > 0)
+    {
+        job.levelCount++;
+    }
+
+    job.firstLevel = std::min(job.firstLevel, job.levelCount - 1);
+
+    // Each mip is built from the one above, only those from the first level held are kept
+    uint32_t levelWidth = job.width;
+    uint32_t levelHeight = job.height;
+
+    for (uint32_t i = 0; i < job.levelCount; i++)
+    {
+        if (i >= job.firstLevel)
+        {
+            job.pixels.insert(job.pixels.end(), level.begin(), level.end());
+        }
+
+        if (i + 1 < job.levelCount)
+        {
+            level = downsample(level, levelWidth, levelHeight);
+            levelWidth = std::max(levelWidth / 2, 1u);
+            levelHeight = std::max(levelHeight / 2, 1u);
+        }
+    }
+}
+
+void AssetManager::update()
+{
+    TRACE_ZONE("updateAssets");
+
+    std::deque<Job> finished;
+
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        finished.swap(finishedJobs);
+    }
+
+    if (finished.empty())
+    {
+        return;
+    }
+
+    std::vector<uint32_t> completed;
+    std::vector<uint32_t> uploaded;
+
+    for (Job& job : finished)
+    {
+        stats.bytesRead += job.fileSize;
+        stats.readMs += job.readMs;
+        stats.decodeMs += job.decodeMs;
+
+        // Superseded by a later read, or the asset was released meanwhile
+        if (getAsset(job.id).free || getAsset(job.id).stream != job.stream)
+        {
+            continue;
+        }
+
+        (finish(job) ? uploaded : completed).push_back(job.id);
+    }
+
+    // Everything finished this update shares one upload batch
+    if (!uploaded.empty())
+    {
+        SyncTicket ticket = UploadManager::instance().flush();
+
+        for (uint32_t id : uploaded)
+        {
+            getAsset(id).ticket = ticket;
+            getAsset(id).state = READY;
+        }
+
+        completed.insert(completed.end(), uploaded.begin(), uploaded.end());
+    }
+
+    // Continuations may load more, which can move the assets, so they're run by id once every asset is final
+    for (uint32_t id : completed)
+    {
+        runContinuations(id);
+    }
+}
+
+bool AssetManager::finish(Job& job)
+{
+    Asset& asset = getAsset(job.id);
+
+    // Reads after the first replace what the asset holds
+    SyncTicket lastUse = SyncManager::instance().getLastTicket();
+
+    if (asset.state == READY)
+    {
+        releaseResources(asset, lastUse);
+    }
+
+    if (!job.error.empty())
+    {
+        ResidencyManager::instance().removeResource(asset.resource);
+        asset.resource = 0;
+
+        asset.state = FAILED;
+        asset.error = job.error;
+        stats.failed++;
+
+        std::cerr << "Asset " << job.path << " failed to load: " << job.error << std::endl;
+
+        return false;
+    }
+
+    if (job.type == MESH)
+    {
+        asset.mesh.handle = GeometryManager::instance().loadMesh(job.vertices, job.indices);
+        asset.mesh.radius = job.radius;
+        asset.mesh.vertexCount = static_cast<uint32_t>(job.vertices.size());
+        asset.mesh.indexCount = static_cast<uint32_t>(job.indices.size());
+        asset.levelCount = 1;
+        asset.bytes = GeometryManager::instance().getMeshBytes(asset.mesh.handle);
+
+        if (job.keepGeometry)
+        {
+            asset.mesh.vertices.swap(job.vertices);
+            asset.mesh.indices.swap(job.indices);
+        }
+    }
+    else
+    {
+        createTexture(asset, job);
+        asset.levelCount = job.levelCount;
+    }
+
+    if (asset.resource == 0)
+    {
+        stats.loaded++;
+        addResource(job.id, job);
+    }
+
+    stats.residentBytes += asset.bytes;
+
+    return true;
+}
+
+void AssetManager::addResource(uint32_t id, const Job& job)
+{
+    std::vector<VkDeviceSize> levelBytes;
+    uint32_t heap;
+
+    if (job.type == MESH)
+    {
+        // The geometry pools are a fixed allocation on the device heap, so meshes only count against the pools
+        levelBytes.push_back(getAsset(id).bytes);
+        heap = GeometryManager::instance().getResidencyPool();
+    }
+    else
+    {
+        // Texels only, the image's alignment padding is left out
+        for (uint32_t level = 0; level < job.levelCount; level++)
+        {
+            levelBytes.push_back(static_cast<VkDeviceSize>(std::max(job.width >> level, 1u)) * std::max(job.height >> level, 1u) * 4);
+        }
+
+        heap = ResidencyManager::instance().getDeviceLocalHeap();
+    }
+
+    getAsset(id).resource = ResidencyManager::instance().addResource(heap, levelBytes, 0, [this, id](uint32_t firstLevel)
+    {
+        setResidency(id, firstLevel);
+    });
+}
+
+void AssetManager::setResidency(uint32_t id, uint32_t firstLevel)
+{
+    Asset& asset = getAsset(id);
+
+    if (firstLevel < asset.firstLevel)
+    {
+        stats.restreamed++;
+    }
+    else if (firstLevel < asset.levelCount)
+    {
+        stats.trimmed++;
+    }
+
+    asset.firstLevel = firstLevel;
+
+    if (firstLevel >= asset.levelCount)
+    {
+        // A read still in flight is dropped when it finishes
+        if (asset.state == READY)
+        {
+            releaseResources(asset, SyncManager::instance().getLastTicket());
+        }
+
+        asset.state = EVICTED;
+        asset.stream = ++nextStream;
+        stats.dropped++;
+
+        return;
+    }
+
+    // Read again at the new size, a texture keeps its current image until the new one replaces it
+    if (asset.state == EVICTED)
+    {
+        asset.state = LOADING;
+    }
+
+    stream(id, false);
+}
+
+void AssetManager::createTexture(Asset& asset, const Job& job)
+{
+    VkDevice device = DeviceManager::instance().getDevice();
+
+    uint32_t width = std::max(job.width >> job.firstLevel, 1u);
+    uint32_t height = std::max(job.height >> job.firstLevel, 1u);
+    uint32_t levelCount = job.levelCount - job.firstLevel;
+
+    VkImageCreateInfo imageInfo = {};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent.width = width;
+    imageInfo.extent.height = height;
+    imageInfo.extent.depth = 1;
+    imageInfo.mipLevels = levelCount;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+
+    if (vkCreateImage(device, &imageInfo, nullptr, &asset.texture.image) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Error: Failed to create texture image");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(device, asset.texture.image, &memRequirements);
+
+    // Counted against the budget by the levels it holds, as a residency resource
+    asset.memory = Utils::allocateMemory(memRequirements.size, Utils::findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT), "texture");
+
+    vkBindImageMemory(device, asset.texture.image, asset.memory, 0);
+
+    // Pixels are copied into the staging arena immediately
+    UploadManager::instance().uploadImage(asset.texture.image, width, height, job.pixels.data(), levelCount);
+
+    VkImageViewCreateInfo viewInfo = {};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = asset.texture.image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = levelCount;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+
+    if (vkCreateImageView(device, &viewInfo, nullptr, &asset.texture.view) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Error: Failed to create texture image view");
+    }
+
+    asset.texture.width = width;
+    asset.texture.height = height;
+    asset.texture.levelCount = levelCount;
+    asset.bytes = memRequirements.size;
+}
+
+void AssetManager::runContinuations(uint32_t id)
+{
+    std::vector<std::function<void(const Handle&)>> continuations;
+    continuations.swap(getAsset(id).continuations);
+
+    Handle handle(id);
+
+    for (const auto& continuation : continuations)
+    {
+        continuation(handle);
+    }
+}
+
+AssetManager::State AssetManager::wait(const Handle& handle)
+{
+    TRACE_ZONE("waitAsset");
+
+    while (handle.getState() == LOADING)
+    {
+        {
+            std::unique_lock<std::mutex> lock(jobMutex);
+            finishedCondition.wait(lock, [this] { return !finishedJobs.empty(); });
+        }
+
+        update();
+    }
+
+    return handle.getState();
+}
+
+size_t AssetManager::evictUnused()
+{
+    SyncTicket lastUse = SyncManager::instance().getLastTicket();
+    size_t evicted = 0;
+
+    for (uint32_t id = 1; id <= assets.size(); id++)
+    {
+        const Asset& asset = getAsset(id);
+
+        // Loading assets are left to finish, a later eviction picks them up
+        if (!asset.free && asset.references == 0 && asset.state != LOADING)
+        {
+            release(id, lastUse);
+            evicted++;
+        }
+    }
+
+    stats.evicted += static_cast<uint32_t>(evicted);
+
+    return evicted;
+}
+
+void AssetManager::release(uint32_t id, SyncTicket lastUse)
+{
+    Asset& asset = getAsset(id);
+
+    if (asset.state == READY)
+    {
+        releaseResources(asset, lastUse);
+    }
+
+    ResidencyManager::instance().removeResource(asset.resource);
+
+    assetsByPath.erase(asset.path);
+
+    asset = Asset();
+    asset.free = true;
+    freeSlots.push_back(id);
+}
+
+void AssetManager::releaseResources(Asset& asset, SyncTicket lastUse)
+{
+    if (asset.type == MESH)
+    {
+        MeshHandle mesh = asset.mesh.handle;
+
+        DeletionQueue::instance().enqueue(lastUse, [mesh]()
+        {
+            GeometryManager::instance().unloadMesh(mesh);
+        });
+    }
+    else
+    {
+        DeletionQueue::instance().destroyImage(lastUse, asset.texture.image, asset.texture.view, asset.memory);
+    }
+
+    stats.residentBytes -= asset.bytes;
+    asset.bytes = 0;
+}
+
+AssetManager::Stats AssetManager::getStats() const
+{
+    return stats;
+}
+
+void AssetManager::printStats() const
+{
+    std::cout << std::fixed << std::setprecision(1)
+              << "Assets: " << stats.loaded << " loaded, " << stats.failed << " failed, " << stats.cacheHits << " of "
+              << stats.requests << " requests shared, " << stats.evicted << " evicted, " << stats.dropped << " dropped and "
+              << stats.trimmed << " trimmed over budget, " << stats.restreamed << " streamed again, " << stats.bytesRead / 1024 << " KB read ("
+              << stats.readMs << " ms reading, " << stats.decodeMs << " ms decoding), " << stats.residentBytes / 1024 << " KB resident"
+              << std::defaultfloat << std::setprecision(6) << std::endl;
+}
+
+void AssetManager::cleanup()
+{
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        running = false;
+    }
+
+    readCondition.notify_all();
+    decodeCondition.notify_all();
+
+    if (ioThread.joinable())
+    {
+        ioThread.join();
+    }
+
+    for (std::thread& thread : decodeThreads)
+    {
+        thread.join();
+    }
+
+    decodeThreads.clear();
+
+    // Whatever the threads finished is dropped along with the assets waiting on it
+    readJobs.clear();
+    decodeJobs.clear();
+    finishedJobs.clear();
+
+    VkDevice device = DeviceManager::instance().getDevice();
+
+    for (Asset& asset : assets)
+    {
+        if (asset.free || asset.state != READY)
+        {
+            continue;
+        }
+
+        if (asset.type == MESH)
+        {
+            GeometryManager::instance().unloadMesh(asset.mesh.handle);
+        }
+        else
+        {
+            vkDestroyImageView(device, asset.texture.view, nullptr);
+            vkDestroyImage(device, asset.texture.image, nullptr);
+            Utils::freeTrackedMemory(asset.memory);
+        }
+    }
+
+    printStats();
+
+    assets.clear();
+    freeSlots.clear();
+    assetsByPath.clear();
+}
\ No newline at end of file
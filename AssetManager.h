@@ -0,0 +1,292 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+
+#include <GLFW/glfw3.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Vertex.h"
+#include "SyncManager.h"
+#include "GeometryManager.h"
+#include "ResidencyManager.h"
+
+// Asynchronous mesh and texture loading
+// A load returns a handle straight away. The file is read on an I/O thread and decoded on worker threads, and
+// update() on the main thread creates the GPU resources and queues their upload, finishing the asset with the
+// ticket of the upload batch and running its continuations. Assets are shared by path and reference counted by
+// their handles; unreferenced ones stay cached until evicted. Loaded assets are resources of the residency manager,
+// which can trim a texture's top mips or release an asset to stay within budget - textures against the device heap,
+// meshes against the geometry pools - and the file is read again at the new size, or once the asset is requested.
+// Main thread only, apart from the loader threads.
+class AssetManager
+{
+public:
+
+    enum Type
+    {
+        MESH,
+        TEXTURE
+    };
+
+    enum State
+    {
+        LOADING,
+        READY,
+        FAILED,
+
+        // Released to stay within the memory budget, requesting it loads it again
+        EVICTED
+    };
+
+    struct Mesh
+    {
+        MeshHandle handle;
+
+        // Furthest vertex from the mesh origin
+        float radius;
+
+        uint32_t vertexCount;
+        uint32_t indexCount;
+
+        // Empty unless the load asked to keep them
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+    };
+
+    // RGBA8 with a full mip chain, shader-readable once the upload ticket completes
+    // The size is that of the top mip held, which is smaller while the residency manager has mips trimmed
+    struct Texture
+    {
+        VkImage image;
+        VkImageView view;
+        uint32_t width;
+        uint32_t height;
+        uint32_t levelCount;
+    };
+
+    struct Stats
+    {
+        uint32_t requests;
+        uint32_t cacheHits;
+        uint32_t loaded;
+        uint32_t failed;
+        uint32_t evicted;
+
+        // Released or trimmed by the residency manager, and reads started to bring assets back
+        uint32_t dropped;
+        uint32_t trimmed;
+        uint32_t restreamed;
+
+        uint64_t bytesRead;
+        VkDeviceSize residentBytes;
+
+        // Summed over the loader threads
+        double readMs;
+        double decodeMs;
+    };
+
+    // Reference to an asset, copies share it
+    class Handle
+    {
+    public:
+
+        Handle() {}
+        Handle(const Handle& other);
+        Handle& operator=(const Handle& other);
+        ~Handle();
+
+        bool isValid() const;
+
+        State getState() const;
+        const std::string& getPath() const;
+        const std::string& getError() const;
+
+        // Only once ready
+        const Mesh& getMesh() const;
+        const Texture& getTexture() const;
+
+        // Completes when the asset's upload is visible to the graphics queue
+        SyncTicket getTicket() const;
+
+        // The asset is used this frame, so it is kept over others and whatever was released is loaded again
+        // Returns whether it is ready to draw
+        bool request() const;
+
+        // Run on the main thread once the asset is ready or has failed, straight away if it already has
+        void then(const std::function<void(const Handle&)>& continuation) const;
+
+    private:
+
+        friend class AssetManager;
+
+        explicit Handle(uint32_t id);
+
+        // 0 for no asset
+        uint32_t id = 0;
+    };
+
+private:
+
+    AssetManager() : running(false) {}
+
+    struct Asset
+    {
+        std::string path;
+        Type type;
+        State state;
+        std::string error;
+
+        // Live handles
+        uint32_t references;
+
+        Mesh mesh;
+        Texture texture;
+        VkDeviceMemory memory;
+
+        // Device memory held, counted towards the resident bytes
+        VkDeviceSize bytes;
+
+        SyncTicket ticket;
+
+        // 0 until the first load finishes
+        ResidencyManager::ResourceId resource;
+
+        // Mips the residency manager wants held, from firstLevel down
+        uint32_t firstLevel;
+        uint32_t levelCount;
+
+        // Latest read started, the results of older ones are dropped
+        uint64_t stream;
+
+        std::vector<std::function<void(const Handle&)>> continuations;
+
+        // Slot is free for reuse
+        bool free;
+    };
+
+    // Passed from the I/O thread to the workers and back to the main thread
+    struct Job
+    {
+        uint32_t id;
+        Type type;
+        std::string path;
+        bool keepGeometry;
+        uint64_t stream;
+
+        // File contents, dropped once decoded
+        std::vector<char> data;
+        uint64_t fileSize;
+
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+        float radius;
+
+        // Mips from firstLevel down, the size is that of the full image
+        std::vector<unsigned char> pixels;
+        uint32_t width;
+        uint32_t height;
+        uint32_t firstLevel;
+        uint32_t levelCount;
+
+        std::string error;
+        double readMs;
+        double decodeMs;
+    };
+
+    // Ids are slot indices plus one
+    std::vector<Asset> assets;
+    std::vector<uint32_t> freeSlots;
+    std::unordered_map<std::string, uint32_t> assetsByPath;
+
+    std::mutex jobMutex;
+    std::condition_variable readCondition;
+    std::condition_variable decodeCondition;
+    std::condition_variable finishedCondition;
+    std::deque<Job> readJobs;
+    std::deque<Job> decodeJobs;
+    std::deque<Job> finishedJobs;
+
+    std::thread ioThread;
+    std::vector<std::thread> decodeThreads;
+    std::atomic<bool> running;
+
+    uint64_t nextStream = 0;
+
+    Stats stats = {};
+
+    Asset& getAsset(uint32_t id);
+    const Asset& getAsset(uint32_t id) const;
+
+    uint32_t load(const std::string& path, Type type, bool keepGeometry);
+
+    // Queue a read of the asset's file, superseding any read still in flight
+    void stream(uint32_t id, bool keepGeometry);
+
+    void addReference(uint32_t id);
+    void removeReference(uint32_t id);
+    void then(uint32_t id, const std::function<void(const Handle&)>& continuation);
+    bool request(uint32_t id);
+
+    void readLoop();
+    void decodeLoop();
+
+    static void decodeMesh(Job& job);
+    static void decodeTexture(Job& job);
+
+    // Create the GPU resources and queue the upload, false when the job failed
+    bool finish(Job& job);
+    void createTexture(Asset& asset, const Job& job);
+    void addResource(uint32_t id, const Job& job);
+
+    // Called by the residency manager
+    void setResidency(uint32_t id, uint32_t firstLevel);
+
+    // The asset and its resources are released once the submission with lastUse completes
+    void release(uint32_t id, SyncTicket lastUse);
+    void releaseResources(Asset& asset, SyncTicket lastUse);
+
+    void runContinuations(uint32_t id);
+
+public:
+
+    // Return singleton instance
+    static AssetManager& instance();
+
+    // Ensure singleton is never copied
+    AssetManager(AssetManager const&)       = delete;
+    void operator=(AssetManager const&)     = delete;
+
+    // Start the loader threads
+    void init();
+
+    // Wavefront OBJ, indices relative to the mesh's first vertex
+    // Keeping the geometry only applies to the request that starts the load
+    Handle loadMesh(const std::string& path, bool keepGeometry = false);
+
+    // Any format stb_image reads, expanded to RGBA8
+    Handle loadTexture(const std::string& path);
+
+    // Finish the assets the workers have decoded, once per frame
+    void update();
+
+    // Block until the asset is ready or has failed, finishing whatever else was decoded meanwhile
+    State wait(const Handle& handle);
+
+    // Release every asset no handle references, returns the number released
+    size_t evictUnused();
+
+    Stats getStats() const;
+    void printStats() const;
+
+    // Stop the loader threads and release every asset, the device must be idle
+    void cleanup();
+};
\ No newline at end of file
@@ -0,0 +1,478 @@
+#include "Benchmark.h"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+#include <cstdlib>
+
+namespace
+{
+    struct Results
+    {
+        Benchmark::Summary cpu;
+        Benchmark::Summary gpu;
+    };
+
+    bool endsWith(const std::string& value, const std::string& suffix)
+    {
+        return value.size() >= suffix.size() && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    // Nearest-rank percentile of sorted samples
+    double percentile(const std::vector<double>& sorted, double p)
+    {
+        size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+
+        return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+    }
+
+    void writeSummaryJson(std::ostream& out, const char* name, const Benchmark::Summary& summary)
+    {
+        out << "  \"" << name << "\": ";
+
+        if (summary.samples == 0)
+        {
+            out << "null,\n";
+            return;
+        }
+
+        out << "{ \"samples\": " << summary.samples
+            << ", \"mean\": " << summary.mean
+            << ", \"min\": " << summary.min
+            << ", \"max\": " << summary.max
+            << ", \"p50\": " << summary.p50
+            << ", \"p95\": " << summary.p95
+            << ", \"p99\": " << summary.p99
+            << ", \"stddev\": " << summary.stddev << " },\n";
+    }
+
+    // Read back a summary object written by writeSummaryJson, leaving it empty if it was null
+    Benchmark::Summary readSummaryJson(const std::string& text, const std::string& name)
+    {
+        Benchmark::Summary summary = {};
+
+        size_t start = text.find("\"" + name + "\"");
+
+        if (start == std::string::npos)
+        {
+            throw std::runtime_error("Error: Benchmark results have no " + name + " summary");
+        }
+
+        size_t open = text.find_first_not_of(" :", start + name.size() + 2);
+
+        if (open == std::string::npos || text[open] != '{')
+        {
+            return summary;
+        }
+
+        size_t close = text.find('}', open);
+        std::string object = text.substr(open, close - open);
+
+        auto readValue = [&object](const char* key)
+        {
+            size_t position = object.find("\"" + std::string(key) + "\"");
+
+            if (position == std::string::npos)
+            {
+                throw std::runtime_error("Error: Benchmark summary has no " + std::string(key));
+            }
+
+            return std::strtod(object.c_str() + object.find(':', position) + 1, nullptr);
+        };
+
+        summary.samples = static_cast<uint32_t>(readValue("samples"));
+        summary.mean = readValue("mean");
+        summary.min = readValue("min");
+        summary.max = readValue("max");
+        summary.p50 = readValue("p50");
+        summary.p95 = readValue("p95");
+        summary.p99 = readValue("p99");
+
+        return summary;
+    }
+
+    Results loadResults(const std::string& path)
+    {
+        std::ifstream file(path);
+
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Error: Failed to open benchmark results " + path);
+        }
+
+        Results results = {};
+
+        if (endsWith(path, ".csv"))
+        {
+            // Per-frame rows of frame,cpu_ms,gpu_ms - summarize them the same way the run did
+            std::vector<double> cpuSamples;
+            std::vector<double> gpuSamples;
+            std::string line;
+
+            std::getline(file, line);
+
+            while (std::getline(file, line))
+            {
+                std::stringstream row(line);
+                std::string frame, cpu, gpu;
+
+                std::getline(row, frame, ',');
+                std::getline(row, cpu, ',');
+                std::getline(row, gpu, ',');
+
+                if (!cpu.empty())
+                {
+                    cpuSamples.push_back(std::strtod(cpu.c_str(), nullptr));
+                }
+
+                if (!gpu.empty())
+                {
+                    gpuSamples.push_back(std::strtod(gpu.c_str(), nullptr));
+                }
+            }
+
+            results.cpu = Benchmark::summarize(cpuSamples);
+            results.gpu = Benchmark::summarize(gpuSamples);
+        }
+        else
+        {
+            std::stringstream buffer;
+            buffer << file.rdbuf();
+
+            results.cpu = readSummaryJson(buffer.str(), "cpu_ms");
+            results.gpu = readSummaryJson(buffer.str(), "gpu_ms");
+        }
+
+        return results;
+    }
+
+    // Print one statistic's change and report whether it regressed past the threshold
+    bool compareValue(const char* metric, const char* stat, double base, double current, double thresholdPercent)
+    {
+        double change = base > 0.0 ? (current - base) / base * 100.0 : 0.0;
+        bool regressed = change > thresholdPercent;
+
+        std::cout << "  " << std::left << std::setw(7) << metric << std::setw(5) << stat << std::right
+                  << std::setw(10) << base << std::setw(10) << current
+                  << std::setw(8) << std::showpos << change << std::noshowpos << "%"
+                  << (regressed ? "  REGRESSION" : "") << std::endl;
+
+        return !regressed;
+    }
+
+    bool compareSummary(const char* metric, const Benchmark::Summary& base, const Benchmark::Summary& current, double thresholdPercent)
+    {
+        if (base.samples == 0 || current.samples == 0)
+        {
+            std::cout << "  " << metric << " not recorded by both runs, skipped" << std::endl;
+            return true;
+        }
+
+        bool passed = true;
+
+        passed &= compareValue(metric, "mean", base.mean, current.mean, thresholdPercent);
+        passed &= compareValue(metric, "p50", base.p50, current.p50, thresholdPercent);
+        passed &= compareValue(metric, "p95", base.p95, current.p95, thresholdPercent);
+        passed &= compareValue(metric, "p99", base.p99, current.p99, thresholdPercent);
+
+        return passed;
+    }
+}
+
+Benchmark::Benchmark(const Config& config)
+    : config(config)
+{
+    cpuSamples.reserve(config.frames);
+    gpuSamples.reserve(config.frames);
+}
+
+const Benchmark::Config& Benchmark::getConfig() const
+{
+    return config;
+}
+
+uint32_t Benchmark::getFrameIndex() const
+{
+    return frameIndex;
+}
+
+float Benchmark::getTime() const
+{
+    return frameIndex * config.timestep;
+}
+
+bool Benchmark::isWarmingUp() const
+{
+    return frameIndex < config.warmupFrames;
+}
+
+bool Benchmark::isComplete() const
+{
+    return frameIndex >= config.warmupFrames + config.frames;
+}
+
+void Benchmark::addSceneInfo(const std::string& key, double value)
+{
+    sceneInfo.push_back(std::make_pair(key, value));
+}
+
+void Benchmark::setDeviceName(const std::string& name)
+{
+    deviceName = name;
+}
+
+void Benchmark::beginFrame()
+{
+    frameStart = std::chrono::high_resolution_clock::now();
+}
+
+void Benchmark::addPassTime(const std::string& pass, double gpuMs)
+{
+    if (isWarmingUp() || gpuMs < 0.0)
+    {
+        return;
+    }
+
+    for (auto& samples : passSamples)
+    {
+        if (samples.first == pass)
+        {
+            samples.second.push_back(gpuMs);
+            return;
+        }
+    }
+
+    passSamples.push_back(std::make_pair(pass, std::vector<double>(1, gpuMs)));
+}
+
+void Benchmark::endFrame(double gpuMs)
+{
+    double cpuMs = std::chrono::duration<double, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - frameStart).count();
+
+    // Warmup frames settle pipelines, caches and clocks and are not recorded
+    if (!isWarmingUp())
+    {
+        cpuSamples.push_back(cpuMs);
+
+        if (gpuMs >= 0.0)
+        {
+            gpuSamples.push_back(gpuMs);
+        }
+    }
+
+    frameIndex++;
+}
+
+void Benchmark::addLatencySamples(const std::string& stage, const std::vector<double>& samples)
+{
+    if (!samples.empty())
+    {
+        latencySamples.push_back(std::make_pair(stage, samples));
+    }
+}
+
+Benchmark::Summary Benchmark::summarize(std::vector<double> samples)
+{
+    Summary summary = {};
+
+    if (samples.empty())
+    {
+        return summary;
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    double total = 0.0;
+
+    for (double sample : samples)
+    {
+        total += sample;
+    }
+
+    summary.samples = static_cast<uint32_t>(samples.size());
+    summary.mean = total / samples.size();
+    summary.min = samples.front();
+    summary.max = samples.back();
+    summary.p50 = percentile(samples, 50.0);
+    summary.p95 = percentile(samples, 95.0);
+    summary.p99 = percentile(samples, 99.0);
+
+    double variance = 0.0;
+
+    for (double sample : samples)
+    {
+        variance += (sample - summary.mean) * (sample - summary.mean);
+    }
+
+    summary.stddev = std::sqrt(variance / samples.size());
+
+    return summary;
+}
+
+void Benchmark::printSummary() const
+{
+    Summary cpu = summarize(cpuSamples);
+    Summary gpu = summarize(gpuSamples);
+
+    std::cout << std::fixed << std::setprecision(3);
+
+    std::cout << "Benchmark: " << cpu.samples << " frames (" << config.warmupFrames << " warmup), "
+              << config.cameraPath << " camera" << std::endl;
+
+    std::cout << "  CPU ms: mean " << cpu.mean << ", p50 " << cpu.p50 << ", p95 " << cpu.p95
+              << ", p99 " << cpu.p99 << ", max " << cpu.max << ", stddev " << cpu.stddev << std::endl;
+
+    if (gpu.samples > 0)
+    {
+        std::cout << "  GPU ms: mean " << gpu.mean << ", p50 " << gpu.p50 << ", p95 " << gpu.p95
+                  << ", p99 " << gpu.p99 << ", max " << gpu.max << ", stddev " << gpu.stddev << std::endl;
+    }
+    else
+    {
+        std::cout << "  GPU ms: not available" << std::endl;
+    }
+
+    for (const auto& samples : passSamples)
+    {
+        Summary pass = summarize(samples.second);
+
+        std::cout << "  " << samples.first << " GPU ms: mean " << pass.mean << ", p50 " << pass.p50 << ", p95 " << pass.p95
+                  << ", p99 " << pass.p99 << ", max " << pass.max << ", stddev " << pass.stddev << std::endl;
+    }
+
+    for (const auto& samples : latencySamples)
+    {
+        Summary latency = summarize(samples.second);
+
+        std::cout << "  Input to " << samples.first << " ms: mean " << latency.mean << ", p50 " << latency.p50 << ", p95 " << latency.p95
+                  << ", p99 " << latency.p99 << ", max " << latency.max << std::endl;
+    }
+
+    std::cout << std::defaultfloat << std::setprecision(6);
+}
+
+void Benchmark::writeResults() const
+{
+    if (config.outputPath.empty())
+    {
+        return;
+    }
+
+    if (endsWith(config.outputPath, ".csv"))
+    {
+        writeCsv(config.outputPath);
+    }
+    else
+    {
+        writeJson(config.outputPath);
+    }
+
+    std::cout << "Benchmark results written to " << config.outputPath << std::endl;
+}
+
+void Benchmark::writeJson(const std::string& path) const
+{
+    std::ofstream file(path);
+
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Error: Failed to open benchmark output " + path);
+    }
+
+    file << std::setprecision(6);
+
+    file << "{\n";
+    file << "  \"device\": \"" << deviceName << "\",\n";
+    file << "  \"config\": { \"frames\": " << config.frames << ", \"warmup\": " << config.warmupFrames
+         << ", \"timestep\": " << config.timestep << ", \"camera\": \"" << config.cameraPath << "\" },\n";
+
+    file << "  \"scene\": {";
+
+    for (size_t i = 0; i < sceneInfo.size(); i++)
+    {
+        file << (i == 0 ? " " : ", ") << "\"" << sceneInfo[i].first << "\": " << sceneInfo[i].second;
+    }
+
+    file << " },\n";
+
+    writeSummaryJson(file, "cpu_ms", summarize(cpuSamples));
+    writeSummaryJson(file, "gpu_ms", summarize(gpuSamples));
+
+    for (const auto& samples : passSamples)
+    {
+        writeSummaryJson(file, (samples.first + "_gpu_ms").c_str(), summarize(samples.second));
+    }
+
+    for (const auto& samples : latencySamples)
+    {
+        writeSummaryJson(file, ("input_to_" + samples.first + "_ms").c_str(), summarize(samples.second));
+    }
+
+    file << "  \"cpu_frames\": [";
+
+    for (size_t i = 0; i < cpuSamples.size(); i++)
+    {
+        file << (i == 0 ? "" : ", ") << cpuSamples[i];
+    }
+
+    file << "],\n";
+    file << "  \"gpu_frames\": [";
+
+    for (size_t i = 0; i < gpuSamples.size(); i++)
+    {
+        file << (i == 0 ? "" : ", ") << gpuSamples[i];
+    }
+
+    file << "]\n";
+    file << "}\n";
+}
+
+void Benchmark::writeCsv(const std::string& path) const
+{
+    std::ofstream file(path);
+
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Error: Failed to open benchmark output " + path);
+    }
+
+    file << std::setprecision(6);
+    file << "frame,cpu_ms,gpu_ms\n";
+
+    // GPU column is left empty when timestamps were not available
+    for (size_t i = 0; i < cpuSamples.size(); i++)
+    {
+        file << i << "," << cpuSamples[i] << ",";
+
+        if (i < gpuSamples.size())
+        {
+            file << gpuSamples[i];
+        }
+
+        file << "\n";
+    }
+}
+
+bool Benchmark::compare(const std::string& basePath, const std::string& newPath, double thresholdPercent)
+{
+    Results base = loadResults(basePath);
+    Results current = loadResults(newPath);
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Benchmark comparison: " << basePath << " -> " << newPath
+              << " (regression threshold " << thresholdPercent << "%)" << std::endl;
+
+    bool passed = true;
+
+    passed &= compareSummary("cpu_ms", base.cpu, current.cpu, thresholdPercent);
+    passed &= compareSummary("gpu_ms", base.gpu, current.gpu, thresholdPercent);
+
+    std::cout << std::defaultfloat << std::setprecision(6);
+    std::cout << (passed ? "No regressions" : "Regressions found") << std::endl;
+
+    return passed;
+}
\ No newline at end of file
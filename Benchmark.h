@@ -0,0 +1,95 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Fixed-timestep benchmark run - records per-frame CPU/GPU times after a warmup and writes
+// summary percentiles plus every sample as JSON or CSV (chosen by the output file extension)
+class Benchmark
+{
+public:
+
+    struct Config
+    {
+        uint32_t frames = 1000;
+        uint32_t warmupFrames = 100;
+
+        // Simulated seconds per frame, independent of how long the frame took to render
+        float timestep = 1.0f / 60.0f;
+
+        std::string cameraPath = "orbit";
+        std::string outputPath = "bench.json";
+    };
+
+    struct Summary
+    {
+        uint32_t samples;
+        double mean;
+        double min;
+        double max;
+        double p50;
+        double p95;
+        double p99;
+
+        // Frame-to-frame stability, not compared between runs
+        double stddev;
+    };
+
+    explicit Benchmark(const Config& config);
+
+    const Config& getConfig() const;
+
+    // Frames rendered so far including warmup, drives the simulated clock
+    uint32_t getFrameIndex() const;
+    float getTime() const;
+
+    bool isWarmingUp() const;
+    bool isComplete() const;
+
+    // Scene parameters copied into the results so runs of different scenes are not compared blindly
+    void addSceneInfo(const std::string& key, double value);
+    void setDeviceName(const std::string& name);
+
+    void beginFrame();
+
+    // GPU time of one pass this frame, summarized separately - negative times are skipped like the frame's
+    void addPassTime(const std::string& pass, double gpuMs);
+
+    // GPU time is negative when the device has no usable timestamps
+    void endFrame(double gpuMs);
+
+    // Input latency samples of a frame stage, taken after warmup
+    void addLatencySamples(const std::string& stage, const std::vector<double>& samples);
+
+    static Summary summarize(std::vector<double> samples);
+
+    void printSummary() const;
+    void writeResults() const;
+
+    // Compare two result files, printing the change of each statistic
+    // Returns false if any statistic of the new run is slower than the base by more than thresholdPercent
+    static bool compare(const std::string& basePath, const std::string& newPath, double thresholdPercent);
+
+private:
+
+    Config config;
+
+    uint32_t frameIndex = 0;
+    std::chrono::high_resolution_clock::time_point frameStart;
+
+    std::vector<double> cpuSamples;
+    std::vector<double> gpuSamples;
+
+    // Samples of each pass in the order the passes were first added
+    std::vector<std::pair<std::string, std::vector<double>>> passSamples;
+    std::vector<std::pair<std::string, std::vector<double>>> latencySamples;
+
+    std::vector<std::pair<std::string, double>> sceneInfo;
+    std::string deviceName;
+
+    void writeJson(const std::string& path) const;
+    void writeCsv(const std::string& path) const;
+};
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include "CameraPath.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+namespace
+{
+    // Uniform Catmull-Rom segment between p1 and p2
+    glm::vec3 catmullRom(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, float t)
+    {
+        float t2 = t * t;
+        float t3 = t2 * t;
+
+        return 0.5f * ((2.0f * p1) +
+                       (p2 - p0) * t +
+                       (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 +
+                       (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+    }
+}
+
+CameraPath CameraPath::orbit(float radius, float height, float period)
+{
+    CameraPath path;
+
+    // Eight keys per revolution keep the spline within a fraction of a percent of the circle
+    const uint32_t keyCount = 8;
+
+    for (uint32_t i = 0; i < keyCount; i++)
+    {
+        float angle = 2.0f * glm::pi<float>() * i / keyCount;
+        glm::vec3 eye(radius * std::cos(angle), height, radius * std::sin(angle));
+
+        path.addKeyframe(period * i / keyCount, eye, glm::vec3(0.0f));
+    }
+
+    path.duration = period;
+
+    return path;
+}
+
+CameraPath CameraPath::flythrough(float period)
+{
+    CameraPath path;
+
+    path.addKeyframe(0.00f * period, glm::vec3(0.0f, 1.0f, 12.0f), glm::vec3(0.0f));
+    path.addKeyframe(0.20f * period, glm::vec3(3.0f, 0.5f, 4.0f), glm::vec3(0.0f));
+    path.addKeyframe(0.40f * period, glm::vec3(-2.0f, -1.5f, 3.5f), glm::vec3(0.0f, -1.0f, 0.0f));
+    path.addKeyframe(0.60f * period, glm::vec3(-20.0f, 8.0f, 0.0f), glm::vec3(0.0f));
+    path.addKeyframe(0.80f * period, glm::vec3(0.0f, 25.0f, -6.0f), glm::vec3(0.0f, -3.0f, 0.0f));
+
+    path.duration = period;
+
+    return path;
+}
+
+CameraPath CameraPath::fromName(const std::string& name, float period)
+{
+    if (name == "orbit")
+    {
+        return orbit(12.0f, 4.0f, period);
+    }
+    else if (name == "flythrough")
+    {
+        return flythrough(period);
+    }
+
+    throw std::runtime_error("Error: Unknown camera path " + name);
+}
+
+void CameraPath::addKeyframe(float time, glm::vec3 eye, glm::vec3 target)
+{
+    Keyframe keyframe = { time, eye, target };
+
+    auto it = std::upper_bound(keyframes.begin(), keyframes.end(), time, [](float t, const Keyframe& k)
+    {
+        return t < k.time;
+    });
+
+    keyframes.insert(it, keyframe);
+
+    duration = std::max(duration, time);
+}
+
+float CameraPath::getDuration() const
+{
+    return duration;
+}
+
+glm::mat4 CameraPath::getViewMatrix(float time) const
+{
+    if (keyframes.empty())
+    {
+        throw std::runtime_error("Error: Camera path has no keyframes");
+    }
+
+    size_t count = keyframes.size();
+
+    if (count == 1 || duration <= 0.0f)
+    {
+        return glm::lookAt(keyframes[0].eye, keyframes[0].target, glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+
+    // Loop the timeline, the segment after the last key runs back to the first
+    float t = std::fmod(time, duration);
+
+    if (t < 0.0f)
+    {
+        t += duration;
+    }
+
+    size_t segment = 0;
+
+    while (segment + 1 < count && keyframes[segment + 1].time <= t)
+    {
+        segment++;
+    }
+
+    const Keyframe& k1 = keyframes[segment];
+    const Keyframe& k2 = keyframes[(segment + 1) % count];
+    const Keyframe& k0 = keyframes[(segment + count - 1) % count];
+    const Keyframe& k3 = keyframes[(segment + 2) % count];
+
+    float segmentEnd = segment + 1 < count ? k2.time : duration + keyframes[0].time;
+    float segmentLength = segmentEnd - k1.time;
+    float s = segmentLength > 0.0f ? (t - k1.time) / segmentLength : 0.0f;
+
+    glm::vec3 eye = catmullRom(k0.eye, k1.eye, k2.eye, k3.eye, s);
+    glm::vec3 target = catmullRom(k0.target, k1.target, k2.target, k3.target, s);
+
+    return glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f));
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+// Deterministic camera timeline for benchmark replays
+// Keyframes are interpolated with a looping Catmull-Rom spline, so a given time always yields the same view
+class CameraPath
+{
+public:
+
+    struct Keyframe
+    {
+        float time;
+        glm::vec3 eye;
+        glm::vec3 target;
+    };
+
+    // Circle the origin once per period at a fixed radius and height
+    static CameraPath orbit(float radius, float height, float period);
+
+    // Sweep in close to the scene, out wide and back over the top
+    static CameraPath flythrough(float period);
+
+    // Built-in path by name ("orbit" or "flythrough")
+    static CameraPath fromName(const std::string& name, float period);
+
+    void addKeyframe(float time, glm::vec3 eye, glm::vec3 target);
+
+    float getDuration() const;
+
+    glm::mat4 getViewMatrix(float time) const;
+
+private:
+
+    // Keyframes sorted by time, the last one wraps back to the first
+    std::vector<Keyframe> keyframes;
+    float duration = 0.0f;
+};
\ No newline at end of file
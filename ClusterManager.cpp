@@ -0,0 +1,384 @@
+#include "ClusterManager.h"
+
+#include <iostream>
+#include <cstring>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+ClusterManager& ClusterManager::instance()
+{
+    static ClusterManager instance;
+
+    return instance;
+}
+
+void ClusterManager::init(uint32_t frameCount)
+{
+    this->frameCount = frameCount;
+}
+
+void ClusterManager::createStreams()
+{
+    VkDevice device = DeviceManager::instance().getDevice();
+
+    VkDeviceSize indexBytes = std::max<VkDeviceSize>(usedIndexBytes, 4);
+    VkDeviceSize commandBytes = std::max<size_t>(instances.size(), 1) * sizeof(VkDrawIndexedIndirectCommand);
+
+    frames.resize(frameCount);
+
+    // Written by the CPU every frame, so keep the streams host-visible and coherent
+    for (FrameSlot& frame : frames)
+    {
+        Utils::createBuffer(indexBytes, VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                            frame.indexBuffer, frame.indexMemory);
+
+        Utils::createBuffer(commandBytes, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                            frame.indirectBuffer, frame.indirectMemory);
+
+        void* data;
+        vkMapMemory(device, frame.indexMemory, 0, indexBytes, 0, &data);
+        frame.indexData = static_cast<uint8_t*>(data);
+
+        vkMapMemory(device, frame.indirectMemory, 0, commandBytes, 0, &data);
+        frame.commands = static_cast<VkDrawIndexedIndirectCommand*>(data);
+
+        memset(frame.commands, 0, commandBytes);
+    }
+}
+
+ClusterMeshHandle ClusterManager::addMesh(MeshHandle mesh, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+{
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    MeshletData data = MeshletBuilder::build(vertices, indices);
+
+    ClusterMesh cluster = {};
+    cluster.mesh = mesh;
+    cluster.indexType = GeometryManager::instance().getMeshRange(mesh).indexType;
+    cluster.indexSize = cluster.indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+    cluster.meshletCount = static_cast<uint32_t>(data.meshlets.size());
+    cluster.triangleCount = static_cast<uint32_t>(data.triangles.size() / 3);
+
+    VkDeviceSize regionSize = static_cast<VkDeviceSize>(cluster.triangleCount) * 3 * cluster.indexSize;
+
+    // Pad to a multiple of four so the SIMD test never reads past the end
+    size_t paddedCount = (data.meshlets.size() + 3) & ~static_cast<size_t>(3);
+
+    for (std::vector<float>* lane : { &cluster.centerX, &cluster.centerY, &cluster.centerZ, &cluster.radius,
+                                      &cluster.axisX, &cluster.axisY, &cluster.axisZ, &cluster.cutoff })
+    {
+        lane->assign(paddedCount, 0.0f);
+    }
+
+    cluster.indexData.reserve(regionSize);
+    cluster.indexDataOffsets.reserve(data.meshlets.size() + 1);
+
+    for (size_t i = 0; i < data.meshlets.size(); i++)
+    {
+        const Meshlet& meshlet = data.meshlets[i];
+        const MeshletBounds& bounds = data.bounds[i];
+
+        cluster.centerX[i] = bounds.center.x;
+        cluster.centerY[i] = bounds.center.y;
+        cluster.centerZ[i] = bounds.center.z;
+        cluster.radius[i] = bounds.radius;
+        cluster.axisX[i] = bounds.coneAxis.x;
+        cluster.axisY[i] = bounds.coneAxis.y;
+        cluster.axisZ[i] = bounds.coneAxis.z;
+        cluster.cutoff[i] = bounds.coneCutoff;
+
+        cluster.indexDataOffsets.push_back(static_cast<uint32_t>(cluster.indexData.size()));
+
+        for (uint32_t j = 0; j < meshlet.triangleCount * 3; j++)
+        {
+            uint32_t index = data.vertices[meshlet.vertexOffset + data.triangles[meshlet.triangleOffset * 3 + j]];
+
+            if (cluster.indexType == VK_INDEX_TYPE_UINT16)
+            {
+                uint16_t narrowIndex = static_cast<uint16_t>(index);
+                cluster.indexData.insert(cluster.indexData.end(), reinterpret_cast<uint8_t*>(&narrowIndex), reinterpret_cast<uint8_t*>(&narrowIndex) + sizeof(narrowIndex));
+            }
+            else
+            {
+                cluster.indexData.insert(cluster.indexData.end(), reinterpret_cast<uint8_t*>(&index), reinterpret_cast<uint8_t*>(&index) + sizeof(index));
+            }
+        }
+    }
+
+    cluster.indexDataOffsets.push_back(static_cast<uint32_t>(cluster.indexData.size()));
+
+    stats.meshes++;
+    stats.meshlets += cluster.meshletCount;
+    stats.buildMilliseconds += std::chrono::duration<double, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+    meshes.push_back(cluster);
+
+    return static_cast<ClusterMeshHandle>(meshes.size() - 1);
+}
+
+ClusterHandle ClusterManager::addInstance(ClusterMeshHandle mesh)
+{
+    if (!frames.empty())
+    {
+        throw std::runtime_error("Error: Cluster instances must be added before the streams are created");
+    }
+
+    const ClusterMesh& clusterMesh = meshes.at(mesh);
+
+    // Reserve the worst case (nothing culled) in every frame slot, keeping offsets index-aligned
+    ClusterInstance instance = {};
+    instance.mesh = mesh;
+    instance.outputOffset = (usedIndexBytes + 3) & ~static_cast<VkDeviceSize>(3);
+
+    usedIndexBytes = instance.outputOffset + clusterMesh.indexData.size();
+
+    stats.instances++;
+    instances.push_back(instance);
+
+    return static_cast<ClusterHandle>(instances.size() - 1);
+}
+
+void ClusterManager::cullMeshlets(const ClusterMesh& mesh, const glm::vec4 planes[6], const glm::vec3& cameraPos)
+{
+    visible.resize(mesh.centerX.size());
+
+    uint32_t frustumCulled = 0;
+    uint32_t backfaceCulled = 0;
+
+#if defined(__SSE2__)
+    const __m128 zero = _mm_setzero_ps();
+
+    for (size_t i = 0; i < mesh.centerX.size(); i += 4)
+    {
+        __m128 cx = _mm_loadu_ps(&mesh.centerX[i]);
+        __m128 cy = _mm_loadu_ps(&mesh.centerY[i]);
+        __m128 cz = _mm_loadu_ps(&mesh.centerZ[i]);
+        __m128 r = _mm_loadu_ps(&mesh.radius[i]);
+        __m128 negR = _mm_sub_ps(zero, r);
+
+        // Sphere against each frustum plane
+        __m128 inside = _mm_cmpeq_ps(zero, zero);
+
+        for (int p = 0; p < 6; p++)
+        {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[p].x), cx), _mm_mul_ps(_mm_set1_ps(planes[p].y), cy)),
+                                         _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[p].z), cz), _mm_set1_ps(planes[p].w)));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negR));
+        }
+
+        // Normal cone against the view direction
+        __m128 dx = _mm_sub_ps(cx, _mm_set1_ps(cameraPos.x));
+        __m128 dy = _mm_sub_ps(cy, _mm_set1_ps(cameraPos.y));
+        __m128 dz = _mm_sub_ps(cz, _mm_set1_ps(cameraPos.z));
+
+        __m128 coneDot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, _mm_loadu_ps(&mesh.axisX[i])), _mm_mul_ps(dy, _mm_loadu_ps(&mesh.axisY[i]))),
+                                    _mm_mul_ps(dz, _mm_loadu_ps(&mesh.axisZ[i])));
+        __m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+        __m128 backfacing = _mm_cmpge_ps(coneDot, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&mesh.cutoff[i]), distance), r));
+
+        int insideMask = _mm_movemask_ps(inside);
+        int backfacingMask = _mm_movemask_ps(backfacing);
+
+        for (int k = 0; k < 4; k++)
+        {
+            bool frustumVisible = (insideMask >> k) & 1;
+            bool frontFacing = !((backfacingMask >> k) & 1);
+
+            visible[i + k] = frustumVisible && frontFacing;
+
+            if (i + k < mesh.meshletCount)
+            {
+                frustumCulled += !frustumVisible;
+                backfaceCulled += frustumVisible && !frontFacing;
+            }
+        }
+    }
+#else
+    for (size_t i = 0; i < mesh.centerX.size(); i++)
+    {
+        glm::vec3 center(mesh.centerX[i], mesh.centerY[i], mesh.centerZ[i]);
+
+        bool frustumVisible = true;
+
+        for (int p = 0; p < 6; p++)
+        {
+            frustumVisible = frustumVisible && glm::dot(glm::vec3(planes[p]), center) + planes[p].w >= -mesh.radius[i];
+        }
+
+        glm::vec3 toCenter = center - cameraPos;
+        glm::vec3 axis(mesh.axisX[i], mesh.axisY[i], mesh.axisZ[i]);
+        bool frontFacing = glm::dot(toCenter, axis) < mesh.cutoff[i] * glm::length(toCenter) + mesh.radius[i];
+
+        visible[i] = frustumVisible && frontFacing;
+
+        if (i < mesh.meshletCount)
+        {
+            frustumCulled += !frustumVisible;
+            backfaceCulled += frustumVisible && !frontFacing;
+        }
+    }
+#endif
+
+    stats.meshletsTested += mesh.meshletCount;
+    stats.meshletsFrustumCulled += frustumCulled;
+    stats.meshletsBackfaceCulled += backfaceCulled;
+}
+
+void ClusterManager::cull(uint32_t frameIndex, ClusterHandle cluster, const glm::mat4& model, const glm::mat4& view, const glm::mat4& proj)
+{
+    const ClusterInstance& instance = instances.at(cluster);
+    const ClusterMesh& mesh = meshes[instance.mesh];
+    FrameSlot& frame = frames[frameIndex % frames.size()];
+
+    // Extract frustum planes in mesh space from the rows of the combined matrix (Vulkan 0..1 depth)
+    glm::mat4 clip = proj * view * model;
+
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++)
+    {
+        rows[i] = glm::vec4(clip[0][i], clip[1][i], clip[2][i], clip[3][i]);
+    }
+
+    glm::vec4 planes[6] = { rows[3] + rows[0], rows[3] - rows[0],
+                            rows[3] + rows[1], rows[3] - rows[1],
+                            rows[2],           rows[3] - rows[2] };
+
+    for (glm::vec4& plane : planes)
+    {
+        plane /= glm::length(glm::vec3(plane));
+    }
+
+    glm::vec3 cameraPos = glm::vec3(glm::inverse(view * model)[3]);
+
+    cullMeshlets(mesh, planes, cameraPos);
+
+    // Compact surviving meshlets, copying runs of adjacent visible meshlets at once
+    uint8_t* output = frame.indexData + instance.outputOffset;
+    uint32_t written = 0;
+
+    for (uint32_t i = 0; i < mesh.meshletCount;)
+    {
+        if (!visible[i])
+        {
+            i++;
+            continue;
+        }
+
+        uint32_t runStart = i;
+        while (i < mesh.meshletCount && visible[i])
+        {
+            i++;
+        }
+
+        uint32_t runBytes = mesh.indexDataOffsets[i] - mesh.indexDataOffsets[runStart];
+        memcpy(output + written, &mesh.indexData[mesh.indexDataOffsets[runStart]], runBytes);
+        written += runBytes;
+    }
+
+    uint32_t indexCount = written / mesh.indexSize;
+
+    // Vertex offset is refreshed every frame so the indirect commands follow defragmentation, the new buffers
+    // themselves are bound once the command buffers are re-recorded
+    VkDrawIndexedIndirectCommand& command = frame.commands[cluster];
+    command.indexCount = indexCount;
+    command.instanceCount = 1;
+    command.firstIndex = 0;
+    command.vertexOffset = GeometryManager::instance().getMeshRange(mesh.mesh).vertexOffset;
+    command.firstInstance = 0;
+
+    stats.trianglesTested += mesh.triangleCount;
+    stats.trianglesDrawn += indexCount / 3;
+}
+
+VkBuffer ClusterManager::getIndexBuffer(uint32_t frameIndex)
+{
+    return frames[frameIndex % frames.size()].indexBuffer;
+}
+
+VkDeviceSize ClusterManager::getIndexOffset(ClusterHandle cluster)
+{
+    return instances.at(cluster).outputOffset;
+}
+
+VkIndexType ClusterManager::getIndexType(ClusterHandle cluster)
+{
+    return meshes[instances.at(cluster).mesh].indexType;
+}
+
+VkBuffer ClusterManager::getIndirectBuffer(uint32_t frameIndex)
+{
+    return frames[frameIndex % frames.size()].indirectBuffer;
+}
+
+VkDeviceSize ClusterManager::getIndirectOffset(ClusterHandle cluster)
+{
+    return static_cast<VkDeviceSize>(cluster) * sizeof(VkDrawIndexedIndirectCommand);
+}
+
+ClusterManager::Stats ClusterManager::getStats()
+{
+    return stats;
+}
+
+void ClusterManager::printStats()
+{
+    double trianglesPerMs = 0.0;
+    uint64_t triangles = 0;
+
+    for (const ClusterMesh& mesh : meshes)
+    {
+        triangles += mesh.triangleCount;
+    }
+
+    if (stats.buildMilliseconds > 0.0)
+    {
+        trianglesPerMs = triangles / stats.buildMilliseconds;
+    }
+
+    std::cout << "Clusters: " << stats.meshes << " meshes (" << stats.instances << " instances), " << stats.meshlets << " meshlets built in "
+              << stats.buildMilliseconds << " ms (" << trianglesPerMs / 1000.0 << " M triangles/s)" << std::endl;
+
+    if (stats.meshletsTested > 0 && stats.trianglesTested > 0)
+    {
+        std::cout << "Cluster culling: " << 100.0 * (stats.trianglesTested - stats.trianglesDrawn) / stats.trianglesTested << "% of triangles culled ("
+                  << 100.0 * stats.meshletsFrustumCulled / stats.meshletsTested << "% meshlets off-frustum, "
+                  << 100.0 * stats.meshletsBackfaceCulled / stats.meshletsTested << "% back-facing)" << std::endl;
+    }
+}
+
+void ClusterManager::resetCullStats()
+{
+    stats.meshletsTested = 0;
+    stats.meshletsFrustumCulled = 0;
+    stats.meshletsBackfaceCulled = 0;
+    stats.trianglesTested = 0;
+    stats.trianglesDrawn = 0;
+}
+
+void ClusterManager::cleanup()
+{
+    VkDevice device = DeviceManager::instance().getDevice();
+
+    for (FrameSlot& frame : frames)
+    {
+        vkUnmapMemory(device, frame.indexMemory);
+        vkDestroyBuffer(device, frame.indexBuffer, nullptr);
+        Utils::freeTrackedMemory(frame.indexMemory);
+
+        vkUnmapMemory(device, frame.indirectMemory);
+        vkDestroyBuffer(device, frame.indirectBuffer, nullptr);
+        Utils::freeTrackedMemory(frame.indirectMemory);
+    }
+
+    frames.clear();
+    meshes.clear();
+    instances.clear();
+    usedIndexBytes = 0;
+}
\ No newline at end of file
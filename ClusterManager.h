@@ -0,0 +1,132 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "Utils.h"
+#include "MeshletBuilder.h"
+#include "GeometryManager.h"
+
+// Clusterized mesh, shared by every instance drawing it
+typedef uint32_t ClusterMeshHandle;
+
+// Culled and drawn instance of a clusterized mesh
+typedef uint32_t ClusterHandle;
+
+// Per-meshlet frustum and back-face culling on the CPU, without mesh shaders
+// Surviving triangles are compacted each frame into a host-visible index stream per frame slot,
+// drawn with one indexed indirect command per instance against the shared vertex buffer
+class ClusterManager
+{
+private:
+
+    ClusterManager() {}
+
+    struct ClusterMesh
+    {
+        MeshHandle mesh;
+        VkIndexType indexType;
+        uint32_t indexSize;
+
+        uint32_t meshletCount;
+        uint32_t triangleCount;
+
+        // Bounds as padded structure-of-arrays, four meshlets per SIMD test
+        std::vector<float> centerX, centerY, centerZ, radius;
+        std::vector<float> axisX, axisY, axisZ, cutoff;
+
+        // Per-meshlet triangles pre-expanded to mesh-local indices in the output index format
+        std::vector<uint8_t> indexData;
+        std::vector<uint32_t> indexDataOffsets;
+    };
+
+    struct ClusterInstance
+    {
+        ClusterMeshHandle mesh;
+
+        // Byte offset of this instance's region in every frame slot's index stream
+        VkDeviceSize outputOffset;
+    };
+
+    struct FrameSlot
+    {
+        VkBuffer indexBuffer;
+        VkDeviceMemory indexMemory;
+        uint8_t* indexData;
+
+        VkBuffer indirectBuffer;
+        VkDeviceMemory indirectMemory;
+        VkDrawIndexedIndirectCommand* commands;
+    };
+
+    std::vector<ClusterMesh> meshes;
+    std::vector<ClusterInstance> instances;
+    std::vector<FrameSlot> frames;
+
+    uint32_t frameCount;
+    VkDeviceSize usedIndexBytes = 0;
+
+    // Per meshlet visibility mask for the mesh being culled
+    std::vector<uint8_t> visible;
+
+    void cullMeshlets(const ClusterMesh& mesh, const glm::vec4 planes[6], const glm::vec3& cameraPos);
+
+public:
+
+    struct Stats
+    {
+        uint32_t meshes;
+        uint32_t instances;
+        uint32_t meshlets;
+        double buildMilliseconds;
+
+        uint64_t meshletsTested;
+        uint64_t meshletsFrustumCulled;
+        uint64_t meshletsBackfaceCulled;
+        uint64_t trianglesTested;
+        uint64_t trianglesDrawn;
+    };
+
+    // Return singleton instance
+    static ClusterManager& instance();
+
+    // Ensure singleton is never copied
+    ClusterManager(ClusterManager const&)   = delete;
+    void operator=(ClusterManager const&)   = delete;
+
+    void init(uint32_t frameCount);
+
+    // Clusterize a mesh already loaded into the GeometryManager (same vertices and indices)
+    ClusterMeshHandle addMesh(MeshHandle mesh, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+
+    // Reserve an output region and indirect command for one object drawing the mesh
+    ClusterHandle addInstance(ClusterMeshHandle mesh);
+
+    // Size and create the per-frame streams once every instance has been added
+    void createStreams();
+
+    // Cull an instance's meshlets and write its compacted indices and indirect command
+    // Assumes the model matrix has uniform scale
+    void cull(uint32_t frameIndex, ClusterHandle cluster, const glm::mat4& model, const glm::mat4& view, const glm::mat4& proj);
+
+    // Buffers and offsets to record against - stable for the lifetime of the manager
+    VkBuffer getIndexBuffer(uint32_t frameIndex);
+    VkDeviceSize getIndexOffset(ClusterHandle cluster);
+    VkIndexType getIndexType(ClusterHandle cluster);
+    VkBuffer getIndirectBuffer(uint32_t frameIndex);
+    VkDeviceSize getIndirectOffset(ClusterHandle cluster);
+
+    Stats getStats();
+    void printStats();
+    void resetCullStats();
+
+    void cleanup();
+
+private:
+
+    Stats stats = {};
+};
\ No newline at end of file
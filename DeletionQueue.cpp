@@ -0,0 +1,187 @@
+#include "DeletionQueue.h"
+
+#include "DeviceManager.h"
+#include "Utils.h"
+
+#include <algorithm>
+#include <limits>
+
+DeletionQueue& DeletionQueue::instance()
+{
+    static DeletionQueue instance;
+
+    return instance;
+}
+
+void DeletionQueue::enqueue(SyncTicket ticket, std::function<void()> destroy)
+{
+    Entry entry;
+    entry.ticket = ticket;
+    entry.destroy = destroy;
+
+    pending.push_back(entry);
+}
+
+void DeletionQueue::destroyBuffer(SyncTicket ticket, VkBuffer buffer, VkDeviceMemory memory)
+{
+    enqueue(ticket, [buffer, memory]()
+    {
+        VkDevice device = DeviceManager::instance().getDevice();
+
+        vkDestroyBuffer(device, buffer, nullptr);
+
+        if (memory != VK_NULL_HANDLE)
+        {
+            Utils::freeTrackedMemory(memory);
+        }
+    });
+}
+
+void DeletionQueue::destroyImage(SyncTicket ticket, VkImage image, VkImageView imageView, VkDeviceMemory memory)
+{
+    enqueue(ticket, [image, imageView, memory]()
+    {
+        VkDevice device = DeviceManager::instance().getDevice();
+
+        if (imageView != VK_NULL_HANDLE)
+        {
+            vkDestroyImageView(device, imageView, nullptr);
+        }
+
+        vkDestroyImage(device, image, nullptr);
+
+        if (memory != VK_NULL_HANDLE)
+        {
+            Utils::freeTrackedMemory(memory);
+        }
+    });
+}
+
+void DeletionQueue::destroyImageView(SyncTicket ticket, VkImageView imageView)
+{
+    enqueue(ticket, [imageView]()
+    {
+        vkDestroyImageView(DeviceManager::instance().getDevice(), imageView, nullptr);
+    });
+}
+
+void DeletionQueue::destroyFramebuffer(SyncTicket ticket, VkFramebuffer framebuffer)
+{
+    enqueue(ticket, [framebuffer]()
+    {
+        vkDestroyFramebuffer(DeviceManager::instance().getDevice(), framebuffer, nullptr);
+    });
+}
+
+void DeletionQueue::destroyPipeline(SyncTicket ticket, VkPipeline pipeline)
+{
+    enqueue(ticket, [pipeline]()
+    {
+        vkDestroyPipeline(DeviceManager::instance().getDevice(), pipeline, nullptr);
+    });
+}
+
+void DeletionQueue::destroyPipelineLayout(SyncTicket ticket, VkPipelineLayout pipelineLayout)
+{
+    enqueue(ticket, [pipelineLayout]()
+    {
+        vkDestroyPipelineLayout(DeviceManager::instance().getDevice(), pipelineLayout, nullptr);
+    });
+}
+
+void DeletionQueue::destroyRenderPass(SyncTicket ticket, VkRenderPass renderPass)
+{
+    enqueue(ticket, [renderPass]()
+    {
+        vkDestroyRenderPass(DeviceManager::instance().getDevice(), renderPass, nullptr);
+    });
+}
+
+void DeletionQueue::destroyDescriptorPool(SyncTicket ticket, VkDescriptorPool descriptorPool)
+{
+    enqueue(ticket, [descriptorPool]()
+    {
+        vkDestroyDescriptorPool(DeviceManager::instance().getDevice(), descriptorPool, nullptr);
+    });
+}
+
+void DeletionQueue::destroySwapchain(SyncTicket ticket, VkSwapchainKHR swapchain)
+{
+    enqueue(ticket, [swapchain]()
+    {
+        vkDestroySwapchainKHR(DeviceManager::instance().getDevice(), swapchain, nullptr);
+    });
+}
+
+void DeletionQueue::freeCommandBuffers(SyncTicket ticket, VkCommandPool commandPool, const std::vector<VkCommandBuffer>& commandBuffers)
+{
+    if (commandBuffers.empty())
+    {
+        return;
+    }
+
+    enqueue(ticket, [commandPool, commandBuffers]()
+    {
+        vkFreeCommandBuffers(DeviceManager::instance().getDevice(), commandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
+    });
+}
+
+size_t DeletionQueue::collect(SyncTicket completedTicket)
+{
+    // Tickets can be queued out of order, so a later entry may be ready while an earlier one is not
+    std::deque<Entry> remaining;
+    size_t count = 0;
+
+    for (Entry& entry : pending)
+    {
+        if (entry.ticket <= completedTicket)
+        {
+            entry.destroy();
+            count++;
+        }
+        else
+        {
+            remaining.push_back(entry);
+        }
+    }
+
+    pending.swap(remaining);
+    released += count;
+
+    return count;
+}
+
+size_t DeletionQueue::collect()
+{
+    if (pending.empty())
+    {
+        return 0;
+    }
+
+    return collect(SyncManager::instance().getCompletedTicket());
+}
+
+void DeletionQueue::flush()
+{
+    SyncTicket newest = 0;
+
+    for (const Entry& entry : pending)
+    {
+        newest = std::max(newest, entry.ticket);
+    }
+
+    SyncManager::instance().wait(newest);
+
+    // Tickets past the last submission never complete, and after the wait nothing is left to use them
+    collect(std::numeric_limits<SyncTicket>::max());
+}
+
+size_t DeletionQueue::getPendingCount()
+{
+    return pending.size();
+}
+
+uint64_t DeletionQueue::getReleasedCount()
+{
+    return released;
+}
\ No newline at end of file
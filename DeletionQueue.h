@@ -0,0 +1,69 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+
+#include <GLFW/glfw3.h>
+
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include "SyncManager.h"
+
+// Deferred destruction of GPU objects
+// Objects are handed over with the ticket of the last submission that may use them and destroyed once the
+// GPU has passed it, so replacing a resource at runtime never needs the device to go idle. Entries whose
+// tickets have completed are released in the order they were queued. Main thread only.
+class DeletionQueue
+{
+private:
+
+    DeletionQueue() {}
+
+    struct Entry
+    {
+        SyncTicket ticket;
+        std::function<void()> destroy;
+    };
+
+    std::deque<Entry> pending;
+
+    uint64_t released = 0;
+
+public:
+
+    // Return singleton instance
+    static DeletionQueue& instance();
+
+    // Ensure singleton is never copied
+    DeletionQueue(DeletionQueue const&)     = delete;
+    void operator=(DeletionQueue const&)    = delete;
+
+    // Run destroy once every submission up to the ticket has completed
+    void enqueue(SyncTicket ticket, std::function<void()> destroy);
+
+    // Memory may be VK_NULL_HANDLE for objects that share an allocation
+    void destroyBuffer(SyncTicket ticket, VkBuffer buffer, VkDeviceMemory memory);
+    void destroyImage(SyncTicket ticket, VkImage image, VkImageView imageView, VkDeviceMemory memory);
+    void destroyImageView(SyncTicket ticket, VkImageView imageView);
+    void destroyFramebuffer(SyncTicket ticket, VkFramebuffer framebuffer);
+    void destroyPipeline(SyncTicket ticket, VkPipeline pipeline);
+    void destroyPipelineLayout(SyncTicket ticket, VkPipelineLayout pipelineLayout);
+    void destroyRenderPass(SyncTicket ticket, VkRenderPass renderPass);
+    void destroyDescriptorPool(SyncTicket ticket, VkDescriptorPool descriptorPool);
+    void destroySwapchain(SyncTicket ticket, VkSwapchainKHR swapchain);
+    void freeCommandBuffers(SyncTicket ticket, VkCommandPool commandPool, const std::vector<VkCommandBuffer>& commandBuffers);
+
+    // Release everything at or below the completed ticket, returns the number of entries released
+    // Taking the ticket keeps the ordering independent of the device
+    size_t collect(SyncTicket completedTicket);
+
+    // Release everything the GPU has finished with, without waiting
+    size_t collect();
+
+    // Wait for every queued ticket and release everything, for shutdown
+    void flush();
+
+    size_t getPendingCount();
+    uint64_t getReleasedCount();
+};
\ No newline at end of file
@@ -0,0 +1,218 @@
+#include "DescriptorCache.h"
+
+#include <algorithm>
+
+namespace
+{
+    template<typename T>
+    void hashCombine(size_t& seed, const T& value)
+    {
+        seed ^= std::hash<T>()(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    }
+
+    bool isImageDescriptor(VkDescriptorType type)
+    {
+        return type == VK_DESCRIPTOR_TYPE_SAMPLER ||
+               type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ||
+               type == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE ||
+               type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE ||
+               type == VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+    }
+}
+
+DescriptorLayoutKey DescriptorLayoutKey::fromBindings(const VkDescriptorSetLayoutBinding* bindings, uint32_t bindingCount)
+{
+    DescriptorLayoutKey key;
+    key.bindings.assign(bindings, bindings + bindingCount);
+
+    // Binding order in the create info is irrelevant, so normalise it
+    std::sort(key.bindings.begin(), key.bindings.end(), [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b)
+    {
+        return a.binding < b.binding;
+    });
+
+    return key;
+}
+
+size_t DescriptorLayoutKey::hash() const
+{
+    size_t seed = bindings.size();
+
+    for (const auto& binding : bindings)
+    {
+        hashCombine(seed, binding.binding);
+        hashCombine(seed, static_cast<uint32_t>(binding.descriptorType));
+        hashCombine(seed, binding.descriptorCount);
+        hashCombine(seed, static_cast<uint32_t>(binding.stageFlags));
+        hashCombine(seed, (uint64_t) binding.pImmutableSamplers);
+    }
+
+    return seed;
+}
+
+bool DescriptorLayoutKey::operator==(const DescriptorLayoutKey& other) const
+{
+    if (bindings.size() != other.bindings.size())
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < bindings.size(); i++)
+    {
+        const VkDescriptorSetLayoutBinding& a = bindings[i];
+        const VkDescriptorSetLayoutBinding& b = other.bindings[i];
+
+        if (a.binding != b.binding || a.descriptorType != b.descriptorType || a.descriptorCount != b.descriptorCount ||
+            a.stageFlags != b.stageFlags || a.pImmutableSamplers != b.pImmutableSamplers)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+DescriptorSetKey DescriptorSetKey::fromWrites(VkDescriptorSetLayout layout, const VkWriteDescriptorSet* writes, uint32_t writeCount)
+{
+    DescriptorSetKey key;
+    key.layout = layout;
+
+    // Expand array writes into one entry per descriptor
+    for (uint32_t i = 0; i < writeCount; i++)
+    {
+        const VkWriteDescriptorSet& write = writes[i];
+
+        for (uint32_t j = 0; j < write.descriptorCount; j++)
+        {
+            Write entry = {};
+            entry.binding = write.dstBinding;
+            entry.arrayElement = write.dstArrayElement + j;
+            entry.type = write.descriptorType;
+
+            if (isImageDescriptor(write.descriptorType))
+            {
+                entry.imageInfo = write.pImageInfo[j];
+            }
+            else if (write.pBufferInfo != nullptr)
+            {
+                entry.bufferInfo = write.pBufferInfo[j];
+            }
+
+            key.writes.push_back(entry);
+        }
+    }
+
+    std::sort(key.writes.begin(), key.writes.end(), [](const Write& a, const Write& b)
+    {
+        return a.binding != b.binding ? a.binding < b.binding : a.arrayElement < b.arrayElement;
+    });
+
+    return key;
+}
+
+size_t DescriptorSetKey::hash() const
+{
+    size_t seed = std::hash<uint64_t>()((uint64_t) layout);
+
+    for (const auto& write : writes)
+    {
+        hashCombine(seed, write.binding);
+        hashCombine(seed, write.arrayElement);
+        hashCombine(seed, static_cast<uint32_t>(write.type));
+        hashCombine(seed, (uint64_t) write.bufferInfo.buffer);
+        hashCombine(seed, static_cast<uint64_t>(write.bufferInfo.offset));
+        hashCombine(seed, static_cast<uint64_t>(write.bufferInfo.range));
+        hashCombine(seed, (uint64_t) write.imageInfo.sampler);
+        hashCombine(seed, (uint64_t) write.imageInfo.imageView);
+        hashCombine(seed, static_cast<uint32_t>(write.imageInfo.imageLayout));
+    }
+
+    return seed;
+}
+
+bool DescriptorSetKey::operator==(const DescriptorSetKey& other) const
+{
+    if (layout != other.layout || writes.size() != other.writes.size())
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < writes.size(); i++)
+    {
+        const Write& a = writes[i];
+        const Write& b = other.writes[i];
+
+        if (a.binding != b.binding || a.arrayElement != b.arrayElement || a.type != b.type ||
+            a.bufferInfo.buffer != b.bufferInfo.buffer || a.bufferInfo.offset != b.bufferInfo.offset || a.bufferInfo.range != b.bufferInfo.range ||
+            a.imageInfo.sampler != b.imageInfo.sampler || a.imageInfo.imageView != b.imageInfo.imageView || a.imageInfo.imageLayout != b.imageInfo.imageLayout)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+DescriptorLayoutCache::DescriptorLayoutCache(CreateFunc createFunc, DestroyFunc destroyFunc)
+    : createFunc(createFunc), destroyFunc(destroyFunc)
+{
+}
+
+VkDescriptorSetLayout DescriptorLayoutCache::getLayout(const VkDescriptorSetLayoutBinding* bindings, uint32_t bindingCount)
+{
+    DescriptorLayoutKey key = DescriptorLayoutKey::fromBindings(bindings, bindingCount);
+
+    stats.requests++;
+
+    auto it = layouts.find(key);
+    if (it != layouts.end())
+    {
+        stats.hits++;
+        return it->second;
+    }
+
+    VkDescriptorSetLayout layout = createFunc(key);
+    layouts[key] = layout;
+
+    return layout;
+}
+
+void DescriptorLayoutCache::cleanup()
+{
+    for (const auto& entry : layouts)
+    {
+        destroyFunc(entry.second);
+    }
+
+    layouts.clear();
+}
+
+DescriptorSetCache::DescriptorSetCache(AllocateFunc allocateFunc, UpdateFunc updateFunc)
+    : allocateFunc(allocateFunc), updateFunc(updateFunc)
+{
+}
+
+VkDescriptorSet DescriptorSetCache::getSet(VkDescriptorSetLayout layout, const VkWriteDescriptorSet* writes, uint32_t writeCount)
+{
+    DescriptorSetKey key = DescriptorSetKey::fromWrites(layout, writes, writeCount);
+
+    stats.requests++;
+
+    auto it = sets.find(key);
+    if (it != sets.end())
+    {
+        stats.hits++;
+        return it->second;
+    }
+
+    VkDescriptorSet set = allocateFunc(layout);
+    updateFunc(set, writes, writeCount);
+    sets[key] = set;
+
+    return set;
+}
+
+void DescriptorSetCache::clear()
+{
+    sets.clear();
+}
\ No newline at end of file
@@ -0,0 +1,125 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <cstdint>
+
+// Hit/miss counters shared by the layout and set caches
+struct DescriptorCacheStats
+{
+    uint64_t requests = 0;
+    uint64_t hits = 0;
+
+    double hitRate() const
+    {
+        return requests > 0 ? static_cast<double>(hits) / static_cast<double>(requests) : 0.0;
+    }
+};
+
+// Cache key describing a descriptor set layout by its bindings (sorted by binding number)
+class DescriptorLayoutKey
+{
+public:
+
+    std::vector<VkDescriptorSetLayoutBinding> bindings;
+
+    static DescriptorLayoutKey fromBindings(const VkDescriptorSetLayoutBinding* bindings, uint32_t bindingCount);
+
+    size_t hash() const;
+    bool operator==(const DescriptorLayoutKey& other) const;
+};
+
+// Cache key describing a fully written descriptor set: its layout plus every write
+// The destination set of each write is ignored so identical contents map to one set
+class DescriptorSetKey
+{
+public:
+
+    struct Write
+    {
+        uint32_t binding;
+        uint32_t arrayElement;
+        VkDescriptorType type;
+
+        // Either buffer or image info is populated depending on descriptor type
+        VkDescriptorBufferInfo bufferInfo;
+        VkDescriptorImageInfo imageInfo;
+    };
+
+    VkDescriptorSetLayout layout;
+    std::vector<Write> writes;
+
+    static DescriptorSetKey fromWrites(VkDescriptorSetLayout layout, const VkWriteDescriptorSet* writes, uint32_t writeCount);
+
+    size_t hash() const;
+    bool operator==(const DescriptorSetKey& other) const;
+};
+
+struct DescriptorKeyHash
+{
+    template<typename Key>
+    size_t operator()(const Key& key) const
+    {
+        return key.hash();
+    }
+};
+
+// Deduplicates descriptor set layouts with identical bindings
+// Layout creation is injected so the cache can be exercised without a device
+class DescriptorLayoutCache
+{
+public:
+
+    typedef std::function<VkDescriptorSetLayout(const DescriptorLayoutKey&)> CreateFunc;
+    typedef std::function<void(VkDescriptorSetLayout)> DestroyFunc;
+
+    DescriptorLayoutCache(CreateFunc createFunc, DestroyFunc destroyFunc);
+
+    VkDescriptorSetLayout getLayout(const VkDescriptorSetLayoutBinding* bindings, uint32_t bindingCount);
+
+    const DescriptorCacheStats& getStats() const { return stats; }
+    size_t size() const { return layouts.size(); }
+
+    void cleanup();
+
+private:
+
+    CreateFunc createFunc;
+    DestroyFunc destroyFunc;
+
+    std::unordered_map<DescriptorLayoutKey, VkDescriptorSetLayout, DescriptorKeyHash> layouts;
+    DescriptorCacheStats stats;
+};
+
+// Deduplicates immutable descriptor sets with identical layout and contents
+// Allocation and writing are injected so the cache can be exercised without a device
+class DescriptorSetCache
+{
+public:
+
+    typedef std::function<VkDescriptorSet(VkDescriptorSetLayout)> AllocateFunc;
+    typedef std::function<void(VkDescriptorSet, const VkWriteDescriptorSet*, uint32_t)> UpdateFunc;
+
+    DescriptorSetCache(AllocateFunc allocateFunc, UpdateFunc updateFunc);
+
+    VkDescriptorSet getSet(VkDescriptorSetLayout layout, const VkWriteDescriptorSet* writes, uint32_t writeCount);
+
+    const DescriptorCacheStats& getStats() const { return stats; }
+    size_t size() const { return sets.size(); }
+
+    // Sets are owned by their pools, so clearing only forgets them
+    void clear();
+
+private:
+
+    AllocateFunc allocateFunc;
+    UpdateFunc updateFunc;
+
+    std::unordered_map<DescriptorSetKey, VkDescriptorSet, DescriptorKeyHash> sets;
+    DescriptorCacheStats stats;
+};
\ No newline at end of file
@@ -0,0 +1,260 @@
+#include "DescriptorManager.h"
+
+#include <iostream>
+#include <algorithm>
+
+namespace
+{
+    // Expected descriptors per set, matching the engine's material layouts
+    const DescriptorAllocator::PoolRatio poolRatios[] =
+    {
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f },
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.0f },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.0f },
+        { VK_DESCRIPTOR_TYPE_SAMPLER, 1.0f },
+        { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 4.0f },
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.0f }
+    };
+
+    const uint32_t initialSetsPerPool = 16;
+    const uint32_t maxSetsPerPool = 1024;
+}
+
+DescriptorAllocator::PoolFuncs DescriptorAllocator::vulkanPoolFuncs()
+{
+    PoolFuncs poolFuncs;
+
+    poolFuncs.create = [](uint32_t setCount)
+    {
+        std::vector<VkDescriptorPoolSize> poolSizes;
+
+        for (const auto& poolRatio : poolRatios)
+        {
+            VkDescriptorPoolSize poolSize = {};
+            poolSize.type = poolRatio.type;
+            poolSize.descriptorCount = static_cast<uint32_t>(poolRatio.ratio * setCount);
+            poolSizes.push_back(poolSize);
+        }
+
+        VkDescriptorPoolCreateInfo poolInfo = {};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+        poolInfo.pPoolSizes = poolSizes.data();
+        poolInfo.maxSets = setCount;
+
+        VkDescriptorPool pool;
+
+        if (vkCreateDescriptorPool(DeviceManager::instance().getDevice(), &poolInfo, nullptr, &pool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Error: Failed to create descriptor pool");
+        }
+
+        return pool;
+    };
+
+    poolFuncs.allocate = [](VkDescriptorPool pool, VkDescriptorSetLayout layout, VkDescriptorSet& descriptorSet)
+    {
+        VkDescriptorSetAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = pool;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &layout;
+
+        return vkAllocateDescriptorSets(DeviceManager::instance().getDevice(), &allocInfo, &descriptorSet) == VK_SUCCESS;
+    };
+
+    poolFuncs.reset = [](VkDescriptorPool pool)
+    {
+        vkResetDescriptorPool(DeviceManager::instance().getDevice(), pool, 0);
+    };
+
+    poolFuncs.destroy = [](VkDescriptorPool pool)
+    {
+        vkDestroyDescriptorPool(DeviceManager::instance().getDevice(), pool, nullptr);
+    };
+
+    return poolFuncs;
+}
+
+void DescriptorAllocator::init(uint32_t initialSetsPerPool, uint32_t maxSetsPerPool, const PoolFuncs& poolFuncs)
+{
+    this->setsPerPool = initialSetsPerPool;
+    this->maxSetsPerPool = maxSetsPerPool;
+    this->poolFuncs = poolFuncs;
+}
+
+VkDescriptorPool DescriptorAllocator::grabPool()
+{
+    // Reuse a previously reset pool before creating a new one
+    if (!freePools.empty())
+    {
+        VkDescriptorPool pool = freePools.back();
+        freePools.pop_back();
+        return pool;
+    }
+
+    VkDescriptorPool pool = poolFuncs.create(setsPerPool);
+    poolsCreated++;
+
+    // Grow geometrically so long chains stay short
+    setsPerPool = std::min(setsPerPool * 2, maxSetsPerPool);
+
+    return pool;
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout)
+{
+    if (currentPool == VK_NULL_HANDLE)
+    {
+        currentPool = grabPool();
+        usedPools.push_back(currentPool);
+    }
+
+    VkDescriptorSet descriptorSet;
+
+    // Pool exhausted (out of pool memory or fragmented) - chain a fresh pool and retry once
+    if (!poolFuncs.allocate(currentPool, layout, descriptorSet))
+    {
+        currentPool = grabPool();
+        usedPools.push_back(currentPool);
+
+        if (!poolFuncs.allocate(currentPool, layout, descriptorSet))
+        {
+            throw std::runtime_error("Error: Failed to allocate descriptor set");
+        }
+    }
+
+    setsAllocated++;
+
+    return descriptorSet;
+}
+
+void DescriptorAllocator::reset()
+{
+    for (auto pool : usedPools)
+    {
+        poolFuncs.reset(pool);
+        freePools.push_back(pool);
+        poolResets++;
+    }
+
+    usedPools.clear();
+    currentPool = VK_NULL_HANDLE;
+}
+
+void DescriptorAllocator::cleanup()
+{
+    for (auto pool : usedPools)
+    {
+        poolFuncs.destroy(pool);
+    }
+
+    for (auto pool : freePools)
+    {
+        poolFuncs.destroy(pool);
+    }
+
+    usedPools.clear();
+    freePools.clear();
+    currentPool = VK_NULL_HANDLE;
+}
+
+DescriptorManager::DescriptorManager()
+    : layoutCache(
+        [](const DescriptorLayoutKey& key)
+        {
+            VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+            layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+            layoutInfo.bindingCount = static_cast<uint32_t>(key.bindings.size());
+            layoutInfo.pBindings = key.bindings.data();
+
+            VkDescriptorSetLayout layout;
+
+            if (vkCreateDescriptorSetLayout(DeviceManager::instance().getDevice(), &layoutInfo, nullptr, &layout) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Error: Failed to create descriptor set layout");
+            }
+
+            return layout;
+        },
+        [](VkDescriptorSetLayout layout)
+        {
+            vkDestroyDescriptorSetLayout(DeviceManager::instance().getDevice(), layout, nullptr);
+        }),
+      setCache(
+        [this](VkDescriptorSetLayout layout)
+        {
+            return persistentAllocator.allocate(layout);
+        },
+        [](VkDescriptorSet descriptorSet, const VkWriteDescriptorSet* writes, uint32_t writeCount)
+        {
+            // Point caller's writes at the newly allocated set
+            std::vector<VkWriteDescriptorSet> setWrites(writes, writes + writeCount);
+
+            for (auto& write : setWrites)
+            {
+                write.dstSet = descriptorSet;
+            }
+
+            vkUpdateDescriptorSets(DeviceManager::instance().getDevice(), writeCount, setWrites.data(), 0, nullptr);
+        })
+{
+}
+
+DescriptorManager& DescriptorManager::instance()
+{
+    static DescriptorManager instance;
+
+    return instance;
+}
+
+void DescriptorManager::init()
+{
+    persistentAllocator.init(initialSetsPerPool, maxSetsPerPool, DescriptorAllocator::vulkanPoolFuncs());
+}
+
+VkDescriptorSetLayout DescriptorManager::getLayout(const VkDescriptorSetLayoutBinding* bindings, uint32_t bindingCount)
+{
+    return layoutCache.getLayout(bindings, bindingCount);
+}
+
+VkDescriptorSet DescriptorManager::getCachedSet(VkDescriptorSetLayout layout, const VkWriteDescriptorSet* writes, uint32_t writeCount)
+{
+    return setCache.getSet(layout, writes, writeCount);
+}
+
+DescriptorManager::Stats DescriptorManager::getStats()
+{
+    Stats stats = {};
+
+    stats.setsAllocated = persistentAllocator.setsAllocated;
+    stats.poolsCreated = persistentAllocator.poolsCreated;
+    stats.poolResets = persistentAllocator.poolResets;
+
+    stats.liveLayouts = static_cast<uint32_t>(layoutCache.size());
+    stats.liveCachedSets = static_cast<uint32_t>(setCache.size());
+    stats.layoutCache = layoutCache.getStats();
+    stats.setCache = setCache.getStats();
+
+    return stats;
+}
+
+void DescriptorManager::printStats()
+{
+    Stats stats = getStats();
+
+    std::cout << "Descriptor stats:" << std::endl;
+    std::cout << "\tSets allocated: " << stats.setsAllocated << std::endl;
+    std::cout << "\tPools created: " << stats.poolsCreated << " (resets: " << stats.poolResets << ")" << std::endl;
+    std::cout << "\tLayout cache: " << stats.liveLayouts << " layouts, hit rate " << stats.layoutCache.hitRate() * 100.0 << "%" << std::endl;
+    std::cout << "\tSet cache: " << stats.liveCachedSets << " sets, hit rate " << stats.setCache.hitRate() * 100.0 << "%" << std::endl;
+}
+
+void DescriptorManager::cleanup()
+{
+    setCache.clear();
+
+    persistentAllocator.cleanup();
+
+    layoutCache.cleanup();
+}
\ No newline at end of file
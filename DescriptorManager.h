@@ -0,0 +1,113 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <functional>
+
+#include "DeviceManager.h"
+#include "DescriptorCache.h"
+
+// Growable descriptor allocator - chains new pools when the current one is exhausted
+// Pool calls are injected like the caches', so chaining can be exercised without a device
+class DescriptorAllocator
+{
+public:
+
+    // Descriptors reserved per set for each type, scaled by the number of sets per pool
+    struct PoolRatio
+    {
+        VkDescriptorType type;
+        float ratio;
+    };
+
+    struct PoolFuncs
+    {
+        std::function<VkDescriptorPool(uint32_t setCount)> create;
+
+        // False when the pool is exhausted
+        std::function<bool(VkDescriptorPool, VkDescriptorSetLayout, VkDescriptorSet&)> allocate;
+
+        std::function<void(VkDescriptorPool)> reset;
+        std::function<void(VkDescriptorPool)> destroy;
+    };
+
+    // Pools of the DeviceManager's device, sized by the engine's pool ratios
+    static PoolFuncs vulkanPoolFuncs();
+
+    void init(uint32_t initialSetsPerPool, uint32_t maxSetsPerPool, const PoolFuncs& poolFuncs);
+
+    VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+
+    // Reset every pool used by this allocator and return them to the free list
+    void reset();
+
+    void cleanup();
+
+    uint32_t getPoolCount() const { return static_cast<uint32_t>(usedPools.size() + freePools.size()); }
+
+    uint64_t setsAllocated = 0;
+    uint64_t poolsCreated = 0;
+    uint64_t poolResets = 0;
+
+private:
+
+    VkDescriptorPool currentPool = VK_NULL_HANDLE;
+    std::vector<VkDescriptorPool> usedPools;
+    std::vector<VkDescriptorPool> freePools;
+
+    uint32_t setsPerPool = 0;
+    uint32_t maxSetsPerPool = 0;
+
+    PoolFuncs poolFuncs;
+
+    VkDescriptorPool grabPool();
+};
+
+class DescriptorManager
+{
+private:
+
+    DescriptorManager();
+
+    // Sets are immutable and cached by contents, so they live until cleanup
+    DescriptorAllocator persistentAllocator;
+
+    DescriptorLayoutCache layoutCache;
+    DescriptorSetCache setCache;
+
+public:
+
+    struct Stats
+    {
+        uint64_t setsAllocated;
+        uint64_t poolsCreated;
+        uint64_t poolResets;
+        uint32_t liveLayouts;
+        uint32_t liveCachedSets;
+        DescriptorCacheStats layoutCache;
+        DescriptorCacheStats setCache;
+    };
+
+    // Return singleton instance
+    static DescriptorManager& instance();
+
+    // Ensure singleton is never copied
+    DescriptorManager(DescriptorManager const&)     = delete;
+    void operator=(DescriptorManager const&)        = delete;
+
+    void init();
+
+    // Deduplicated layout for the given bindings
+    VkDescriptorSetLayout getLayout(const VkDescriptorSetLayoutBinding* bindings, uint32_t bindingCount);
+
+    // Immutable set with the given contents, allocated and written only on first request
+    VkDescriptorSet getCachedSet(VkDescriptorSetLayout layout, const VkWriteDescriptorSet* writes, uint32_t writeCount);
+
+    Stats getStats();
+    void printStats();
+
+    void cleanup();
+};
\ No newline at end of file
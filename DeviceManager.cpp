@@ -1,5 +1,9 @@
 #include "DeviceManager.h"
 
+#include <iostream>
+#include <cstdlib>
+#include <algorithm>
+
 DeviceManager& DeviceManager::instance()
 {
     static DeviceManager instance;
@@ -22,8 +26,60 @@ VkPhysicalDeviceProperties DeviceManager::getProperties()
     return properties;
 }
 
+VkPhysicalDeviceFeatures DeviceManager::getEnabledFeatures()
+{
+    return enabledFeatures;
+}
+
+bool DeviceManager::hasDisplayTiming()
+{
+    return displayTiming;
+}
+
+bool DeviceManager::hasMemoryBudget()
+{
+    return memoryBudget;
+}
+
+Queue& DeviceManager::getGraphicsQueue()
+{
+    return graphicsQueue;
+}
+
+Queue& DeviceManager::getComputeQueue()
+{
+    return computeQueue;
+}
+
+Queue& DeviceManager::getTransferQueue()
+{
+    return transferQueue;
+}
+
+void DeviceManager::setDeviceOverride(const std::string& deviceOverride)
+{
+    this->deviceOverride = deviceOverride;
+}
+
+void DeviceManager::allowTimelineSemaphores(bool allowed)
+{
+    timelineSemaphoresAllowed = allowed;
+}
+
+void DeviceManager::allowMemoryBudget(bool allowed)
+{
+    memoryBudgetAllowed = allowed;
+}
+
+void DeviceManager::allowDeviceUuid(bool allowed)
+{
+    deviceUuidAllowed = allowed;
+}
+
 void DeviceManager::pickPhysicalDevice(VkInstance& instance, VkSurfaceKHR& surface)
 {
+    vulkanInstance = instance;
+
     // Enumerate device count
     uint32_t deviceCount = 0;
     vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
@@ -37,21 +93,101 @@ void DeviceManager::pickPhysicalDevice(VkInstance& instance, VkSurfaceKHR& surfa
     std::vector<VkPhysicalDevice> devices(deviceCount);
     vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
 
-    // Choose first suitable physical device
+    std::string selectionOverride = deviceOverride;
+
+    if (selectionOverride.empty())
+    {
+        const char* environment = std::getenv("VULKAN_DEVICE");
+        selectionOverride = environment != nullptr ? environment : "";
+    }
+
+    std::vector<DeviceCandidate> candidates;
+    std::vector<DeviceScore> scores;
+
     for (const auto& potentialDevice : devices)
     {
-        if (isDeviceSuitable(potentialDevice, surface))
+        candidates.push_back(queryCandidate(potentialDevice, surface));
+        scores.push_back(DeviceScorer::score(candidates.back()));
+    }
+
+    // Highest scoring suitable device, or the first suitable device matching the override
+    int selected = -1;
+    bool overrideMatched = false;
+
+    for (uint32_t i = 0; i < deviceCount; i++)
+    {
+        if (!selectionOverride.empty())
+        {
+            if (DeviceScorer::matchesOverride(candidates[i], i, selectionOverride))
+            {
+                overrideMatched = true;
+
+                if (scores[i].suitable && selected < 0)
+                {
+                    selected = static_cast<int>(i);
+                }
+            }
+        }
+        else if (scores[i].suitable && (selected < 0 || scores[i].score > scores[selected].score))
         {
-            physicalDevice = potentialDevice;
-            vkGetPhysicalDeviceProperties(physicalDevice, &properties);
-            break;
+            selected = static_cast<int>(i);
         }
     }
 
-    if (physicalDevice == VK_NULL_HANDLE)
+    std::cout << "GPU candidates:" << std::endl;
+
+    for (uint32_t i = 0; i < deviceCount; i++)
+    {
+        const VkPhysicalDeviceProperties& deviceProperties = candidates[i].properties;
+
+        std::cout << "  [" << i << "] " << deviceProperties.deviceName
+                  << " (" << DeviceScorer::getTypeName(deviceProperties.deviceType)
+                  << ", " << DeviceScorer::getDeviceLocalBytes(candidates[i].memoryProperties) / (1024 * 1024) << " MB";
+
+        if (candidates[i].hasDeviceUuid)
+        {
+            std::cout << ", uuid " << DeviceScorer::getUuid(candidates[i]);
+        }
+
+        std::cout << ")";
+
+        if (!scores[i].suitable)
+        {
+            std::cout << " rejected";
+        }
+        else
+        {
+            std::cout << " score " << scores[i].score;
+
+            if (static_cast<int>(i) == selected)
+            {
+                std::cout << (selectionOverride.empty() ? " - selected" : " - selected by override");
+            }
+        }
+
+        std::cout << std::endl << "      ";
+
+        for (size_t j = 0; j < scores[i].notes.size(); j++)
+        {
+            std::cout << (j > 0 ? ", " : "") << scores[i].notes[j];
+        }
+
+        std::cout << std::endl;
+    }
+
+    if (!selectionOverride.empty() && selected < 0)
+    {
+        throw std::runtime_error(overrideMatched ? "Error: Device override '" + selectionOverride + "' only matches unsuitable GPUs"
+                                                 : "Error: Device override '" + selectionOverride + "' matches no GPU");
+    }
+
+    if (selected < 0)
     {
         throw std::runtime_error("Error: Failed to find a suitable GPU");
     }
+
+    physicalDevice = devices[selected];
+    properties = candidates[selected].properties;
 }
 
 void DeviceManager::createLogicalDevice(VkSurfaceKHR& surface, VkQueue& graphicsQueue, VkQueue& presentQueue, bool enableValidationLayers, const std::vector<const char*>& validationLayers)
@@ -59,25 +195,62 @@ void DeviceManager::createLogicalDevice(VkSurfaceKHR& surface, VkQueue& graphics
     // Acquire device queue family indices
     QueueFamilyIndices indices = QueueFamilyIndices::findQueueFamilies(physicalDevice, surface);
 
-    // Set up create info vector and unique queue family set
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    // Give each role its own queue while its family has one spare, otherwise share the family's last queue
+    std::vector<uint32_t> queuesUsed(queueFamilyCount, 0);
+
+    auto assignQueue = [&](int family) -> uint32_t
+    {
+        if (queuesUsed[family] < queueFamilies[family].queueCount)
+        {
+            return queuesUsed[family]++;
+        }
+
+        return queuesUsed[family] - 1;
+    };
+
+    uint32_t graphicsIndex = assignQueue(indices.graphicsFamily);
+
+    // Present shares the graphics queue whenever the family allows it
+    bool separatePresent = indices.presentFamily >= 0 && indices.presentFamily != indices.graphicsFamily;
+    uint32_t presentIndex = separatePresent ? assignQueue(indices.presentFamily) : graphicsIndex;
+
+    uint32_t computeIndex = assignQueue(indices.computeFamily);
+    uint32_t transferIndex = assignQueue(indices.transferFamily);
+
+    // Populate device queue creation info structs, one per family with all of its queues
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-    std::set<int> uniqueQueueFamilies = {indices.graphicsFamily, indices.presentFamily};
+    std::vector<float> queuePriorities(*std::max_element(queuesUsed.begin(), queuesUsed.end()), 1.0f);
 
-    // Populate device queue creation info structs
-    float queuePriority = 1.0f;
-    for (int queueFamily : uniqueQueueFamilies)
+    for (uint32_t queueFamily = 0; queueFamily < queueFamilyCount; queueFamily++)
     {
+        if (queuesUsed[queueFamily] == 0)
+        {
+            continue;
+        }
+
         VkDeviceQueueCreateInfo queueCreateInfo = {};
         queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
         queueCreateInfo.queueFamilyIndex = queueFamily;
-        queueCreateInfo.queueCount = 1;
-        queueCreateInfo.pQueuePriorities = &queuePriority;
+        queueCreateInfo.queueCount = queuesUsed[queueFamily];
+        queueCreateInfo.pQueuePriorities = queuePriorities.data();
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
-    // Device features struct
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
+    // Device features struct - pipeline statistics are optional, used by the GPU profiler when present
     VkPhysicalDeviceFeatures deviceFeatures = {};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
+    deviceFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+
+    enabledFeatures = deviceFeatures;
 
     // Device creation info
     VkDeviceCreateInfo createInfo = {};
@@ -85,8 +258,64 @@ void DeviceManager::createLogicalDevice(VkSurfaceKHR& surface, VkQueue& graphics
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
     createInfo.pEnabledFeatures = &deviceFeatures;
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+
+    // Swapchain extension is only needed when presenting to a surface
+    std::vector<const char*> enabledExtensions;
+
+    if (surface != VK_NULL_HANDLE)
+    {
+        enabledExtensions = deviceExtensions;
+
+#ifdef VK_GOOGLE_display_timing
+        // Only used to measure latency, so enabled wherever the driver has it
+        if (hasDeviceExtension(physicalDevice, VK_GOOGLE_DISPLAY_TIMING_EXTENSION_NAME))
+        {
+            enabledExtensions.push_back(VK_GOOGLE_DISPLAY_TIMING_EXTENSION_NAME);
+            displayTiming = true;
+        }
+#endif
+    }
+
+    bool timelineSemaphores = false;
+
+#ifdef VK_KHR_timeline_semaphore
+    // Timeline semaphores are an optional feature of the extension, so query before enabling
+    VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures = {};
+    timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+
+    if (timelineSemaphoresAllowed && hasDeviceExtension(physicalDevice, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME))
+    {
+        auto getFeatures2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2KHR>(vkGetInstanceProcAddr(vulkanInstance, "vkGetPhysicalDeviceFeatures2KHR"));
+
+        VkPhysicalDeviceFeatures2KHR features2 = {};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+        features2.pNext = &timelineFeatures;
+
+        if (getFeatures2 != nullptr)
+        {
+            getFeatures2(physicalDevice, &features2);
+        }
+
+        if (timelineFeatures.timelineSemaphore == VK_TRUE)
+        {
+            enabledExtensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+            createInfo.pNext = &timelineFeatures;
+            timelineSemaphores = true;
+        }
+    }
+#endif
+
+#ifdef VK_EXT_memory_budget
+    // Only queried by the residency manager, so enabled wherever the driver has it
+    if (memoryBudgetAllowed && hasDeviceExtension(physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME))
+    {
+        enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        memoryBudget = true;
+    }
+#endif
+
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+    createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
     // Set validation layer info if applicable
     if (enableValidationLayers)
@@ -106,29 +335,104 @@ void DeviceManager::createLogicalDevice(VkSurfaceKHR& surface, VkQueue& graphics
     }
 
     // Get device queues for graphics/present families
-    vkGetDeviceQueue(device, indices.graphicsFamily, 0, &graphicsQueue);
-    vkGetDeviceQueue(device, indices.presentFamily, 0, &presentQueue);
+    vkGetDeviceQueue(device, indices.graphicsFamily, graphicsIndex, &graphicsQueue);
+
+    // Headless devices have no present family, so present queue waits fall back to the graphics queue
+    if (indices.presentFamily >= 0)
+    {
+        vkGetDeviceQueue(device, indices.presentFamily, presentIndex, &presentQueue);
+    }
+    else
+    {
+        presentQueue = graphicsQueue;
+    }
+
+    // Queues register with the sync manager as they are set up
+    SyncManager::instance().init(timelineSemaphores);
+
+    this->graphicsQueue.init(graphicsQueue, indices.graphicsFamily, graphicsIndex);
+
+    VkQueue queue;
+    vkGetDeviceQueue(device, indices.computeFamily, computeIndex, &queue);
+    computeQueue.init(queue, indices.computeFamily, computeIndex);
+
+    vkGetDeviceQueue(device, indices.transferFamily, transferIndex, &queue);
+    transferQueue.init(queue, indices.transferFamily, transferIndex);
+
+    std::cout << "Queues: graphics family " << indices.graphicsFamily
+              << ", compute family " << indices.computeFamily << (computeQueue.sharesQueueWith(this->graphicsQueue) ? " (shared with graphics)" : "")
+              << ", transfer family " << indices.transferFamily << (transferQueue.sharesQueueWith(this->graphicsQueue) ? " (shared with graphics)" : "")
+              << std::endl;
+
+    std::cout << "Sync: " << (SyncManager::instance().usesTimelineSemaphores() ? "timeline semaphores" : "fences") << std::endl;
 }
 
-// Ensure a given device supports required queue families
-bool DeviceManager::isDeviceSuitable(VkPhysicalDevice potentialDevice, VkSurfaceKHR surface)
+DeviceCandidate DeviceManager::queryCandidate(VkPhysicalDevice potentialDevice, VkSurfaceKHR surface)
 {
-    QueueFamilyIndices indices = QueueFamilyIndices::findQueueFamilies(potentialDevice, surface);
+    DeviceCandidate candidate = {};
+
+    vkGetPhysicalDeviceProperties(potentialDevice, &candidate.properties);
+    vkGetPhysicalDeviceMemoryProperties(potentialDevice, &candidate.memoryProperties);
+    vkGetPhysicalDeviceFeatures(potentialDevice, &candidate.features);
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(potentialDevice, &queueFamilyCount, nullptr);
+
+    candidate.queueFamilies.resize(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(potentialDevice, &queueFamilyCount, candidate.queueFamilies.data());
 
-    bool extensionsSupported = checkDeviceExtensionSupport(potentialDevice);
+    // Without a surface there is nothing to present to, so skip swapchain requirements
+    candidate.headless = surface == VK_NULL_HANDLE;
+
+    if (!candidate.headless)
+    {
+        for (uint32_t i = 0; i < queueFamilyCount; i++)
+        {
+            VkBool32 presentSupport = false;
+            vkGetPhysicalDeviceSurfaceSupportKHR(potentialDevice, i, surface, &presentSupport);
+            candidate.presentSupport.push_back(presentSupport == VK_TRUE);
+        }
+    }
 
-    bool swapchainAdequate = false;
+    candidate.extensionsSupported = candidate.headless || checkDeviceExtensionSupport(potentialDevice);
+    candidate.swapchainAdequate = candidate.headless;
 
-    if (extensionsSupported)
+    if (!candidate.headless && candidate.extensionsSupported)
     {
         SwapchainSupportDetails swapchainSupport = querySwapchainSupport(potentialDevice, surface);
-        swapchainAdequate = !swapchainSupport.formats.empty() && !swapchainSupport.presentModes.empty();
+        candidate.swapchainAdequate = !swapchainSupport.formats.empty() && !swapchainSupport.presentModes.empty();
     }
 
-    VkPhysicalDeviceFeatures supportedFeatures;
-    vkGetPhysicalDeviceFeatures(potentialDevice, &supportedFeatures);
+#ifdef VK_KHR_external_memory_capabilities
+    // The device UUID is an ID property, which needs both instance extensions to query
+    if (deviceUuidAllowed)
+    {
+        auto getProperties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceProperties2KHR>(vkGetInstanceProcAddr(vulkanInstance, "vkGetPhysicalDeviceProperties2KHR"));
+
+        if (getProperties2 != nullptr)
+        {
+            VkPhysicalDeviceIDPropertiesKHR idProperties = {};
+            idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES_KHR;
+
+            VkPhysicalDeviceProperties2KHR properties2 = {};
+            properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR;
+            properties2.pNext = &idProperties;
 
-    return indices.isComplete() && extensionsSupported && swapchainAdequate && supportedFeatures.samplerAnisotropy;
+            getProperties2(potentialDevice, &properties2);
+
+            std::copy(idProperties.deviceUUID, idProperties.deviceUUID + VK_UUID_SIZE, candidate.deviceUuid);
+            candidate.hasDeviceUuid = true;
+        }
+    }
+#endif
+
+    return candidate;
+}
+
+// Ensure a given device supports required queue families
+bool DeviceManager::isDeviceSuitable(VkPhysicalDevice potentialDevice, VkSurfaceKHR surface)
+{
+    return DeviceScorer::score(queryCandidate(potentialDevice, surface)).suitable;
 }
 
 bool DeviceManager::checkDeviceExtensionSupport(VkPhysicalDevice potentialDevice)
@@ -149,6 +453,25 @@ bool DeviceManager::checkDeviceExtensionSupport(VkPhysicalDevice potentialDevice
     return requiredExtensions.empty();
 }
 
+bool DeviceManager::hasDeviceExtension(VkPhysicalDevice potentialDevice, const char* extensionName)
+{
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(potentialDevice, nullptr, &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(potentialDevice, nullptr, &extensionCount, availableExtensions.data());
+
+    for (const auto& extension : availableExtensions)
+    {
+        if (std::string(extension.extensionName) == extensionName)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 SwapchainSupportDetails DeviceManager::querySwapchainSupport(VkPhysicalDevice potentialDevice, VkSurfaceKHR surface)
 {
     SwapchainSupportDetails details;
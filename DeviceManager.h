@@ -7,9 +7,12 @@
 #include <stdexcept>
 #include <vector>
 #include <set>
+#include <string>
 
 #include "QueueFamilyIndices.h"
 #include "SwapchainSupportDetails.h"
+#include "DeviceScorer.h"
+#include "Queue.h"
 
 class DeviceManager
 {
@@ -21,9 +24,35 @@ private:
     VkDevice device;
     VkPhysicalDevice physicalDevice;
     VkPhysicalDeviceProperties properties;
+    VkPhysicalDeviceFeatures enabledFeatures;
 
     const std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
 
+    // Index, device UUID or name, takes precedence over the VULKAN_DEVICE environment variable
+    std::string deviceOverride;
+
+    // Set when the instance enabled VK_KHR_get_physical_device_properties2, which timeline semaphores need
+    bool timelineSemaphoresAllowed = false;
+
+    // Set when VK_GOOGLE_display_timing was enabled on the device
+    bool displayTiming = false;
+
+    // VK_EXT_memory_budget is queried through VK_KHR_get_physical_device_properties2 as well
+    bool memoryBudgetAllowed = false;
+    bool memoryBudget = false;
+
+    // Set when the instance enabled VK_KHR_get_physical_device_properties2 and VK_KHR_external_memory_capabilities,
+    // without them devices can only be picked by index or name
+    bool deviceUuidAllowed = false;
+
+    // Instance the physical device came from, for instance-level extension entry points
+    VkInstance vulkanInstance = VK_NULL_HANDLE;
+
+    // Queue per role - roles wrap the same queue when the device has no separate one for them
+    Queue graphicsQueue;
+    Queue computeQueue;
+    Queue transferQueue;
+
 public:
 
     // Return singleton instance
@@ -38,13 +67,43 @@ public:
     VkPhysicalDevice getPhysicalDevice();
     VkPhysicalDeviceProperties getProperties();
 
+    // Features the logical device was created with
+    VkPhysicalDeviceFeatures getEnabledFeatures();
+
+    // Whether presents can report when they reached the display
+    bool hasDisplayTiming();
+
+    // Whether the driver reports per-heap budgets through VK_EXT_memory_budget
+    bool hasMemoryBudget();
+
+    Queue& getGraphicsQueue();
+    Queue& getComputeQueue();
+    Queue& getTransferQueue();
+
+    // Force a device instead of the highest scoring one
+    void setDeviceOverride(const std::string& deviceOverride);
+
+    // Use timeline semaphores for CPU/GPU sync when the device supports them, must precede createLogicalDevice
+    void allowTimelineSemaphores(bool allowed);
+
+    // Enable VK_EXT_memory_budget when the device has it, must precede createLogicalDevice
+    void allowMemoryBudget(bool allowed);
+
+    // Query device UUIDs to list and match overrides against, must precede pickPhysicalDevice
+    void allowDeviceUuid(bool allowed);
+
     // Set up logical & physical device handles
+    // Every device is scored and listed with the reason it was chosen or rejected
     void pickPhysicalDevice(VkInstance& instance, VkSurfaceKHR& surface);
     void createLogicalDevice(VkSurfaceKHR& surface, VkQueue& graphicsQueue, VkQueue& presentQueue, bool enableValidationLayers, const std::vector<const char*>& validationLayers);
 
+    // Query everything the scorer needs from a device
+    DeviceCandidate queryCandidate(VkPhysicalDevice potentialDevice, VkSurfaceKHR surface);
+
     // Ensure a given device supports required queue families
     bool isDeviceSuitable(VkPhysicalDevice potentialDevice, VkSurfaceKHR surface);
     bool checkDeviceExtensionSupport(VkPhysicalDevice potentialDevice);
+    bool hasDeviceExtension(VkPhysicalDevice potentialDevice, const char* extensionName);
 
     SwapchainSupportDetails querySwapchainSupport(VkPhysicalDevice potentialDevice, VkSurfaceKHR surface);
 };
\ No newline at end of file
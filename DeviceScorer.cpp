@@ -0,0 +1,216 @@
+#include "DeviceScorer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+
+namespace
+{
+    // Type dominates - integrated memory is shared system memory, so its heap score is capped below the gap
+    const uint32_t DISCRETE_SCORE = 1000;
+    const uint32_t INTEGRATED_SCORE = 500;
+    const uint32_t VIRTUAL_SCORE = 250;
+    const uint32_t CPU_SCORE = 50;
+
+    // One point per 32 MB of device-local memory
+    const VkDeviceSize HEAP_POINT_BYTES = 32 * 1024 * 1024;
+    const uint32_t MAX_HEAP_SCORE = 400;
+
+    const uint32_t TRANSFER_QUEUE_SCORE = 50;
+    const uint32_t COMPUTE_QUEUE_SCORE = 30;
+    const uint32_t SHARED_PRESENT_SCORE = 20;
+
+    const uint32_t FEATURE_SCORE = 10;
+
+    std::string toLower(std::string text)
+    {
+        std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return text;
+    }
+
+    void addPoints(DeviceScore& result, uint32_t points, const std::string& reason)
+    {
+        if (points > 0)
+        {
+            result.score += points;
+            result.notes.push_back(reason + " +" + std::to_string(points));
+        }
+    }
+}
+
+DeviceScore DeviceScorer::score(const DeviceCandidate& candidate)
+{
+    DeviceScore result = {};
+
+    // Requirements first - any missing one rejects the device outright
+    int graphicsFamily = -1;
+    int presentFamily = -1;
+    bool sharedPresent = false;
+    bool transferFamily = false;
+    bool computeFamily = false;
+
+    for (size_t i = 0; i < candidate.queueFamilies.size(); i++)
+    {
+        const VkQueueFamilyProperties& family = candidate.queueFamilies[i];
+
+        if (family.queueCount == 0)
+        {
+            continue;
+        }
+
+        bool graphics = (family.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+        bool present = i < candidate.presentSupport.size() && candidate.presentSupport[i];
+
+        if (graphics && graphicsFamily < 0)
+        {
+            graphicsFamily = static_cast<int>(i);
+        }
+
+        if (present && presentFamily < 0)
+        {
+            presentFamily = static_cast<int>(i);
+        }
+
+        sharedPresent = sharedPresent || (graphics && present);
+
+        // Families without graphics can run copies/compute alongside rendering
+        if (!graphics && (family.queueFlags & VK_QUEUE_COMPUTE_BIT))
+        {
+            computeFamily = true;
+        }
+        else if (!graphics && (family.queueFlags & VK_QUEUE_TRANSFER_BIT))
+        {
+            transferFamily = true;
+        }
+    }
+
+    if (graphicsFamily < 0)
+    {
+        result.notes.push_back("no graphics queue");
+    }
+
+    if (!candidate.headless)
+    {
+        if (presentFamily < 0)
+        {
+            result.notes.push_back("cannot present to the surface");
+        }
+
+        if (!candidate.extensionsSupported)
+        {
+            result.notes.push_back("missing " VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+        }
+        else if (!candidate.swapchainAdequate)
+        {
+            result.notes.push_back("no surface formats or present modes");
+        }
+    }
+
+    if (!candidate.features.samplerAnisotropy)
+    {
+        result.notes.push_back("no samplerAnisotropy");
+    }
+
+    if (!result.notes.empty())
+    {
+        result.suitable = false;
+        return result;
+    }
+
+    result.suitable = true;
+
+    switch (candidate.properties.deviceType)
+    {
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:   addPoints(result, DISCRETE_SCORE, "discrete GPU"); break;
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: addPoints(result, INTEGRATED_SCORE, "integrated GPU"); break;
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:    addPoints(result, VIRTUAL_SCORE, "virtual GPU"); break;
+    case VK_PHYSICAL_DEVICE_TYPE_CPU:            addPoints(result, CPU_SCORE, "CPU implementation"); break;
+    default: break;
+    }
+
+    VkDeviceSize deviceLocalBytes = getDeviceLocalBytes(candidate.memoryProperties);
+    uint32_t heapPoints = static_cast<uint32_t>(std::min<VkDeviceSize>(deviceLocalBytes / HEAP_POINT_BYTES, MAX_HEAP_SCORE));
+    addPoints(result, heapPoints, std::to_string(deviceLocalBytes / (1024 * 1024)) + " MB device-local");
+
+    addPoints(result, transferFamily ? TRANSFER_QUEUE_SCORE : 0, "dedicated transfer queue");
+    addPoints(result, computeFamily ? COMPUTE_QUEUE_SCORE : 0, "async compute queue");
+    addPoints(result, !candidate.headless && sharedPresent ? SHARED_PRESENT_SCORE : 0, "graphics queue presents");
+
+    // Optional features the renderer uses when available
+    const VkPhysicalDeviceFeatures& features = candidate.features;
+    addPoints(result, features.pipelineStatisticsQuery ? FEATURE_SCORE : 0, "pipelineStatisticsQuery");
+    addPoints(result, features.multiDrawIndirect ? FEATURE_SCORE : 0, "multiDrawIndirect");
+    addPoints(result, features.textureCompressionBC ? FEATURE_SCORE : 0, "textureCompressionBC");
+
+    const VkPhysicalDeviceLimits& limits = candidate.properties.limits;
+    addPoints(result, limits.timestampComputeAndGraphics ? FEATURE_SCORE : 0, "timestamps");
+    addPoints(result, limits.maxImageDimension2D / 1024, "max image " + std::to_string(limits.maxImageDimension2D));
+    addPoints(result, static_cast<uint32_t>(limits.maxSamplerAnisotropy), "anisotropy " + std::to_string(static_cast<uint32_t>(limits.maxSamplerAnisotropy)) + "x");
+
+    return result;
+}
+
+bool DeviceScorer::matchesOverride(const DeviceCandidate& candidate, uint32_t index, const std::string& deviceOverride)
+{
+    if (deviceOverride.empty())
+    {
+        return false;
+    }
+
+    // Plain number - enumeration index
+    if (deviceOverride.size() < 10 && std::all_of(deviceOverride.begin(), deviceOverride.end(), [](unsigned char c) { return std::isdigit(c) != 0; }))
+    {
+        return std::stoul(deviceOverride) == index;
+    }
+
+    std::string match = toLower(deviceOverride);
+    match.erase(std::remove(match.begin(), match.end(), '-'), match.end());
+
+    if (candidate.hasDeviceUuid && match == getUuid(candidate))
+    {
+        return true;
+    }
+
+    return toLower(candidate.properties.deviceName).find(toLower(deviceOverride)) != std::string::npos;
+}
+
+VkDeviceSize DeviceScorer::getDeviceLocalBytes(const VkPhysicalDeviceMemoryProperties& memoryProperties)
+{
+    VkDeviceSize bytes = 0;
+
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+    {
+        if (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+        {
+            bytes += memoryProperties.memoryHeaps[i].size;
+        }
+    }
+
+    return bytes;
+}
+
+std::string DeviceScorer::getUuid(const DeviceCandidate& candidate)
+{
+    std::string uuid;
+
+    for (uint32_t i = 0; candidate.hasDeviceUuid && i < VK_UUID_SIZE; i++)
+    {
+        char hex[3];
+        std::snprintf(hex, sizeof(hex), "%02x", candidate.deviceUuid[i]);
+        uuid += hex;
+    }
+
+    return uuid;
+}
+
+const char* DeviceScorer::getTypeName(VkPhysicalDeviceType type)
+{
+    switch (type)
+    {
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:   return "discrete";
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: return "integrated";
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:    return "virtual";
+    case VK_PHYSICAL_DEVICE_TYPE_CPU:            return "cpu";
+    default:                                     return "other";
+    }
+}
\ No newline at end of file
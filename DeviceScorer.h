@@ -0,0 +1,57 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+
+#include <GLFW/glfw3.h>
+
+#include <string>
+#include <vector>
+
+// Everything device selection looks at, gathered up front so scoring never touches the driver
+// Tests can fill one in by hand to score synthetic devices
+struct DeviceCandidate
+{
+    VkPhysicalDeviceProperties properties;
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    VkPhysicalDeviceFeatures features;
+    std::vector<VkQueueFamilyProperties> queueFamilies;
+
+    // Per queue family, empty when there is no surface to present to
+    std::vector<bool> presentSupport;
+
+    bool headless;
+    bool extensionsSupported;
+    bool swapchainAdequate;
+
+    // Identifies the device across drivers and runs, only reported through VK_KHR_get_physical_device_properties2
+    uint8_t deviceUuid[VK_UUID_SIZE];
+    bool hasDeviceUuid;
+};
+
+struct DeviceScore
+{
+    bool suitable;
+    uint32_t score;
+
+    // Why the device was rejected, or what each part of its score came from
+    std::vector<std::string> notes;
+};
+
+class DeviceScorer
+{
+public:
+
+    static DeviceScore score(const DeviceCandidate& candidate);
+
+    // Override by enumeration index, device UUID, or case-insensitive part of the device name
+    // UUIDs only match when the candidate has one, otherwise only the index and name can
+    static bool matchesOverride(const DeviceCandidate& candidate, uint32_t index, const std::string& deviceOverride);
+
+    // Total size of the device-local heaps
+    static VkDeviceSize getDeviceLocalBytes(const VkPhysicalDeviceMemoryProperties& memoryProperties);
+
+    // Device UUID as hex, empty when the candidate has none
+    static std::string getUuid(const DeviceCandidate& candidate);
+
+    static const char* getTypeName(VkPhysicalDeviceType type);
+};
\ No newline at end of file
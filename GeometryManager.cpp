@@ -0,0 +1,367 @@
+#include "GeometryManager.h"
+#include "UploadManager.h"
+#include "DeletionQueue.h"
+#include "ResidencyManager.h"
+
+#include <iostream>
+#include <algorithm>
+
+GeometryManager& GeometryManager::instance()
+{
+    static GeometryManager instance;
+
+    return instance;
+}
+
+void GeometryManager::createVertexBuffer(VkBuffer& buffer, VkDeviceMemory& memory)
+{
+    // Transfer source usage allows defragmentation to copy out of the buffers
+    Utils::createBuffer(static_cast<VkDeviceSize>(maxVertices) * sizeof(Vertex),
+                        VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, memory);
+}
+
+void GeometryManager::createIndexBuffer(const IndexPool& pool, VkBuffer& buffer, VkDeviceMemory& memory)
+{
+    Utils::createBuffer(static_cast<VkDeviceSize>(pool.maxIndices) * pool.indexSize,
+                        VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, memory);
+}
+
+void GeometryManager::init(uint32_t maxVertices, uint32_t maxIndices16, uint32_t maxIndices32)
+{
+    this->maxVertices = maxVertices;
+    largestVertexRequest = 0;
+    repacked = false;
+
+    vertexAllocator.reset(maxVertices);
+    createVertexBuffer(vertexBuffer, vertexBufferMemory);
+
+    indexPools[INDEX_POOL_16].indexType = VK_INDEX_TYPE_UINT16;
+    indexPools[INDEX_POOL_16].indexSize = sizeof(uint16_t);
+    indexPools[INDEX_POOL_16].maxIndices = maxIndices16;
+
+    indexPools[INDEX_POOL_32].indexType = VK_INDEX_TYPE_UINT32;
+    indexPools[INDEX_POOL_32].indexSize = sizeof(uint32_t);
+    indexPools[INDEX_POOL_32].maxIndices = maxIndices32;
+
+    VkDeviceSize poolBytes = static_cast<VkDeviceSize>(maxVertices) * sizeof(Vertex);
+
+    for (IndexPool& pool : indexPools)
+    {
+        pool.allocator.reset(pool.maxIndices);
+        pool.largestRequest = 0;
+        createIndexBuffer(pool, pool.buffer, pool.memory);
+
+        poolBytes += static_cast<VkDeviceSize>(pool.maxIndices) * pool.indexSize;
+    }
+
+    // The buffers are tracked whole as fixed allocations, meshes are evicted against what they hold
+    residencyPool = ResidencyManager::instance().addPool(poolBytes);
+}
+
+VkIndexType GeometryManager::selectIndexType(uint32_t vertexCount)
+{
+    // Indices are mesh-local, so only the mesh's own vertex count matters
+    return vertexCount <= 65536 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+}
+
+bool GeometryManager::allocateSlot(MeshSlot& slot)
+{
+    IndexPool& pool = indexPools[slot.indexPool];
+
+    slot.vertexAllocation = vertexAllocator.allocate(slot.vertexCount);
+    slot.indexAllocation = pool.allocator.allocate(slot.indexCount);
+    slot.live = true;
+
+    if (!slot.vertexAllocation.isValid() || !slot.indexAllocation.isValid())
+    {
+        vertexAllocator.free(slot.vertexAllocation);
+        pool.allocator.free(slot.indexAllocation);
+
+        return false;
+    }
+
+    return true;
+}
+
+MeshHandle GeometryManager::loadMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+{
+    MeshSlot slot = {};
+    slot.vertexCount = static_cast<uint32_t>(vertices.size());
+    slot.indexCount = static_cast<uint32_t>(indices.size());
+    slot.indexPool = selectIndexType(slot.vertexCount) == VK_INDEX_TYPE_UINT16 ? INDEX_POOL_16 : INDEX_POOL_32;
+
+    IndexPool& pool = indexPools[slot.indexPool];
+
+    largestVertexRequest = std::max(largestVertexRequest, slot.vertexCount);
+    pool.largestRequest = std::max(pool.largestRequest, slot.indexCount);
+
+    if (!allocateSlot(slot))
+    {
+        // Only worth a repack if the free space adds up, otherwise the pools are simply full
+        if (vertexAllocator.getStorageReport().totalFree < slot.vertexCount ||
+            pool.allocator.getStorageReport().totalFree < slot.indexCount)
+        {
+            throw std::runtime_error("Error: Geometry buffer out of space");
+        }
+
+        defragment();
+
+        if (!allocateSlot(slot))
+        {
+            throw std::runtime_error("Error: Geometry buffer out of space");
+        }
+    }
+
+    UploadManager::instance().uploadBuffer(vertexBuffer, static_cast<VkDeviceSize>(slot.vertexAllocation.offset) * sizeof(Vertex), vertices.data(), vertices.size() * sizeof(Vertex));
+
+    VkDeviceSize indexOffset = static_cast<VkDeviceSize>(slot.indexAllocation.offset) * pool.indexSize;
+
+    if (pool.indexType == VK_INDEX_TYPE_UINT16)
+    {
+        std::vector<uint16_t> narrowIndices(indices.begin(), indices.end());
+        UploadManager::instance().uploadBuffer(pool.buffer, indexOffset, narrowIndices.data(), narrowIndices.size() * sizeof(uint16_t));
+    }
+    else
+    {
+        UploadManager::instance().uploadBuffer(pool.buffer, indexOffset, indices.data(), indices.size() * sizeof(uint32_t));
+    }
+
+    // Reuse a released handle if there is one
+    MeshHandle handle;
+
+    if (!freeHandles.empty())
+    {
+        handle = freeHandles.back();
+        freeHandles.pop_back();
+        meshes[handle] = slot;
+    }
+    else
+    {
+        handle = static_cast<MeshHandle>(meshes.size());
+        meshes.push_back(slot);
+    }
+
+    return handle;
+}
+
+void GeometryManager::unloadMesh(MeshHandle mesh)
+{
+    MeshSlot& slot = meshes.at(mesh);
+
+    if (!slot.live)
+    {
+        return;
+    }
+
+    vertexAllocator.free(slot.vertexAllocation);
+    indexPools[slot.indexPool].allocator.free(slot.indexAllocation);
+
+    slot.live = false;
+    freeHandles.push_back(mesh);
+}
+
+GeometryManager::MeshRange GeometryManager::getMeshRange(MeshHandle mesh)
+{
+    const MeshSlot& slot = meshes.at(mesh);
+
+    MeshRange range = {};
+    range.vertexOffset = static_cast<int32_t>(slot.vertexAllocation.offset);
+    range.vertexCount = slot.vertexCount;
+    range.firstIndex = slot.indexAllocation.offset;
+    range.indexCount = slot.indexCount;
+    range.indexType = indexPools[slot.indexPool].indexType;
+
+    return range;
+}
+
+VkDeviceSize GeometryManager::getMeshBytes(MeshHandle mesh)
+{
+    const MeshSlot& slot = meshes.at(mesh);
+
+    return static_cast<VkDeviceSize>(slot.vertexCount) * sizeof(Vertex) + static_cast<VkDeviceSize>(slot.indexCount) * indexPools[slot.indexPool].indexSize;
+}
+
+uint32_t GeometryManager::getResidencyPool()
+{
+    return residencyPool;
+}
+
+VkBuffer GeometryManager::getVertexBuffer()
+{
+    return vertexBuffer;
+}
+
+VkBuffer GeometryManager::getIndexBuffer(VkIndexType indexType)
+{
+    return indexType == VK_INDEX_TYPE_UINT16 ? indexPools[INDEX_POOL_16].buffer : indexPools[INDEX_POOL_32].buffer;
+}
+
+GeometryManager::IndexStats GeometryManager::getIndexStats()
+{
+    IndexStats stats = {};
+
+    for (const MeshSlot& slot : meshes)
+    {
+        if (!slot.live)
+        {
+            continue;
+        }
+
+        const IndexPool& pool = indexPools[slot.indexPool];
+        stats.indexBytes += static_cast<VkDeviceSize>(slot.indexCount) * pool.indexSize;
+
+        if (slot.indexPool == INDEX_POOL_16)
+        {
+            stats.meshes16++;
+            stats.bytesSaved += static_cast<VkDeviceSize>(slot.indexCount) * (sizeof(uint32_t) - sizeof(uint16_t));
+        }
+        else
+        {
+            stats.meshes32++;
+        }
+    }
+
+    return stats;
+}
+
+bool GeometryManager::isDefragmentWorthwhile(float minFreeShare)
+{
+    RangeAllocator::StorageReport report = vertexAllocator.getStorageReport();
+
+    if (report.totalFree >= minFreeShare * vertexAllocator.getSize() && report.largestFree < largestVertexRequest)
+    {
+        return true;
+    }
+
+    for (const IndexPool& pool : indexPools)
+    {
+        report = pool.allocator.getStorageReport();
+
+        if (report.totalFree >= minFreeShare * pool.allocator.getSize() && report.largestFree < pool.largestRequest)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool GeometryManager::takeRepacked()
+{
+    bool result = repacked;
+    repacked = false;
+
+    return result;
+}
+
+void GeometryManager::defragment()
+{
+    VkBuffer newVertexBuffer;
+    VkDeviceMemory newVertexMemory;
+    VkBuffer newIndexBuffers[INDEX_POOL_COUNT];
+    VkDeviceMemory newIndexMemory[INDEX_POOL_COUNT];
+
+    createVertexBuffer(newVertexBuffer, newVertexMemory);
+
+    for (uint32_t i = 0; i < INDEX_POOL_COUNT; i++)
+    {
+        createIndexBuffer(indexPools[i], newIndexBuffers[i], newIndexMemory[i]);
+    }
+
+    // Repack in current offset order so the copies read the old buffers front to back
+    std::vector<MeshHandle> order;
+    for (MeshHandle handle = 0; handle < meshes.size(); handle++)
+    {
+        if (meshes[handle].live)
+        {
+            order.push_back(handle);
+        }
+    }
+
+    std::sort(order.begin(), order.end(), [this](MeshHandle a, MeshHandle b)
+    {
+        return meshes[a].vertexAllocation.offset < meshes[b].vertexAllocation.offset;
+    });
+
+    vertexAllocator.reset(maxVertices);
+
+    for (IndexPool& pool : indexPools)
+    {
+        pool.allocator.reset(pool.maxIndices);
+    }
+
+    std::vector<VkBufferCopy> vertexCopies;
+    std::vector<VkBufferCopy> indexCopies[INDEX_POOL_COUNT];
+
+    for (MeshHandle handle : order)
+    {
+        MeshSlot& slot = meshes[handle];
+        IndexPool& pool = indexPools[slot.indexPool];
+
+        RangeAllocator::Allocation vertexAllocation = vertexAllocator.allocate(slot.vertexCount);
+        RangeAllocator::Allocation indexAllocation = pool.allocator.allocate(slot.indexCount);
+
+        VkBufferCopy vertexCopy = {};
+        vertexCopy.srcOffset = static_cast<VkDeviceSize>(slot.vertexAllocation.offset) * sizeof(Vertex);
+        vertexCopy.dstOffset = static_cast<VkDeviceSize>(vertexAllocation.offset) * sizeof(Vertex);
+        vertexCopy.size = static_cast<VkDeviceSize>(slot.vertexCount) * sizeof(Vertex);
+        vertexCopies.push_back(vertexCopy);
+
+        VkBufferCopy indexCopy = {};
+        indexCopy.srcOffset = static_cast<VkDeviceSize>(slot.indexAllocation.offset) * pool.indexSize;
+        indexCopy.dstOffset = static_cast<VkDeviceSize>(indexAllocation.offset) * pool.indexSize;
+        indexCopy.size = static_cast<VkDeviceSize>(slot.indexCount) * pool.indexSize;
+        indexCopies[slot.indexPool].push_back(indexCopy);
+
+        slot.vertexAllocation = vertexAllocation;
+        slot.indexAllocation = indexAllocation;
+    }
+
+    UploadManager::instance().copyBuffer(vertexBuffer, newVertexBuffer, vertexCopies);
+
+    for (uint32_t i = 0; i < INDEX_POOL_COUNT; i++)
+    {
+        UploadManager::instance().copyBuffer(indexPools[i].buffer, newIndexBuffers[i], indexCopies[i]);
+    }
+
+    // Old buffers are read by the copy and by frames already in flight, so they go once those complete
+    UploadManager::instance().flush();
+
+    SyncTicket lastUse = SyncManager::instance().getLastTicket();
+
+    DeletionQueue::instance().destroyBuffer(lastUse, vertexBuffer, vertexBufferMemory);
+
+    vertexBuffer = newVertexBuffer;
+    vertexBufferMemory = newVertexMemory;
+
+    for (uint32_t i = 0; i < INDEX_POOL_COUNT; i++)
+    {
+        DeletionQueue::instance().destroyBuffer(lastUse, indexPools[i].buffer, indexPools[i].memory);
+
+        indexPools[i].buffer = newIndexBuffers[i];
+        indexPools[i].memory = newIndexMemory[i];
+    }
+
+    repacked = true;
+
+    std::cout << "Geometry defragmented: " << order.size() << " meshes repacked" << std::endl;
+}
+
+void GeometryManager::cleanup()
+{
+    VkDevice device = DeviceManager::instance().getDevice();
+
+    for (IndexPool& pool : indexPools)
+    {
+        vkDestroyBuffer(device, pool.buffer, nullptr);
+        Utils::freeTrackedMemory(pool.memory);
+    }
+
+    vkDestroyBuffer(device, vertexBuffer, nullptr);
+    Utils::freeTrackedMemory(vertexBufferMemory);
+
+    meshes.clear();
+    freeHandles.clear();
+}
\ No newline at end of file
@@ -0,0 +1,148 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+
+#include <GLFW/glfw3.h>
+
+#include <vector>
+
+#include "Utils.h"
+#include "Vertex.h"
+#include "RangeAllocator.h"
+
+typedef uint32_t MeshHandle;
+
+// Shared device-local vertex/index megabuffers with sub-allocated per-mesh ranges
+// Mesh indices are local to the mesh and drawn with vertexOffset/firstIndex, so a mesh whose own
+// vertex count fits in 16 bits is stored in the 16-bit index pool regardless of where its vertices land
+class GeometryManager
+{
+private:
+
+    GeometryManager() {}
+
+    // Pool slots, one per index width
+    static const uint32_t INDEX_POOL_16 = 0;
+    static const uint32_t INDEX_POOL_32 = 1;
+    static const uint32_t INDEX_POOL_COUNT = 2;
+
+    struct IndexPool
+    {
+        VkIndexType indexType;
+        uint32_t indexSize;
+        uint32_t maxIndices;
+
+        VkBuffer buffer;
+        VkDeviceMemory memory;
+
+        RangeAllocator allocator;
+
+        // Largest index count requested so far, what the free space has to stay able to hold
+        uint32_t largestRequest;
+    };
+
+    struct MeshSlot
+    {
+        RangeAllocator::Allocation vertexAllocation;
+        RangeAllocator::Allocation indexAllocation;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t indexPool;
+        bool live;
+    };
+
+    VkBuffer vertexBuffer;
+    VkDeviceMemory vertexBufferMemory;
+
+    // Capacity in vertices
+    uint32_t maxVertices;
+
+    RangeAllocator vertexAllocator;
+    IndexPool indexPools[INDEX_POOL_COUNT];
+
+    uint32_t largestVertexRequest;
+
+    // Set by defragment, cleared when read through takeRepacked
+    bool repacked;
+
+    // Residency pool the meshes are held to
+    uint32_t residencyPool;
+
+    std::vector<MeshSlot> meshes;
+    std::vector<MeshHandle> freeHandles;
+
+    void createVertexBuffer(VkBuffer& buffer, VkDeviceMemory& memory);
+    void createIndexBuffer(const IndexPool& pool, VkBuffer& buffer, VkDeviceMemory& memory);
+
+    // Allocates the slot's ranges, leaving nothing allocated on failure
+    bool allocateSlot(MeshSlot& slot);
+
+public:
+
+    // Draw parameters for a loaded mesh
+    struct MeshRange
+    {
+        int32_t vertexOffset;
+        uint32_t vertexCount;
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        VkIndexType indexType;
+    };
+
+    struct IndexStats
+    {
+        uint32_t meshes16;
+        uint32_t meshes32;
+        VkDeviceSize indexBytes;
+
+        // Bytes the same meshes would have taken on top of indexBytes with 32-bit indices
+        VkDeviceSize bytesSaved;
+    };
+
+    // Return singleton instance
+    static GeometryManager& instance();
+
+    // Ensure singleton is never copied
+    GeometryManager(GeometryManager const&)     = delete;
+    void operator=(GeometryManager const&)      = delete;
+
+    void init(uint32_t maxVertices, uint32_t maxIndices16, uint32_t maxIndices32);
+
+    // Smallest index type able to address vertexCount mesh-local vertices
+    static VkIndexType selectIndexType(uint32_t vertexCount);
+
+    // Allocate ranges and queue the upload; indices are relative to the mesh's first vertex
+    // and are narrowed to 16 bits when the mesh's vertex count allows
+    MeshHandle loadMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+
+    // Release a mesh's ranges - the caller must ensure no in-flight work still draws it
+    void unloadMesh(MeshHandle mesh);
+
+    MeshRange getMeshRange(MeshHandle mesh);
+
+    // Vertex and index bytes the mesh takes in the pools
+    VkDeviceSize getMeshBytes(MeshHandle mesh);
+
+    // Residency pool covering the vertex and index pools together, so a mesh can still run out of room in its own
+    // pool while the budget holds; valid after init
+    uint32_t getResidencyPool();
+
+    VkBuffer getVertexBuffer();
+    VkBuffer getIndexBuffer(VkIndexType indexType);
+
+    IndexStats getIndexStats();
+
+    // True when some pool has at least minFreeShare of its capacity free, yet no free range big enough for the
+    // largest mesh loaded into it, so repacking would win back room the pool can't otherwise use
+    bool isDefragmentWorthwhile(float minFreeShare);
+
+    // Repack every live mesh to the start of fresh buffers by GPU copy
+    // Mesh ranges change, so command buffers referencing them must be re-recorded
+    // loadMesh also repacks on its own when a mesh only fails to fit because the free space is split up
+    void defragment();
+
+    // Whether a repack happened since the last call
+    bool takeRepacked();
+
+    void cleanup();
+};
\ No newline at end of file
@@ -0,0 +1,468 @@
+#include "GpuProfiler.h"
+
+#include "Tracer.h"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <algorithm>
+
+namespace
+{
+    // Weight of the newest sample in the rolling average
+    const double AVERAGE_WEIGHT = 0.05;
+
+    const VkQueryPipelineStatisticFlags STATISTICS_FLAGS = VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+                                                           VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+                                                           VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+    // Statistic values come back in flag bit order, followed by the availability word
+    const uint32_t STATISTICS_VALUES = 3;
+}
+
+GpuProfiler& GpuProfiler::instance()
+{
+    static GpuProfiler instance;
+
+    return instance;
+}
+
+GpuProfiler::Scope::Scope(VkCommandBuffer commandBuffer, ProfilerSlot slot, const char* name, bool statistics)
+    : commandBuffer(commandBuffer), slot(slot)
+{
+    GpuProfiler::instance().beginScope(commandBuffer, slot, name, statistics);
+}
+
+GpuProfiler::Scope::~Scope()
+{
+    GpuProfiler::instance().endScope(commandBuffer, slot);
+}
+
+void GpuProfiler::init(uint32_t queueFamilyIndex, bool pipelineStatistics)
+{
+    VkPhysicalDevice physicalDevice = DeviceManager::instance().getPhysicalDevice();
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    uint32_t validBits = queueFamilies.at(queueFamilyIndex).timestampValidBits;
+
+    enabled = validBits > 0;
+    timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+    timestampPeriod = DeviceManager::instance().getProperties().limits.timestampPeriod;
+
+    statisticsEnabled = enabled && pipelineStatistics && DeviceManager::instance().getEnabledFeatures().pipelineStatisticsQuery;
+
+    if (!enabled)
+    {
+        std::cout << "GPU profiler: queue family has no timestamp support, profiling disabled" << std::endl;
+    }
+    else if (pipelineStatistics && !statisticsEnabled)
+    {
+        std::cout << "GPU profiler: pipeline statistics queries not supported" << std::endl;
+    }
+}
+
+ProfilerSlot GpuProfiler::createSlot()
+{
+    Slot slot = {};
+
+    if (enabled)
+    {
+        VkDevice device = DeviceManager::instance().getDevice();
+
+        VkQueryPoolCreateInfo queryPoolInfo = {};
+        queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount = MAX_SCOPES * 2;
+
+        if (vkCreateQueryPool(device, &queryPoolInfo, nullptr, &slot.timestampPool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Error: Failed to create timestamp query pool");
+        }
+
+        if (statisticsEnabled)
+        {
+            queryPoolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+            queryPoolInfo.queryCount = MAX_SCOPES;
+            queryPoolInfo.pipelineStatistics = STATISTICS_FLAGS;
+
+            if (vkCreateQueryPool(device, &queryPoolInfo, nullptr, &slot.statisticsPool) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Error: Failed to create pipeline statistics query pool");
+            }
+        }
+    }
+
+    slots.push_back(slot);
+
+    return static_cast<ProfilerSlot>(slots.size() - 1);
+}
+
+bool GpuProfiler::isEnabled()
+{
+    return enabled;
+}
+
+bool GpuProfiler::hasPipelineStatistics()
+{
+    return statisticsEnabled;
+}
+
+void GpuProfiler::beginRecording(VkCommandBuffer commandBuffer, ProfilerSlot slot)
+{
+    if (!enabled)
+    {
+        return;
+    }
+
+    Slot& profilerSlot = slots.at(slot);
+
+    profilerSlot.scopes.clear();
+    profilerSlot.openScopes.clear();
+    profilerSlot.statisticsQueries = 0;
+    profilerSlot.statisticsActive = false;
+    profilerSlot.pending = false;
+
+    // Reset on the GPU every time the command buffer runs, queries can only be written once per reset
+    vkCmdResetQueryPool(commandBuffer, profilerSlot.timestampPool, 0, MAX_SCOPES * 2);
+
+    if (statisticsEnabled)
+    {
+        vkCmdResetQueryPool(commandBuffer, profilerSlot.statisticsPool, 0, MAX_SCOPES);
+    }
+}
+
+void GpuProfiler::endRecording(ProfilerSlot slot)
+{
+    if (!enabled)
+    {
+        return;
+    }
+
+    if (!slots.at(slot).openScopes.empty())
+    {
+        throw std::runtime_error("Error: GPU profiler scope left open at end of recording");
+    }
+}
+
+void GpuProfiler::beginScope(VkCommandBuffer commandBuffer, ProfilerSlot slot, const char* name, bool statistics)
+{
+    if (!enabled)
+    {
+        return;
+    }
+
+    Slot& profilerSlot = slots.at(slot);
+
+    if (profilerSlot.scopes.size() >= MAX_SCOPES)
+    {
+        throw std::runtime_error("Error: Too many GPU profiler scopes in one command buffer");
+    }
+
+    ScopeRecord scope = {};
+    scope.name = name;
+    scope.result = getResultIndex(name, static_cast<uint32_t>(profilerSlot.openScopes.size()));
+    scope.startQuery = static_cast<uint32_t>(profilerSlot.scopes.size()) * 2;
+    scope.endQuery = scope.startQuery + 1;
+    scope.statisticsQuery = -1;
+
+    // Only one statistics query can be active at a time, nested requests just get timestamps
+    if (statistics && statisticsEnabled && !profilerSlot.statisticsActive)
+    {
+        scope.statisticsQuery = static_cast<int32_t>(profilerSlot.statisticsQueries++);
+        profilerSlot.statisticsActive = true;
+
+        vkCmdBeginQuery(commandBuffer, profilerSlot.statisticsPool, scope.statisticsQuery, 0);
+    }
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, profilerSlot.timestampPool, scope.startQuery);
+
+    profilerSlot.openScopes.push_back(static_cast<uint32_t>(profilerSlot.scopes.size()));
+    profilerSlot.scopes.push_back(scope);
+}
+
+void GpuProfiler::endScope(VkCommandBuffer commandBuffer, ProfilerSlot slot)
+{
+    if (!enabled)
+    {
+        return;
+    }
+
+    Slot& profilerSlot = slots.at(slot);
+
+    if (profilerSlot.openScopes.empty())
+    {
+        throw std::runtime_error("Error: GPU profiler scope ended without a matching begin");
+    }
+
+    const ScopeRecord& scope = profilerSlot.scopes[profilerSlot.openScopes.back()];
+    profilerSlot.openScopes.pop_back();
+
+    // Bottom of pipe - written once all earlier work in the command buffer has finished
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, profilerSlot.timestampPool, scope.endQuery);
+
+    if (scope.statisticsQuery >= 0)
+    {
+        vkCmdEndQuery(commandBuffer, profilerSlot.statisticsPool, scope.statisticsQuery);
+        profilerSlot.statisticsActive = false;
+    }
+}
+
+void GpuProfiler::submitted(ProfilerSlot slot)
+{
+    if (enabled)
+    {
+        slots.at(slot).pending = true;
+        slots.at(slot).submitTicks = Tracer::now();
+    }
+}
+
+bool GpuProfiler::collect(ProfilerSlot slot)
+{
+    if (!enabled)
+    {
+        return false;
+    }
+
+    Slot& profilerSlot = slots.at(slot);
+
+    if (!profilerSlot.pending || profilerSlot.scopes.empty())
+    {
+        return false;
+    }
+
+    VkDevice device = DeviceManager::instance().getDevice();
+
+    // Value and availability pairs - no wait flag, so an unfinished submission just reports unavailable
+    uint32_t queryCount = static_cast<uint32_t>(profilerSlot.scopes.size()) * 2;
+    std::vector<uint64_t> timestamps(queryCount * 2);
+
+    VkResult result = vkGetQueryPoolResults(device, profilerSlot.timestampPool, 0, queryCount,
+                                            timestamps.size() * sizeof(uint64_t), timestamps.data(), 2 * sizeof(uint64_t),
+                                            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+    if (result != VK_SUCCESS && result != VK_NOT_READY)
+    {
+        throw std::runtime_error("Error: Failed to read GPU timestamps");
+    }
+
+    for (uint32_t i = 0; i < queryCount; i++)
+    {
+        if (timestamps[i * 2 + 1] == 0)
+        {
+            return false;
+        }
+    }
+
+    std::vector<uint64_t> statistics;
+
+    if (profilerSlot.statisticsQueries > 0)
+    {
+        uint32_t stride = STATISTICS_VALUES + 1;
+        statistics.resize(profilerSlot.statisticsQueries * stride);
+
+        result = vkGetQueryPoolResults(device, profilerSlot.statisticsPool, 0, profilerSlot.statisticsQueries,
+                                       statistics.size() * sizeof(uint64_t), statistics.data(), stride * sizeof(uint64_t),
+                                       VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+        // Written by the same submission as the timestamps, so they are available too
+        if (result != VK_SUCCESS)
+        {
+            return false;
+        }
+    }
+
+    uint64_t firstStart = timestamps[profilerSlot.scopes.front().startQuery * 2] & timestampMask;
+
+    for (const ScopeRecord& scope : profilerSlot.scopes)
+    {
+        uint64_t start = timestamps[scope.startQuery * 2] & timestampMask;
+        uint64_t end = timestamps[scope.endQuery * 2] & timestampMask;
+
+        // Ticks to nanoseconds to milliseconds, allowing for wraparound of the valid bits
+        double milliseconds = static_cast<double>((end - start) & timestampMask) * timestampPeriod / 1000000.0;
+
+        // No calibrated timestamps in this Vulkan version, so the GPU track starts each submission at its
+        // CPU submit time - queue latency is lost but scope nesting and durations are exact
+        if (Tracer::ENABLED)
+        {
+            uint64_t offset = static_cast<uint64_t>(static_cast<double>((start - firstStart) & timestampMask) * timestampPeriod);
+
+            Tracer::instance().addGpuZone(scope.name, profilerSlot.submitTicks, offset, static_cast<uint64_t>(milliseconds * 1000000.0));
+        }
+
+        Result& scopeResult = results[scope.result];
+
+        scopeResult.lastMs = milliseconds;
+        scopeResult.averageMs = scopeResult.samples == 0 ? milliseconds : scopeResult.averageMs + (milliseconds - scopeResult.averageMs) * AVERAGE_WEIGHT;
+        scopeResult.minMs = scopeResult.samples == 0 ? milliseconds : std::min(scopeResult.minMs, milliseconds);
+        scopeResult.maxMs = std::max(scopeResult.maxMs, milliseconds);
+        scopeResult.samples++;
+
+        if (scope.statisticsQuery >= 0)
+        {
+            const uint64_t* values = &statistics[scope.statisticsQuery * (STATISTICS_VALUES + 1)];
+
+            scopeResult.vertexInvocations = values[0];
+            scopeResult.clippingPrimitives = values[1];
+            scopeResult.fragmentInvocations = values[2];
+        }
+    }
+
+    profilerSlot.pending = false;
+
+    return true;
+}
+
+uint32_t GpuProfiler::getResultIndex(const char* name, uint32_t depth)
+{
+    auto it = resultIndices.find(name);
+
+    if (it != resultIndices.end())
+    {
+        return it->second;
+    }
+
+    Result result = {};
+    result.name = name;
+    result.depth = depth;
+
+    uint32_t index = static_cast<uint32_t>(results.size());
+
+    results.push_back(result);
+    resultIndices[name] = index;
+
+    return index;
+}
+
+const std::vector<GpuProfiler::Result>& GpuProfiler::getResults()
+{
+    return results;
+}
+
+double GpuProfiler::getLastTime(const std::string& name)
+{
+    auto it = resultIndices.find(name);
+
+    if (it == resultIndices.end() || results[it->second].samples == 0)
+    {
+        return -1.0;
+    }
+
+    return results[it->second].lastMs;
+}
+
+void GpuProfiler::resetResults()
+{
+    for (Result& result : results)
+    {
+        std::string name = result.name;
+        uint32_t depth = result.depth;
+
+        result = Result();
+        result.name = name;
+        result.depth = depth;
+    }
+}
+
+void GpuProfiler::printResults()
+{
+    if (!enabled || results.empty())
+    {
+        return;
+    }
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "GPU profile (rolling average / min / max ms):" << std::endl;
+
+    for (const Result& result : results)
+    {
+        std::cout << "  " << std::string(result.depth * 2, ' ') << result.name << ": "
+                  << result.averageMs << " / " << result.minMs << " / " << result.maxMs
+                  << " over " << result.samples << " samples";
+
+        if (result.vertexInvocations > 0 || result.fragmentInvocations > 0)
+        {
+            std::cout << ", " << result.vertexInvocations << " vertex, " << result.clippingPrimitives
+                      << " primitives, " << result.fragmentInvocations << " fragment invocations";
+        }
+
+        std::cout << std::endl;
+    }
+
+    std::cout << std::defaultfloat << std::setprecision(6);
+}
+
+void GpuProfiler::exportResults(const std::string& path)
+{
+    std::ofstream file(path);
+
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Error: Failed to open GPU profile output " + path);
+    }
+
+    bool csv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+
+    if (csv)
+    {
+        file << "scope,depth,last_ms,average_ms,min_ms,max_ms,samples,vertex_invocations,clipping_primitives,fragment_invocations\n";
+    }
+    else
+    {
+        file << "{\n  \"scopes\": [\n";
+    }
+
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const Result& result = results[i];
+
+        if (csv)
+        {
+            file << result.name << "," << result.depth << "," << result.lastMs << "," << result.averageMs << ","
+                 << result.minMs << "," << result.maxMs << "," << result.samples << "," << result.vertexInvocations << ","
+                 << result.clippingPrimitives << "," << result.fragmentInvocations << "\n";
+        }
+        else
+        {
+            file << "    { \"name\": \"" << result.name << "\", \"depth\": " << result.depth
+                 << ", \"last_ms\": " << result.lastMs << ", \"average_ms\": " << result.averageMs
+                 << ", \"min_ms\": " << result.minMs << ", \"max_ms\": " << result.maxMs
+                 << ", \"samples\": " << result.samples << ", \"vertex_invocations\": " << result.vertexInvocations
+                 << ", \"clipping_primitives\": " << result.clippingPrimitives
+                 << ", \"fragment_invocations\": " << result.fragmentInvocations << " }"
+                 << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+    }
+
+    if (!csv)
+    {
+        file << "  ]\n}\n";
+    }
+
+    std::cout << "GPU profile written to " << path << std::endl;
+}
+
+void GpuProfiler::cleanup()
+{
+    VkDevice device = DeviceManager::instance().getDevice();
+
+    for (Slot& slot : slots)
+    {
+        if (slot.timestampPool != VK_NULL_HANDLE)
+        {
+            vkDestroyQueryPool(device, slot.timestampPool, nullptr);
+        }
+
+        if (slot.statisticsPool != VK_NULL_HANDLE)
+        {
+            vkDestroyQueryPool(device, slot.statisticsPool, nullptr);
+        }
+    }
+
+    slots.clear();
+}
\ No newline at end of file
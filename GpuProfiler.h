@@ -0,0 +1,151 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+
+#include <GLFW/glfw3.h>
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "DeviceManager.h"
+
+// Query sets owned by one command buffer, reused every time it is submitted
+typedef uint32_t ProfilerSlot;
+
+// GPU timestamps around named scopes, with optional pipeline statistics
+// Each command buffer records into its own slot, which is read back without waiting once its
+// submission has completed, so results are always one use of the slot old and never stall
+class GpuProfiler
+{
+private:
+
+    GpuProfiler() {}
+
+    struct ScopeRecord
+    {
+        const char* name;
+        uint32_t result;
+        uint32_t startQuery;
+        uint32_t endQuery;
+
+        // Statistics query index, or -1 if the scope has none
+        int32_t statisticsQuery;
+    };
+
+    struct Slot
+    {
+        VkQueryPool timestampPool;
+        VkQueryPool statisticsPool;
+
+        std::vector<ScopeRecord> scopes;
+        std::vector<uint32_t> openScopes;
+        uint32_t statisticsQueries;
+        bool statisticsActive;
+
+        // Submitted since its results were last read
+        bool pending;
+
+        // CPU time of the last submission, where its scopes are placed on the trace timeline
+        uint64_t submitTicks;
+    };
+
+    bool enabled = false;
+    bool statisticsEnabled = false;
+
+    // Nanoseconds per tick, and the bits of each timestamp that are valid
+    double timestampPeriod;
+    uint64_t timestampMask;
+
+    std::vector<Slot> slots;
+
+public:
+
+    // Rolling timings for every scope of the same name
+    struct Result
+    {
+        std::string name;
+        uint32_t depth;
+
+        double lastMs;
+        double averageMs;
+        double minMs;
+        double maxMs;
+        uint64_t samples;
+
+        // Last values, only filled by scopes recorded with statistics
+        uint64_t vertexInvocations;
+        uint64_t clippingPrimitives;
+        uint64_t fragmentInvocations;
+    };
+
+    // Scope markers per slot, two timestamps each
+    static const uint32_t MAX_SCOPES = 64;
+
+    // Scope marker for the lifetime of the object
+    class Scope
+    {
+    public:
+
+        Scope(VkCommandBuffer commandBuffer, ProfilerSlot slot, const char* name, bool statistics = false);
+        ~Scope();
+
+        Scope(Scope const&)                 = delete;
+        void operator=(Scope const&)        = delete;
+
+    private:
+
+        VkCommandBuffer commandBuffer;
+        ProfilerSlot slot;
+    };
+
+    // Return singleton instance
+    static GpuProfiler& instance();
+
+    // Ensure singleton is never copied
+    GpuProfiler(GpuProfiler const&)         = delete;
+    void operator=(GpuProfiler const&)      = delete;
+
+    // Timestamps are disabled if the queue family has none, statistics if the device feature is missing
+    void init(uint32_t queueFamilyIndex, bool pipelineStatistics);
+
+    ProfilerSlot createSlot();
+
+    bool isEnabled();
+    bool hasPipelineStatistics();
+
+    // Start recording a slot's scopes into a command buffer, outside any render pass
+    void beginRecording(VkCommandBuffer commandBuffer, ProfilerSlot slot);
+    void endRecording(ProfilerSlot slot);
+
+    // Statistics scopes must not nest and must begin and end on the same side of a render pass
+    void beginScope(VkCommandBuffer commandBuffer, ProfilerSlot slot, const char* name, bool statistics = false);
+    void endScope(VkCommandBuffer commandBuffer, ProfilerSlot slot);
+
+    // Call after every submission of the slot's command buffer
+    void submitted(ProfilerSlot slot);
+
+    // Read the slot's last submission if it has completed, returns false without waiting otherwise
+    bool collect(ProfilerSlot slot);
+
+    const std::vector<Result>& getResults();
+
+    // Last time of the named scope in milliseconds, or -1 if it has not been read yet
+    double getLastTime(const std::string& name);
+
+    void resetResults();
+
+    void printResults();
+
+    // Write results as JSON, or CSV if the path ends in .csv
+    void exportResults(const std::string& path);
+
+    void cleanup();
+
+private:
+
+    std::vector<Result> results;
+    std::unordered_map<std::string, uint32_t> resultIndices;
+
+    uint32_t getResultIndex(const char* name, uint32_t depth);
+};
\ No newline at end of file
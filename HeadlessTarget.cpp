@@ -0,0 +1,351 @@
+#include "HeadlessTarget.h"
+
+#include "DeletionQueue.h"
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+
+HeadlessTarget::HeadlessTarget(uint32_t width, uint32_t height, uint32_t frameLimit, const std::string& capturePath)
+    : frameLimit(frameLimit), capturePath(capturePath)
+{
+    extent = { width, height };
+}
+
+void HeadlessTarget::init()
+{
+    // No window system is touched, so this runs on display-less machines
+}
+
+void HeadlessTarget::cleanup()
+{
+}
+
+std::vector<const char*> HeadlessTarget::getRequiredInstanceExtensions()
+{
+    return std::vector<const char*>();
+}
+
+void HeadlessTarget::createSurface(VkInstance instance)
+{
+}
+
+void HeadlessTarget::destroySurface(VkInstance instance)
+{
+}
+
+VkSurfaceKHR HeadlessTarget::getSurface()
+{
+    return VK_NULL_HANDLE;
+}
+
+GLFWwindow* HeadlessTarget::getWindow()
+{
+    return nullptr;
+}
+
+void HeadlessTarget::pollEvents()
+{
+}
+
+bool HeadlessTarget::shouldClose()
+{
+    return frameLimit > 0 && framesPresented >= frameLimit;
+}
+
+void HeadlessTarget::setQueues(VkQueue graphicsQueue, VkQueue presentQueue)
+{
+    // Readback runs on the graphics queue, there is no present queue
+    queue = graphicsQueue;
+}
+
+void HeadlessTarget::createImages()
+{
+    VkDevice device = DeviceManager::instance().getDevice();
+    QueueFamilyIndices indices = QueueFamilyIndices::findQueueFamilies(DeviceManager::instance().getPhysicalDevice(), VK_NULL_HANDLE);
+
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = indices.graphicsFamily;
+
+    if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Error: Failed to create headless command pool");
+    }
+
+    frames.resize(IMAGE_COUNT);
+
+    for (Frame& frame : frames)
+    {
+        // Colour target, read back by transfer after the render pass
+        VkImageCreateInfo imageInfo = {};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent.width = extent.width;
+        imageInfo.extent.height = extent.height;
+        imageInfo.extent.depth = 1;
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = format;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+
+        if (vkCreateImage(device, &imageInfo, nullptr, &frame.image) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Error: Failed to create headless colour image");
+        }
+
+        VkMemoryRequirements memRequirements;
+        vkGetImageMemoryRequirements(device, frame.image, &memRequirements);
+
+        frame.imageMemory = Utils::allocateTrackedMemory(memRequirements.size, Utils::findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT), "headless colour image");
+
+        vkBindImageMemory(device, frame.image, frame.imageMemory, 0);
+
+        VkImageViewCreateInfo viewInfo = {};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = frame.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = format;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(device, &viewInfo, nullptr, &frame.imageView) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Error: Failed to create headless colour image view");
+        }
+
+        Utils::createBuffer(static_cast<VkDeviceSize>(extent.width) * extent.height * 4, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                            frame.readbackBuffer, frame.readbackMemory);
+
+        VkCommandBufferAllocateInfo commandInfo = {};
+        commandInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        commandInfo.commandPool = commandPool;
+        commandInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        commandInfo.commandBufferCount = 1;
+
+        if (vkAllocateCommandBuffers(device, &commandInfo, &frame.readbackCommands) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Error: Failed to allocate headless readback command buffer");
+        }
+
+        recordReadback(frame);
+
+        frame.framebuffer = VK_NULL_HANDLE;
+    }
+}
+
+void HeadlessTarget::recordReadback(Frame& frame)
+{
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+
+    vkBeginCommandBuffer(frame.readbackCommands, &beginInfo);
+
+    // The frame leaves the image in TRANSFER_SRC_OPTIMAL, the semaphore wait orders it before this copy
+    VkBufferImageCopy region = {};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = { 0, 0, 0 };
+    region.imageExtent = { extent.width, extent.height, 1 };
+
+    vkCmdCopyImageToBuffer(frame.readbackCommands, frame.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, frame.readbackBuffer, 1, &region);
+
+    // Make the copy visible to host reads once the fence signals
+    VkBufferMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = frame.readbackBuffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+
+    vkCmdPipelineBarrier(frame.readbackCommands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+    if (vkEndCommandBuffer(frame.readbackCommands) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Error: Failed to record headless readback command buffer");
+    }
+}
+
+void HeadlessTarget::createFramebuffers(VkImageView depthImageView, VkImageView multisampleImageView, VkRenderPass renderPass)
+{
+    for (Frame& frame : frames)
+    {
+        std::vector<VkImageView> attachments = { frame.imageView, depthImageView };
+
+        if (multisampleImageView != VK_NULL_HANDLE)
+        {
+            attachments.push_back(multisampleImageView);
+        }
+
+        VkFramebufferCreateInfo framebufferInfo = {};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass = renderPass;
+        framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        framebufferInfo.pAttachments = attachments.data();
+        framebufferInfo.width = extent.width;
+        framebufferInfo.height = extent.height;
+        framebufferInfo.layers = 1;
+
+        if (vkCreateFramebuffer(DeviceManager::instance().getDevice(), &framebufferInfo, nullptr, &frame.framebuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Error: Failed to create headless framebuffer");
+        }
+    }
+}
+
+void HeadlessTarget::destroyFramebuffers()
+{
+    // Frames already submitted may still render to these, so they go once those frames complete
+    SyncTicket lastUse = SyncManager::instance().getLastTicket();
+
+    for (Frame& frame : frames)
+    {
+        DeletionQueue::instance().destroyFramebuffer(lastUse, frame.framebuffer);
+        frame.framebuffer = VK_NULL_HANDLE;
+    }
+}
+
+void HeadlessTarget::destroyImages()
+{
+    VkDevice device = DeviceManager::instance().getDevice();
+
+    for (Frame& frame : frames)
+    {
+        vkDestroyFramebuffer(device, frame.framebuffer, nullptr);
+        vkDestroyImageView(device, frame.imageView, nullptr);
+        vkDestroyImage(device, frame.image, nullptr);
+        Utils::freeTrackedMemory(frame.imageMemory);
+        vkDestroyBuffer(device, frame.readbackBuffer, nullptr);
+        Utils::freeTrackedMemory(frame.readbackMemory);
+    }
+
+    frames.clear();
+
+    vkDestroyCommandPool(device, commandPool, nullptr);
+}
+
+VkFormat HeadlessTarget::getImageFormat()
+{
+    return format;
+}
+
+VkExtent2D HeadlessTarget::getExtent()
+{
+    return extent;
+}
+
+uint32_t HeadlessTarget::getImageCount()
+{
+    return IMAGE_COUNT;
+}
+
+VkFramebuffer HeadlessTarget::getFramebuffer(uint32_t imageIndex)
+{
+    return frames[imageIndex].framebuffer;
+}
+
+VkImage HeadlessTarget::getImage(uint32_t imageIndex)
+{
+    return frames[imageIndex].image;
+}
+
+VkImageLayout HeadlessTarget::getFinalLayout()
+{
+    return VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+}
+
+VkResult HeadlessTarget::acquireNextImage(VkSemaphore imageAvailable, uint32_t& imageIndex)
+{
+    // Images are reused round robin, so wait out the image's previous readback
+    // A signal-only submission stands in for the swapchain, so the frame submission is the same as when presenting
+    imageIndex = nextImage;
+    nextImage = (nextImage + 1) % IMAGE_COUNT;
+
+    SyncManager::instance().wait(frames[imageIndex].readbackTicket);
+
+    DeviceManager::instance().getGraphicsQueue().submit(VK_NULL_HANDLE, std::vector<Queue::Wait>(), imageAvailable);
+
+    return VK_SUCCESS;
+}
+
+VkResult HeadlessTarget::present(VkSemaphore renderFinished, uint32_t imageIndex, uint32_t presentId)
+{
+    std::vector<Queue::Wait> waits(1);
+    waits[0].semaphore = renderFinished;
+    waits[0].stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+    Queue& graphicsQueue = DeviceManager::instance().getGraphicsQueue();
+    graphicsQueue.submit(frames[imageIndex].readbackCommands, waits);
+    frames[imageIndex].readbackTicket = graphicsQueue.flush();
+
+    framesPresented++;
+
+    // Only a capture needs the pixels on the CPU straight away
+    if (!capturePath.empty() && framesPresented == frameLimit)
+    {
+        SyncManager::instance().wait(frames[imageIndex].readbackTicket);
+        saveFrame(imageIndex, capturePath);
+    }
+
+    return VK_SUCCESS;
+}
+
+void HeadlessTarget::getPresentTimes(std::vector<PresentTime>& times)
+{
+    // Nothing is displayed
+    times.clear();
+}
+
+void HeadlessTarget::readPixels(uint32_t imageIndex, std::vector<uint8_t>& pixels)
+{
+    VkDevice device = DeviceManager::instance().getDevice();
+    VkDeviceSize size = static_cast<VkDeviceSize>(extent.width) * extent.height * 4;
+
+    pixels.resize(size);
+
+    void* data;
+    vkMapMemory(device, frames[imageIndex].readbackMemory, 0, size, 0, &data);
+    memcpy(pixels.data(), data, size);
+    vkUnmapMemory(device, frames[imageIndex].readbackMemory);
+}
+
+void HeadlessTarget::saveFrame(uint32_t imageIndex, const std::string& path)
+{
+    std::vector<uint8_t> pixels;
+    readPixels(imageIndex, pixels);
+
+    std::ofstream file(path, std::ios::binary);
+
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Error: Failed to open capture file");
+    }
+
+    file << "P6\n" << extent.width << " " << extent.height << "\n255\n";
+
+    // BGRA to RGB
+    for (size_t i = 0; i < pixels.size(); i += 4)
+    {
+        char rgb[3] = { static_cast<char>(pixels[i + 2]), static_cast<char>(pixels[i + 1]), static_cast<char>(pixels[i + 0]) };
+        file.write(rgb, 3);
+    }
+
+    std::cout << "Captured frame " << framesPresented << " to " << path << std::endl;
+}
\ No newline at end of file
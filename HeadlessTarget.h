@@ -0,0 +1,98 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+
+#include <GLFW/glfw3.h>
+
+#include <string>
+#include <vector>
+
+#include "PresentationTarget.h"
+#include "Utils.h"
+#include "SyncManager.h"
+
+// Renders into device-local colour images with no window, surface or swapchain
+// Every presented frame is copied back to a host-visible staging buffer; the last one can be written out as a PPM
+class HeadlessTarget : public PresentationTarget
+{
+private:
+
+    static const uint32_t IMAGE_COUNT = 2;
+
+    struct Frame
+    {
+        VkImage image;
+        VkDeviceMemory imageMemory;
+        VkImageView imageView;
+        VkFramebuffer framebuffer;
+
+        // Readback of the image after it has been rendered
+        VkBuffer readbackBuffer;
+        VkDeviceMemory readbackMemory;
+        VkCommandBuffer readbackCommands;
+
+        // Readback submission, the image and buffer are free once it completes
+        SyncTicket readbackTicket;
+    };
+
+    VkExtent2D extent;
+    VkFormat format = VK_FORMAT_B8G8R8A8_UNORM;
+
+    // Stop after this many frames, 0 runs until interrupted
+    uint32_t frameLimit;
+    uint32_t framesPresented = 0;
+    uint32_t nextImage = 0;
+
+    std::string capturePath;
+
+    VkQueue queue;
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+
+    std::vector<Frame> frames;
+
+    void recordReadback(Frame& frame);
+
+public:
+
+    HeadlessTarget(uint32_t width, uint32_t height, uint32_t frameLimit, const std::string& capturePath);
+
+    void init() override;
+    void cleanup() override;
+
+    std::vector<const char*> getRequiredInstanceExtensions() override;
+
+    void createSurface(VkInstance instance) override;
+    void destroySurface(VkInstance instance) override;
+    VkSurfaceKHR getSurface() override;
+
+    GLFWwindow* getWindow() override;
+
+    void pollEvents() override;
+    bool shouldClose() override;
+
+    void setQueues(VkQueue graphicsQueue, VkQueue presentQueue) override;
+
+    void createImages() override;
+    void destroyImages() override;
+
+    void createFramebuffers(VkImageView depthImageView, VkImageView multisampleImageView, VkRenderPass renderPass) override;
+    void destroyFramebuffers() override;
+
+    VkFormat getImageFormat() override;
+    VkExtent2D getExtent() override;
+    uint32_t getImageCount() override;
+    VkFramebuffer getFramebuffer(uint32_t imageIndex) override;
+    VkImage getImage(uint32_t imageIndex) override;
+
+    VkImageLayout getFinalLayout() override;
+
+    VkResult acquireNextImage(VkSemaphore imageAvailable, uint32_t& imageIndex) override;
+    VkResult present(VkSemaphore renderFinished, uint32_t imageIndex, uint32_t presentId) override;
+    void getPresentTimes(std::vector<PresentTime>& times) override;
+
+    // Tightly packed BGRA8 pixels of a presented image
+    void readPixels(uint32_t imageIndex, std::vector<uint8_t>& pixels);
+
+    // Write a presented image as a binary PPM
+    void saveFrame(uint32_t imageIndex, const std::string& path);
+};
\ No newline at end of file
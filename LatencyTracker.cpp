@@ -0,0 +1,160 @@
+#include "LatencyTracker.h"
+
+#include "Benchmark.h"
+
+#include <iostream>
+#include <iomanip>
+
+namespace
+{
+    // Frames waiting on a display time, older ones are given up on (and never wait without display timing)
+    const size_t MAX_PENDING_FRAMES = 16;
+}
+
+const char* LatencyTracker::getStageName(Stage stage)
+{
+    switch (stage)
+    {
+    case SUBMIT:   return "submit";
+    case PRESENT:  return "present";
+    case COMPLETE: return "complete";
+    case DISPLAY:  return "display";
+    default:       return "other";
+    }
+}
+
+uint32_t LatencyTracker::beginFrame()
+{
+    return beginFrame(Clock::now());
+}
+
+uint32_t LatencyTracker::beginFrame(Clock::time_point input)
+{
+    Frame frame = {};
+    frame.id = nextId++;
+    frame.input = input;
+
+    frames.push_back(frame);
+
+    while (frames.size() > MAX_PENDING_FRAMES)
+    {
+        frames.pop_front();
+    }
+
+    return frame.id;
+}
+
+void LatencyTracker::submitted(uint32_t frame, SyncTicket ticket)
+{
+    Frame* tracked = findFrame(frame);
+
+    if (tracked != nullptr)
+    {
+        tracked->ticket = ticket;
+        addSample(SUBMIT, *tracked, Clock::now());
+    }
+}
+
+void LatencyTracker::presented(uint32_t frame)
+{
+    Frame* tracked = findFrame(frame);
+
+    if (tracked != nullptr)
+    {
+        addSample(PRESENT, *tracked, Clock::now());
+    }
+}
+
+void LatencyTracker::update(const std::vector<PresentTime>& presentTimes)
+{
+    Clock::time_point now = Clock::now();
+
+    for (Frame& frame : frames)
+    {
+        if (!frame.complete && frame.ticket != 0 && SyncManager::instance().isComplete(frame.ticket))
+        {
+            frame.complete = true;
+            addSample(COMPLETE, frame, now);
+        }
+    }
+
+    for (const PresentTime& presentTime : presentTimes)
+    {
+        Frame* frame = findFrame(presentTime.presentId);
+
+        if (frame == nullptr || frame->displayed)
+        {
+            continue;
+        }
+
+        frame->displayed = true;
+
+        Clock::time_point displayed = Clock::time_point(std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(presentTime.displayedNs)));
+
+        // A display clock other than the steady clock would give nonsense, so drop anything before the input
+        if (displayed >= frame->input)
+        {
+            addSample(DISPLAY, *frame, displayed);
+        }
+    }
+
+    while (!frames.empty() && frames.front().complete && frames.front().displayed)
+    {
+        frames.pop_front();
+    }
+}
+
+void LatencyTracker::reset()
+{
+    for (uint32_t stage = 0; stage < STAGE_COUNT; stage++)
+    {
+        samples[stage].clear();
+    }
+}
+
+const std::vector<double>& LatencyTracker::getSamples(Stage stage) const
+{
+    return samples[stage];
+}
+
+void LatencyTracker::printSummary() const
+{
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Input latency:" << std::endl;
+
+    for (uint32_t stage = 0; stage < STAGE_COUNT; stage++)
+    {
+        std::cout << "  to " << getStageName(static_cast<Stage>(stage)) << " ms: ";
+
+        if (samples[stage].empty())
+        {
+            std::cout << "not available" << std::endl;
+            continue;
+        }
+
+        Benchmark::Summary summary = Benchmark::summarize(samples[stage]);
+
+        std::cout << "mean " << summary.mean << ", p50 " << summary.p50 << ", p95 " << summary.p95
+                  << ", p99 " << summary.p99 << ", max " << summary.max << std::endl;
+    }
+
+    std::cout << std::defaultfloat << std::setprecision(6);
+}
+
+LatencyTracker::Frame* LatencyTracker::findFrame(uint32_t id)
+{
+    for (Frame& frame : frames)
+    {
+        if (frame.id == id)
+        {
+            return &frame;
+        }
+    }
+
+    return nullptr;
+}
+
+void LatencyTracker::addSample(Stage stage, const Frame& frame, Clock::time_point time)
+{
+    samples[stage].push_back(std::chrono::duration<double, std::milli>(time - frame.input).count());
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "PresentationTarget.h"
+#include "SyncManager.h"
+
+// Input-to-present latency
+// Each frame carries the time its input was sampled, and every later point the main thread sees it reach is
+// recorded against it: the submit, the present call, the submission completing and, where the target reports
+// it, the frame reaching the display. Completion is seen by polling, so it is an upper bound. Main thread only.
+class LatencyTracker
+{
+public:
+
+    typedef std::chrono::steady_clock Clock;
+
+    enum Stage
+    {
+        SUBMIT,
+        PRESENT,
+        COMPLETE,
+        DISPLAY,
+        STAGE_COUNT
+    };
+
+    static const char* getStageName(Stage stage);
+
+    // Input for a new frame was just sampled, returns the id the frame is tracked and presented by
+    uint32_t beginFrame();
+
+    // Input sampled earlier, such as that of a simulation step the frame draws
+    uint32_t beginFrame(Clock::time_point input);
+
+    void submitted(uint32_t frame, SyncTicket ticket);
+    void presented(uint32_t frame);
+
+    // Record the frames whose submission has completed, and the display times the target reported
+    void update(const std::vector<PresentTime>& presentTimes);
+
+    // Drop the samples so far, such as those of warmup frames
+    void reset();
+
+    // Milliseconds from input to the stage, one per frame that reached it
+    const std::vector<double>& getSamples(Stage stage) const;
+
+    void printSummary() const;
+
+private:
+
+    struct Frame
+    {
+        uint32_t id;
+        Clock::time_point input;
+        SyncTicket ticket;
+        bool complete;
+        bool displayed;
+    };
+
+    // Oldest first, kept until displayed or pushed out by newer frames
+    std::deque<Frame> frames;
+    uint32_t nextId = 1;
+
+    std::vector<double> samples[STAGE_COUNT];
+
+    Frame* findFrame(uint32_t id);
+    void addSample(Stage stage, const Frame& frame, Clock::time_point time);
+};
\ No newline at end of file
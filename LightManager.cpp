@@ -0,0 +1,514 @@
+#include "LightManager.h"
+
+#include "DescriptorManager.h"
+#include "ShaderReflection.h"
+#include "Tracer.h"
+#include "Utils.h"
+
+#include <iostream>
+#include <cstring>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <array>
+#include <random>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    // Start of the exponential depth slices, everything nearer shares the first slice
+    // The projection's near plane is far too close to slice from usefully
+    const float SLICE_NEAR = 0.5f;
+
+    const uint32_t CLUSTER_COUNT = LightManager::GRID_X * LightManager::GRID_Y * LightManager::GRID_Z;
+
+    // Count followed by the light indices
+    const uint32_t CLUSTER_STRIDE = LightManager::MAX_CLUSTER_LIGHTS + 1;
+}
+
+LightManager& LightManager::instance()
+{
+    static LightManager instance;
+
+    return instance;
+}
+
+ShaderManager::ShaderDefines LightManager::getGridDefines()
+{
+    ShaderManager::ShaderDefines defines;
+    defines["CLUSTER_X"] = std::to_string(GRID_X);
+    defines["CLUSTER_Y"] = std::to_string(GRID_Y);
+    defines["CLUSTER_Z"] = std::to_string(GRID_Z);
+    defines["MAX_CLUSTER_LIGHTS"] = std::to_string(MAX_CLUSTER_LIGHTS);
+
+    return defines;
+}
+
+void LightManager::init(uint32_t lightCount, float sceneRadius, const std::vector<char>& computeCode)
+{
+    this->lightCount = lightCount;
+
+    // Fixed seed, so benchmark runs light the scene identically
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    orbitRadius.resize(lightCount);
+    orbitHeight.resize(lightCount);
+    orbitPhase.resize(lightCount);
+    orbitSpeed.resize(lightCount);
+    lights.resize(lightCount);
+
+    for (uint32_t i = 0; i < lightCount; i++)
+    {
+        // Uniform over the disc covering the scene
+        orbitRadius[i] = sceneRadius * std::sqrt(unit(random));
+        orbitHeight[i] = -1.0f + 4.0f * unit(random);
+        orbitPhase[i] = 6.2831853f * unit(random);
+        orbitSpeed[i] = -0.5f + unit(random);
+
+        glm::vec3 color(unit(random), unit(random), unit(random));
+
+        lights[i].positionRadius.w = 1.5f + 2.5f * unit(random);
+        lights[i].colorPower = glm::vec4(color / std::max(std::max(color.x, color.y), std::max(color.z, 0.01f)), 4.0f + 6.0f * unit(random));
+    }
+
+    // Padding lights sit behind the camera with no radius, so they never bin
+    size_t padded = (lightCount + 3) & ~static_cast<size_t>(3);
+
+    viewX.assign(padded, 0.0f);
+    viewY.assign(padded, 0.0f);
+    viewZ.assign(padded, 1.0f);
+    viewRadius.assign(padded, 0.0f);
+
+    VkDevice device = DeviceManager::instance().getDevice();
+
+    // Rewritten by the CPU every frame
+    lightBufferSize = sizeof(LightHeader) + std::max<VkDeviceSize>(lightCount, 1) * sizeof(GpuLight);
+
+    Utils::createBuffer(lightBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                        lightBuffer, lightMemory);
+
+    void* data;
+    vkMapMemory(device, lightMemory, 0, lightBufferSize, 0, &data);
+    lightData = static_cast<uint8_t*>(data);
+
+    memset(lightData, 0, lightBufferSize);
+
+    clusterBufferSize = static_cast<VkDeviceSize>(CLUSTER_COUNT) * CLUSTER_STRIDE * sizeof(uint32_t);
+
+    if (!computeCode.empty())
+    {
+        Utils::createBuffer(clusterBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, clusterBuffer, clusterMemory);
+
+        createComputePipeline(computeCode);
+    }
+    else
+    {
+        Utils::createBuffer(clusterBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                            clusterBuffer, clusterMemory);
+
+        vkMapMemory(device, clusterMemory, 0, clusterBufferSize, 0, &data);
+        clusterData = static_cast<uint32_t*>(data);
+
+        memset(clusterData, 0, clusterBufferSize);
+        clusterCounts.assign(CLUSTER_COUNT, 0);
+    }
+
+    stats = {};
+    stats.lights = lightCount;
+    stats.gpuBinning = pipeline != VK_NULL_HANDLE;
+}
+
+void LightManager::createComputePipeline(const std::vector<char>& code)
+{
+    VkDevice device = DeviceManager::instance().getDevice();
+
+    ShaderReflection reflection = ShaderReflection::reflect(code);
+    std::vector<VkDescriptorSetLayoutBinding> bindings = reflection.getLayoutBindings(0);
+
+    // Layouts are owned and deduplicated by the descriptor manager
+    VkDescriptorSetLayout descriptorSetLayout = DescriptorManager::instance().getLayout(bindings.data(), static_cast<uint32_t>(bindings.size()));
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Error: Failed to create light binning pipeline layout");
+    }
+
+    VkShaderModuleCreateInfo moduleInfo = {};
+    moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    moduleInfo.codeSize = code.size();
+    moduleInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+    VkShaderModule shaderModule;
+
+    if (vkCreateShaderModule(device, &moduleInfo, nullptr, &shaderModule) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Error: Failed to create light binning shader module");
+    }
+
+    VkComputePipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = pipelineLayout;
+
+    VkResult result = vkCreateComputePipelines(device, ShaderManager::instance().getPipelineCache(), 1, &pipelineInfo, nullptr, &pipeline);
+
+    vkDestroyShaderModule(device, shaderModule, nullptr);
+
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Error: Failed to create light binning pipeline");
+    }
+
+    VkDescriptorBufferInfo lightInfo = {};
+    lightInfo.buffer = lightBuffer;
+    lightInfo.offset = 0;
+    lightInfo.range = lightBufferSize;
+
+    VkDescriptorBufferInfo clusterInfo = {};
+    clusterInfo.buffer = clusterBuffer;
+    clusterInfo.offset = 0;
+    clusterInfo.range = clusterBufferSize;
+
+    std::array<VkWriteDescriptorSet, 2> descriptorWrites = {};
+
+    descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[0].dstBinding = 0;
+    descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptorWrites[0].descriptorCount = 1;
+    descriptorWrites[0].pBufferInfo = &lightInfo;
+
+    descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[1].dstBinding = 1;
+    descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptorWrites[1].descriptorCount = 1;
+    descriptorWrites[1].pBufferInfo = &clusterInfo;
+
+    descriptorSet = DescriptorManager::instance().getCachedSet(descriptorSetLayout, descriptorWrites.data(), static_cast<uint32_t>(descriptorWrites.size()));
+}
+
+void LightManager::update(float time, const glm::mat4& view, const glm::mat4& proj, VkExtent2D extent)
+{
+    TRACE_ZONE("updateLights");
+
+    // Planes of a zero-to-one depth perspective projection
+    float nearPlane = proj[3][2] / proj[2][2];
+    float farPlane = proj[3][2] / (proj[2][2] + 1.0f);
+    float sliceNear = std::min(std::max(SLICE_NEAR, nearPlane), farPlane);
+
+    LightHeader header;
+    header.projection = glm::vec4(proj[0][0], proj[1][1], nearPlane, farPlane);
+    header.grid = glm::uvec4(GRID_X, GRID_Y, GRID_Z, lightCount);
+    header.screen = glm::vec4(extent.width, extent.height, sliceNear, (GRID_Z - 1) / std::log(farPlane / sliceNear));
+
+    for (uint32_t i = 0; i < lightCount; i++)
+    {
+        float angle = orbitPhase[i] + orbitSpeed[i] * time;
+        glm::vec4 world(orbitRadius[i] * std::cos(angle), orbitHeight[i] + 0.5f * std::sin(time + orbitPhase[i]), orbitRadius[i] * std::sin(angle), 1.0f);
+        glm::vec4 position = view * world;
+
+        lights[i].positionRadius = glm::vec4(glm::vec3(position), lights[i].positionRadius.w);
+
+        viewX[i] = position.x;
+        viewY[i] = position.y;
+        viewZ[i] = position.z;
+        viewRadius[i] = lights[i].positionRadius.w;
+    }
+
+    memcpy(lightData, &header, sizeof(header));
+
+    if (lightCount > 0)
+    {
+        memcpy(lightData + sizeof(header), lights.data(), lights.size() * sizeof(GpuLight));
+    }
+
+    if (pipeline == VK_NULL_HANDLE)
+    {
+        binLights(header);
+    }
+}
+
+void LightManager::binLights(const LightHeader& header)
+{
+    TRACE_ZONE("binLights");
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    std::fill(clusterCounts.begin(), clusterCounts.end(), 0);
+
+    float nearPlane = header.projection.z;
+
+    // View-space bounds of each light's box as x/w and y/w ranges plus a depth range, the frustum is symmetric
+    // so projecting them only takes P[0][0] and P[1][1]
+#if defined(__SSE2__)
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 nearVector = _mm_set1_ps(nearPlane);
+
+    alignas(16) float minX[4], maxX[4], minY[4], maxY[4], depthMin[4], depthMax[4];
+
+    for (size_t i = 0; i < viewX.size(); i += 4)
+    {
+        __m128 x = _mm_loadu_ps(&viewX[i]);
+        __m128 y = _mm_loadu_ps(&viewY[i]);
+        __m128 w = _mm_sub_ps(zero, _mm_loadu_ps(&viewZ[i]));
+        __m128 r = _mm_loadu_ps(&viewRadius[i]);
+
+        __m128 wMin = _mm_max_ps(_mm_sub_ps(w, r), nearVector);
+        __m128 wMax = _mm_add_ps(w, r);
+
+        // Dividing by the nearest depth widens a bound on its outer side, the farthest narrows the inner one
+        __m128 xLow = _mm_sub_ps(x, r);
+        __m128 xHigh = _mm_add_ps(x, r);
+        __m128 yLow = _mm_sub_ps(y, r);
+        __m128 yHigh = _mm_add_ps(y, r);
+
+        __m128 xLowNegative = _mm_cmplt_ps(xLow, zero);
+        __m128 xHighPositive = _mm_cmpgt_ps(xHigh, zero);
+        __m128 yLowNegative = _mm_cmplt_ps(yLow, zero);
+        __m128 yHighPositive = _mm_cmpgt_ps(yHigh, zero);
+
+        __m128 xLowDepth = _mm_or_ps(_mm_and_ps(xLowNegative, wMin), _mm_andnot_ps(xLowNegative, wMax));
+        __m128 xHighDepth = _mm_or_ps(_mm_and_ps(xHighPositive, wMin), _mm_andnot_ps(xHighPositive, wMax));
+        __m128 yLowDepth = _mm_or_ps(_mm_and_ps(yLowNegative, wMin), _mm_andnot_ps(yLowNegative, wMax));
+        __m128 yHighDepth = _mm_or_ps(_mm_and_ps(yHighPositive, wMin), _mm_andnot_ps(yHighPositive, wMax));
+
+        _mm_store_ps(minX, _mm_div_ps(xLow, xLowDepth));
+        _mm_store_ps(maxX, _mm_div_ps(xHigh, xHighDepth));
+        _mm_store_ps(minY, _mm_div_ps(yLow, yLowDepth));
+        _mm_store_ps(maxY, _mm_div_ps(yHigh, yHighDepth));
+        _mm_store_ps(depthMin, wMin);
+        _mm_store_ps(depthMax, wMax);
+
+        // Wholly in front of the near plane
+        int visibleMask = _mm_movemask_ps(_mm_cmpgt_ps(wMax, nearVector));
+
+        for (int k = 0; k < 4; k++)
+        {
+            if ((visibleMask >> k) & 1)
+            {
+                insertLight(static_cast<uint32_t>(i + k), minX[k], maxX[k], minY[k], maxY[k], depthMin[k], depthMax[k], header);
+            }
+        }
+    }
+#else
+    for (size_t i = 0; i < viewX.size(); i++)
+    {
+        float w = -viewZ[i];
+        float r = viewRadius[i];
+
+        float wMin = std::max(w - r, nearPlane);
+        float wMax = w + r;
+
+        if (wMax <= nearPlane)
+        {
+            continue;
+        }
+
+        float xLow = viewX[i] - r;
+        float xHigh = viewX[i] + r;
+        float yLow = viewY[i] - r;
+        float yHigh = viewY[i] + r;
+
+        insertLight(static_cast<uint32_t>(i),
+                    xLow / (xLow < 0.0f ? wMin : wMax), xHigh / (xHigh > 0.0f ? wMin : wMax),
+                    yLow / (yLow < 0.0f ? wMin : wMax), yHigh / (yHigh > 0.0f ? wMin : wMax),
+                    wMin, wMax, header);
+    }
+#endif
+
+    // Counts go in last, ahead of each cluster's indices
+    uint32_t maxCount = 0;
+    uint64_t total = 0;
+
+    for (uint32_t cluster = 0; cluster < CLUSTER_COUNT; cluster++)
+    {
+        clusterData[cluster * CLUSTER_STRIDE] = clusterCounts[cluster];
+
+        maxCount = std::max(maxCount, clusterCounts[cluster]);
+        total += clusterCounts[cluster];
+    }
+
+    stats.binnedFrames++;
+    stats.binMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+    stats.maxClusterLights = std::max(stats.maxClusterLights, maxCount);
+    stats.clusterLightTotal += total;
+}
+
+void LightManager::insertLight(uint32_t index, float minX, float maxX, float minY, float maxY, float depthMin, float depthMax, const LightHeader& header)
+{
+    if (index >= lightCount || depthMin > header.projection.w)
+    {
+        return;
+    }
+
+    float ndcMinX = minX * header.projection.x;
+    float ndcMaxX = maxX * header.projection.x;
+
+    // Y is flipped in the projection, so its sign swaps the bounds
+    float ndcMinY = std::min(minY * header.projection.y, maxY * header.projection.y);
+    float ndcMaxY = std::max(minY * header.projection.y, maxY * header.projection.y);
+
+    if (ndcMaxX < -1.0f || ndcMinX > 1.0f || ndcMaxY < -1.0f || ndcMinY > 1.0f)
+    {
+        return;
+    }
+
+    auto getTile = [](float ndc, uint32_t tiles)
+    {
+        int tile = static_cast<int>(std::floor((ndc * 0.5f + 0.5f) * tiles));
+
+        return static_cast<uint32_t>(std::min(std::max(tile, 0), static_cast<int>(tiles) - 1));
+    };
+
+    auto getSlice = [&header](float depth)
+    {
+        if (depth < header.screen.z)
+        {
+            return 0u;
+        }
+
+        uint32_t slice = 1 + static_cast<uint32_t>(std::log(depth / header.screen.z) * header.screen.w);
+
+        return std::min(slice, GRID_Z - 1);
+    };
+
+    uint32_t tileMinX = getTile(ndcMinX, GRID_X);
+    uint32_t tileMaxX = getTile(ndcMaxX, GRID_X);
+    uint32_t tileMinY = getTile(ndcMinY, GRID_Y);
+    uint32_t tileMaxY = getTile(ndcMaxY, GRID_Y);
+    uint32_t sliceMin = getSlice(depthMin);
+    uint32_t sliceMax = getSlice(std::min(depthMax, header.projection.w));
+
+    for (uint32_t z = sliceMin; z <= sliceMax; z++)
+    {
+        for (uint32_t y = tileMinY; y <= tileMaxY; y++)
+        {
+            for (uint32_t x = tileMinX; x <= tileMaxX; x++)
+            {
+                uint32_t cluster = (z * GRID_Y + y) * GRID_X + x;
+                uint32_t& count = clusterCounts[cluster];
+
+                if (count < MAX_CLUSTER_LIGHTS)
+                {
+                    clusterData[cluster * CLUSTER_STRIDE + 1 + count] = index;
+                    count++;
+                }
+                else
+                {
+                    stats.overflows++;
+                }
+            }
+        }
+    }
+}
+
+void LightManager::recordBinning(VkCommandBuffer commandBuffer)
+{
+    if (pipeline == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    // The previous frame has completed before the lights are rewritten, so there is no reader to wait for
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+    vkCmdDispatch(commandBuffer, (CLUSTER_COUNT + 63) / 64, 1, 1);
+}
+
+bool LightManager::usesComputeBinning()
+{
+    return pipeline != VK_NULL_HANDLE;
+}
+
+VkBuffer LightManager::getLightBuffer()
+{
+    return lightBuffer;
+}
+
+VkDeviceSize LightManager::getLightBufferSize()
+{
+    return lightBufferSize;
+}
+
+VkBuffer LightManager::getClusterBuffer()
+{
+    return clusterBuffer;
+}
+
+VkDeviceSize LightManager::getClusterBufferSize()
+{
+    return clusterBufferSize;
+}
+
+LightManager::Stats LightManager::getStats()
+{
+    return stats;
+}
+
+void LightManager::printStats()
+{
+    std::cout << "Clustered lighting: " << stats.lights << " lights, " << GRID_X << "x" << GRID_Y << "x" << GRID_Z << " clusters, "
+              << (stats.gpuBinning ? "compute" : "CPU") << " binning" << std::endl;
+
+    if (stats.binnedFrames > 0)
+    {
+        double averageLights = static_cast<double>(stats.clusterLightTotal) / (static_cast<double>(stats.binnedFrames) * CLUSTER_COUNT);
+
+        std::cout << "  CPU binning: " << stats.binMilliseconds / stats.binnedFrames << " ms per frame, "
+                  << averageLights << " lights per cluster on average, " << stats.maxClusterLights << " at most, "
+                  << stats.overflows << " dropped at capacity" << std::endl;
+    }
+}
+
+void LightManager::cleanup()
+{
+    VkDevice device = DeviceManager::instance().getDevice();
+
+    // The descriptor set and its layout belong to the descriptor manager
+    if (pipeline != VK_NULL_HANDLE)
+    {
+        vkDestroyPipeline(device, pipeline, nullptr);
+        vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+
+        pipeline = VK_NULL_HANDLE;
+        pipelineLayout = VK_NULL_HANDLE;
+    }
+
+    if (lightBuffer != VK_NULL_HANDLE)
+    {
+        vkUnmapMemory(device, lightMemory);
+        vkDestroyBuffer(device, lightBuffer, nullptr);
+        Utils::freeTrackedMemory(lightMemory);
+
+        lightBuffer = VK_NULL_HANDLE;
+        lightData = nullptr;
+    }
+
+    if (clusterBuffer != VK_NULL_HANDLE)
+    {
+        if (clusterData != nullptr)
+        {
+            vkUnmapMemory(device, clusterMemory);
+        }
+
+        vkDestroyBuffer(device, clusterBuffer, nullptr);
+        Utils::freeTrackedMemory(clusterMemory);
+
+        clusterBuffer = VK_NULL_HANDLE;
+        clusterData = nullptr;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,135 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "ShaderManager.h"
+
+// Clustered forward lighting for many dynamic point lights
+// Lights are animated on the CPU and written in view space to a host-visible storage buffer every frame. They
+// are then binned into a froxel grid - screen tiles by exponential depth slices, derived from the projection -
+// either by a compute pass recorded ahead of the main pass or on the CPU, four lights per SIMD step. The
+// fragment shader only walks the lights listed for its cluster. Frames don't overlap (the uniform buffers are
+// shared), so a single light and cluster buffer serve every swapchain image.
+class LightManager
+{
+public:
+
+    // Grid size and per-cluster capacity, passed to shaders/cluster.comp and shader.frag as defines
+    static const uint32_t GRID_X = 16;
+    static const uint32_t GRID_Y = 9;
+    static const uint32_t GRID_Z = 24;
+    static const uint32_t MAX_CLUSTER_LIGHTS = 255;
+
+    struct Stats
+    {
+        uint32_t lights;
+        bool gpuBinning;
+
+        // CPU binning only, the compute pass is timed by the GPU profiler
+        uint32_t binnedFrames;
+        double binMilliseconds;
+        uint32_t maxClusterLights;
+        uint64_t clusterLightTotal;
+        uint64_t overflows;
+    };
+
+private:
+
+    LightManager() {}
+
+    // Matches PointLight in the shaders
+    struct GpuLight
+    {
+        glm::vec4 positionRadius;
+        glm::vec4 colorPower;
+    };
+
+    // Matches the LightBuffer header in the shaders, the lights follow it
+    struct LightHeader
+    {
+        // P[0][0], P[1][1], near and far plane
+        glm::vec4 projection;
+        // Grid size and light count
+        glm::uvec4 grid;
+        // Framebuffer size, first exponential slice and slices per log depth
+        glm::vec4 screen;
+    };
+
+    uint32_t lightCount = 0;
+
+    // Orbits around the scene centre as structure-of-arrays
+    std::vector<float> orbitRadius, orbitHeight, orbitPhase, orbitSpeed;
+    std::vector<GpuLight> lights;
+
+    // View-space bounds for CPU binning, padded to a multiple of four
+    std::vector<float> viewX, viewY, viewZ, viewRadius;
+
+    VkBuffer lightBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory lightMemory = VK_NULL_HANDLE;
+    VkDeviceSize lightBufferSize = 0;
+    uint8_t* lightData = nullptr;
+
+    // Device local when the compute pass writes it, mapped for CPU binning
+    VkBuffer clusterBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory clusterMemory = VK_NULL_HANDLE;
+    VkDeviceSize clusterBufferSize = 0;
+    uint32_t* clusterData = nullptr;
+
+    // Lights binned into each cluster this frame, CPU binning only
+    std::vector<uint32_t> clusterCounts;
+
+    // Compute binning, null when binning on the CPU
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+
+    void createComputePipeline(const std::vector<char>& code);
+
+    void binLights(const LightHeader& header);
+
+    // Add a light to every cluster its projected bounds overlap, bounds are x/w and y/w ranges plus depths
+    void insertLight(uint32_t index, float minX, float maxX, float minY, float maxY, float depthMin, float depthMax, const LightHeader& header);
+
+    Stats stats = {};
+
+public:
+
+    // Return singleton instance
+    static LightManager& instance();
+
+    // Ensure singleton is never copied
+    LightManager(LightManager const&)   = delete;
+    void operator=(LightManager const&) = delete;
+
+    // Grid defines shared by the binning and shading shaders
+    static ShaderManager::ShaderDefines getGridDefines();
+
+    // Lights orbit within sceneRadius of the origin, the same seed always gives the same lights
+    // Bins with the compute shader code when given, otherwise on the CPU
+    void init(uint32_t lightCount, float sceneRadius, const std::vector<char>& computeCode);
+
+    // Animate, transform to view space and (on the CPU path) bin, once the previous frame has completed
+    void update(float time, const glm::mat4& view, const glm::mat4& proj, VkExtent2D extent);
+
+    // Dispatch binning ahead of the main pass, no-op when binning on the CPU
+    // The caller orders the cluster writes before the fragment shader reads them
+    void recordBinning(VkCommandBuffer commandBuffer);
+
+    bool usesComputeBinning();
+
+    // Bindings 4 and 5 of the fragment shader
+    VkBuffer getLightBuffer();
+    VkDeviceSize getLightBufferSize();
+    VkBuffer getClusterBuffer();
+    VkDeviceSize getClusterBufferSize();
+
+    Stats getStats();
+    void printStats();
+
+    void cleanup();
+};
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include "MeshletBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+
+MeshletData MeshletBuilder::build(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+                                  uint32_t maxVertices, uint32_t maxTriangles)
+{
+    MeshletData data;
+
+    // Meshlet-local slot of each mesh vertex in the meshlet being built, 0xff when not yet referenced
+    std::vector<uint8_t> localIndex(vertices.size(), 0xff);
+
+    Meshlet current = {};
+
+    auto finishMeshlet = [&]()
+    {
+        for (uint32_t i = 0; i < current.vertexCount; i++)
+        {
+            localIndex[data.vertices[current.vertexOffset + i]] = 0xff;
+        }
+
+        data.meshlets.push_back(current);
+        data.bounds.push_back(computeBounds(data, current, vertices));
+
+        current.vertexOffset += current.vertexCount;
+        current.triangleOffset += current.triangleCount;
+        current.vertexCount = 0;
+        current.triangleCount = 0;
+    };
+
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        uint32_t a = indices[i + 0];
+        uint32_t b = indices[i + 1];
+        uint32_t c = indices[i + 2];
+
+        uint32_t newVertices = (localIndex[a] == 0xff) + (localIndex[b] == 0xff) + (localIndex[c] == 0xff);
+
+        if (current.vertexCount + newVertices > maxVertices || current.triangleCount + 1 > maxTriangles)
+        {
+            finishMeshlet();
+        }
+
+        for (uint32_t vertex : { a, b, c })
+        {
+            if (localIndex[vertex] == 0xff)
+            {
+                localIndex[vertex] = static_cast<uint8_t>(current.vertexCount++);
+                data.vertices.push_back(vertex);
+            }
+
+            data.triangles.push_back(localIndex[vertex]);
+        }
+
+        current.triangleCount++;
+    }
+
+    if (current.triangleCount > 0)
+    {
+        finishMeshlet();
+    }
+
+    return data;
+}
+
+MeshletBounds MeshletBuilder::computeBounds(const MeshletData& data, const Meshlet& meshlet, const std::vector<Vertex>& vertices)
+{
+    MeshletBounds bounds = {};
+
+    // Sphere around the AABB centre - cheap and within a few percent of minimal for compact clusters
+    glm::vec3 minPos = vertices[data.vertices[meshlet.vertexOffset]].pos;
+    glm::vec3 maxPos = minPos;
+
+    for (uint32_t i = 1; i < meshlet.vertexCount; i++)
+    {
+        const glm::vec3& pos = vertices[data.vertices[meshlet.vertexOffset + i]].pos;
+        minPos = glm::min(minPos, pos);
+        maxPos = glm::max(maxPos, pos);
+    }
+
+    bounds.center = (minPos + maxPos) * 0.5f;
+
+    for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+    {
+        bounds.radius = std::max(bounds.radius, glm::length(vertices[data.vertices[meshlet.vertexOffset + i]].pos - bounds.center));
+    }
+
+    // Normal cone from unit face normals (counter-clockwise front faces), ignoring degenerate triangles
+    std::vector<glm::vec3> normals;
+    normals.reserve(meshlet.triangleCount);
+
+    glm::vec3 normalSum(0.0f);
+
+    for (uint32_t i = 0; i < meshlet.triangleCount; i++)
+    {
+        const uint8_t* triangle = &data.triangles[(meshlet.triangleOffset + i) * 3];
+
+        const glm::vec3& p0 = vertices[data.vertices[meshlet.vertexOffset + triangle[0]]].pos;
+        const glm::vec3& p1 = vertices[data.vertices[meshlet.vertexOffset + triangle[1]]].pos;
+        const glm::vec3& p2 = vertices[data.vertices[meshlet.vertexOffset + triangle[2]]].pos;
+
+        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        float area = glm::length(normal);
+
+        if (area > 0.0f)
+        {
+            normals.push_back(normal / area);
+            normalSum += normals.back();
+        }
+    }
+
+    float axisLength = glm::length(normalSum);
+
+    if (normals.empty() || axisLength == 0.0f)
+    {
+        bounds.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+        bounds.coneCutoff = 1.0f;
+
+        return bounds;
+    }
+
+    bounds.coneAxis = normalSum / axisLength;
+
+    float minDot = 1.0f;
+
+    for (const glm::vec3& normal : normals)
+    {
+        minDot = std::min(minDot, glm::dot(normal, bounds.coneAxis));
+    }
+
+    // Cones wider than ~84 degrees reject almost nothing, so never test them
+    bounds.coneCutoff = minDot <= 0.1f ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+
+    return bounds;
+}
\ No newline at end of file
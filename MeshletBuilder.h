@@ -0,0 +1,59 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+#include "Vertex.h"
+
+// Small cluster of a mesh's triangles, addressing at most MAX_VERTICES of its vertices
+struct Meshlet
+{
+    // First entry in MeshletData::vertices / first triangle in MeshletData::triangles
+    uint32_t vertexOffset;
+    uint32_t triangleOffset;
+
+    uint32_t vertexCount;
+    uint32_t triangleCount;
+};
+
+// Culling bounds in mesh space
+// The meshlet is back-facing from camera c if dot(center - c, coneAxis) >= coneCutoff * length(center - c) + radius
+struct MeshletBounds
+{
+    glm::vec3 center;
+    float radius;
+
+    glm::vec3 coneAxis;
+
+    // 1 disables cone culling (normals spread too wide)
+    float coneCutoff;
+};
+
+struct MeshletData
+{
+    std::vector<Meshlet> meshlets;
+    std::vector<MeshletBounds> bounds;
+
+    // Mesh-local vertex index per meshlet vertex
+    std::vector<uint32_t> vertices;
+
+    // Meshlet-local vertex index, three per triangle
+    std::vector<uint8_t> triangles;
+};
+
+class MeshletBuilder
+{
+public:
+
+    static const uint32_t MAX_VERTICES = 64;
+    static const uint32_t MAX_TRIANGLES = 124;
+
+    // Greedily split an indexed triangle list into meshlets in index order
+    // Imported index order is spatially coherent enough that no reordering is done
+    static MeshletData build(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+                             uint32_t maxVertices = MAX_VERTICES, uint32_t maxTriangles = MAX_TRIANGLES);
+
+    static MeshletBounds computeBounds(const MeshletData& data, const Meshlet& meshlet, const std::vector<Vertex>& vertices);
+};
\ No newline at end of file
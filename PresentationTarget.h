@@ -0,0 +1,74 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <vector>
+
+// When a presented frame reached the display, in steady clock nanoseconds
+struct PresentTime
+{
+    uint32_t presentId;
+    uint64_t displayedNs;
+};
+
+// Destination for rendered frames
+// The renderer only sees colour images, framebuffers and acquire/present, so windowed and
+// headless output share every other part of the frame
+class PresentationTarget
+{
+public:
+
+    virtual ~PresentationTarget() {}
+
+    // Window/platform setup before the instance exists, and teardown after it is destroyed
+    virtual void init() = 0;
+    virtual void cleanup() = 0;
+
+    // Instance extensions the target needs (surface extensions when presenting to a window)
+    virtual std::vector<const char*> getRequiredInstanceExtensions() = 0;
+
+    // Headless targets have no surface and return VK_NULL_HANDLE
+    virtual void createSurface(VkInstance instance) = 0;
+    virtual void destroySurface(VkInstance instance) = 0;
+    virtual VkSurfaceKHR getSurface() = 0;
+
+    // Window for input, nullptr when headless
+    virtual GLFWwindow* getWindow() = 0;
+
+    virtual void pollEvents() = 0;
+    virtual bool shouldClose() = 0;
+
+    // Queues are only known once the logical device exists
+    virtual void setQueues(VkQueue graphicsQueue, VkQueue presentQueue) = 0;
+
+    // Colour images frames are rendered to, recreated on resize
+    virtual void createImages() = 0;
+    virtual void destroyImages() = 0;
+
+    // Attachments are the target image, the depth buffer and, when multisampling, the multisampled colour
+    // buffer the target image is resolved from. Destroyed once the frames using them complete
+    virtual void createFramebuffers(VkImageView depthImageView, VkImageView multisampleImageView, VkRenderPass renderPass) = 0;
+    virtual void destroyFramebuffers() = 0;
+
+    virtual VkFormat getImageFormat() = 0;
+    virtual VkExtent2D getExtent() = 0;
+    virtual uint32_t getImageCount() = 0;
+    virtual VkFramebuffer getFramebuffer(uint32_t imageIndex) = 0;
+    virtual VkImage getImage(uint32_t imageIndex) = 0;
+
+    // Layout the frame must leave the colour image in
+    virtual VkImageLayout getFinalLayout() = 0;
+
+    // Pick the next image to render to - imageAvailable is signalled once it may be written
+    virtual VkResult acquireNextImage(VkSemaphore imageAvailable, uint32_t& imageIndex) = 0;
+
+    // Hand off a rendered image once renderFinished is signalled, presentId tags it in getPresentTimes
+    virtual VkResult present(VkSemaphore renderFinished, uint32_t imageIndex, uint32_t presentId) = 0;
+
+    // Display times of frames presented since the last call, in any order
+    // Empty where the target can't tell, headless or without VK_GOOGLE_display_timing
+    virtual void getPresentTimes(std::vector<PresentTime>& times) = 0;
+};
\ No newline at end of file
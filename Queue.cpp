@@ -0,0 +1,228 @@
+#include "Queue.h"
+
+#include "DeviceManager.h"
+
+#include <limits>
+#include <stdexcept>
+
+void Queue::init(VkQueue queue, uint32_t familyIndex, uint32_t queueIndex)
+{
+    this->queue = queue;
+    this->familyIndex = familyIndex;
+    this->queueIndex = queueIndex;
+
+#ifdef VK_KHR_timeline_semaphore
+    if (SyncManager::instance().usesTimelineSemaphores())
+    {
+        VkSemaphoreTypeCreateInfoKHR typeInfo = {};
+        typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+        typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+        typeInfo.initialValue = 0;
+
+        VkSemaphoreCreateInfo semaphoreInfo = {};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphoreInfo.pNext = &typeInfo;
+
+        if (vkCreateSemaphore(DeviceManager::instance().getDevice(), &semaphoreInfo, nullptr, &timeline) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Error: Failed to create timeline semaphore");
+        }
+    }
+#endif
+
+    SyncManager::instance().registerQueue(this);
+}
+
+VkQueue Queue::getHandle()
+{
+    return queue;
+}
+
+uint32_t Queue::getFamilyIndex()
+{
+    return familyIndex;
+}
+
+uint32_t Queue::getQueueIndex()
+{
+    return queueIndex;
+}
+
+bool Queue::sharesQueueWith(const Queue& other) const
+{
+    return queue == other.queue;
+}
+
+void Queue::submit(VkCommandBuffer commandBuffer, const std::vector<Wait>& waits, VkSemaphore signal)
+{
+    Submission submission = {};
+    submission.commandBuffer = commandBuffer;
+    submission.signalSemaphore = signal;
+
+    for (const Wait& wait : waits)
+    {
+        submission.waitSemaphores.push_back(wait.semaphore);
+        submission.waitStages.push_back(wait.stage);
+    }
+
+    pending.push_back(submission);
+}
+
+SyncTicket Queue::flush()
+{
+    if (pending.empty())
+    {
+        return lastTicket;
+    }
+
+    InFlight submitted = {};
+    submitted.ticket = SyncManager::instance().nextTicket();
+
+    // Submissions are fully queued, so pointers into them stay valid for the call
+    std::vector<VkSubmitInfo> submitInfos(pending.size());
+
+    for (size_t i = 0; i < pending.size(); i++)
+    {
+        const Submission& submission = pending[i];
+
+        VkSubmitInfo& submitInfo = submitInfos[i];
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.waitSemaphoreCount = static_cast<uint32_t>(submission.waitSemaphores.size());
+        submitInfo.pWaitSemaphores = submission.waitSemaphores.data();
+        submitInfo.pWaitDstStageMask = submission.waitStages.data();
+        submitInfo.commandBufferCount = submission.commandBuffer != VK_NULL_HANDLE ? 1 : 0;
+        submitInfo.pCommandBuffers = &submission.commandBuffer;
+        submitInfo.signalSemaphoreCount = submission.signalSemaphore != VK_NULL_HANDLE ? 1 : 0;
+        submitInfo.pSignalSemaphores = &submission.signalSemaphore;
+    }
+
+#ifdef VK_KHR_timeline_semaphore
+    // Last submission of the batch also signals the ticket - submissions complete in order on a queue
+    VkSemaphore signalSemaphores[2];
+    uint64_t signalValues[2] = { 0, submitted.ticket };
+    VkTimelineSemaphoreSubmitInfoKHR timelineInfo = {};
+
+    if (timeline != VK_NULL_HANDLE)
+    {
+        VkSubmitInfo& submitInfo = submitInfos.back();
+
+        // A binary signal in the same submission takes a value that is ignored
+        uint32_t binaryCount = submitInfo.signalSemaphoreCount;
+
+        signalSemaphores[0] = pending.back().signalSemaphore;
+        signalSemaphores[1] = timeline;
+
+        submitInfo.signalSemaphoreCount = binaryCount + 1;
+        submitInfo.pSignalSemaphores = signalSemaphores + (1 - binaryCount);
+
+        // Waits are all binary semaphores, so they need no values
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+        timelineInfo.signalSemaphoreValueCount = submitInfo.signalSemaphoreCount;
+        timelineInfo.pSignalSemaphoreValues = signalValues + (1 - binaryCount);
+
+        submitInfo.pNext = &timelineInfo;
+    }
+#endif
+
+    if (timeline == VK_NULL_HANDLE)
+    {
+        submitted.fence = SyncManager::instance().acquireFence();
+    }
+
+    VkResult result = vkQueueSubmit(queue, static_cast<uint32_t>(submitInfos.size()), submitInfos.data(), submitted.fence);
+    pending.clear();
+
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Error: Failed to submit to queue");
+    }
+
+    inFlight.push_back(submitted);
+    lastTicket = submitted.ticket;
+
+    return submitted.ticket;
+}
+
+SyncTicket Queue::poll()
+{
+#ifdef VK_KHR_timeline_semaphore
+    if (timeline != VK_NULL_HANDLE)
+    {
+        uint64_t completed = inFlight.empty() ? 0 : SyncManager::instance().getCounterValue(timeline);
+
+        while (!inFlight.empty() && inFlight.front().ticket <= completed)
+        {
+            inFlight.pop_front();
+        }
+
+        return inFlight.empty() ? 0 : inFlight.front().ticket;
+    }
+#endif
+
+    VkDevice device = DeviceManager::instance().getDevice();
+
+    // Fences signal in submission order, so stop at the first one still running
+    while (!inFlight.empty() && vkGetFenceStatus(device, inFlight.front().fence) == VK_SUCCESS)
+    {
+        SyncManager::instance().releaseFence(inFlight.front().fence);
+        inFlight.pop_front();
+    }
+
+    return inFlight.empty() ? 0 : inFlight.front().ticket;
+}
+
+void Queue::wait(SyncTicket ticket)
+{
+    // Newest submission on this queue covered by the ticket
+    SyncTicket target = 0;
+
+    for (const InFlight& submitted : inFlight)
+    {
+        if (submitted.ticket > ticket)
+        {
+            break;
+        }
+
+        target = submitted.ticket;
+    }
+
+    if (target == 0)
+    {
+        return;
+    }
+
+#ifdef VK_KHR_timeline_semaphore
+    if (timeline != VK_NULL_HANDLE)
+    {
+        SyncManager::instance().waitCounterValue(timeline, target);
+        poll();
+
+        return;
+    }
+#endif
+
+    VkDevice device = DeviceManager::instance().getDevice();
+
+    while (!inFlight.empty() && inFlight.front().ticket <= target)
+    {
+        vkWaitForFences(device, 1, &inFlight.front().fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+        SyncManager::instance().releaseFence(inFlight.front().fence);
+        inFlight.pop_front();
+    }
+}
+
+void Queue::waitIdle()
+{
+    wait(flush());
+}
+
+void Queue::cleanup()
+{
+    waitIdle();
+
+    if (timeline != VK_NULL_HANDLE)
+    {
+        vkDestroySemaphore(DeviceManager::instance().getDevice(), timeline, nullptr);
+        timeline = VK_NULL_HANDLE;
+    }
+}
\ No newline at end of file
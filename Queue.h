@@ -0,0 +1,83 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+
+#include <GLFW/glfw3.h>
+
+#include <deque>
+#include <vector>
+
+#include "SyncManager.h"
+
+// Device queue with batched submission
+// Work queued with submit() goes out in a single vkQueueSubmit on the next flush(). Dependencies on
+// other queues are expressed as semaphore waits, which is the only ordering Vulkan gives across queues.
+// Every flush returns a ticket the CPU can poll or wait on through the SyncManager.
+class Queue
+{
+public:
+
+    // Semaphore signalled by another queue, and the stage of this submission that waits for it
+    struct Wait
+    {
+        VkSemaphore semaphore;
+        VkPipelineStageFlags stage;
+    };
+
+    // Registers with the SyncManager, which must already be initialised
+    void init(VkQueue queue, uint32_t familyIndex, uint32_t queueIndex);
+
+    VkQueue getHandle();
+    uint32_t getFamilyIndex();
+    uint32_t getQueueIndex();
+
+    // Roles that share one device queue wrap the same handle
+    bool sharesQueueWith(const Queue& other) const;
+
+    // Queue a submission - a wait-only or signal-only submission may have no command buffer
+    void submit(VkCommandBuffer commandBuffer, const std::vector<Wait>& waits = std::vector<Wait>(), VkSemaphore signal = VK_NULL_HANDLE);
+
+    // Submit everything queued since the last flush, returning the ticket that completes with it
+    // With nothing queued this is the queue's last ticket
+    SyncTicket flush();
+
+    // Retire completed tickets, returns the oldest still running or 0 if the queue is idle
+    SyncTicket poll();
+
+    // Block until this queue's submissions up to the ticket have completed
+    void wait(SyncTicket ticket);
+
+    void waitIdle();
+
+    void cleanup();
+
+private:
+
+    struct Submission
+    {
+        std::vector<VkSemaphore> waitSemaphores;
+        std::vector<VkPipelineStageFlags> waitStages;
+        VkCommandBuffer commandBuffer;
+        VkSemaphore signalSemaphore;
+    };
+
+    // Fence is only used without timeline semaphores
+    struct InFlight
+    {
+        SyncTicket ticket;
+        VkFence fence;
+    };
+
+    VkQueue queue = VK_NULL_HANDLE;
+    uint32_t familyIndex = 0;
+    uint32_t queueIndex = 0;
+
+    std::vector<Submission> pending;
+
+    // Tickets submitted on this queue in order, and the last one
+    std::deque<InFlight> inFlight;
+    SyncTicket lastTicket = 0;
+
+    // Counts up to the last completed ticket
+    VkSemaphore timeline = VK_NULL_HANDLE;
+};
\ No newline at end of file
@@ -7,15 +7,34 @@ public:
     int graphicsFamily = -1;
     int presentFamily = -1;
 
+    // Prefer families without graphics so copies and compute can overlap rendering
+    // Both fall back to a more general family, so they are always set when graphics is
+    int computeFamily = -1;
+    int transferFamily = -1;
+
+    // Headless rendering has no surface, so no present family is needed
+    bool requiresPresent = true;
+
     bool isComplete()
     {
-        return graphicsFamily >= 0 && presentFamily >= 0;
+        return graphicsFamily >= 0 && (presentFamily >= 0 || !requiresPresent);
+    }
+
+    bool hasDedicatedCompute()
+    {
+        return computeFamily >= 0 && computeFamily != graphicsFamily;
+    }
+
+    bool hasDedicatedTransfer()
+    {
+        return transferFamily >= 0 && transferFamily != graphicsFamily && transferFamily != computeFamily;
     }
 
     // Find suitable command queue families
     static QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface)
     {
         QueueFamilyIndices indices;
+        indices.requiresPresent = surface != VK_NULL_HANDLE;
 
         // Enumerate queue family count
         uint32_t queueFamilyCount = 0;
@@ -25,34 +44,62 @@ public:
         std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
         vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
 
-        // Pick queue family with suitable features
-        int i=0;
-        for (const auto& queueFamily : queueFamilies)
+        int computeOnlyFamily = -1;
+        int transferOnlyFamily = -1;
+        int anyComputeFamily = -1;
+
+        // Look at every family rather than stopping at the first complete match
+        for (int i = 0; i < static_cast<int>(queueFamilies.size()); i++)
         {
+            const VkQueueFamilyProperties& queueFamily = queueFamilies[i];
+
+            if (queueFamily.queueCount == 0)
+            {
+                continue;
+            }
+
             VkBool32 presentSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
 
-            if (queueFamily.queueCount > 0)
+            if (indices.requiresPresent)
             {
-                if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
-                {
-                    indices.graphicsFamily = i;
-                }
-                
-                if (presentSupport)
-                {
-                    indices.presentFamily = i;
-                }
+                vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
             }
 
-            if (indices.isComplete())
+            bool graphics = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+            bool compute = (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) != 0;
+            bool transfer = (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) != 0;
+
+            // A graphics family that can also present saves a queue ownership hand-off per frame
+            if (graphics && (indices.graphicsFamily < 0 || (presentSupport && indices.presentFamily != indices.graphicsFamily)))
+            {
+                indices.graphicsFamily = i;
+            }
+
+            if (presentSupport && (indices.presentFamily < 0 || i == indices.graphicsFamily))
+            {
+                indices.presentFamily = i;
+            }
+
+            if (compute && anyComputeFamily < 0)
             {
-                break;
+                anyComputeFamily = i;
             }
 
-            i++;
+            if (compute && !graphics && computeOnlyFamily < 0)
+            {
+                computeOnlyFamily = i;
+            }
+
+            if (transfer && !graphics && !compute && transferOnlyFamily < 0)
+            {
+                transferOnlyFamily = i;
+            }
         }
 
+        // Graphics families always support compute and transfer, so they are the last fallback
+        indices.computeFamily = computeOnlyFamily >= 0 ? computeOnlyFamily : (anyComputeFamily >= 0 ? anyComputeFamily : indices.graphicsFamily);
+        indices.transferFamily = transferOnlyFamily >= 0 ? transferOnlyFamily : (computeOnlyFamily >= 0 ? computeOnlyFamily : indices.graphicsFamily);
+
         return indices;
     }
 };
\ No newline at end of file
@@ -0,0 +1,403 @@
+// Based on OffsetAllocator by Sebastian Aaltonen, https://github.com/sebbbi/OffsetAllocator
+//
+// MIT License
+//
+// Copyright (c) 2023 Sebastian Aaltonen
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "RangeAllocator.h"
+
+#include <algorithm>
+
+namespace
+{
+    const uint32_t MANTISSA_BITS = 3;
+    const uint32_t MANTISSA_VALUE = 1 << MANTISSA_BITS;
+    const uint32_t MANTISSA_MASK = MANTISSA_VALUE - 1;
+
+    uint32_t lzcnt(uint32_t value)
+    {
+        return value == 0 ? 32 : __builtin_clz(value);
+    }
+
+    uint32_t tzcnt(uint32_t value)
+    {
+        return value == 0 ? 32 : __builtin_ctz(value);
+    }
+
+    // Index of the lowest set bit at or above startIndex, or NO_SPACE
+    uint32_t findLowestSetBitAfter(uint32_t bitMask, uint32_t startIndex)
+    {
+        if (startIndex >= 32)
+        {
+            return RangeAllocator::NO_SPACE;
+        }
+
+        uint32_t maskAfterStart = bitMask & ~((1u << startIndex) - 1);
+
+        return maskAfterStart == 0 ? RangeAllocator::NO_SPACE : tzcnt(maskAfterStart);
+    }
+}
+
+uint32_t RangeAllocator::sizeToBinRoundUp(uint32_t size)
+{
+    uint32_t exp = 0;
+    uint32_t mantissa = 0;
+
+    if (size < MANTISSA_VALUE)
+    {
+        // Denormal - sizes below 8 map directly to bins 0-7
+        mantissa = size;
+    }
+    else
+    {
+        uint32_t highestSetBit = 31 - lzcnt(size);
+        uint32_t mantissaStartBit = highestSetBit - MANTISSA_BITS;
+        exp = mantissaStartBit + 1;
+        mantissa = (size >> mantissaStartBit) & MANTISSA_MASK;
+
+        // Round up if any bits below the mantissa are set (carry into exp is intended)
+        uint32_t lowBitsMask = (1u << mantissaStartBit) - 1;
+        if ((size & lowBitsMask) != 0)
+        {
+            mantissa++;
+        }
+    }
+
+    return (exp << MANTISSA_BITS) + mantissa;
+}
+
+uint32_t RangeAllocator::sizeToBinRoundDown(uint32_t size)
+{
+    uint32_t exp = 0;
+    uint32_t mantissa = 0;
+
+    if (size < MANTISSA_VALUE)
+    {
+        mantissa = size;
+    }
+    else
+    {
+        uint32_t highestSetBit = 31 - lzcnt(size);
+        uint32_t mantissaStartBit = highestSetBit - MANTISSA_BITS;
+        exp = mantissaStartBit + 1;
+        mantissa = (size >> mantissaStartBit) & MANTISSA_MASK;
+    }
+
+    return (exp << MANTISSA_BITS) | mantissa;
+}
+
+uint32_t RangeAllocator::binToSize(uint32_t bin)
+{
+    uint32_t exp = bin >> MANTISSA_BITS;
+    uint32_t mantissa = bin & MANTISSA_MASK;
+
+    if (exp == 0)
+    {
+        return mantissa;
+    }
+
+    return (mantissa | MANTISSA_VALUE) << (exp - 1);
+}
+
+RangeAllocator::RangeAllocator(uint32_t size, uint32_t maxAllocations)
+    : maxAllocations(maxAllocations)
+{
+    reset(size);
+}
+
+void RangeAllocator::reset(uint32_t size)
+{
+    this->size = size;
+    freeStorage = 0;
+    usedBinsTop = 0;
+
+    std::fill(usedBins, usedBins + TOP_BINS, 0);
+    std::fill(binIndices, binIndices + LEAF_BINS, UNUSED);
+
+    nodes.assign(maxAllocations, Node());
+    freeNodes.resize(maxAllocations);
+
+    // Free node stack, popped from the back so node 0 is handed out first
+    for (uint32_t i = 0; i < maxAllocations; i++)
+    {
+        freeNodes[i] = maxAllocations - i - 1;
+    }
+
+    freeOffset = maxAllocations - 1;
+
+    if (size > 0)
+    {
+        insertNodeIntoBin(size, 0);
+    }
+}
+
+RangeAllocator::Allocation RangeAllocator::allocate(uint32_t size)
+{
+    Allocation allocation;
+
+    // Out of nodes (need one spare for a potential split)
+    if (size == 0 || freeOffset == 0 || freeOffset == UNUSED)
+    {
+        return allocation;
+    }
+
+    // Round up so every range in the chosen bin is guaranteed to fit
+    uint32_t minBinIndex = sizeToBinRoundUp(size);
+    uint32_t minTopBinIndex = minBinIndex >> MANTISSA_BITS;
+    uint32_t minLeafBinIndex = minBinIndex & MANTISSA_MASK;
+
+    uint32_t topBinIndex = minTopBinIndex;
+    uint32_t leafBinIndex = NO_SPACE;
+
+    if (minTopBinIndex < TOP_BINS && (usedBinsTop & (1u << topBinIndex)))
+    {
+        leafBinIndex = findLowestSetBitAfter(usedBins[topBinIndex], minLeafBinIndex);
+    }
+
+    // Nothing suitable in the same top bin - take the smallest leaf of the next non-empty top bin
+    if (leafBinIndex == NO_SPACE)
+    {
+        topBinIndex = findLowestSetBitAfter(usedBinsTop, minTopBinIndex + 1);
+
+        if (topBinIndex == NO_SPACE)
+        {
+            return allocation;
+        }
+
+        leafBinIndex = tzcnt(usedBins[topBinIndex]);
+    }
+
+    uint32_t binIndex = (topBinIndex << MANTISSA_BITS) | leafBinIndex;
+
+    // Pop the head of the bin list
+    uint32_t nodeIndex = binIndices[binIndex];
+    Node& node = nodes[nodeIndex];
+    uint32_t nodeTotalSize = node.dataSize;
+
+    node.dataSize = size;
+    node.used = true;
+    binIndices[binIndex] = node.binListNext;
+
+    if (node.binListNext != UNUSED)
+    {
+        nodes[node.binListNext].binListPrev = UNUSED;
+    }
+
+    freeStorage -= nodeTotalSize;
+
+    if (binIndices[binIndex] == UNUSED)
+    {
+        usedBins[topBinIndex] &= ~(1u << leafBinIndex);
+
+        if (usedBins[topBinIndex] == 0)
+        {
+            usedBinsTop &= ~(1u << topBinIndex);
+        }
+    }
+
+    // Return the remainder to the free bins as a new neighbour node
+    uint32_t remainderSize = nodeTotalSize - size;
+    if (remainderSize > 0)
+    {
+        uint32_t newNodeIndex = insertNodeIntoBin(remainderSize, node.dataOffset + size);
+
+        Node& updatedNode = nodes[nodeIndex];
+
+        if (updatedNode.neighborNext != UNUSED)
+        {
+            nodes[updatedNode.neighborNext].neighborPrev = newNodeIndex;
+        }
+
+        nodes[newNodeIndex].neighborPrev = nodeIndex;
+        nodes[newNodeIndex].neighborNext = updatedNode.neighborNext;
+        updatedNode.neighborNext = newNodeIndex;
+    }
+
+    allocation.offset = nodes[nodeIndex].dataOffset;
+    allocation.node = nodeIndex;
+
+    return allocation;
+}
+
+void RangeAllocator::free(Allocation allocation)
+{
+    if (!allocation.isValid())
+    {
+        return;
+    }
+
+    uint32_t nodeIndex = allocation.node;
+    Node& node = nodes[nodeIndex];
+
+    uint32_t offset = node.dataOffset;
+    uint32_t rangeSize = node.dataSize;
+
+    // Merge with a free previous neighbour
+    if (node.neighborPrev != UNUSED && !nodes[node.neighborPrev].used)
+    {
+        Node& prevNode = nodes[node.neighborPrev];
+        offset = prevNode.dataOffset;
+        rangeSize += prevNode.dataSize;
+
+        removeNodeFromBin(node.neighborPrev);
+        node.neighborPrev = prevNode.neighborPrev;
+    }
+
+    // Merge with a free next neighbour
+    if (node.neighborNext != UNUSED && !nodes[node.neighborNext].used)
+    {
+        Node& nextNode = nodes[node.neighborNext];
+        rangeSize += nextNode.dataSize;
+
+        removeNodeFromBin(node.neighborNext);
+        node.neighborNext = nextNode.neighborNext;
+    }
+
+    uint32_t neighborNext = node.neighborNext;
+    uint32_t neighborPrev = node.neighborPrev;
+
+    // Release the node and reinsert the merged range
+    freeNodes[++freeOffset] = nodeIndex;
+
+    uint32_t combinedNodeIndex = insertNodeIntoBin(rangeSize, offset);
+
+    if (neighborNext != UNUSED)
+    {
+        nodes[combinedNodeIndex].neighborNext = neighborNext;
+        nodes[neighborNext].neighborPrev = combinedNodeIndex;
+    }
+
+    if (neighborPrev != UNUSED)
+    {
+        nodes[combinedNodeIndex].neighborPrev = neighborPrev;
+        nodes[neighborPrev].neighborNext = combinedNodeIndex;
+    }
+}
+
+uint32_t RangeAllocator::insertNodeIntoBin(uint32_t size, uint32_t dataOffset)
+{
+    // Round down so the bin's minimum size is never larger than the range
+    uint32_t binIndex = sizeToBinRoundDown(size);
+    uint32_t topBinIndex = binIndex >> MANTISSA_BITS;
+    uint32_t leafBinIndex = binIndex & MANTISSA_MASK;
+
+    if (binIndices[binIndex] == UNUSED)
+    {
+        usedBins[topBinIndex] |= 1u << leafBinIndex;
+        usedBinsTop |= 1u << topBinIndex;
+    }
+
+    uint32_t topNodeIndex = binIndices[binIndex];
+    uint32_t nodeIndex = freeNodes[freeOffset--];
+
+    Node node;
+    node.dataOffset = dataOffset;
+    node.dataSize = size;
+    node.binListNext = topNodeIndex;
+    nodes[nodeIndex] = node;
+
+    if (topNodeIndex != UNUSED)
+    {
+        nodes[topNodeIndex].binListPrev = nodeIndex;
+    }
+
+    binIndices[binIndex] = nodeIndex;
+    freeStorage += size;
+
+    return nodeIndex;
+}
+
+void RangeAllocator::removeNodeFromBin(uint32_t nodeIndex)
+{
+    Node& node = nodes[nodeIndex];
+
+    if (node.binListPrev != UNUSED)
+    {
+        // Middle or tail of the list - just unlink
+        nodes[node.binListPrev].binListNext = node.binListNext;
+
+        if (node.binListNext != UNUSED)
+        {
+            nodes[node.binListNext].binListPrev = node.binListPrev;
+        }
+    }
+    else
+    {
+        // Head of the list - update the bin and its bitmask
+        uint32_t binIndex = sizeToBinRoundDown(node.dataSize);
+        uint32_t topBinIndex = binIndex >> MANTISSA_BITS;
+        uint32_t leafBinIndex = binIndex & MANTISSA_MASK;
+
+        binIndices[binIndex] = node.binListNext;
+
+        if (node.binListNext != UNUSED)
+        {
+            nodes[node.binListNext].binListPrev = UNUSED;
+        }
+
+        if (binIndices[binIndex] == UNUSED)
+        {
+            usedBins[topBinIndex] &= ~(1u << leafBinIndex);
+
+            if (usedBins[topBinIndex] == 0)
+            {
+                usedBinsTop &= ~(1u << topBinIndex);
+            }
+        }
+    }
+
+    freeNodes[++freeOffset] = nodeIndex;
+    freeStorage -= node.dataSize;
+}
+
+uint32_t RangeAllocator::allocationSize(Allocation allocation) const
+{
+    return allocation.isValid() ? nodes[allocation.node].dataSize : 0;
+}
+
+RangeAllocator::StorageReport RangeAllocator::getStorageReport() const
+{
+    StorageReport report = {};
+    report.totalFree = freeStorage;
+
+    for (uint32_t binIndex = 0; binIndex < LEAF_BINS; binIndex++)
+    {
+        for (uint32_t nodeIndex = binIndices[binIndex]; nodeIndex != UNUSED; nodeIndex = nodes[nodeIndex].binListNext)
+        {
+            report.largestFree = std::max(report.largestFree, nodes[nodeIndex].dataSize);
+            report.freeRanges++;
+        }
+    }
+
+    return report;
+}
+
+float RangeAllocator::getFragmentation() const
+{
+    StorageReport report = getStorageReport();
+
+    if (report.totalFree == 0)
+    {
+        return 0.0f;
+    }
+
+    return 1.0f - static_cast<float>(report.largestFree) / static_cast<float>(report.totalFree);
+}
\ No newline at end of file
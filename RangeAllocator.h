@@ -0,0 +1,108 @@
+// Based on OffsetAllocator by Sebastian Aaltonen, https://github.com/sebbbi/OffsetAllocator
+//
+// MIT License
+//
+// Copyright (c) 2023 Sebastian Aaltonen
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// O(1) offset allocator for sub-allocating ranges of a fixed-size resource
+// Free ranges are binned by a small floating point size class (3 mantissa bits), with a two-level
+// bitmask to find the first non-empty bin. Neighbouring free ranges are coalesced on free.
+class RangeAllocator
+{
+public:
+
+    static const uint32_t NO_SPACE = 0xffffffff;
+
+    struct Allocation
+    {
+        uint32_t offset = NO_SPACE;
+        uint32_t node = NO_SPACE;
+
+        bool isValid() const { return offset != NO_SPACE; }
+    };
+
+    struct StorageReport
+    {
+        uint32_t totalFree;
+        uint32_t largestFree;
+        uint32_t freeRanges;
+    };
+
+    explicit RangeAllocator(uint32_t size = 0, uint32_t maxAllocations = 64 * 1024);
+
+    // Forget every allocation and start again with one free range covering the whole resource
+    void reset(uint32_t size);
+
+    Allocation allocate(uint32_t size);
+    void free(Allocation allocation);
+
+    uint32_t allocationSize(Allocation allocation) const;
+
+    StorageReport getStorageReport() const;
+
+    // 0 when all free space is one contiguous range, approaching 1 as it splinters
+    float getFragmentation() const;
+
+    uint32_t getSize() const { return size; }
+
+    // Size class helpers, exposed for testing
+    static uint32_t sizeToBinRoundUp(uint32_t size);
+    static uint32_t sizeToBinRoundDown(uint32_t size);
+    static uint32_t binToSize(uint32_t bin);
+
+private:
+
+    static const uint32_t TOP_BINS = 32;
+    static const uint32_t BINS_PER_LEAF = 8;
+    static const uint32_t LEAF_BINS = TOP_BINS * BINS_PER_LEAF;
+    static const uint32_t UNUSED = 0xffffffff;
+
+    struct Node
+    {
+        uint32_t dataOffset = 0;
+        uint32_t dataSize = 0;
+        uint32_t binListPrev = UNUSED;
+        uint32_t binListNext = UNUSED;
+        uint32_t neighborPrev = UNUSED;
+        uint32_t neighborNext = UNUSED;
+        bool used = false;
+    };
+
+    uint32_t size;
+    uint32_t maxAllocations;
+    uint32_t freeStorage;
+
+    uint32_t usedBinsTop;
+    uint8_t usedBins[TOP_BINS];
+    uint32_t binIndices[LEAF_BINS];
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> freeNodes;
+    uint32_t freeOffset;
+
+    uint32_t insertNodeIntoBin(uint32_t size, uint32_t dataOffset);
+    void removeNodeFromBin(uint32_t nodeIndex);
+};
\ No newline at end of file
@@ -0,0 +1,761 @@
+#include "RenderGraph.h"
+
+#include "DeletionQueue.h"
+#include "DeviceManager.h"
+#include "Utils.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+    // Only writes need making available, read bits in a source mask do nothing
+    const VkAccessFlags WRITE_ACCESS = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+                                       VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+    VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+    {
+        return alignment == 0 ? value : (value + alignment - 1) / alignment * alignment;
+    }
+
+    double toMegabytes(VkDeviceSize bytes)
+    {
+        return static_cast<double>(bytes) / (1024.0 * 1024.0);
+    }
+
+    // Lazily allocated where the device has it and the images allow it, device local otherwise
+    uint32_t findMemoryType(const RenderGraph::MemoryBlock& block)
+    {
+        if (block.lazy)
+        {
+            VkPhysicalDeviceMemoryProperties memProperties;
+            vkGetPhysicalDeviceMemoryProperties(DeviceManager::instance().getPhysicalDevice(), &memProperties);
+
+            for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
+            {
+                if ((block.memoryTypeBits & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT))
+                {
+                    return i;
+                }
+            }
+        }
+
+        return Utils::findMemoryType(block.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    }
+}
+
+const RenderGraph::Access RenderGraph::COLOR_ATTACHMENT = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+    VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+
+const RenderGraph::Access RenderGraph::DEPTH_ATTACHMENT = { VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+
+const RenderGraph::Access RenderGraph::DEPTH_READ_ONLY = { VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+
+const RenderGraph::Access RenderGraph::SAMPLED_FRAGMENT = { VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+
+const RenderGraph::Access RenderGraph::SAMPLED_COMPUTE = { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+
+const RenderGraph::Access RenderGraph::DEPTH_SAMPLED_FRAGMENT = { VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+
+const RenderGraph::Access RenderGraph::STORAGE_READ_FRAGMENT = { VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL };
+
+const RenderGraph::Access RenderGraph::STORAGE_READ_COMPUTE = { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL };
+
+const RenderGraph::Access RenderGraph::STORAGE_WRITE_COMPUTE = { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL };
+
+const RenderGraph::Access RenderGraph::TRANSFER_SRC = { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL };
+
+const RenderGraph::Access RenderGraph::TRANSFER_DST = { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL };
+
+RenderGraph::Resource RenderGraph::importImage(const std::string& name, const std::vector<VkImage>& images, VkImageAspectFlags aspect,
+                                               VkImageLayout initialLayout, VkImageLayout finalLayout, VkPipelineStageFlags initialStage)
+{
+    ResourceInfo info = {};
+    info.name = name;
+    info.isImage = true;
+    info.images = images;
+    info.aspect = aspect;
+    info.initialLayout = initialLayout;
+    info.finalLayout = finalLayout;
+    info.initialStage = initialStage;
+
+    resources.push_back(info);
+
+    return static_cast<Resource>(resources.size() - 1);
+}
+
+RenderGraph::Resource RenderGraph::importBuffer(const std::string& name, VkBuffer buffer)
+{
+    ResourceInfo info = {};
+    info.name = name;
+    info.buffer = buffer;
+
+    resources.push_back(info);
+
+    return static_cast<Resource>(resources.size() - 1);
+}
+
+RenderGraph::Resource RenderGraph::createImage(const std::string& name, const ImageDesc& desc)
+{
+    ResourceInfo info = {};
+    info.name = name;
+    info.isImage = true;
+    info.transient = true;
+    info.desc = desc;
+    info.aspect = desc.aspect;
+
+    resources.push_back(info);
+
+    return static_cast<Resource>(resources.size() - 1);
+}
+
+uint32_t RenderGraph::addPass(const std::string& name, RecordFunc record)
+{
+    PassInfo pass;
+    pass.name = name;
+    pass.record = record;
+    pass.sideEffects = false;
+
+    passes.push_back(pass);
+
+    return static_cast<uint32_t>(passes.size() - 1);
+}
+
+void RenderGraph::addUse(uint32_t pass, Resource resource, const Access& access, bool write)
+{
+    Use use;
+    use.resource = resource;
+    use.access = access;
+    use.read = !write;
+    use.write = write;
+
+    passes[pass].uses.push_back(use);
+}
+
+void RenderGraph::read(uint32_t pass, Resource resource, const Access& access)
+{
+    addUse(pass, resource, access, false);
+}
+
+void RenderGraph::write(uint32_t pass, Resource resource, const Access& access)
+{
+    addUse(pass, resource, access, true);
+}
+
+void RenderGraph::setSideEffects(uint32_t pass)
+{
+    passes[pass].sideEffects = true;
+}
+
+void RenderGraph::setOutput(Resource resource)
+{
+    resources[resource].output = true;
+}
+
+void RenderGraph::setMemoryRequirements(Resource resource, const VkMemoryRequirements& requirements)
+{
+    resources[resource].requirements = requirements;
+    resources[resource].hasRequirements = true;
+}
+
+std::vector<RenderGraph::Use> RenderGraph::mergeUses(uint32_t pass) const
+{
+    std::vector<Use> merged;
+
+    for (const Use& use : passes[pass].uses)
+    {
+        auto existing = std::find_if(merged.begin(), merged.end(), [&use](const Use& other) { return other.resource == use.resource; });
+
+        if (existing == merged.end())
+        {
+            merged.push_back(use);
+            continue;
+        }
+
+        if (resources[use.resource].isImage && existing->access.layout != use.access.layout)
+        {
+            throw std::runtime_error("Error: Render graph pass " + passes[pass].name + " uses " + resources[use.resource].name + " in two layouts");
+        }
+
+        existing->access.stage |= use.access.stage;
+        existing->access.access |= use.access.access;
+        existing->read = existing->read || use.read;
+        existing->write = existing->write || use.write;
+    }
+
+    return merged;
+}
+
+std::vector<uint32_t> RenderGraph::cull() const
+{
+    // Walk back from the outputs, a pass stays if a later pass or the outside reads something it writes
+    std::vector<bool> needed(resources.size());
+
+    for (size_t i = 0; i < resources.size(); i++)
+    {
+        needed[i] = resources[i].output;
+    }
+
+    std::vector<bool> kept(passes.size(), false);
+
+    for (size_t i = passes.size(); i-- > 0;)
+    {
+        std::vector<Use> uses = mergeUses(static_cast<uint32_t>(i));
+
+        bool keep = passes[i].sideEffects;
+
+        for (const Use& use : uses)
+        {
+            keep = keep || (use.write && needed[use.resource]);
+        }
+
+        if (!keep)
+        {
+            continue;
+        }
+
+        kept[i] = true;
+
+        // Contents it replaces are no longer needed from earlier passes, contents it reads are
+        for (const Use& use : uses)
+        {
+            needed[use.resource] = use.read || (needed[use.resource] && !use.write);
+        }
+    }
+
+    std::vector<uint32_t> order;
+
+    for (uint32_t i = 0; i < passes.size(); i++)
+    {
+        if (kept[i])
+        {
+            order.push_back(i);
+        }
+    }
+
+    return order;
+}
+
+const RenderGraph::Plan& RenderGraph::compile()
+{
+    plan = Plan();
+    plan.placements.resize(resources.size());
+
+    std::vector<uint32_t> order = cull();
+    std::vector<std::vector<Use>> uses(order.size());
+
+    for (uint32_t i = 0, next = 0; i < passes.size(); i++)
+    {
+        if (next < order.size() && order[next] == i)
+        {
+            next++;
+        }
+        else
+        {
+            plan.culledPasses.push_back(i);
+        }
+    }
+
+    // Transient lifetimes, in steps
+    for (uint32_t step = 0; step < order.size(); step++)
+    {
+        uses[step] = mergeUses(order[step]);
+
+        for (const Use& use : uses[step])
+        {
+            Placement& placement = plan.placements[use.resource];
+
+            if (!resources[use.resource].transient)
+            {
+                continue;
+            }
+
+            if (placement.firstStep == NONE)
+            {
+                if (!use.write)
+                {
+                    throw std::runtime_error("Error: Render graph pass " + passes[order[step]].name + " reads " + resources[use.resource].name + " before anything writes it");
+                }
+
+                placement.firstStep = step;
+            }
+
+            placement.lastStep = step;
+        }
+    }
+
+    placeTransients();
+
+    std::vector<State> states(resources.size());
+
+    for (size_t i = 0; i < resources.size(); i++)
+    {
+        states[i] = {};
+        states[i].layout = resources[i].transient ? VK_IMAGE_LAYOUT_UNDEFINED : resources[i].initialLayout;
+        states[i].writeStages = resources[i].initialStage;
+    }
+
+    for (uint32_t step = 0; step < order.size(); step++)
+    {
+        addStep(order[step], uses[step], states);
+    }
+
+    // Leave imported images the way the outside expects them, semaphores order whatever comes next
+    Step finalStep = {};
+    finalStep.pass = NONE;
+
+    for (Resource i = 0; i < resources.size(); i++)
+    {
+        const ResourceInfo& info = resources[i];
+        const State& state = states[i];
+
+        if (!info.isImage || info.transient || info.finalLayout == VK_IMAGE_LAYOUT_UNDEFINED || info.finalLayout == state.layout)
+        {
+            continue;
+        }
+
+        Barrier barrier = {};
+        barrier.resource = i;
+        barrier.srcStage = state.readStages != 0 ? state.readStages : state.writeStages;
+        barrier.srcAccess = state.readStages != 0 ? 0 : state.writeAccess;
+        barrier.dstStage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+        barrier.dstAccess = 0;
+        barrier.oldLayout = state.layout;
+        barrier.newLayout = info.finalLayout;
+
+        finalStep.barriers.push_back(barrier);
+    }
+
+    if (!finalStep.barriers.empty())
+    {
+        plan.steps.push_back(finalStep);
+    }
+
+    for (Step& step : plan.steps)
+    {
+        step.srcStages = 0;
+        step.dstStages = 0;
+
+        for (Barrier& barrier : step.barriers)
+        {
+            // Layout transitions out of nothing wait for nothing
+            if (barrier.srcStage == 0)
+            {
+                barrier.srcStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+            }
+
+            step.srcStages |= barrier.srcStage;
+            step.dstStages |= barrier.dstStage;
+        }
+
+        plan.barrierCount += static_cast<uint32_t>(step.barriers.size());
+        plan.barrierBatches += step.barriers.empty() ? 0 : 1;
+    }
+
+    return plan;
+}
+
+void RenderGraph::placeTransients()
+{
+    std::vector<Resource> order;
+
+    for (Resource i = 0; i < resources.size(); i++)
+    {
+        if (!resources[i].transient || plan.placements[i].firstStep == NONE)
+        {
+            continue;
+        }
+
+        if (!resources[i].hasRequirements)
+        {
+            throw std::runtime_error("Error: Render graph transient " + resources[i].name + " has no memory requirements");
+        }
+
+        order.push_back(i);
+    }
+
+    // Largest first, so blocks are sized by the biggest image and smaller ones pack into them
+    std::stable_sort(order.begin(), order.end(), [this](Resource a, Resource b)
+    {
+        return resources[a].requirements.size > resources[b].requirements.size;
+    });
+
+    std::vector<std::vector<Resource>> blockResources;
+
+    for (Resource resource : order)
+    {
+        const VkMemoryRequirements& requirements = resources[resource].requirements;
+        Placement& placement = plan.placements[resource];
+        placement.size = requirements.size;
+
+        for (uint32_t block = 0; block < plan.blocks.size() && placement.block == NONE; block++)
+        {
+            if ((plan.blocks[block].memoryTypeBits & requirements.memoryTypeBits) == 0 || plan.blocks[block].lazy != resources[resource].desc.lazy)
+            {
+                continue;
+            }
+
+            // Images alive at the same time as this one, it must not overlap any of them
+            std::vector<const Placement*> live;
+            std::vector<VkDeviceSize> offsets(1, 0);
+
+            for (Resource other : blockResources[block])
+            {
+                const Placement& otherPlacement = plan.placements[other];
+
+                if (otherPlacement.firstStep <= placement.lastStep && placement.firstStep <= otherPlacement.lastStep)
+                {
+                    live.push_back(&otherPlacement);
+                    offsets.push_back(alignUp(otherPlacement.offset + otherPlacement.size, requirements.alignment));
+                }
+            }
+
+            std::sort(offsets.begin(), offsets.end());
+
+            for (VkDeviceSize offset : offsets)
+            {
+                bool fits = offset + placement.size <= plan.blocks[block].size;
+
+                for (const Placement* other : live)
+                {
+                    fits = fits && (offset >= other->offset + other->size || other->offset >= offset + placement.size);
+                }
+
+                if (fits)
+                {
+                    placement.block = block;
+                    placement.offset = offset;
+                    break;
+                }
+            }
+        }
+
+        if (placement.block == NONE)
+        {
+            MemoryBlock block = {};
+            block.size = requirements.size;
+            block.memoryTypeBits = requirements.memoryTypeBits;
+            block.lazy = resources[resource].desc.lazy;
+
+            plan.blocks.push_back(block);
+            blockResources.push_back(std::vector<Resource>());
+
+            placement.block = static_cast<uint32_t>(plan.blocks.size() - 1);
+            placement.offset = 0;
+        }
+
+        plan.blocks[placement.block].memoryTypeBits &= requirements.memoryTypeBits;
+        blockResources[placement.block].push_back(resource);
+
+        plan.unaliasedBytes += placement.size;
+    }
+
+    // Every transient is optimal tiling, so neighbours in a block need no buffer-image granularity padding
+    for (uint32_t block = 0; block < plan.blocks.size(); block++)
+    {
+        plan.transientBytes += plan.blocks[block].size;
+
+        for (Resource resource : blockResources[block])
+        {
+            Placement& placement = plan.placements[resource];
+
+            for (Resource other : blockResources[block])
+            {
+                const Placement& otherPlacement = plan.placements[other];
+
+                bool overlaps = placement.offset < otherPlacement.offset + otherPlacement.size && otherPlacement.offset < placement.offset + placement.size;
+
+                if (other != resource && overlaps && otherPlacement.lastStep < placement.firstStep)
+                {
+                    placement.aliases.push_back(other);
+                }
+            }
+
+            std::sort(placement.aliases.begin(), placement.aliases.end());
+        }
+    }
+}
+
+void RenderGraph::addStep(uint32_t pass, const std::vector<Use>& uses, std::vector<State>& states)
+{
+    Step step = {};
+    step.pass = pass;
+
+    uint32_t stepIndex = static_cast<uint32_t>(plan.steps.size());
+
+    for (const Use& use : uses)
+    {
+        const ResourceInfo& info = resources[use.resource];
+        State& state = states[use.resource];
+
+        Barrier barrier = {};
+        barrier.resource = use.resource;
+        barrier.dstStage = use.access.stage;
+        barrier.dstAccess = use.access.access;
+        barrier.oldLayout = state.layout;
+        barrier.newLayout = info.isImage ? use.access.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+
+        bool transition = info.isImage && barrier.newLayout != state.layout;
+        bool needed = false;
+
+        if (info.transient && plan.placements[use.resource].firstStep == stepIndex)
+        {
+            // The contents are undefined, so only wait for the images it aliases to finish with the memory
+            barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            transition = true;
+            needed = true;
+
+            for (Resource alias : plan.placements[use.resource].aliases)
+            {
+                barrier.srcStage |= states[alias].writeStages | states[alias].readStages;
+                barrier.srcAccess |= states[alias].writeAccess;
+            }
+        }
+        else if (use.write || transition)
+        {
+            // Reads since the last write were ordered after it, so waiting on them covers it too
+            barrier.srcStage = state.readStages != 0 ? state.readStages : state.writeStages;
+            barrier.srcAccess = state.readStages != 0 ? 0 : state.writeAccess;
+            needed = transition || barrier.srcStage != 0;
+        }
+        else
+        {
+            // Read after read needs nothing, unless the last write isn't yet visible to this stage
+            bool visible = (use.access.stage & ~state.readStages) == 0 && (use.access.access & ~state.readAccess) == 0;
+
+            barrier.srcStage = state.writeStages;
+            barrier.srcAccess = state.writeAccess;
+            needed = state.writeStages != 0 && !visible;
+        }
+
+        if (needed)
+        {
+            step.barriers.push_back(barrier);
+        }
+
+        if (use.write || transition)
+        {
+            // A layout transition counts as a write the pass's own accesses are ordered after
+            state.layout = barrier.newLayout;
+            state.writeStages = use.access.stage;
+            state.writeAccess = use.write ? use.access.access & WRITE_ACCESS : 0;
+            state.readStages = use.write ? 0 : use.access.stage;
+            state.readAccess = use.write ? 0 : use.access.access;
+        }
+        else
+        {
+            state.readStages |= use.access.stage;
+            state.readAccess |= use.access.access;
+        }
+    }
+
+    plan.steps.push_back(step);
+}
+
+void RenderGraph::createResources()
+{
+    VkDevice device = DeviceManager::instance().getDevice();
+
+    // Only transients a kept pass uses are created
+    for (uint32_t pass : cull())
+    {
+        for (const Use& use : passes[pass].uses)
+        {
+            ResourceInfo& info = resources[use.resource];
+
+            if (!info.transient || info.image != VK_NULL_HANDLE)
+            {
+                continue;
+            }
+
+            VkImageCreateInfo imageInfo = {};
+            imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            imageInfo.imageType = VK_IMAGE_TYPE_2D;
+            imageInfo.extent.width = info.desc.extent.width;
+            imageInfo.extent.height = info.desc.extent.height;
+            imageInfo.extent.depth = 1;
+            imageInfo.mipLevels = 1;
+            imageInfo.arrayLayers = 1;
+            imageInfo.format = info.desc.format;
+            imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            imageInfo.usage = info.desc.usage | (info.desc.lazy ? VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT : 0);
+            imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            imageInfo.samples = info.desc.samples;
+
+            if (vkCreateImage(device, &imageInfo, nullptr, &info.image) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Error: Failed to create render graph image " + info.name);
+            }
+
+            vkGetImageMemoryRequirements(device, info.image, &info.requirements);
+            info.hasRequirements = true;
+        }
+    }
+
+    compile();
+
+    blockMemory.resize(plan.blocks.size());
+
+    for (size_t i = 0; i < plan.blocks.size(); i++)
+    {
+        blockMemory[i] = Utils::allocateTrackedMemory(plan.blocks[i].size, findMemoryType(plan.blocks[i]), "render graph");
+    }
+
+    for (Resource i = 0; i < resources.size(); i++)
+    {
+        ResourceInfo& info = resources[i];
+
+        if (info.image == VK_NULL_HANDLE)
+        {
+            continue;
+        }
+
+        vkBindImageMemory(device, info.image, blockMemory[plan.placements[i].block], plan.placements[i].offset);
+
+        VkImageViewCreateInfo viewInfo = {};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = info.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = info.desc.format;
+        viewInfo.subresourceRange.aspectMask = info.desc.aspect;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(device, &viewInfo, nullptr, &info.view) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Error: Failed to create render graph image view " + info.name);
+        }
+    }
+}
+
+VkImage RenderGraph::getImage(Resource resource, uint32_t imageIndex) const
+{
+    const ResourceInfo& info = resources[resource];
+
+    if (info.transient)
+    {
+        return info.image;
+    }
+
+    return info.images.size() == 1 ? info.images[0] : info.images[imageIndex];
+}
+
+void RenderGraph::execute(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+{
+    std::vector<VkImageMemoryBarrier> imageBarriers;
+
+    for (const Step& step : plan.steps)
+    {
+        if (!step.barriers.empty())
+        {
+            imageBarriers.clear();
+
+            // Buffer hazards fold into one global memory barrier, which drivers handle no worse than per-buffer ones
+            VkMemoryBarrier memoryBarrier = {};
+            memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+
+            for (const Barrier& barrier : step.barriers)
+            {
+                const ResourceInfo& info = resources[barrier.resource];
+
+                if (!info.isImage)
+                {
+                    memoryBarrier.srcAccessMask |= barrier.srcAccess;
+                    memoryBarrier.dstAccessMask |= barrier.dstAccess;
+                    continue;
+                }
+
+                VkImageMemoryBarrier imageBarrier = {};
+                imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                imageBarrier.srcAccessMask = barrier.srcAccess;
+                imageBarrier.dstAccessMask = barrier.dstAccess;
+                imageBarrier.oldLayout = barrier.oldLayout;
+                imageBarrier.newLayout = barrier.newLayout;
+                imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                imageBarrier.image = getImage(barrier.resource, imageIndex);
+                imageBarrier.subresourceRange = { info.aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+
+                imageBarriers.push_back(imageBarrier);
+            }
+
+            uint32_t memoryBarrierCount = memoryBarrier.srcAccessMask != 0 || memoryBarrier.dstAccessMask != 0 ? 1 : 0;
+
+            vkCmdPipelineBarrier(commandBuffer, step.srcStages, step.dstStages, 0, memoryBarrierCount, &memoryBarrier, 0, nullptr,
+                                 static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+        }
+
+        if (step.pass != NONE)
+        {
+            passes[step.pass].record(commandBuffer, imageIndex);
+        }
+    }
+}
+
+VkImageView RenderGraph::getImageView(Resource resource) const
+{
+    return resources[resource].view;
+}
+
+void RenderGraph::printPlan() const
+{
+    std::cout << "Render graph: " << passes.size() - plan.culledPasses.size() << " passes";
+
+    if (!plan.culledPasses.empty())
+    {
+        std::cout << " (" << plan.culledPasses.size() << " culled:";
+
+        for (uint32_t pass : plan.culledPasses)
+        {
+            std::cout << " " << passes[pass].name;
+        }
+
+        std::cout << ")";
+    }
+
+    std::cout << ", " << plan.barrierCount << " barriers in " << plan.barrierBatches << " batches" << std::endl;
+
+    uint32_t lazyBlocks = 0;
+
+    for (const MemoryBlock& block : plan.blocks)
+    {
+        lazyBlocks += block.lazy ? 1 : 0;
+    }
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "  transient memory " << toMegabytes(plan.transientBytes) << " MB in " << plan.blocks.size() << " blocks (" << lazyBlocks << " lazy), "
+              << toMegabytes(plan.unaliasedBytes) << " MB without aliasing" << std::endl;
+
+    std::cout << std::defaultfloat << std::setprecision(6);
+}
+
+void RenderGraph::cleanup(SyncTicket lastUse)
+{
+    for (ResourceInfo& info : resources)
+    {
+        if (info.image != VK_NULL_HANDLE)
+        {
+            DeletionQueue::instance().destroyImage(lastUse, info.image, info.view, VK_NULL_HANDLE);
+        }
+    }
+
+    for (VkDeviceMemory memory : blockMemory)
+    {
+        DeletionQueue::instance().enqueue(lastUse, [memory]()
+        {
+            Utils::freeTrackedMemory(memory);
+        });
+    }
+
+    resources.clear();
+    passes.clear();
+    blockMemory.clear();
+    plan = Plan();
+}
\ No newline at end of file
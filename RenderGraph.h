@@ -0,0 +1,236 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+
+#include <GLFW/glfw3.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "SyncManager.h"
+
+// Frame render graph
+// Passes declare the resources they read and write, and run in the order they were added. Compiling culls passes
+// whose writes nothing reads, works out a single batched barrier ahead of each remaining pass from the declared
+// accesses, and places transient images whose lifetimes don't overlap at overlapping offsets of shared memory
+// blocks. Imported images and buffers (target images, manager-owned resources) are synchronized but not owned.
+// Compiling is CPU only, so a plan can be inspected without a device.
+class RenderGraph
+{
+public:
+
+    typedef uint32_t Resource;
+
+    static const uint32_t NONE = 0xffffffff;
+
+    // How a pass touches a resource, the layout is ignored for buffers
+    struct Access
+    {
+        VkPipelineStageFlags stage;
+        VkAccessFlags access;
+        VkImageLayout layout;
+    };
+
+    static const Access COLOR_ATTACHMENT;
+    static const Access DEPTH_ATTACHMENT;
+    static const Access DEPTH_READ_ONLY;
+    static const Access SAMPLED_FRAGMENT;
+    static const Access SAMPLED_COMPUTE;
+    // Depth images sampled while bound read-only, such as shadow maps
+    static const Access DEPTH_SAMPLED_FRAGMENT;
+    static const Access STORAGE_READ_FRAGMENT;
+    static const Access STORAGE_READ_COMPUTE;
+    static const Access STORAGE_WRITE_COMPUTE;
+    static const Access TRANSFER_SRC;
+    static const Access TRANSFER_DST;
+
+    // Single layer, single mip images created by the graph
+    struct ImageDesc
+    {
+        VkFormat format;
+        VkExtent2D extent;
+        VkImageUsageFlags usage;
+        VkImageAspectFlags aspect;
+        VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+
+        // Attachments that are never loaded or stored can live in lazily allocated memory, which tile-based
+        // GPUs never back. Adds transient attachment usage, and falls back to device-local memory elsewhere
+        bool lazy = false;
+    };
+
+    // Records a pass, imageIndex selects between per-image imports
+    typedef std::function<void(VkCommandBuffer commandBuffer, uint32_t imageIndex)> RecordFunc;
+
+    // One resource's part of a barrier
+    struct Barrier
+    {
+        Resource resource;
+        VkPipelineStageFlags srcStage;
+        VkAccessFlags srcAccess;
+        VkPipelineStageFlags dstStage;
+        VkAccessFlags dstAccess;
+        VkImageLayout oldLayout;
+        VkImageLayout newLayout;
+    };
+
+    // A pass and the barrier ahead of it, issued as one vkCmdPipelineBarrier with the combined stages
+    struct Step
+    {
+        // NONE for the final transitions of imported images
+        uint32_t pass;
+        std::vector<Barrier> barriers;
+        VkPipelineStageFlags srcStages;
+        VkPipelineStageFlags dstStages;
+    };
+
+    struct MemoryBlock
+    {
+        VkDeviceSize size;
+        uint32_t memoryTypeBits;
+
+        // Only lazy transients share a lazy block
+        bool lazy;
+    };
+
+    // Where a transient image lives and the steps it is used in
+    struct Placement
+    {
+        uint32_t block = NONE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        uint32_t firstStep = NONE;
+        uint32_t lastStep = NONE;
+
+        // Earlier transients sharing its memory, its first barrier waits for them
+        std::vector<Resource> aliases;
+    };
+
+    struct Plan
+    {
+        std::vector<Step> steps;
+        std::vector<uint32_t> culledPasses;
+
+        std::vector<MemoryBlock> blocks;
+        // Indexed by resource, only live transients have a block
+        std::vector<Placement> placements;
+
+        VkDeviceSize transientBytes;
+        VkDeviceSize unaliasedBytes;
+
+        uint32_t barrierCount;
+        uint32_t barrierBatches;
+    };
+
+    // Images may be one per target image, picked by the index passed to execute, or a single image
+    // The graph waits for initialStage before the first access and leaves the image in finalLayout (unless UNDEFINED)
+    Resource importImage(const std::string& name, const std::vector<VkImage>& images, VkImageAspectFlags aspect,
+                         VkImageLayout initialLayout, VkImageLayout finalLayout, VkPipelineStageFlags initialStage = 0);
+    Resource importBuffer(const std::string& name, VkBuffer buffer);
+
+    // Created by createResources, lives from its first to its last use in the frame
+    Resource createImage(const std::string& name, const ImageDesc& desc);
+
+    uint32_t addPass(const std::string& name, RecordFunc record);
+
+    // A write replaces the contents, a pass that blends into or partially updates a resource reads it as well
+    void read(uint32_t pass, Resource resource, const Access& access);
+    void write(uint32_t pass, Resource resource, const Access& access);
+
+    // Keep passes with effects outside the graph, and the passes writing resources read outside it
+    void setSideEffects(uint32_t pass);
+    void setOutput(Resource resource);
+
+    // Stands in for the requirements createResources queries, for planning without a device
+    void setMemoryRequirements(Resource resource, const VkMemoryRequirements& requirements);
+
+    // Cull, place transients and work out the barriers
+    // Every live transient needs its memory requirements, from createResources or setMemoryRequirements
+    const Plan& compile();
+
+    // Create the transient images, compile, then allocate the shared memory blocks and bind into them
+    void createResources();
+
+    // Record every pass with its barriers, and the final transitions
+    void execute(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+
+    const Plan& getPlan() const { return plan; }
+    VkImageView getImageView(Resource resource) const;
+
+    // imageIndex picks between per-image imports, like in execute
+    VkImage getImage(Resource resource, uint32_t imageIndex) const;
+
+    void printPlan() const;
+
+    // Release created resources once the last submission using them completes, and forget every declaration
+    void cleanup(SyncTicket lastUse);
+
+private:
+
+    struct ResourceInfo
+    {
+        std::string name;
+        bool isImage;
+        bool transient;
+        bool output;
+
+        // Imports
+        std::vector<VkImage> images;
+        VkBuffer buffer;
+        VkImageAspectFlags aspect;
+        VkImageLayout initialLayout;
+        VkImageLayout finalLayout;
+        VkPipelineStageFlags initialStage;
+
+        // Transients
+        ImageDesc desc;
+        VkMemoryRequirements requirements;
+        bool hasRequirements;
+        VkImage image;
+        VkImageView view;
+    };
+
+    struct Use
+    {
+        Resource resource;
+        Access access;
+        bool read;
+        bool write;
+    };
+
+    struct PassInfo
+    {
+        std::string name;
+        RecordFunc record;
+        std::vector<Use> uses;
+        bool sideEffects;
+    };
+
+    // Accesses since the resource was last written
+    struct State
+    {
+        VkImageLayout layout;
+        VkPipelineStageFlags writeStages;
+        VkAccessFlags writeAccess;
+        VkPipelineStageFlags readStages;
+        VkAccessFlags readAccess;
+    };
+
+    std::vector<ResourceInfo> resources;
+    std::vector<PassInfo> passes;
+
+    Plan plan = {};
+
+    std::vector<VkDeviceMemory> blockMemory;
+
+    void addUse(uint32_t pass, Resource resource, const Access& access, bool write);
+
+    // Passes that stay, in order
+    std::vector<uint32_t> cull() const;
+
+    // A pass's accesses to each resource combined
+    std::vector<Use> mergeUses(uint32_t pass) const;
+
+    void placeTransients();
+    void addStep(uint32_t pass, const std::vector<Use>& uses, std::vector<State>& states);
+};
\ No newline at end of file
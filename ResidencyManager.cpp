@@ -0,0 +1,611 @@
+#include "ResidencyManager.h"
+
+#include "DeviceManager.h"
+#include "Tracer.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+namespace
+{
+    // Budget of a device-local heap without an override or VK_EXT_memory_budget, the rest is left to the
+    // driver and other processes
+    const double DEFAULT_BUDGET_SHARE = 0.8;
+
+    // Budget of a pool, the rest is headroom for fragmentation and loads in flight
+    const double POOL_BUDGET_SHARE = 0.9;
+
+    // Mips this size and smaller are kept when trimming, dropping them saves little over evicting the texture
+    const VkDeviceSize MIN_TRIMMED_LEVEL_BYTES = 64 * 1024;
+
+    // Simulated scene, a mix of mip-mapped RGBA8 textures from 64 to 1024 texels square and single-level meshes
+    const uint32_t SIM_RESOURCES = 512;
+    const uint32_t SIM_MIN_TEXTURE_LEVELS = 7;
+    const uint32_t SIM_MAX_TEXTURE_LEVELS = 11;
+    const VkDeviceSize SIM_MIN_MESH_BYTES = 32 * 1024;
+    const VkDeviceSize SIM_MAX_MESH_BYTES = 2 * 1024 * 1024;
+    const uint32_t SIM_REQUESTS_PER_FRAME = 32;
+
+    // Geometry pool size as a share of the scene's meshes
+    const double SIM_POOL_SHARE = 0.5;
+
+    enum AccessPattern
+    {
+        // Every resource equally likely
+        UNIFORM,
+
+        // Nine requests in ten go to a tenth of the resources
+        HOT_SET,
+
+        // A window of neighbouring resources moving through the scene, like a camera flying through a level
+        SWEEP,
+
+        // A hot set that moves to other resources four times over the run
+        PHASES,
+
+        ACCESS_PATTERN_COUNT
+    };
+
+    const char* getPatternName(AccessPattern pattern)
+    {
+        switch (pattern)
+        {
+        case UNIFORM:   return "uniform";
+        case HOT_SET:   return "hot-set";
+        case SWEEP:     return "sweep";
+        case PHASES:    return "phases";
+        default:        return "unknown";
+        }
+    }
+
+    uint32_t selectResource(AccessPattern pattern, uint32_t frame, uint32_t frames, uint32_t request, std::mt19937& random)
+    {
+        std::uniform_int_distribution<uint32_t> any(0, SIM_RESOURCES - 1);
+        std::uniform_int_distribution<uint32_t> hot(0, SIM_RESOURCES / 10 - 1);
+        std::uniform_real_distribution<float> chance(0.0f, 1.0f);
+
+        switch (pattern)
+        {
+        case HOT_SET:
+            return chance(random) < 0.9f ? hot(random) : any(random);
+
+        case SWEEP:
+            return (frame / 4 + request) % SIM_RESOURCES;
+
+        case PHASES:
+        {
+            uint32_t phase = frame / std::max(frames / 4, 1u);
+
+            return chance(random) < 0.9f ? (phase * SIM_RESOURCES / 4 + hot(random)) % SIM_RESOURCES : any(random);
+        }
+
+        default:
+            return any(random);
+        }
+    }
+}
+
+ResidencyManager& ResidencyManager::instance()
+{
+    static ResidencyManager instance;
+
+    return instance;
+}
+
+void ResidencyManager::init(VkInstance instance, VkDeviceSize budgetOverride)
+{
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(DeviceManager::instance().getPhysicalDevice(), &memoryProperties);
+
+    memoryTypeHeaps.clear();
+
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+    {
+        memoryTypeHeaps.push_back(memoryProperties.memoryTypes[i].heapIndex);
+    }
+
+    heaps.assign(memoryProperties.memoryHeapCount, Heap());
+
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+    {
+        Heap& heap = heaps[i];
+        heap.size = memoryProperties.memoryHeaps[i].size;
+        heap.deviceLocal = (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+        heap.pool = false;
+
+        // Host heaps are tracked but only held to their size
+        if (budgetOverride > 0 && heap.deviceLocal)
+        {
+            heap.budget = budgetOverride;
+        }
+        else
+        {
+            heap.budget = heap.deviceLocal ? static_cast<VkDeviceSize>(heap.size * DEFAULT_BUDGET_SHARE) : heap.size;
+        }
+    }
+
+    vulkanInstance = instance;
+    driverBudget = budgetOverride == 0 && DeviceManager::instance().hasMemoryBudget();
+
+    if (driverBudget)
+    {
+        refreshBudgets();
+    }
+
+    for (uint32_t i = 0; i < heaps.size(); i++)
+    {
+        if (heaps[i].deviceLocal)
+        {
+            std::cout << "Residency: heap " << i << " budget " << heaps[i].budget / (1024 * 1024) << " of " << heaps[i].size / (1024 * 1024)
+                      << " MB (" << (budgetOverride > 0 ? "override" : driverBudget ? "VK_EXT_memory_budget" : "default share") << ")" << std::endl;
+        }
+    }
+}
+
+void ResidencyManager::initHeaps(const std::vector<VkDeviceSize>& budgets)
+{
+    heaps.assign(budgets.size(), Heap());
+    memoryTypeHeaps.clear();
+
+    for (uint32_t i = 0; i < budgets.size(); i++)
+    {
+        heaps[i].size = budgets[i];
+        heaps[i].budget = budgets[i];
+        heaps[i].deviceLocal = true;
+        heaps[i].pool = false;
+
+        memoryTypeHeaps.push_back(i);
+    }
+
+    driverBudget = false;
+}
+
+uint32_t ResidencyManager::addPool(VkDeviceSize size)
+{
+    Heap pool = {};
+    pool.size = size;
+    pool.budget = static_cast<VkDeviceSize>(size * POOL_BUDGET_SHARE);
+    pool.pool = true;
+
+    heaps.push_back(pool);
+
+    return static_cast<uint32_t>(heaps.size() - 1);
+}
+
+void ResidencyManager::setMipTrimming(bool enabled)
+{
+    mipTrimming = enabled;
+}
+
+void ResidencyManager::refreshBudgets()
+{
+#ifdef VK_EXT_memory_budget
+    auto getMemoryProperties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceMemoryProperties2KHR>(vkGetInstanceProcAddr(vulkanInstance, "vkGetPhysicalDeviceMemoryProperties2KHR"));
+
+    if (getMemoryProperties2 == nullptr)
+    {
+        return;
+    }
+
+    // The driver's budget already allows for other processes, and changes as they come and go
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties = {};
+    budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+    VkPhysicalDeviceMemoryProperties2KHR memoryProperties = {};
+    memoryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2_KHR;
+    memoryProperties.pNext = &budgetProperties;
+
+    getMemoryProperties2(DeviceManager::instance().getPhysicalDevice(), &memoryProperties);
+
+    for (uint32_t i = 0; i < heaps.size(); i++)
+    {
+        if (!heaps[i].pool)
+        {
+            heaps[i].budget = budgetProperties.heapBudget[i];
+        }
+    }
+#endif
+}
+
+void ResidencyManager::allocated(VkDeviceMemory memory, uint32_t memoryTypeIndex, VkDeviceSize size)
+{
+    // Allocations made before init go uncounted
+    if (memoryTypeIndex >= memoryTypeHeaps.size())
+    {
+        return;
+    }
+
+    Allocation allocation = {};
+    allocation.heap = memoryTypeHeaps[memoryTypeIndex];
+    allocation.size = size;
+
+    allocations[memory] = allocation;
+
+    Heap& heap = heaps[allocation.heap];
+    heap.allocatedBytes += size;
+    heap.peakBytes = std::max(heap.peakBytes, getUsage(heap));
+}
+
+void ResidencyManager::release(VkDeviceMemory memory)
+{
+    auto found = allocations.find(memory);
+
+    if (found == allocations.end())
+    {
+        return;
+    }
+
+    heaps[found->second.heap].allocatedBytes -= found->second.size;
+    allocations.erase(found);
+}
+
+uint32_t ResidencyManager::getHeapIndex(uint32_t memoryTypeIndex) const
+{
+    return memoryTypeHeaps[memoryTypeIndex];
+}
+
+uint32_t ResidencyManager::getDeviceLocalHeap() const
+{
+    for (uint32_t i = 0; i < heaps.size(); i++)
+    {
+        if (heaps[i].deviceLocal)
+        {
+            return i;
+        }
+    }
+
+    return 0;
+}
+
+VkDeviceSize ResidencyManager::getUsage(const Heap& heap) const
+{
+    return heap.allocatedBytes + heap.residentBytes;
+}
+
+VkDeviceSize ResidencyManager::getLevelBytes(const Resource& resource, uint32_t firstLevel, uint32_t lastLevel) const
+{
+    VkDeviceSize bytes = 0;
+
+    for (uint32_t level = firstLevel; level < lastLevel; level++)
+    {
+        bytes += resource.levelBytes[level];
+    }
+
+    return bytes;
+}
+
+ResidencyManager::ResourceId ResidencyManager::addResource(uint32_t heap, const std::vector<VkDeviceSize>& levelBytes, uint32_t firstLevel, const ResidencyFunction& setResidency)
+{
+    ResourceId id;
+
+    if (!freeSlots.empty())
+    {
+        id = freeSlots.back();
+        freeSlots.pop_back();
+    }
+    else
+    {
+        resources.push_back(Resource());
+        id = static_cast<ResourceId>(resources.size());
+    }
+
+    Resource& resource = resources[id - 1];
+    resource.heap = heap;
+    resource.levelBytes = levelBytes;
+    resource.firstLevel = firstLevel;
+    resource.lastUse = frame;
+    resource.setResidency = setResidency;
+    resource.live = true;
+
+    heaps[heap].residentBytes += getLevelBytes(resource, firstLevel, static_cast<uint32_t>(levelBytes.size()));
+    heaps[heap].peakBytes = std::max(heaps[heap].peakBytes, getUsage(heaps[heap]));
+
+    return id;
+}
+
+void ResidencyManager::removeResource(ResourceId id)
+{
+    if (id == 0)
+    {
+        return;
+    }
+
+    Resource& resource = resources[id - 1];
+    heaps[resource.heap].residentBytes -= getLevelBytes(resource, resource.firstLevel, static_cast<uint32_t>(resource.levelBytes.size()));
+
+    resource = Resource();
+    freeSlots.push_back(id);
+}
+
+bool ResidencyManager::request(ResourceId id)
+{
+    Resource& resource = resources[id - 1];
+    resource.lastUse = frame;
+
+    stats.requests++;
+
+    if (resource.firstLevel == 0)
+    {
+        stats.hits++;
+        return true;
+    }
+
+    if (resource.firstLevel < resource.levelBytes.size())
+    {
+        stats.partialHits++;
+    }
+    else
+    {
+        stats.misses++;
+    }
+
+    stats.bytesStreamed += getLevelBytes(resource, 0, resource.firstLevel);
+    setFirstLevel(resource, 0);
+
+    return false;
+}
+
+void ResidencyManager::setFirstLevel(Resource& resource, uint32_t firstLevel)
+{
+    uint32_t levelCount = static_cast<uint32_t>(resource.levelBytes.size());
+    Heap& heap = heaps[resource.heap];
+
+    heap.residentBytes -= getLevelBytes(resource, resource.firstLevel, levelCount);
+    heap.residentBytes += getLevelBytes(resource, firstLevel, levelCount);
+    heap.peakBytes = std::max(heap.peakBytes, getUsage(heap));
+
+    resource.firstLevel = firstLevel;
+    resource.setResidency(firstLevel);
+}
+
+void ResidencyManager::evict(Resource& resource)
+{
+    uint32_t levelCount = static_cast<uint32_t>(resource.levelBytes.size());
+
+    stats.evictions++;
+    stats.bytesReleased += getLevelBytes(resource, resource.firstLevel, levelCount);
+    setFirstLevel(resource, levelCount);
+}
+
+void ResidencyManager::enforce()
+{
+    TRACE_ZONE("enforceResidency");
+
+    if (driverBudget)
+    {
+        refreshBudgets();
+    }
+
+    for (uint32_t i = 0; i < heaps.size(); i++)
+    {
+        if (getUsage(heaps[i]) > heaps[i].budget)
+        {
+            enforceHeap(i);
+        }
+    }
+
+    frame++;
+}
+
+void ResidencyManager::enforceHeap(uint32_t heapIndex)
+{
+    const Heap& heap = heaps[heapIndex];
+
+    // Anything resident and not requested this frame, least recently used first
+    std::vector<ResourceId> candidates;
+
+    for (ResourceId id = 1; id <= resources.size(); id++)
+    {
+        const Resource& resource = resources[id - 1];
+
+        if (resource.live && resource.heap == heapIndex && resource.lastUse < frame && resource.firstLevel < resource.levelBytes.size())
+        {
+            candidates.push_back(id);
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [this](ResourceId a, ResourceId b)
+    {
+        return resources[a - 1].lastUse != resources[b - 1].lastUse ? resources[a - 1].lastUse < resources[b - 1].lastUse : a < b;
+    });
+
+    // Oldest first, textures give up their top mips and meshes are evicted
+    for (ResourceId id : candidates)
+    {
+        if (getUsage(heap) <= heap.budget)
+        {
+            return;
+        }
+
+        Resource& resource = resources[id - 1];
+        uint32_t levelCount = static_cast<uint32_t>(resource.levelBytes.size());
+
+        if (mipTrimming && levelCount > 1)
+        {
+            VkDeviceSize excess = getUsage(heap) - heap.budget;
+            VkDeviceSize trimmed = 0;
+            uint32_t level = resource.firstLevel;
+
+            while (trimmed < excess && level + 1 < levelCount && resource.levelBytes[level] > MIN_TRIMMED_LEVEL_BYTES)
+            {
+                trimmed += resource.levelBytes[level];
+                level++;
+            }
+
+            if (level != resource.firstLevel)
+            {
+                stats.levelsTrimmed += level - resource.firstLevel;
+                stats.bytesReleased += trimmed;
+                setFirstLevel(resource, level);
+            }
+        }
+        else
+        {
+            evict(resource);
+        }
+    }
+
+    // Then whatever is left of the textures, in the same order
+    for (ResourceId id : candidates)
+    {
+        if (getUsage(heap) <= heap.budget)
+        {
+            return;
+        }
+
+        if (resources[id - 1].firstLevel < resources[id - 1].levelBytes.size())
+        {
+            evict(resources[id - 1]);
+        }
+    }
+
+    // Everything left is in use this frame
+    if (getUsage(heap) > heap.budget)
+    {
+        stats.framesOverBudget++;
+    }
+}
+
+ResidencyManager::Stats ResidencyManager::getStats() const
+{
+    return stats;
+}
+
+void ResidencyManager::printStats() const
+{
+    double requests = static_cast<double>(std::max(stats.requests, static_cast<uint64_t>(1)));
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "Residency: " << stats.requests << " requests, " << 100.0 * stats.hits / requests << "% hits, "
+              << 100.0 * stats.partialHits / requests << "% trimmed, " << 100.0 * stats.misses / requests << "% misses, "
+              << stats.levelsTrimmed << " mips trimmed, " << stats.evictions << " evictions, "
+              << stats.bytesStreamed / (1024.0 * 1024.0) << " MB streamed, " << stats.bytesReleased / (1024.0 * 1024.0) << " MB released, "
+              << stats.framesOverBudget << " frames over budget" << std::endl;
+
+    for (uint32_t i = 0; i < heaps.size(); i++)
+    {
+        const Heap& heap = heaps[i];
+
+        if (heap.pool)
+        {
+            std::cout << "  Pool " << i << ": " << heap.residentBytes / (1024.0 * 1024.0) << " of " << heap.budget / (1024.0 * 1024.0) << " MB streamed, peak "
+                      << heap.peakBytes / (1024.0 * 1024.0) << " MB" << std::endl;
+        }
+        else if (heap.deviceLocal)
+        {
+            std::cout << "  Heap " << i << ": " << getUsage(heap) / (1024.0 * 1024.0) << " of " << heap.budget / (1024.0 * 1024.0) << " MB ("
+                      << heap.allocatedBytes / (1024.0 * 1024.0) << " MB allocated, " << heap.residentBytes / (1024.0 * 1024.0) << " MB streamed), peak "
+                      << heap.peakBytes / (1024.0 * 1024.0) << " MB" << std::endl;
+        }
+    }
+
+    std::cout << std::defaultfloat << std::setprecision(6);
+}
+
+void ResidencyManager::simulate(VkDeviceSize budget, uint32_t frames)
+{
+    // Same scene for every run
+    std::mt19937 random(1);
+    std::uniform_int_distribution<uint32_t> textureLevels(SIM_MIN_TEXTURE_LEVELS, SIM_MAX_TEXTURE_LEVELS);
+    std::uniform_int_distribution<VkDeviceSize> meshBytes(SIM_MIN_MESH_BYTES, SIM_MAX_MESH_BYTES);
+    std::uniform_int_distribution<uint32_t> coin(0, 1);
+
+    std::vector<std::vector<VkDeviceSize>> scene(SIM_RESOURCES);
+    std::vector<bool> meshes(SIM_RESOURCES);
+    VkDeviceSize sceneBytes = 0;
+    VkDeviceSize meshSceneBytes = 0;
+
+    for (uint32_t i = 0; i < SIM_RESOURCES; i++)
+    {
+        std::vector<VkDeviceSize>& levelBytes = scene[i];
+        meshes[i] = coin(random) == 1;
+
+        if (!meshes[i])
+        {
+            uint32_t levels = textureLevels(random);
+
+            for (uint32_t level = 0; level < levels; level++)
+            {
+                VkDeviceSize size = static_cast<VkDeviceSize>(1) << (levels - 1 - level);
+                levelBytes.push_back(size * size * 4);
+            }
+        }
+        else
+        {
+            levelBytes.push_back(meshBytes(random));
+            meshSceneBytes += levelBytes.back();
+        }
+
+        for (VkDeviceSize bytes : levelBytes)
+        {
+            sceneBytes += bytes;
+        }
+    }
+
+    VkDeviceSize poolSize = static_cast<VkDeviceSize>(meshSceneBytes * SIM_POOL_SHARE);
+
+    std::cout << "Residency simulation: " << SIM_RESOURCES << " resources (" << sceneBytes / (1024 * 1024) << " MB, "
+              << meshSceneBytes / (1024 * 1024) << " MB of meshes), " << budget / (1024 * 1024) << " MB texture budget, "
+              << poolSize / (1024 * 1024) << " MB geometry pool, " << frames << " frames of " << SIM_REQUESTS_PER_FRAME << " requests" << std::endl;
+
+    std::cout << std::left << std::setw(10) << "pattern" << std::setw(10) << "trimming" << std::right
+              << std::setw(8) << "hits" << std::setw(9) << "trimmed" << std::setw(8) << "misses"
+              << std::setw(14) << "streamed MB" << std::setw(14) << "released MB" << std::setw(13) << "over budget" << std::endl;
+
+    for (uint32_t pattern = 0; pattern < ACCESS_PATTERN_COUNT; pattern++)
+    {
+        for (uint32_t trimming = 0; trimming < 2; trimming++)
+        {
+            ResidencyManager policy;
+            policy.initHeaps({ budget });
+            policy.setMipTrimming(trimming == 1);
+
+            uint32_t pool = policy.addPool(poolSize);
+
+            // Everything starts out on disk, so the first request of each resource is a miss
+            for (uint32_t i = 0; i < SIM_RESOURCES; i++)
+            {
+                policy.addResource(meshes[i] ? pool : 0, scene[i], static_cast<uint32_t>(scene[i].size()), [](uint32_t) {});
+            }
+
+            std::mt19937 accesses(pattern + 1);
+
+            for (uint32_t frame = 0; frame < frames; frame++)
+            {
+                for (uint32_t request = 0; request < SIM_REQUESTS_PER_FRAME; request++)
+                {
+                    policy.request(selectResource(static_cast<AccessPattern>(pattern), frame, frames, request, accesses) + 1);
+                }
+
+                policy.enforce();
+            }
+
+            const Stats& result = policy.stats;
+            double requests = static_cast<double>(std::max(result.requests, static_cast<uint64_t>(1)));
+
+            std::cout << std::fixed << std::setprecision(1)
+                      << std::left << std::setw(10) << getPatternName(static_cast<AccessPattern>(pattern)) << std::setw(10) << (trimming == 1 ? "mips" : "off") << std::right
+                      << std::setw(7) << 100.0 * result.hits / requests << "%" << std::setw(8) << 100.0 * result.partialHits / requests << "%"
+                      << std::setw(7) << 100.0 * result.misses / requests << "%"
+                      << std::setw(14) << result.bytesStreamed / (1024.0 * 1024.0) << std::setw(14) << result.bytesReleased / (1024.0 * 1024.0)
+                      << std::setw(13) << result.framesOverBudget
+                      << std::defaultfloat << std::setprecision(6) << std::endl;
+        }
+    }
+}
+
+void ResidencyManager::cleanup()
+{
+    printStats();
+
+    allocations.clear();
+    resources.clear();
+    freeSlots.clear();
+    heaps.clear();
+    memoryTypeHeaps.clear();
+
+    stats = Stats();
+    frame = 0;
+}
\ No newline at end of file
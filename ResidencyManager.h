@@ -0,0 +1,168 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+// Device memory use per heap against a budget, and which streamed resources stay resident
+// Fixed allocations are tracked as they are made and freed. Streamed resources - textures and meshes the asset
+// manager can read again - are counted by the levels they hold, largest first, so a texture is its mip chain and a
+// mesh a single level. Meshes are sub-allocated from the geometry pools, a fixed allocation, so they are held to a
+// pool of their own instead of the device heap. Each frame the least recently used resources are trimmed while a
+// heap or pool is over budget: textures lose their top mips first, and only then are whole resources evicted.
+// A resource that is requested while trimmed or evicted is streamed back in. Main thread only.
+class ResidencyManager
+{
+public:
+
+    typedef uint32_t ResourceId;
+
+    // Called with the first level the resource should hold, levelCount to release it
+    // The change is counted straight away, so the owner may finish it over the following frames
+    typedef std::function<void(uint32_t firstLevel)> ResidencyFunction;
+
+    struct Stats
+    {
+        uint64_t requests;
+        uint64_t hits;
+
+        // Resident, but with top mips dropped
+        uint64_t partialHits;
+        uint64_t misses;
+
+        uint64_t levelsTrimmed;
+        uint64_t evictions;
+
+        VkDeviceSize bytesStreamed;
+        VkDeviceSize bytesReleased;
+
+        // Frames that ended over budget with nothing left unused to trim
+        uint64_t framesOverBudget;
+    };
+
+private:
+
+    ResidencyManager() {}
+
+    struct Allocation
+    {
+        uint32_t heap;
+        VkDeviceSize size;
+    };
+
+    struct Resource
+    {
+        uint32_t heap;
+        std::vector<VkDeviceSize> levelBytes;
+
+        // Levels from this one down are resident, levelBytes.size() when evicted
+        uint32_t firstLevel;
+
+        uint64_t lastUse;
+
+        std::function<void(uint32_t)> setResidency;
+
+        bool live;
+    };
+
+    struct Heap
+    {
+        VkDeviceSize size;
+        VkDeviceSize budget;
+        bool deviceLocal;
+
+        // Space within a fixed allocation, only its resources count
+        bool pool;
+
+        VkDeviceSize allocatedBytes;
+        VkDeviceSize residentBytes;
+        VkDeviceSize peakBytes;
+    };
+
+    std::vector<Heap> heaps;
+    std::vector<uint32_t> memoryTypeHeaps;
+
+    std::unordered_map<VkDeviceMemory, Allocation> allocations;
+
+    // Ids are slot indices plus one
+    std::vector<Resource> resources;
+    std::vector<uint32_t> freeSlots;
+
+    uint64_t frame = 0;
+
+    // Set when the budgets come from VK_EXT_memory_budget and are refreshed every frame
+    bool driverBudget = false;
+    VkInstance vulkanInstance = VK_NULL_HANDLE;
+
+    bool mipTrimming = true;
+
+    Stats stats = {};
+
+    VkDeviceSize getUsage(const Heap& heap) const;
+    VkDeviceSize getLevelBytes(const Resource& resource, uint32_t firstLevel, uint32_t lastLevel) const;
+
+    void refreshBudgets();
+    void enforceHeap(uint32_t heapIndex);
+    void setFirstLevel(Resource& resource, uint32_t firstLevel);
+    void evict(Resource& resource);
+
+public:
+
+    // Return singleton instance
+    static ResidencyManager& instance();
+
+    // Ensure singleton is never copied
+    ResidencyManager(ResidencyManager const&)   = delete;
+    void operator=(ResidencyManager const&)     = delete;
+
+    // Budget of each device-local heap, 0 to use VK_EXT_memory_budget when the device has it
+    // and a share of the heap's size otherwise
+    void init(VkInstance instance, VkDeviceSize budgetOverride);
+
+    // Heaps without a device, for simulating the policy
+    void initHeaps(const std::vector<VkDeviceSize>& budgets);
+
+    // Hold the resources of a fixed allocation of size bytes, such as the geometry pools, to a share of it
+    // Returns the index to add them with, until the next init
+    uint32_t addPool(VkDeviceSize size);
+
+    // Drop top mips before evicting whole resources, on by default
+    void setMipTrimming(bool enabled);
+
+    // Fixed allocations, released when freed
+    void allocated(VkDeviceMemory memory, uint32_t memoryTypeIndex, VkDeviceSize size);
+    void release(VkDeviceMemory memory);
+
+    uint32_t getHeapIndex(uint32_t memoryTypeIndex) const;
+
+    // First device-local heap, where streamed textures live
+    uint32_t getDeviceLocalHeap() const;
+
+    // Starts out resident from firstLevel and counts as used this frame
+    ResourceId addResource(uint32_t heap, const std::vector<VkDeviceSize>& levelBytes, uint32_t firstLevel, const ResidencyFunction& setResidency);
+    void removeResource(ResourceId resource);
+
+    // The resource is used this frame, anything it lacks is streamed back in
+    // Returns whether it was fully resident
+    bool request(ResourceId resource);
+
+    // Trim the least recently used resources of every heap over budget and start the next frame, once per frame
+    // Resources requested since the last call are kept
+    void enforce();
+
+    Stats getStats() const;
+    void printStats() const;
+
+    // Replay access patterns against a simulated heap of budget bytes for textures and a geometry pool holding
+    // part of the meshes, and print the hit rate and bytes streamed of each, with and without mip trimming.
+    // No device is needed
+    static void simulate(VkDeviceSize budget, uint32_t frames);
+
+    // Forget every allocation and resource
+    void cleanup();
+};
\ No newline at end of file
@@ -0,0 +1,133 @@
+#include "ResolutionScaler.h"
+
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <algorithm>
+
+namespace
+{
+    // Weight of each new frame time in the moving average
+    const double SMOOTHING = 0.25;
+
+    // No change while the average sits between these fractions of the budget, so noise doesn't keep the extent moving
+    const double LOWER_BAND = 0.8;
+    const double UPPER_BAND = 1.0;
+
+    // Changes aim for this fraction of the budget, leaving headroom for spikes
+    const double TARGET = 0.9;
+
+    // Largest change per step of the scale, dropping quickly on spikes and recovering gently
+    const float MAX_DECREASE = 0.8f;
+    const float MAX_INCREASE = 1.05f;
+
+    // Scales snap to multiples of this, so small corrections don't each produce a new extent
+    const float SCALE_STEP = 1.0f / 40.0f;
+
+    // Frames are serialized, so only the frame straddling a change is skipped
+    const uint32_t SETTLE_FRAMES = 1;
+}
+
+ResolutionScaler::ResolutionScaler(const Config& config)
+    : config(config)
+{
+    this->config.minScale = std::max(config.minScale, SCALE_STEP);
+    this->config.maxScale = std::max(config.maxScale, this->config.minScale);
+
+    scale = this->config.maxScale;
+}
+
+const ResolutionScaler::Config& ResolutionScaler::getConfig() const
+{
+    return config;
+}
+
+void ResolutionScaler::setTargetExtent(VkExtent2D extent)
+{
+    targetExtent = extent;
+    averageMs = -1.0;
+}
+
+VkExtent2D ResolutionScaler::getMaxExtent() const
+{
+    return getExtent(config.maxScale);
+}
+
+VkExtent2D ResolutionScaler::getRenderExtent() const
+{
+    return getExtent(scale);
+}
+
+float ResolutionScaler::getScale() const
+{
+    return scale;
+}
+
+bool ResolutionScaler::update(double gpuMs)
+{
+    frames++;
+    scaleTotal += scale;
+
+    if (gpuMs <= 0.0)
+    {
+        return false;
+    }
+
+    if (settleFrames > 0)
+    {
+        settleFrames--;
+        return false;
+    }
+
+    averageMs = averageMs < 0.0 ? gpuMs : averageMs + SMOOTHING * (gpuMs - averageMs);
+
+    if (averageMs > config.budgetMs * LOWER_BAND && averageMs <= config.budgetMs * UPPER_BAND)
+    {
+        return false;
+    }
+
+    // GPU time follows the pixel count, so each axis scales by the square root of the time ratio
+    float factor = static_cast<float>(std::sqrt(config.budgetMs * TARGET / averageMs));
+    factor = std::min(std::max(factor, MAX_DECREASE), MAX_INCREASE);
+
+    // Round away from the current scale, an over-budget frame must always lower it
+    float steps = scale * factor / SCALE_STEP;
+    float next = (factor < 1.0f ? std::floor(steps) : std::ceil(steps)) * SCALE_STEP;
+    next = std::min(std::max(next, config.minScale), config.maxScale);
+
+    VkExtent2D current = getExtent(scale);
+    VkExtent2D extent = getExtent(next);
+
+    if (extent.width == current.width && extent.height == current.height)
+    {
+        return false;
+    }
+
+    scale = next;
+    changes++;
+
+    // The average restarts at the new extent
+    averageMs = -1.0;
+    settleFrames = SETTLE_FRAMES;
+
+    return true;
+}
+
+void ResolutionScaler::printStats() const
+{
+    VkExtent2D extent = getRenderExtent();
+
+    std::cout << std::fixed << std::setprecision(2)
+              << "Dynamic resolution: " << changes << " changes over " << frames << " frames, mean scale "
+              << (frames > 0 ? scaleTotal / frames : scale) << ", last " << scale << " (" << extent.width << "x" << extent.height << ")"
+              << std::defaultfloat << std::setprecision(6) << std::endl;
+}
+
+VkExtent2D ResolutionScaler::getExtent(float scale) const
+{
+    VkExtent2D extent = {};
+    extent.width = std::max(static_cast<uint32_t>(targetExtent.width * scale), 1u);
+    extent.height = std::max(static_cast<uint32_t>(targetExtent.height * scale), 1u);
+
+    return extent;
+}
\ No newline at end of file
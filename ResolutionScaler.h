@@ -0,0 +1,60 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+
+#include <GLFW/glfw3.h>
+
+// Dynamic resolution controller
+// Steers the fraction of the target's width and height that is rendered towards a GPU frame time budget. The
+// scene is drawn into a sub-rect of an image sized for the largest scale, so a change only re-records commands
+class ResolutionScaler
+{
+public:
+
+    struct Config
+    {
+        // GPU frame time to stay under
+        double budgetMs = 16.0;
+
+        // Bounds on the scale of each axis, above 1 supersamples
+        float minScale = 0.5f;
+        float maxScale = 1.0f;
+    };
+
+    explicit ResolutionScaler(const Config& config);
+
+    const Config& getConfig() const;
+
+    // Extent the render extent is upscaled to, recreated with the swapchain. Keeps the current scale
+    void setTargetExtent(VkExtent2D extent);
+
+    // Size to allocate scaled images at
+    VkExtent2D getMaxExtent() const;
+    VkExtent2D getRenderExtent() const;
+    float getScale() const;
+
+    // GPU time of the last frame, negative without timestamps
+    // Returns true when the render extent changed
+    bool update(double gpuMs);
+
+    void printStats() const;
+
+private:
+
+    Config config;
+
+    VkExtent2D targetExtent = {};
+    float scale;
+
+    // Moving average of GPU frame times since the last change, negative when restarted
+    double averageMs = -1.0;
+
+    // Frames to skip after a change, their times may still cover the old extent
+    uint32_t settleFrames = 0;
+
+    uint32_t frames = 0;
+    uint32_t changes = 0;
+    double scaleTotal = 0.0;
+
+    VkExtent2D getExtent(float scale) const;
+};
\ No newline at end of file
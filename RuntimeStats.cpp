@@ -0,0 +1,291 @@
+#include "RuntimeStats.h"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+#include <csignal>
+
+namespace
+{
+    // Set from the signal handler, which can do nothing else safely
+    volatile std::sig_atomic_t dumpRequested = 0;
+
+    void requestDump(int)
+    {
+        dumpRequested = 1;
+    }
+
+    void writeHistogram(std::ostream& out, const RuntimeStats::Histogram& histogram, double scale)
+    {
+        out << "{\"mean\":" << histogram.getMean() * scale
+            << ",\"min\":" << histogram.getMin() * scale
+            << ",\"max\":" << histogram.getMax() * scale
+            << ",\"p50\":" << histogram.getPercentile(50.0) * scale
+            << ",\"p95\":" << histogram.getPercentile(95.0) * scale
+            << ",\"p99\":" << histogram.getPercentile(99.0) * scale << "}";
+    }
+}
+
+uint32_t RuntimeStats::Histogram::getBucket(uint64_t value)
+{
+    if (value < SUB_BUCKETS)
+    {
+        return static_cast<uint32_t>(value);
+    }
+
+    // Top three bits below the leading one pick the step within the power of two
+    uint32_t exponent = 63 - static_cast<uint32_t>(__builtin_clzll(value));
+    uint32_t step = static_cast<uint32_t>(value >> (exponent - 3)) & (SUB_BUCKETS - 1);
+
+    return (exponent - 2) * SUB_BUCKETS + step;
+}
+
+uint64_t RuntimeStats::Histogram::getBucketValue(uint32_t bucket)
+{
+    if (bucket < SUB_BUCKETS)
+    {
+        return bucket;
+    }
+
+    uint32_t exponent = bucket / SUB_BUCKETS + 2;
+    uint64_t step = bucket % SUB_BUCKETS;
+
+    return (SUB_BUCKETS + step) << (exponent - 3);
+}
+
+void RuntimeStats::Histogram::record(uint64_t value)
+{
+    buckets[getBucket(value)]++;
+
+    min = count == 0 ? value : std::min(min, value);
+    max = std::max(max, value);
+    sum += value;
+    count++;
+}
+
+void RuntimeStats::Histogram::clear()
+{
+    std::fill(buckets, buckets + BUCKET_COUNT, 0);
+    count = 0;
+    sum = 0;
+    min = 0;
+    max = 0;
+}
+
+uint64_t RuntimeStats::Histogram::getCount() const
+{
+    return count;
+}
+
+uint64_t RuntimeStats::Histogram::getMin() const
+{
+    return min;
+}
+
+uint64_t RuntimeStats::Histogram::getMax() const
+{
+    return max;
+}
+
+double RuntimeStats::Histogram::getMean() const
+{
+    return count > 0 ? static_cast<double>(sum) / count : 0.0;
+}
+
+uint64_t RuntimeStats::Histogram::getPercentile(double percentile) const
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    // Nearest rank, clamped to the exact extremes
+    uint64_t rank = static_cast<uint64_t>(percentile / 100.0 * count + 0.5);
+    rank = std::max<uint64_t>(rank, 1);
+
+    uint64_t seen = 0;
+
+    for (uint32_t i = 0; i < BUCKET_COUNT; i++)
+    {
+        seen += buckets[i];
+
+        if (seen >= rank)
+        {
+            return std::min(std::max(getBucketValue(i), min), max);
+        }
+    }
+
+    return max;
+}
+
+RuntimeStats& RuntimeStats::instance()
+{
+    static RuntimeStats instance;
+
+    return instance;
+}
+
+void RuntimeStats::init(double logInterval, const std::string& dumpPath)
+{
+    this->logInterval = logInterval;
+    this->dumpPath = dumpPath;
+
+    for (uint32_t i = 0; i < COUNTER_COUNT; i++)
+    {
+        counters[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void RuntimeStats::installSignalHandler()
+{
+#ifdef SIGUSR1
+    std::signal(SIGUSR1, requestDump);
+#endif
+}
+
+void RuntimeStats::addCommands(const CommandCounts& counts)
+{
+    add(DRAW_CALLS, counts.drawCalls);
+    add(DESCRIPTOR_BINDS, counts.descriptorBinds);
+    add(PIPELINE_BINDS, counts.pipelineBinds);
+}
+
+void RuntimeStats::endFrame(double frameMs)
+{
+    auto now = std::chrono::steady_clock::now();
+
+    if (!windowStarted)
+    {
+        windowStart = now;
+        windowStarted = true;
+    }
+
+    for (uint32_t i = 0; i < COUNTER_COUNT; i++)
+    {
+        uint64_t value = counters[i].exchange(0, std::memory_order_relaxed);
+
+        histograms[i].record(value);
+        windowHistograms[i].record(value);
+        totals[i] += value;
+    }
+
+    uint64_t frameUs = static_cast<uint64_t>(std::max(frameMs, 0.0) * 1000.0);
+    frameTimes.record(frameUs);
+    windowFrameTimes.record(frameUs);
+
+    // Overlay refreshes twice a second even when the log line is off
+    double seconds = std::chrono::duration<double>(now - windowStart).count();
+    double interval = logInterval > 0.0 ? logInterval : 0.5;
+
+    if (seconds >= interval)
+    {
+        logWindow(seconds);
+
+        for (uint32_t i = 0; i < COUNTER_COUNT; i++)
+        {
+            windowHistograms[i].clear();
+        }
+
+        windowFrameTimes.clear();
+        windowStart = now;
+    }
+
+    if (dumpRequested)
+    {
+        dumpRequested = 0;
+
+        // A bad dump path should not take the running application down
+        try
+        {
+            writeJson(dumpPath);
+        }
+        catch (const std::runtime_error& e)
+        {
+            std::cerr << e.what() << std::endl;
+        }
+    }
+}
+
+void RuntimeStats::logWindow(double seconds)
+{
+    double fps = windowFrameTimes.getCount() / seconds;
+    double p50 = windowFrameTimes.getPercentile(50.0) / 1000.0;
+    double p99 = windowFrameTimes.getPercentile(99.0) / 1000.0;
+
+    std::ostringstream overlay;
+    overlay << std::fixed << std::setprecision(1)
+            << fps << " fps | " << p50 << " ms (p99 " << p99 << ") | "
+            << static_cast<uint64_t>(windowHistograms[DRAW_CALLS].getMean() + 0.5) << " draws";
+    overlayText = overlay.str();
+
+    if (logInterval <= 0.0)
+    {
+        return;
+    }
+
+    // Counters are per-frame means over the interval
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(1)
+         << "Stats: " << fps << " fps, frame " << p50 << " ms (p99 " << p99 << ", max " << windowFrameTimes.getMax() / 1000.0 << ")"
+         << ", draws " << windowHistograms[DRAW_CALLS].getMean()
+         << ", descriptor binds " << windowHistograms[DESCRIPTOR_BINDS].getMean()
+         << ", pipeline binds " << windowHistograms[PIPELINE_BINDS].getMean()
+         << ", uploaded " << windowHistograms[BYTES_UPLOADED].getMean() / 1024.0 << " KB"
+         << ", allocations " << windowHistograms[ALLOCATIONS].getMean()
+         << ", swapchain recreations " << totals[SWAPCHAIN_RECREATIONS];
+
+    std::cout << line.str() << std::endl;
+}
+
+std::string RuntimeStats::getOverlayText()
+{
+    return overlayText;
+}
+
+void RuntimeStats::writeJson(const std::string& path)
+{
+    std::ofstream file(path);
+
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Error: Failed to open stats output " + path);
+    }
+
+    file << std::fixed << std::setprecision(3);
+    file << "{\n  \"frames\": " << frameTimes.getCount() << ",\n";
+    file << "  \"frameMs\": ";
+    writeHistogram(file, frameTimes, 0.001);
+    file << ",\n  \"counters\": {\n";
+
+    // Per-frame distribution and running total of every counter
+    for (uint32_t i = 0; i < COUNTER_COUNT; i++)
+    {
+        Counter counter = static_cast<Counter>(i);
+
+        file << "    \"" << getCounterName(counter) << "\": {\"total\":" << totals[i] << ",\"perFrame\":";
+        writeHistogram(file, histograms[i], 1.0);
+        file << "}" << (i + 1 < COUNTER_COUNT ? "," : "") << "\n";
+    }
+
+    file << "  }\n}\n";
+
+    std::cout << "Stats written to " << path << std::endl;
+}
+
+const char* RuntimeStats::getCounterName(Counter counter)
+{
+    switch (counter)
+    {
+    case DRAW_CALLS:            return "drawCalls";
+    case DESCRIPTOR_BINDS:      return "descriptorBinds";
+    case PIPELINE_BINDS:        return "pipelineBinds";
+    case BYTES_UPLOADED:        return "bytesUploaded";
+    case ALLOCATIONS:           return "allocations";
+    case ALLOCATED_BYTES:       return "allocatedBytes";
+    case SWAPCHAIN_RECREATIONS: return "swapchainRecreations";
+    default:                    return "unknown";
+    }
+}
\ No newline at end of file
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Per-frame engine counters rolled up into histograms
+// Counters are relaxed atomics so any thread can bump them; only the main thread ends frames and
+// reads them. Results are reported as a periodic log line, a short summary for the window title
+// and a JSON dump written on request (SIGUSR1) or at exit.
+class RuntimeStats
+{
+public:
+
+    enum Counter
+    {
+        DRAW_CALLS,
+        DESCRIPTOR_BINDS,
+        PIPELINE_BINDS,
+        BYTES_UPLOADED,
+        ALLOCATIONS,
+        ALLOCATED_BYTES,
+        SWAPCHAIN_RECREATIONS,
+        COUNTER_COUNT
+    };
+
+    // Commands recorded into a command buffer, added to the frame each time it is submitted
+    struct CommandCounts
+    {
+        uint32_t drawCalls;
+        uint32_t descriptorBinds;
+        uint32_t pipelineBinds;
+    };
+
+    // Log-linear buckets - 8 linear steps per power of two, so any value is within 12.5% of its bucket
+    class Histogram
+    {
+    public:
+
+        static const uint32_t SUB_BUCKETS = 8;
+        static const uint32_t BUCKET_COUNT = (64 - 2) * SUB_BUCKETS;
+
+        void record(uint64_t value);
+        void clear();
+
+        uint64_t getCount() const;
+        uint64_t getMin() const;
+        uint64_t getMax() const;
+        double getMean() const;
+
+        // Lower bound of the bucket holding the given percentile (0-100)
+        uint64_t getPercentile(double percentile) const;
+
+    private:
+
+        uint32_t buckets[BUCKET_COUNT] = {};
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t min = 0;
+        uint64_t max = 0;
+
+        static uint32_t getBucket(uint64_t value);
+        static uint64_t getBucketValue(uint32_t bucket);
+    };
+
+    // Return singleton instance
+    static RuntimeStats& instance();
+
+    // Ensure singleton is never copied
+    RuntimeStats(RuntimeStats const&)       = delete;
+    void operator=(RuntimeStats const&)     = delete;
+
+    // Log every logInterval seconds (0 disables), dumps go to dumpPath
+    void init(double logInterval, const std::string& dumpPath);
+
+    // Dump on SIGUSR1 - the handler only sets a flag, the dump is written at the end of the next frame
+    void installSignalHandler();
+
+    void add(Counter counter, uint64_t value = 1)
+    {
+        counters[counter].fetch_add(value, std::memory_order_relaxed);
+    }
+
+    void addCommands(const CommandCounts& counts);
+
+    // Close the frame - counters move into the histograms and are reset
+    void endFrame(double frameMs);
+
+    // Short summary of the last interval, for an overlay
+    std::string getOverlayText();
+
+    void writeJson(const std::string& path);
+
+    static const char* getCounterName(Counter counter);
+
+private:
+
+    RuntimeStats() {}
+
+    std::atomic<uint64_t> counters[COUNTER_COUNT];
+
+    // Per-frame values since start, and since the last log line
+    Histogram histograms[COUNTER_COUNT];
+    Histogram windowHistograms[COUNTER_COUNT];
+    uint64_t totals[COUNTER_COUNT] = {};
+
+    // Frame times in microseconds
+    Histogram frameTimes;
+    Histogram windowFrameTimes;
+
+    double logInterval = 0.0;
+    std::string dumpPath;
+
+    std::chrono::steady_clock::time_point windowStart;
+    bool windowStarted = false;
+
+    std::string overlayText;
+
+    void logWindow(double seconds);
+};
\ No newline at end of file
@@ -0,0 +1,620 @@
+#include "ShaderManager.h"
+
+#include "DeviceManager.h"
+#include "Tracer.h"
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+ShaderManager& ShaderManager::instance()
+{
+    static ShaderManager instance;
+
+    return instance;
+}
+
+void ShaderManager::init(const std::string& directory)
+{
+    this->directory = directory;
+
+    const char* compiler = std::getenv("GLSLANG_VALIDATOR");
+    const char* sdk = std::getenv("VULKAN_SDK");
+
+    if (compiler != nullptr)
+    {
+        compilerPath = compiler;
+    }
+    else if (sdk != nullptr)
+    {
+        compilerPath = std::string(sdk) + "/bin/glslangValidator";
+    }
+    else
+    {
+        compilerPath = "glslangValidator";
+    }
+
+    VkPipelineCacheCreateInfo cacheInfo = {};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+    if (vkCreatePipelineCache(DeviceManager::instance().getDevice(), &cacheInfo, nullptr, &pipelineCache) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Error: Failed to create pipeline cache");
+    }
+}
+
+void ShaderManager::addShader(const std::string& source, const std::string& spirvPath, const ShaderDefines& defines)
+{
+    Shader shader;
+    shader.source = source;
+    shader.spirvPath = spirvPath;
+    shader.defines = defines;
+
+    if (defines.empty() && !spirvPath.empty())
+    {
+        shader.code = readFile(directory + "/" + spirvPath);
+    }
+    else
+    {
+        shader.code = getPermutation(source, defines);
+    }
+
+    shaders.push_back(shader);
+    compiledCode.push_back(shader.code);
+}
+
+std::vector<char> ShaderManager::getPermutation(const std::string& source, const ShaderDefines& defines)
+{
+    Shader shader;
+    shader.source = source;
+    shader.defines = defines;
+
+    std::vector<char> code;
+    std::string log;
+
+    if (!loadPermutation(shader, code, log))
+    {
+        throw std::runtime_error("Error: Failed to compile shader permutation " + source + "\n" + log);
+    }
+
+    return code;
+}
+
+const std::vector<char>& ShaderManager::getCode(const std::string& source)
+{
+    for (const Shader& shader : shaders)
+    {
+        if (shader.source == source)
+        {
+            return shader.code;
+        }
+    }
+
+    throw std::runtime_error("Error: Unknown shader " + source);
+}
+
+std::vector<std::vector<char>> ShaderManager::getAllCode()
+{
+    std::vector<std::vector<char>> code;
+
+    for (const Shader& shader : shaders)
+    {
+        code.push_back(shader.code);
+    }
+
+    return code;
+}
+
+VkPipelineCache ShaderManager::getPipelineCache()
+{
+    return pipelineCache;
+}
+
+void ShaderManager::setPipelineBuilder(PipelineBuilder builder)
+{
+    std::lock_guard<std::mutex> lock(buildMutex);
+
+    this->builder = builder;
+    builderGeneration++;
+}
+
+void ShaderManager::startWatching()
+{
+    if (running)
+    {
+        return;
+    }
+
+    running = true;
+    worker = std::thread(&ShaderManager::watch, this);
+
+    std::cout << "Shader hot reload: watching " << directory << " (compiler " << compilerPath << ")" << std::endl;
+}
+
+void ShaderManager::watch()
+{
+    TRACE_THREAD_NAME("Shader reload");
+
+    int watchHandle = -1;
+
+#ifdef __linux__
+    // Editors often save by writing a new file and renaming it over the old one, so watch the directory
+    watchHandle = inotify_init1(IN_NONBLOCK);
+
+    if (watchHandle >= 0 && inotify_add_watch(watchHandle, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0)
+    {
+        close(watchHandle);
+        watchHandle = -1;
+    }
+
+    if (watchHandle < 0)
+    {
+        std::cerr << "Shader hot reload: inotify unavailable, polling modification times" << std::endl;
+    }
+#endif
+
+    while (running)
+    {
+        std::set<std::string> changed = waitForChanges(watchHandle, 100);
+
+        if (!changed.empty())
+        {
+            // Saves arrive as several events, so let them settle into one rebuild
+            std::set<std::string> more;
+
+            do
+            {
+                more = waitForChanges(watchHandle, 50);
+                changed.insert(more.begin(), more.end());
+            }
+            while (!more.empty() && running);
+
+            rebuild(changed);
+        }
+        else if (rebuildRequested.exchange(false))
+        {
+            rebuild(changed);
+        }
+    }
+
+#ifdef __linux__
+    if (watchHandle >= 0)
+    {
+        close(watchHandle);
+    }
+#endif
+}
+
+std::set<std::string> ShaderManager::waitForChanges(int watchHandle, int timeoutMs)
+{
+    std::set<std::string> changed;
+
+#ifdef __linux__
+    if (watchHandle >= 0)
+    {
+        pollfd descriptor = {};
+        descriptor.fd = watchHandle;
+        descriptor.events = POLLIN;
+
+        if (poll(&descriptor, 1, timeoutMs) <= 0)
+        {
+            return changed;
+        }
+
+        alignas(inotify_event) char buffer[4096];
+        ssize_t length;
+
+        while ((length = read(watchHandle, buffer, sizeof(buffer))) > 0)
+        {
+            for (char* event = buffer; event < buffer + length; )
+            {
+                const inotify_event* notification = reinterpret_cast<const inotify_event*>(event);
+
+                if (notification->len > 0)
+                {
+                    for (const Shader& shader : shaders)
+                    {
+                        if (shader.source == notification->name)
+                        {
+                            changed.insert(shader.source);
+                        }
+                    }
+                }
+
+                event += sizeof(inotify_event) + notification->len;
+            }
+        }
+
+        return changed;
+    }
+#endif
+
+    // Fallback - compare modification times
+    std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+
+    for (const Shader& shader : shaders)
+    {
+        struct stat status;
+
+        if (stat((directory + "/" + shader.source).c_str(), &status) != 0)
+        {
+            continue;
+        }
+
+        auto known = modifiedTimes.find(shader.source);
+
+        if (known != modifiedTimes.end() && known->second != status.st_mtime)
+        {
+            changed.insert(shader.source);
+        }
+
+        modifiedTimes[shader.source] = status.st_mtime;
+    }
+
+    return changed;
+}
+
+bool ShaderManager::compile(const Shader& shader, const std::string& spirvPath, std::vector<char>& code, std::string& log)
+{
+    TRACE_ZONE("compileShader");
+
+    std::string output = directory + "/" + spirvPath + ".tmp";
+
+    // Same invocation as shaders/compile.sh, including its resource limits when present
+    std::string command = "cd \"" + directory + "\" && \"" + compilerPath + "\" -V";
+
+    for (const auto& define : shader.defines)
+    {
+        command += " \"-D" + define.first + "=" + define.second + "\"";
+    }
+
+    command += " \"" + shader.source + "\"";
+
+    if (std::ifstream(directory + "/myconfig.conf").good())
+    {
+        command += " myconfig.conf";
+    }
+
+    command += " -o \"" + spirvPath + ".tmp\" 2>&1";
+
+    FILE* pipe = popen(command.c_str(), "r");
+
+    if (pipe == nullptr)
+    {
+        log = "failed to run " + compilerPath;
+        return false;
+    }
+
+    char line[512];
+
+    while (fgets(line, sizeof(line), pipe) != nullptr)
+    {
+        log += line;
+    }
+
+    if (pclose(pipe) != 0)
+    {
+        std::remove(output.c_str());
+        return false;
+    }
+
+    try
+    {
+        code = readFile(output);
+    }
+    catch (const std::runtime_error& e)
+    {
+        log = e.what();
+        return false;
+    }
+
+    // Keep the offline SPIR-V in step, so the next run starts from the edited shader
+    std::rename(output.c_str(), (directory + "/" + spirvPath).c_str());
+
+    return true;
+}
+
+std::string ShaderManager::getCacheKey(const Shader& shader)
+{
+    std::vector<char> text = readFile(directory + "/" + shader.source);
+
+    // FNV-1a over the file name (it selects the stage), the source text and the sorted defines
+    uint64_t hash = 14695981039346656037ull;
+
+    auto add = [&hash](const char* data, size_t size)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= static_cast<unsigned char>(data[i]);
+            hash *= 1099511628211ull;
+        }
+
+        // Separator, so neighbouring fields can't run together
+        hash ^= 0xFF;
+        hash *= 1099511628211ull;
+    };
+
+    add(shader.source.data(), shader.source.size());
+    add(text.data(), text.size());
+
+    for (const auto& define : shader.defines)
+    {
+        add(define.first.data(), define.first.size());
+        add(define.second.data(), define.second.size());
+    }
+
+    std::ostringstream key;
+    key << std::hex << std::setw(16) << std::setfill('0') << hash;
+
+    return key.str();
+}
+
+bool ShaderManager::loadPermutation(const Shader& shader, std::vector<char>& code, std::string& log)
+{
+    std::string key;
+
+    try
+    {
+        key = getCacheKey(shader);
+    }
+    catch (const std::runtime_error& e)
+    {
+        log = e.what();
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(permutationMutex);
+
+        permutationStats.requests++;
+
+        auto cached = permutations.find(key);
+
+        if (cached != permutations.end())
+        {
+            permutationStats.memoryHits++;
+            code = cached->second;
+
+            return true;
+        }
+    }
+
+    std::string spirvPath = "cache/" + key + ".spv";
+
+    // Written by an earlier run, or by another permutation request that raced this one
+    // Only complete files are renamed into the cache, so a file that opens is whole
+    std::ifstream cachedFile(directory + "/" + spirvPath, std::ios::binary);
+
+    if (cachedFile.is_open())
+    {
+        code.assign(std::istreambuf_iterator<char>(cachedFile), std::istreambuf_iterator<char>());
+
+        std::lock_guard<std::mutex> lock(permutationMutex);
+
+        permutationStats.diskHits++;
+        permutations[key] = code;
+
+        return true;
+    }
+
+    mkdir((directory + "/cache").c_str(), 0755);
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    if (!compile(shader, spirvPath, code, log))
+    {
+        return false;
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+    std::lock_guard<std::mutex> lock(permutationMutex);
+
+    permutationStats.compiles++;
+    permutationStats.compileMs += ms;
+    permutations[key] = code;
+
+    return true;
+}
+
+void ShaderManager::rebuild(const std::set<std::string>& changed)
+{
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    for (size_t i = 0; i < shaders.size(); i++)
+    {
+        if (changed.count(shaders[i].source) == 0)
+        {
+            continue;
+        }
+
+        std::vector<char> code;
+        std::string log;
+
+        bool offline = shaders[i].defines.empty() && !shaders[i].spirvPath.empty();
+        bool compiled = offline ? compile(shaders[i], shaders[i].spirvPath, code, log) : loadPermutation(shaders[i], code, log);
+
+        if (!compiled)
+        {
+            // Keep rendering with the last good pipeline
+            std::cerr << "Shader error: " << shaders[i].source << std::endl << log << std::endl;
+            failures++;
+
+            return;
+        }
+
+        compiledCode[i] = code;
+    }
+
+    std::lock_guard<std::mutex> lock(buildMutex);
+
+    if (!builder)
+    {
+        return;
+    }
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+
+    {
+        TRACE_ZONE("buildPipeline");
+
+        try
+        {
+            pipeline = builder(compiledCode);
+        }
+        catch (const std::runtime_error& e)
+        {
+            std::cerr << "Shader reload: " << e.what() << std::endl;
+        }
+    }
+
+    if (pipeline == VK_NULL_HANDLE)
+    {
+        failures++;
+        return;
+    }
+
+    std::lock_guard<std::mutex> resultLock(resultMutex);
+
+    // An unclaimed pipeline from an earlier edit was never used, so it can go straight away
+    if (readyPipeline != VK_NULL_HANDLE)
+    {
+        discardedPipelines.push_back(readyPipeline);
+    }
+
+    readyPipeline = pipeline;
+    readyCode = compiledCode;
+    readyGeneration = builderGeneration;
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+    std::cout << "Shader reload: pipeline rebuilt in " << ms << " ms" << std::endl;
+}
+
+VkPipeline ShaderManager::takePipeline()
+{
+    VkDevice device = DeviceManager::instance().getDevice();
+
+    // Never waits on a build in progress, only on the moment a finished one is published
+    std::lock_guard<std::mutex> lock(resultMutex);
+
+    for (VkPipeline discarded : discardedPipelines)
+    {
+        vkDestroyPipeline(device, discarded, nullptr);
+    }
+
+    discardedPipelines.clear();
+
+    if (readyPipeline == VK_NULL_HANDLE)
+    {
+        return VK_NULL_HANDLE;
+    }
+
+    VkPipeline pipeline = readyPipeline;
+    readyPipeline = VK_NULL_HANDLE;
+
+    // Built against state the builder no longer matches, e.g. the render pass before a resize
+    if (readyGeneration != builderGeneration)
+    {
+        vkDestroyPipeline(device, pipeline, nullptr);
+        rebuildRequested = true;
+
+        return VK_NULL_HANDLE;
+    }
+
+    for (size_t i = 0; i < shaders.size(); i++)
+    {
+        shaders[i].code = readyCode[i];
+    }
+
+    reloads++;
+
+    return pipeline;
+}
+
+ShaderManager::PermutationStats ShaderManager::getPermutationStats()
+{
+    std::lock_guard<std::mutex> lock(permutationMutex);
+
+    return permutationStats;
+}
+
+void ShaderManager::printPermutationStats()
+{
+    PermutationStats stats = getPermutationStats();
+
+    if (stats.requests == 0)
+    {
+        return;
+    }
+
+    double hitRate = 100.0 * (stats.memoryHits + stats.diskHits) / stats.requests;
+
+    std::cout << "Shader permutations: " << stats.requests << " requested, " << stats.memoryHits << " memory hits, "
+              << stats.diskHits << " disk hits (" << hitRate << "% hit rate), " << stats.compiles << " compiled in "
+              << stats.compileMs << " ms" << std::endl;
+}
+
+void ShaderManager::cleanup()
+{
+    if (running)
+    {
+        running = false;
+        worker.join();
+    }
+
+    VkDevice device = DeviceManager::instance().getDevice();
+
+    if (readyPipeline != VK_NULL_HANDLE)
+    {
+        discardedPipelines.push_back(readyPipeline);
+        readyPipeline = VK_NULL_HANDLE;
+    }
+
+    for (VkPipeline discarded : discardedPipelines)
+    {
+        vkDestroyPipeline(device, discarded, nullptr);
+    }
+
+    discardedPipelines.clear();
+
+    if (reloads > 0 || failures > 0)
+    {
+        std::cout << "Shader reloads: " << reloads << " applied, " << failures << " failed" << std::endl;
+        printPermutationStats();
+    }
+
+    vkDestroyPipelineCache(device, pipelineCache, nullptr);
+    pipelineCache = VK_NULL_HANDLE;
+}
+
+std::vector<char> ShaderManager::readFile(const std::string& path)
+{
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Error: Failed to open file " + path);
+    }
+
+    size_t fileSize = static_cast<size_t>(file.tellg());
+    std::vector<char> buffer(fileSize);
+
+    file.seekg(0);
+    file.read(buffer.data(), fileSize);
+
+    return buffer;
+}
\ No newline at end of file
@@ -0,0 +1,158 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+
+#include <GLFW/glfw3.h>
+
+#include <atomic>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Shader sources, their SPIR-V and live reloading
+// SPIR-V compiled offline is loaded at startup. With watching started, edits to the GLSL sources are picked up
+// (inotify on Linux, modification times elsewhere), recompiled with glslangValidator and turned into a new
+// pipeline on a background thread through the shared pipeline cache. The renderer swaps it in at a frame
+// boundary; compile or pipeline errors are reported and the previous pipeline stays in use.
+// Shaders added with preprocessor defines or without an offline SPIR-V file are permutations, compiled on demand
+// and cached in memory and under cache/ keyed by a hash of the source text and defines, so each permutation is
+// only compiled once per edit and can never be older than its source.
+class ShaderManager
+{
+public:
+
+    // SPIR-V of every shader in the order they were added, returns the pipeline built from it
+    // Runs on the reload thread, so it must only use state it captured by value
+    typedef std::function<VkPipeline(const std::vector<std::vector<char>>& code)> PipelineBuilder;
+
+    // Preprocessor defines of a permutation, passed to the compiler as -DNAME=VALUE
+    typedef std::map<std::string, std::string> ShaderDefines;
+
+    struct PermutationStats
+    {
+        uint32_t requests = 0;
+        uint32_t memoryHits = 0;
+        uint32_t diskHits = 0;
+        uint32_t compiles = 0;
+        double compileMs = 0.0;
+    };
+
+private:
+
+    ShaderManager() : rebuildRequested(false), running(false) {}
+
+    struct Shader
+    {
+        std::string source;
+        std::string spirvPath;
+        ShaderDefines defines;
+        std::vector<char> code;
+    };
+
+    std::string directory;
+    std::string compilerPath;
+
+    VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+
+    // Code the current pipeline was built from, main thread only
+    std::vector<Shader> shaders;
+
+    // Latest code that compiled, owned by the reload thread
+    std::vector<std::vector<char>> compiledCode;
+
+    // Source modification times, when inotify is unavailable
+    std::map<std::string, time_t> modifiedTimes;
+
+    // Compiled permutations by cache key, guarded since the reload thread compiles them too
+    std::mutex permutationMutex;
+    std::map<std::string, std::vector<char>> permutations;
+    PermutationStats permutationStats;
+
+    // Held for the whole build so the builder is never swapped mid-build
+    // The generation is only written by the main thread
+    std::mutex buildMutex;
+    PipelineBuilder builder;
+    uint64_t builderGeneration = 0;
+
+    // Finished pipeline, the code it was built from and the builder generation it was built with
+    std::mutex resultMutex;
+    VkPipeline readyPipeline = VK_NULL_HANDLE;
+    std::vector<std::vector<char>> readyCode;
+    uint64_t readyGeneration = 0;
+    std::vector<VkPipeline> discardedPipelines;
+
+    // Set when a finished pipeline was built for an outdated builder
+    std::atomic<bool> rebuildRequested;
+
+    std::thread worker;
+    std::atomic<bool> running;
+
+    uint32_t reloads = 0;
+    uint32_t failures = 0;
+
+    void watch();
+
+    // Block until a watched source changes or the timeout passes, returns the sources that changed
+    std::set<std::string> waitForChanges(int watchHandle, int timeoutMs);
+
+    // Run the compiler on one source, the output replaces the SPIR-V file only on success
+    bool compile(const Shader& shader, const std::string& spirvPath, std::vector<char>& code, std::string& log);
+
+    // Hash of the source text and defines, names the permutation in the cache
+    std::string getCacheKey(const Shader& shader);
+
+    // SPIR-V of a permutation from memory, cache/ or the compiler
+    bool loadPermutation(const Shader& shader, std::vector<char>& code, std::string& log);
+
+    void rebuild(const std::set<std::string>& changed);
+
+public:
+
+    // Return singleton instance
+    static ShaderManager& instance();
+
+    // Ensure singleton is never copied
+    ShaderManager(ShaderManager const&)     = delete;
+    void operator=(ShaderManager const&)    = delete;
+
+    // Sources and SPIR-V paths are relative to directory
+    // The compiler comes from GLSLANG_VALIDATOR, then VULKAN_SDK/bin, then the PATH
+    void init(const std::string& directory);
+
+    // Register a GLSL source and load the SPIR-V compiled from it
+    // Without defines that is the offline SPIR-V file, otherwise or with an empty path the permutation for the defines
+    void addShader(const std::string& source, const std::string& spirvPath, const ShaderDefines& defines = ShaderDefines());
+
+    // SPIR-V of a permutation that isn't part of the reloaded pipeline, e.g. a compute shader
+    // Throws when it doesn't compile
+    std::vector<char> getPermutation(const std::string& source, const ShaderDefines& defines);
+
+    // SPIR-V the current pipeline was built from
+    const std::vector<char>& getCode(const std::string& source);
+    std::vector<std::vector<char>> getAllCode();
+
+    // Shared by every pipeline build, internally synchronised by the driver
+    VkPipelineCache getPipelineCache();
+
+    // Replace the builder whenever the state it captured changes, waits for a build in progress
+    void setPipelineBuilder(PipelineBuilder builder);
+
+    // Start the reload thread
+    void startWatching();
+
+    // At a frame boundary - a pipeline built from edited shaders for the current builder, or VK_NULL_HANDLE
+    VkPipeline takePipeline();
+
+    PermutationStats getPermutationStats();
+    void printPermutationStats();
+
+    // Stop the reload thread and destroy pipelines that were never taken
+    void cleanup();
+
+    static std::vector<char> readFile(const std::string& path);
+};
\ No newline at end of file
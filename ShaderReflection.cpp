@@ -0,0 +1,603 @@
+#include "ShaderReflection.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+    // Opcodes, decorations and enums from the SPIR-V specification, only those reflection reads
+    const uint32_t SpirvMagic = 0x07230203;
+
+    enum Op
+    {
+        OpName              = 5,
+        OpEntryPoint        = 15,
+        OpTypeBool          = 20,
+        OpTypeInt           = 21,
+        OpTypeFloat         = 22,
+        OpTypeVector        = 23,
+        OpTypeMatrix        = 24,
+        OpTypeImage         = 25,
+        OpTypeSampler       = 26,
+        OpTypeSampledImage  = 27,
+        OpTypeArray         = 28,
+        OpTypeRuntimeArray  = 29,
+        OpTypeStruct        = 30,
+        OpTypePointer       = 32,
+        OpConstant          = 43,
+        OpSpecConstantTrue  = 48,
+        OpSpecConstantFalse = 49,
+        OpSpecConstant      = 50,
+        OpVariable          = 59,
+        OpDecorate          = 71,
+        OpMemberDecorate    = 72
+    };
+
+    enum Decoration
+    {
+        DecorationSpecId        = 1,
+        DecorationBlock         = 2,
+        DecorationBufferBlock   = 3,
+        DecorationArrayStride   = 6,
+        DecorationMatrixStride  = 7,
+        DecorationBinding       = 33,
+        DecorationDescriptorSet = 34,
+        DecorationOffset        = 35
+    };
+
+    enum StorageClass
+    {
+        StorageClassUniformConstant = 0,
+        StorageClassUniform         = 2,
+        StorageClassPushConstant    = 9,
+        StorageClassStorageBuffer   = 12
+    };
+
+    const uint32_t DimBuffer = 5;
+
+    struct Id
+    {
+        uint32_t opcode = 0;
+
+        // Operands after the result id
+        std::vector<uint32_t> operands;
+
+        std::string name;
+
+        uint32_t set = 0;
+        uint32_t binding = 0;
+        bool hasBinding = false;
+
+        bool block = false;
+        bool bufferBlock = false;
+
+        uint32_t specId = 0;
+        bool hasSpecId = false;
+
+        uint32_t arrayStride = 0;
+        std::map<uint32_t, uint32_t> memberOffsets;
+        std::map<uint32_t, uint32_t> memberMatrixStrides;
+    };
+
+    VkShaderStageFlags getStage(uint32_t executionModel)
+    {
+        switch (executionModel)
+        {
+            case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+            case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+            case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+            case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+            case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+            case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+            default: return 0;
+        }
+    }
+
+    const char* getTypeName(VkDescriptorType type)
+    {
+        switch (type)
+        {
+            case VK_DESCRIPTOR_TYPE_SAMPLER: return "sampler";
+            case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER: return "combined image sampler";
+            case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE: return "sampled image";
+            case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE: return "storage image";
+            case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER: return "uniform texel buffer";
+            case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER: return "storage texel buffer";
+            case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER: return "uniform buffer";
+            case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER: return "storage buffer";
+            case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC: return "dynamic uniform buffer";
+            case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC: return "dynamic storage buffer";
+            default: return "unknown";
+        }
+    }
+
+    class Parser
+    {
+    public:
+
+        std::vector<Id> ids;
+
+        Id& get(uint32_t id)
+        {
+            if (id >= ids.size())
+            {
+                throw std::runtime_error("Error: SPIR-V id out of range");
+            }
+
+            return ids[id];
+        }
+
+        uint32_t getConstant(uint32_t id)
+        {
+            Id& constant = get(id);
+
+            if (constant.opcode != OpConstant || constant.operands.size() < 2)
+            {
+                throw std::runtime_error("Error: SPIR-V array length is not a constant");
+            }
+
+            return constant.operands[1];
+        }
+
+        // Size of a type as laid out in a block, for push constant ranges
+        uint32_t getSize(uint32_t typeId, uint32_t matrixStride)
+        {
+            Id& type = get(typeId);
+
+            switch (type.opcode)
+            {
+                case OpTypeBool:
+                    return 4;
+
+                case OpTypeInt:
+                case OpTypeFloat:
+                    return type.operands[0] / 8;
+
+                case OpTypeVector:
+                    return getSize(type.operands[0], 0) * type.operands[1];
+
+                case OpTypeMatrix:
+                    return matrixStride > 0 ? matrixStride * type.operands[1] : getSize(type.operands[0], 0) * type.operands[1];
+
+                case OpTypeArray:
+                    return type.arrayStride > 0 ? type.arrayStride * getConstant(type.operands[1]) : getSize(type.operands[0], matrixStride) * getConstant(type.operands[1]);
+
+                case OpTypeStruct:
+                {
+                    uint32_t size = 0;
+
+                    for (uint32_t member = 0; member < type.operands.size(); member++)
+                    {
+                        uint32_t offset = type.memberOffsets.count(member) ? type.memberOffsets[member] : size;
+                        uint32_t stride = type.memberMatrixStrides.count(member) ? type.memberMatrixStrides[member] : 0;
+
+                        size = std::max(size, offset + getSize(type.operands[member], stride));
+                    }
+
+                    return size;
+                }
+
+                default:
+                    throw std::runtime_error("Error: SPIR-V push constant block has an unsupported member type");
+            }
+        }
+    };
+}
+
+ShaderReflection ShaderReflection::reflect(const std::vector<char>& code)
+{
+    if (code.size() < 20 || code.size() % 4 != 0)
+    {
+        throw std::runtime_error("Error: SPIR-V module has an invalid size");
+    }
+
+    std::vector<uint32_t> words(code.size() / 4);
+    std::memcpy(words.data(), code.data(), code.size());
+
+    if (words[0] != SpirvMagic)
+    {
+        throw std::runtime_error("Error: Not a SPIR-V module");
+    }
+
+    Parser parser;
+    parser.ids.resize(words[3]);
+
+    ShaderReflection reflection;
+    std::vector<uint32_t> variables;
+
+    for (size_t i = 5; i < words.size(); )
+    {
+        uint32_t opcode = words[i] & 0xFFFF;
+        uint32_t count = words[i] >> 16;
+
+        if (count == 0 || i + count > words.size())
+        {
+            throw std::runtime_error("Error: SPIR-V module is truncated");
+        }
+
+        const uint32_t* operands = &words[i + 1];
+        uint32_t operandCount = count - 1;
+
+        switch (opcode)
+        {
+            case OpName:
+                parser.get(operands[0]).name = reinterpret_cast<const char*>(&operands[1]);
+                break;
+
+            case OpEntryPoint:
+                reflection.stages |= getStage(operands[0]);
+                break;
+
+            case OpDecorate:
+            {
+                Id& target = parser.get(operands[0]);
+
+                switch (operands[1])
+                {
+                    case DecorationSpecId: target.specId = operands[2]; target.hasSpecId = true; break;
+                    case DecorationBlock: target.block = true; break;
+                    case DecorationBufferBlock: target.bufferBlock = true; break;
+                    case DecorationArrayStride: target.arrayStride = operands[2]; break;
+                    case DecorationBinding: target.binding = operands[2]; target.hasBinding = true; break;
+                    case DecorationDescriptorSet: target.set = operands[2]; break;
+                }
+
+                break;
+            }
+
+            case OpMemberDecorate:
+            {
+                Id& target = parser.get(operands[0]);
+
+                if (operands[2] == DecorationOffset)
+                {
+                    target.memberOffsets[operands[1]] = operands[3];
+                }
+                else if (operands[2] == DecorationMatrixStride)
+                {
+                    target.memberMatrixStrides[operands[1]] = operands[3];
+                }
+
+                break;
+            }
+
+            case OpTypeBool:
+            case OpTypeInt:
+            case OpTypeFloat:
+            case OpTypeVector:
+            case OpTypeMatrix:
+            case OpTypeImage:
+            case OpTypeSampler:
+            case OpTypeSampledImage:
+            case OpTypeArray:
+            case OpTypeRuntimeArray:
+            case OpTypeStruct:
+            case OpTypePointer:
+            {
+                Id& type = parser.get(operands[0]);
+                type.opcode = opcode;
+                type.operands.assign(operands + 1, operands + operandCount);
+                break;
+            }
+
+            case OpConstant:
+            case OpSpecConstantTrue:
+            case OpSpecConstantFalse:
+            case OpSpecConstant:
+            {
+                // Result type first, then the result id
+                Id& constant = parser.get(operands[1]);
+                constant.opcode = opcode;
+                constant.operands.assign(operands, operands + operandCount);
+                constant.operands.erase(constant.operands.begin() + 1);
+                break;
+            }
+
+            case OpVariable:
+            {
+                Id& variable = parser.get(operands[1]);
+                variable.opcode = opcode;
+                variable.operands.assign(operands, operands + operandCount);
+                variable.operands.erase(variable.operands.begin() + 1);
+
+                variables.push_back(operands[1]);
+                break;
+            }
+        }
+
+        i += count;
+    }
+
+    for (size_t id = 0; id < parser.ids.size(); id++)
+    {
+        const Id& constant = parser.ids[id];
+
+        if (constant.hasSpecId && (constant.opcode == OpSpecConstant || constant.opcode == OpSpecConstantTrue || constant.opcode == OpSpecConstantFalse))
+        {
+            SpecializationConstant specialization;
+            specialization.id = constant.specId;
+            specialization.name = constant.name;
+
+            reflection.specializationConstants.push_back(specialization);
+        }
+    }
+
+    for (uint32_t variableId : variables)
+    {
+        Id& variable = parser.get(variableId);
+
+        uint32_t storage = variable.operands[1];
+        Id& pointer = parser.get(variable.operands[0]);
+
+        if (pointer.opcode != OpTypePointer)
+        {
+            continue;
+        }
+
+        uint32_t typeId = pointer.operands[1];
+
+        if (storage == StorageClassPushConstant)
+        {
+            reflection.pushConstantSize = std::max(reflection.pushConstantSize, parser.getSize(typeId, 0));
+            reflection.pushConstantStages = reflection.stages;
+            continue;
+        }
+
+        if (!variable.hasBinding || (storage != StorageClassUniformConstant && storage != StorageClassUniform && storage != StorageClassStorageBuffer))
+        {
+            continue;
+        }
+
+        Binding binding;
+        binding.set = variable.set;
+        binding.binding = variable.binding;
+        binding.count = 1;
+        binding.stages = reflection.stages;
+
+        // Arrays of descriptors, runtime sized ones get a single descriptor
+        while (parser.get(typeId).opcode == OpTypeArray || parser.get(typeId).opcode == OpTypeRuntimeArray)
+        {
+            Id& array = parser.get(typeId);
+
+            if (array.opcode == OpTypeArray)
+            {
+                binding.count *= parser.getConstant(array.operands[1]);
+            }
+
+            typeId = array.operands[0];
+        }
+
+        Id& type = parser.get(typeId);
+
+        if (storage == StorageClassStorageBuffer)
+        {
+            binding.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        }
+        else if (storage == StorageClassUniform)
+        {
+            binding.type = type.bufferBlock ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        }
+        else if (type.opcode == OpTypeSampler)
+        {
+            binding.type = VK_DESCRIPTOR_TYPE_SAMPLER;
+        }
+        else if (type.opcode == OpTypeSampledImage)
+        {
+            Id& image = parser.get(type.operands[0]);
+            binding.type = image.operands[1] == DimBuffer ? VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        }
+        else if (type.opcode == OpTypeImage)
+        {
+            // Sampled is 1 for images read through samplers, 2 for storage images
+            bool storageImage = type.operands[5] == 2;
+
+            if (type.operands[1] == DimBuffer)
+            {
+                binding.type = storageImage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+            }
+            else
+            {
+                binding.type = storageImage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+            }
+        }
+        else
+        {
+            continue;
+        }
+
+        reflection.bindings.push_back(binding);
+    }
+
+    std::sort(reflection.bindings.begin(), reflection.bindings.end(), [](const Binding& a, const Binding& b)
+    {
+        return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+    });
+
+    return reflection;
+}
+
+void ShaderReflection::merge(const ShaderReflection& other)
+{
+    stages |= other.stages;
+
+    for (const Binding& binding : other.bindings)
+    {
+        auto existing = std::find_if(bindings.begin(), bindings.end(), [&binding](const Binding& candidate)
+        {
+            return candidate.set == binding.set && candidate.binding == binding.binding;
+        });
+
+        if (existing == bindings.end())
+        {
+            bindings.push_back(binding);
+            continue;
+        }
+
+        if (existing->type != binding.type || existing->count != binding.count)
+        {
+            std::ostringstream message;
+            message << "Error: Shader stages disagree on set " << binding.set << " binding " << binding.binding;
+
+            throw std::runtime_error(message.str());
+        }
+
+        existing->stages |= binding.stages;
+    }
+
+    std::sort(bindings.begin(), bindings.end(), [](const Binding& a, const Binding& b)
+    {
+        return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+    });
+
+    if (other.pushConstantSize > 0)
+    {
+        pushConstantSize = std::max(pushConstantSize, other.pushConstantSize);
+        pushConstantStages |= other.pushConstantStages;
+    }
+
+    for (const SpecializationConstant& constant : other.specializationConstants)
+    {
+        bool known = false;
+
+        for (const SpecializationConstant& candidate : specializationConstants)
+        {
+            known = known || candidate.id == constant.id;
+        }
+
+        if (!known)
+        {
+            specializationConstants.push_back(constant);
+        }
+    }
+}
+
+void ShaderReflection::setDynamic(uint32_t set, uint32_t binding)
+{
+    for (Binding& candidate : bindings)
+    {
+        if (candidate.set != set || candidate.binding != binding)
+        {
+            continue;
+        }
+
+        if (candidate.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
+        {
+            candidate.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        }
+        else if (candidate.type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+        {
+            candidate.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+        }
+
+        return;
+    }
+
+    throw std::runtime_error("Error: Shaders have no buffer to make dynamic");
+}
+
+uint32_t ShaderReflection::getDescriptorCount(uint32_t set, uint32_t binding) const
+{
+    for (const Binding& candidate : bindings)
+    {
+        if (candidate.set == set && candidate.binding == binding)
+        {
+            return candidate.count;
+        }
+    }
+
+    return 0;
+}
+
+std::vector<VkDescriptorSetLayoutBinding> ShaderReflection::getLayoutBindings(uint32_t set) const
+{
+    std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+
+    for (const Binding& binding : bindings)
+    {
+        if (binding.set != set)
+        {
+            continue;
+        }
+
+        VkDescriptorSetLayoutBinding layoutBinding = {};
+        layoutBinding.binding = binding.binding;
+        layoutBinding.descriptorType = binding.type;
+        layoutBinding.descriptorCount = binding.count;
+        layoutBinding.stageFlags = binding.stages;
+        layoutBinding.pImmutableSamplers = nullptr;
+
+        layoutBindings.push_back(layoutBinding);
+    }
+
+    return layoutBindings;
+}
+
+std::vector<VkPushConstantRange> ShaderReflection::getPushConstantRanges() const
+{
+    std::vector<VkPushConstantRange> ranges;
+
+    if (pushConstantSize > 0)
+    {
+        VkPushConstantRange range = {};
+        range.stageFlags = pushConstantStages;
+        range.offset = 0;
+        range.size = pushConstantSize;
+
+        ranges.push_back(range);
+    }
+
+    return ranges;
+}
+
+bool ShaderReflection::matches(const ShaderReflection& other) const
+{
+    if (bindings.size() != other.bindings.size() || pushConstantSize != other.pushConstantSize || pushConstantStages != other.pushConstantStages)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < bindings.size(); i++)
+    {
+        const Binding& a = bindings[i];
+        const Binding& b = other.bindings[i];
+
+        if (a.set != b.set || a.binding != b.binding || a.type != b.type || a.count != b.count || a.stages != b.stages)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::string ShaderReflection::describe() const
+{
+    std::ostringstream text;
+
+    for (const Binding& binding : bindings)
+    {
+        text << "  set " << binding.set << " binding " << binding.binding << ": " << getTypeName(binding.type);
+
+        if (binding.count > 1)
+        {
+            text << " x" << binding.count;
+        }
+
+        text << std::endl;
+    }
+
+    if (pushConstantSize > 0)
+    {
+        text << "  push constants: " << pushConstantSize << " bytes" << std::endl;
+    }
+
+    for (const SpecializationConstant& constant : specializationConstants)
+    {
+        text << "  specialization constant " << constant.id << ": " << constant.name << std::endl;
+    }
+
+    return text.str();
+}
\ No newline at end of file
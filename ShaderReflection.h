@@ -0,0 +1,65 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Resource interface read straight from SPIR-V, so descriptor set layouts and push constant ranges follow
+// the shaders instead of being written out by hand
+// Only what layouts need is parsed: descriptor bindings, push constant block size and specialization constants.
+class ShaderReflection
+{
+public:
+
+    struct Binding
+    {
+        uint32_t set;
+        uint32_t binding;
+        VkDescriptorType type;
+        uint32_t count;
+        VkShaderStageFlags stages;
+    };
+
+    struct SpecializationConstant
+    {
+        uint32_t id;
+        std::string name;
+    };
+
+    VkShaderStageFlags stages = 0;
+
+    // Sorted by set then binding
+    std::vector<Binding> bindings;
+
+    // Size of the push constant block, 0 without one
+    uint32_t pushConstantSize = 0;
+    VkShaderStageFlags pushConstantStages = 0;
+
+    std::vector<SpecializationConstant> specializationConstants;
+
+    // Throws on anything that is not SPIR-V
+    static ShaderReflection reflect(const std::vector<char>& code);
+
+    // Combine the stages of one pipeline - shared bindings must agree on type and count
+    void merge(const ShaderReflection& other);
+
+    // Uniform buffers SPIR-V cannot tell apart from dynamic ones, so the application marks them
+    void setDynamic(uint32_t set, uint32_t binding);
+
+    // Array size of a binding, 0 when no stage uses it
+    uint32_t getDescriptorCount(uint32_t set, uint32_t binding) const;
+
+    std::vector<VkDescriptorSetLayoutBinding> getLayoutBindings(uint32_t set) const;
+
+    // Empty without a push constant block
+    std::vector<VkPushConstantRange> getPushConstantRanges() const;
+
+    // Same bindings and push constants, i.e. pipelines built from both can share a layout
+    bool matches(const ShaderReflection& other) const;
+
+    std::string describe() const;
+};
\ No newline at end of file
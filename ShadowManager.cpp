@@ -0,0 +1,954 @@
+#include "ShadowManager.h"
+
+#include "DescriptorManager.h"
+#include "ShaderReflection.h"
+#include "Tracer.h"
+#include "UniformManager.h"
+#include "Utils.h"
+#include "Vertex.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <iostream>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+namespace
+{
+    // Blend between logarithmic and uniform cascade splits, logarithmic keeps near texels dense
+    const float SPLIT_LAMBDA = 0.75f;
+
+    // Shadows end at twice the scene radius or this, whichever is further
+    const float MIN_SHADOW_DISTANCE = 20.0f;
+
+    // Cached cascades cover this much more than the view needs, so small camera moves keep the cache
+    const float CACHE_MARGIN = 0.25f;
+
+    // Receivers are pushed along their normal by this many texels before the lookup, against acne on slopes
+    const float NORMAL_OFFSET_TEXELS = 1.5f;
+
+    // Orthographic projection to zero-to-one depth, looking down -z
+    glm::mat4 orthographic(float left, float right, float bottom, float top, float zNear, float zFar)
+    {
+        glm::mat4 result(1.0f);
+        result[0][0] = 2.0f / (right - left);
+        result[1][1] = 2.0f / (top - bottom);
+        result[2][2] = -1.0f / (zFar - zNear);
+        result[3][0] = -(right + left) / (right - left);
+        result[3][1] = -(top + bottom) / (top - bottom);
+        result[3][2] = -zNear / (zFar - zNear);
+
+        return result;
+    }
+}
+
+ShadowManager& ShadowManager::instance()
+{
+    static ShadowManager instance;
+
+    return instance;
+}
+
+ShaderManager::ShaderDefines ShadowManager::getShaderDefines()
+{
+    ShaderManager::ShaderDefines defines;
+    defines["SHADOWS"] = "1";
+
+    return defines;
+}
+
+void ShadowManager::init(uint32_t resolution, bool cacheEnabled, float sceneRadius, const std::vector<char>& vertexCode)
+{
+    this->resolution = resolution;
+    this->cacheEnabled = cacheEnabled;
+    this->sceneRadius = std::max(sceneRadius, 1.0f);
+
+    VkDevice device = DeviceManager::instance().getDevice();
+
+    createImages();
+
+    clearPass = createRenderPass(VK_ATTACHMENT_LOAD_OP_CLEAR, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+    loadPass = createRenderPass(VK_ATTACHMENT_LOAD_OP_LOAD, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+
+    if (cacheEnabled)
+    {
+        staticPass = createRenderPass(VK_ATTACHMENT_LOAD_OP_CLEAR, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+    }
+
+    createFramebuffers();
+
+    // Rewritten by the CPU every frame
+    Utils::createBuffer(sizeof(ShadowUbo), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                        uniformBuffer, uniformMemory);
+
+    void* data;
+    vkMapMemory(device, uniformMemory, 0, sizeof(ShadowUbo), 0, &data);
+    memset(data, 0, sizeof(ShadowUbo));
+    uniformData = static_cast<ShadowUbo*>(data);
+
+    createPipeline(vertexCode);
+
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = DeviceManager::instance().getGraphicsQueue().getFamilyIndex();
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+    if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Error: Failed to create shadow cache command pool");
+    }
+
+    VkCommandBufferAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+
+    if (vkAllocateCommandBuffers(device, &allocInfo, &cacheCommandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Error: Failed to allocate shadow cache command buffer");
+    }
+
+    cacheSlot = GpuProfiler::instance().createSlot();
+
+    for (uint32_t i = 0; i < CASCADES; i++)
+    {
+        cachedCenters[i] = glm::vec3(0.0f);
+        cachedRadii[i] = 0.0f;
+        cacheValid[i] = false;
+    }
+
+    stats = {};
+    stats.resolution = resolution;
+    stats.cached = cacheEnabled;
+
+    // Forces the light space to be built
+    lightDirection = glm::vec3(0.0f);
+    setLightDirection(glm::vec3(-0.4f, -1.0f, -0.3f));
+}
+
+void ShadowManager::createImages()
+{
+    VkPhysicalDevice physicalDevice = DeviceManager::instance().getPhysicalDevice();
+
+    // Depth-only formats, so copies between the cached and sampled layers only have one aspect
+    const VkFormat candidates[] = { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D16_UNORM };
+    const VkFormatFeatureFlags features = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+
+    VkFilter filter = VK_FILTER_NEAREST;
+
+    for (VkFormat candidate : candidates)
+    {
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, candidate, &properties);
+
+        if ((properties.optimalTilingFeatures & features) == features)
+        {
+            depthFormat = candidate;
+
+            // Linear filtering makes each comparison a 2x2 bilinear PCF tap
+            if (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)
+            {
+                filter = VK_FILTER_LINEAR;
+            }
+
+            break;
+        }
+    }
+
+    if (depthFormat == VK_FORMAT_UNDEFINED)
+    {
+        throw std::runtime_error("Error: Failed to find a sampled depth format for shadow maps");
+    }
+
+    createDepthImage(CASCADES, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, shadowImage, shadowMemory);
+
+    shadowArrayView = createView(shadowImage, VK_IMAGE_VIEW_TYPE_2D_ARRAY, 0, CASCADES);
+
+    for (uint32_t i = 0; i < CASCADES; i++)
+    {
+        cascadeViews.push_back(createView(shadowImage, VK_IMAGE_VIEW_TYPE_2D, i, 1));
+    }
+
+    if (cacheEnabled)
+    {
+        uint32_t cachedCascades = CASCADES - FIRST_CACHED_CASCADE;
+
+        createDepthImage(cachedCascades, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, staticImage, staticMemory);
+
+        for (uint32_t i = 0; i < cachedCascades; i++)
+        {
+            staticViews.push_back(createView(staticImage, VK_IMAGE_VIEW_TYPE_2D, i, 1));
+        }
+    }
+
+    // Outside the map is lit
+    VkSamplerCreateInfo samplerInfo = {};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = filter;
+    samplerInfo.minFilter = filter;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+    samplerInfo.anisotropyEnable = VK_FALSE;
+    samplerInfo.maxAnisotropy = 1;
+    samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+    samplerInfo.unnormalizedCoordinates = VK_FALSE;
+    samplerInfo.compareEnable = VK_TRUE;
+    samplerInfo.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.mipLodBias = 0.0f;
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = 0.0f;
+
+    if (vkCreateSampler(DeviceManager::instance().getDevice(), &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Error: Failed to create shadow map sampler");
+    }
+}
+
+void ShadowManager::createDepthImage(uint32_t layers, VkImageUsageFlags usage, VkImage& image, VkDeviceMemory& memory)
+{
+    VkDevice device = DeviceManager::instance().getDevice();
+
+    VkImageCreateInfo imageInfo = {};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent.width = resolution;
+    imageInfo.extent.height = resolution;
+    imageInfo.extent.depth = 1;
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = layers;
+    imageInfo.format = depthFormat;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = usage;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+
+    if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Error: Failed to create shadow map image");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(device, image, &memRequirements);
+
+    memory = Utils::allocateTrackedMemory(memRequirements.size, Utils::findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT), "shadow map");
+
+    vkBindImageMemory(device, image, memory, 0);
+}
+
+VkImageView ShadowManager::createView(VkImage image, VkImageViewType viewType, uint32_t firstLayer, uint32_t layerCount)
+{
+    VkImageViewCreateInfo viewInfo = {};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = image;
+    viewInfo.viewType = viewType;
+    viewInfo.format = depthFormat;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.baseArrayLayer = firstLayer;
+    viewInfo.subresourceRange.layerCount = layerCount;
+
+    VkImageView imageView;
+
+    if (vkCreateImageView(DeviceManager::instance().getDevice(), &viewInfo, nullptr, &imageView) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Error: Failed to create shadow map image view");
+    }
+
+    return imageView;
+}
+
+VkRenderPass ShadowManager::createRenderPass(VkAttachmentLoadOp loadOp, VkImageLayout initialLayout, VkImageLayout finalLayout)
+{
+    VkAttachmentDescription depthAttachment = {};
+    depthAttachment.format = depthFormat;
+    depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    depthAttachment.loadOp = loadOp;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.initialLayout = initialLayout;
+    depthAttachment.finalLayout = finalLayout;
+
+    VkAttachmentReference depthAttachmentRef = {};
+    depthAttachmentRef.attachment = 0;
+    depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkSubpassDescription subpass = {};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 0;
+    subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+    // Previous frame's lookups finish before the map is overwritten, and writes are visible to lookups and copies after
+    std::array<VkSubpassDependency, 2> dependencies = {};
+
+    dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[0].dstSubpass = 0;
+    dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    dependencies[0].srcAccessMask = 0;
+    dependencies[0].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependencies[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    dependencies[1].srcSubpass = 0;
+    dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[1].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+    dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+
+    VkRenderPassCreateInfo renderPassInfo = {};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = 1;
+    renderPassInfo.pAttachments = &depthAttachment;
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+    renderPassInfo.pDependencies = dependencies.data();
+
+    VkRenderPass renderPass;
+
+    if (vkCreateRenderPass(DeviceManager::instance().getDevice(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Error: Failed to create shadow render pass");
+    }
+
+    return renderPass;
+}
+
+void ShadowManager::createFramebuffers()
+{
+    VkFramebufferCreateInfo framebufferInfo = {};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.attachmentCount = 1;
+    framebufferInfo.width = resolution;
+    framebufferInfo.height = resolution;
+    framebufferInfo.layers = 1;
+
+    VkDevice device = DeviceManager::instance().getDevice();
+
+    // The passes only differ in load op and layouts, so they are compatible and share framebuffers
+    for (VkImageView view : cascadeViews)
+    {
+        VkFramebuffer framebuffer;
+
+        framebufferInfo.renderPass = clearPass;
+        framebufferInfo.pAttachments = &view;
+
+        if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Error: Failed to create shadow framebuffer");
+        }
+
+        cascadeFramebuffers.push_back(framebuffer);
+    }
+
+    for (VkImageView view : staticViews)
+    {
+        VkFramebuffer framebuffer;
+
+        framebufferInfo.renderPass = staticPass;
+        framebufferInfo.pAttachments = &view;
+
+        if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Error: Failed to create shadow cache framebuffer");
+        }
+
+        staticFramebuffers.push_back(framebuffer);
+    }
+}
+
+void ShadowManager::createPipeline(const std::vector<char>& vertexCode)
+{
+    VkDevice device = DeviceManager::instance().getDevice();
+
+    ShaderReflection reflection = ShaderReflection::reflect(vertexCode);
+
+    // Model matrices come from the main pass's per-object uniforms at dynamic offsets
+    reflection.setDynamic(0, 0);
+
+    std::vector<VkDescriptorSetLayoutBinding> bindings = reflection.getLayoutBindings(0);
+    std::vector<VkPushConstantRange> pushConstantRanges = reflection.getPushConstantRanges();
+
+    // Layouts are owned and deduplicated by the descriptor manager
+    VkDescriptorSetLayout descriptorSetLayout = DescriptorManager::instance().getLayout(bindings.data(), static_cast<uint32_t>(bindings.size()));
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+    pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Error: Failed to create shadow pipeline layout");
+    }
+
+    VkShaderModuleCreateInfo moduleInfo = {};
+    moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    moduleInfo.codeSize = vertexCode.size();
+    moduleInfo.pCode = reinterpret_cast<const uint32_t*>(vertexCode.data());
+
+    VkShaderModule shaderModule;
+
+    if (vkCreateShaderModule(device, &moduleInfo, nullptr, &shaderModule) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Error: Failed to create shadow shader module");
+    }
+
+    // Depth only, there is no fragment stage
+    VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
+    vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+    vertShaderStageInfo.module = shaderModule;
+    vertShaderStageInfo.pName = "main";
+
+    // Positions only - the stride still steps over the other attributes of the shared vertex buffer
+    VkVertexInputBindingDescription bindingDescription = Vertex::getBindingDescription();
+    VkVertexInputAttributeDescription positionAttribute = Vertex::getAttributeDescriptions()[0];
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputInfo.vertexBindingDescriptionCount = 1;
+    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+    vertexInputInfo.vertexAttributeDescriptionCount = 1;
+    vertexInputInfo.pVertexAttributeDescriptions = &positionAttribute;
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+    VkViewport viewport = {};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(resolution);
+    viewport.height = static_cast<float>(resolution);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+
+    VkRect2D scissor = {};
+    scissor.offset = {0, 0};
+    scissor.extent = {resolution, resolution};
+
+    VkPipelineViewportStateCreateInfo viewportState = {};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.pViewports = &viewport;
+    viewportState.scissorCount = 1;
+    viewportState.pScissors = &scissor;
+
+    // No culling, so open meshes like the ground plane still cast, with slope-scaled bias against acne
+    VkPipelineRasterizationStateCreateInfo rasterizer = {};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.depthClampEnable = VK_FALSE;
+    rasterizer.rasterizerDiscardEnable = VK_FALSE;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = VK_CULL_MODE_NONE;
+    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    rasterizer.depthBiasEnable = VK_TRUE;
+    rasterizer.depthBiasConstantFactor = 1.25f;
+    rasterizer.depthBiasClamp = 0.0f;
+    rasterizer.depthBiasSlopeFactor = 1.75f;
+
+    VkPipelineMultisampleStateCreateInfo multisampling = {};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.sampleShadingEnable = VK_FALSE;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    multisampling.minSampleShading = 1.0f;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending = {};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable = VK_FALSE;
+    colorBlending.attachmentCount = 0;
+
+    VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = VK_TRUE;
+    depthStencil.depthWriteEnable = VK_TRUE;
+    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+    depthStencil.depthBoundsTestEnable = VK_FALSE;
+    depthStencil.stencilTestEnable = VK_FALSE;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = 1;
+    pipelineInfo.pStages = &vertShaderStageInfo;
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = &depthStencil;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.layout = pipelineLayout;
+    pipelineInfo.renderPass = clearPass;
+    pipelineInfo.subpass = 0;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+    pipelineInfo.basePipelineIndex = -1;
+
+    VkResult result = vkCreateGraphicsPipelines(device, ShaderManager::instance().getPipelineCache(), 1, &pipelineInfo, nullptr, &pipeline);
+
+    vkDestroyShaderModule(device, shaderModule, nullptr);
+
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Error: Failed to create shadow pipeline");
+    }
+
+    VkDescriptorBufferInfo dynamicBufferInfo = {};
+    dynamicBufferInfo.buffer = UniformManager::instance().getDynamicUniformBuffer();
+    dynamicBufferInfo.offset = 0;
+    dynamicBufferInfo.range = sizeof(UniformManager::DynamicUbo);
+
+    VkDescriptorBufferInfo shadowBufferInfo = {};
+    shadowBufferInfo.buffer = uniformBuffer;
+    shadowBufferInfo.offset = 0;
+    shadowBufferInfo.range = sizeof(ShadowUbo);
+
+    std::array<VkWriteDescriptorSet, 2> descriptorWrites = {};
+
+    descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[0].dstBinding = 0;
+    descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    descriptorWrites[0].descriptorCount = 1;
+    descriptorWrites[0].pBufferInfo = &dynamicBufferInfo;
+
+    descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[1].dstBinding = 1;
+    descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    descriptorWrites[1].descriptorCount = 1;
+    descriptorWrites[1].pBufferInfo = &shadowBufferInfo;
+
+    descriptorSet = DescriptorManager::instance().getCachedSet(descriptorSetLayout, descriptorWrites.data(), static_cast<uint32_t>(descriptorWrites.size()));
+}
+
+void ShadowManager::setCasters(const std::vector<Caster>& casters)
+{
+    this->casters = casters;
+
+    uint32_t dynamicCasters = 0;
+
+    for (const Caster& caster : casters)
+    {
+        dynamicCasters += caster.dynamic ? 1 : 0;
+    }
+
+    uint32_t casterCount = static_cast<uint32_t>(casters.size());
+
+    stats.uncachedDrawsPerFrame = CASCADES * casterCount;
+    stats.drawsPerFrame = cacheEnabled ? FIRST_CACHED_CASCADE * casterCount + (CASCADES - FIRST_CACHED_CASCADE) * dynamicCasters : stats.uncachedDrawsPerFrame;
+
+    for (uint32_t i = 0; i < CASCADES; i++)
+    {
+        cacheValid[i] = false;
+    }
+}
+
+void ShadowManager::setLightDirection(const glm::vec3& direction)
+{
+    glm::vec3 normalized = glm::normalize(direction);
+
+    if (normalized == lightDirection)
+    {
+        return;
+    }
+
+    lightDirection = normalized;
+
+    // Any up vector not parallel to the light will do, it only has to stay fixed
+    glm::vec3 up = std::abs(lightDirection.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    lightView = glm::lookAt(glm::vec3(0.0f), lightDirection, up);
+
+    for (uint32_t i = 0; i < CASCADES; i++)
+    {
+        cacheValid[i] = false;
+    }
+}
+
+glm::mat4 ShadowManager::getCascadeProjection(const glm::vec3& center, float radius)
+{
+    glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.0f));
+
+    // Move the window in whole texels, so a caster always rasterizes to the same texels
+    float texelSize = 2.0f * radius / resolution;
+
+    lightCenter.x = std::floor(lightCenter.x / texelSize) * texelSize;
+    lightCenter.y = std::floor(lightCenter.y / texelSize) * texelSize;
+
+    // Light space is a rotation about the origin, so casters between the sphere and the light are within sceneRadius
+    float zMax = std::max(lightCenter.z + radius, sceneRadius);
+    float zMin = lightCenter.z - radius;
+
+    return orthographic(lightCenter.x - radius, lightCenter.x + radius, lightCenter.y - radius, lightCenter.y + radius, -zMax, -zMin);
+}
+
+void ShadowManager::update(const glm::mat4& view, const glm::mat4& proj)
+{
+    TRACE_ZONE("updateShadows");
+
+    stats.frames++;
+
+    // Planes of a zero-to-one depth perspective projection
+    float nearPlane = proj[3][2] / proj[2][2];
+    float farPlane = proj[3][2] / (proj[2][2] + 1.0f);
+
+    float shadowDistance = std::min(farPlane, std::max(2.0f * sceneRadius, MIN_SHADOW_DISTANCE));
+    float splitNear = std::min(std::max(nearPlane, 0.1f), shadowDistance);
+
+    // Squared distance of a slice corner from the view axis, per unit of depth
+    float cornerSlope = 1.0f / (proj[0][0] * proj[0][0]) + 1.0f / (proj[1][1] * proj[1][1]);
+
+    glm::mat4 inverseView = glm::inverse(view);
+    glm::vec3 cameraPosition = glm::vec3(inverseView[3]);
+
+    ShadowUbo ubo = {};
+    bool rebuild = false;
+    float sliceNear = nearPlane;
+
+    for (uint32_t i = 0; i < CASCADES; i++)
+    {
+        float fraction = static_cast<float>(i + 1) / CASCADES;
+        float logSplit = splitNear * std::pow(shadowDistance / splitNear, fraction);
+        float uniformSplit = splitNear + (shadowDistance - splitNear) * fraction;
+        float sliceFar = SPLIT_LAMBDA * logSplit + (1.0f - SPLIT_LAMBDA) * uniformSplit;
+
+        glm::vec3 center;
+        float radius;
+
+        if (cacheEnabled && i >= FIRST_CACHED_CASCADE)
+        {
+            // Cached cascades surround the camera so turning doesn't invalidate them, only moving far enough does
+            float reach = sliceFar * std::sqrt(1.0f + cornerSlope);
+
+            if (!cacheValid[i] || reach > cachedRadii[i] || glm::length(cameraPosition - cachedCenters[i]) > cachedRadii[i] - reach)
+            {
+                cachedCenters[i] = cameraPosition;
+                cachedRadii[i] = reach * (1.0f + CACHE_MARGIN);
+                cacheValid[i] = false;
+                rebuild = true;
+            }
+
+            center = cachedCenters[i];
+            radius = cachedRadii[i];
+        }
+        else
+        {
+            // Smallest sphere around the slice, it lies on the view axis and only depends on the projection
+            float depth = std::min(0.5f * (sliceFar + sliceNear) * (1.0f + cornerSlope), sliceFar);
+            radius = std::sqrt((sliceFar - depth) * (sliceFar - depth) + cornerSlope * sliceFar * sliceFar);
+            center = glm::vec3(inverseView * glm::vec4(0.0f, 0.0f, -depth, 1.0f));
+        }
+
+        // Pad by a texel on each side, snapping moves the window by up to one
+        radius *= static_cast<float>(resolution) / (resolution - 2);
+
+        ubo.lightViewProj[i] = getCascadeProjection(center, radius) * lightView;
+        ubo.viewToShadow[i] = ubo.lightViewProj[i] * inverseView;
+        ubo.splits[i] = sliceFar;
+        ubo.texelSizes[i] = 2.0f * radius / resolution;
+
+        sliceNear = sliceFar;
+    }
+
+    ubo.lightDirection = glm::vec4(glm::normalize(-glm::vec3(view * glm::vec4(lightDirection, 0.0f))), 0.0f);
+    ubo.params = glm::vec4(1.0f / resolution, NORMAL_OFFSET_TEXELS, 0.0f, 0.0f);
+
+    memcpy(uniformData, &ubo, sizeof(ubo));
+
+    if (rebuild)
+    {
+        renderStaticCasters();
+    }
+}
+
+void ShadowManager::renderStaticCasters()
+{
+    TRACE_ZONE("renderStaticCasters");
+
+    // Frames are serialized, so the last rebuild has long completed
+    SyncManager::instance().wait(cacheTicket);
+    GpuProfiler::instance().collect(cacheSlot);
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkResetCommandBuffer(cacheCommandBuffer, 0);
+    vkBeginCommandBuffer(cacheCommandBuffer, &beginInfo);
+
+    GpuProfiler::instance().beginRecording(cacheCommandBuffer, cacheSlot);
+
+    {
+        GpuProfiler::Scope scope(cacheCommandBuffer, cacheSlot, "Shadow cache");
+
+        VkClearValue clearValue = {};
+        clearValue.depthStencil = { 1.0f, 0 };
+
+        for (uint32_t i = FIRST_CACHED_CASCADE; i < CASCADES; i++)
+        {
+            if (cacheValid[i])
+            {
+                continue;
+            }
+
+            VkRenderPassBeginInfo renderPassInfo = {};
+            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+            renderPassInfo.renderPass = staticPass;
+            renderPassInfo.framebuffer = staticFramebuffers[i - FIRST_CACHED_CASCADE];
+            renderPassInfo.renderArea.extent = {resolution, resolution};
+            renderPassInfo.clearValueCount = 1;
+            renderPassInfo.pClearValues = &clearValue;
+
+            vkCmdBeginRenderPass(cacheCommandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+            recordCasters(cacheCommandBuffer, i, true, false);
+            vkCmdEndRenderPass(cacheCommandBuffer);
+
+            cacheValid[i] = true;
+        }
+    }
+
+    GpuProfiler::instance().endRecording(cacheSlot);
+
+    if (vkEndCommandBuffer(cacheCommandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Error: Failed to record shadow cache command buffer");
+    }
+
+    // Ahead of this frame's submission on the same queue, whose barriers wait for it
+    Queue& queue = DeviceManager::instance().getGraphicsQueue();
+    queue.submit(cacheCommandBuffer);
+    cacheTicket = queue.flush();
+
+    GpuProfiler::instance().submitted(cacheSlot);
+
+    stats.staticRebuilds++;
+}
+
+void ShadowManager::recordCasters(VkCommandBuffer commandBuffer, uint32_t cascade, bool staticCasters, bool dynamicCasters)
+{
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(uint32_t), &cascade);
+
+    VkBuffer vertexBuffers[] = {GeometryManager::instance().getVertexBuffer()};
+    VkDeviceSize offsets[] = {0};
+
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+
+    // Whole meshes, batched by index width - meshlet culling is against the camera, not the light
+    const VkIndexType indexTypes[] = { VK_INDEX_TYPE_UINT16, VK_INDEX_TYPE_UINT32 };
+
+    for (VkIndexType indexType : indexTypes)
+    {
+        bool indexBufferBound = false;
+
+        for (const Caster& caster : casters)
+        {
+            GeometryManager::MeshRange mesh = GeometryManager::instance().getMeshRange(caster.mesh);
+
+            if (mesh.indexType != indexType || !(caster.dynamic ? dynamicCasters : staticCasters))
+            {
+                continue;
+            }
+
+            if (!indexBufferBound)
+            {
+                vkCmdBindIndexBuffer(commandBuffer, GeometryManager::instance().getIndexBuffer(indexType), 0, indexType);
+                indexBufferBound = true;
+            }
+
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 1, &caster.dynamicOffset);
+            vkCmdDrawIndexed(commandBuffer, mesh.indexCount, 1, mesh.firstIndex, mesh.vertexOffset, 0);
+        }
+    }
+}
+
+void ShadowManager::recordShadowPass(VkCommandBuffer commandBuffer)
+{
+    VkClearValue clearValue = {};
+    clearValue.depthStencil = { 1.0f, 0 };
+
+    VkRenderPassBeginInfo renderPassInfo = {};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderArea.extent = {resolution, resolution};
+
+    for (uint32_t i = 0; i < CASCADES; i++)
+    {
+        renderPassInfo.framebuffer = cascadeFramebuffers[i];
+
+        if (!cacheEnabled || i < FIRST_CACHED_CASCADE)
+        {
+            renderPassInfo.renderPass = clearPass;
+            renderPassInfo.clearValueCount = 1;
+            renderPassInfo.pClearValues = &clearValue;
+
+            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+            recordCasters(commandBuffer, i, true, true);
+            vkCmdEndRenderPass(commandBuffer);
+
+            continue;
+        }
+
+        // Start from the static casters, the last lookups of this layer must be done before it is overwritten
+        std::array<VkImageMemoryBarrier, 2> barriers = {};
+
+        barriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barriers[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[0].image = staticImage;
+        barriers[0].subresourceRange = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, i - FIRST_CACHED_CASCADE, 1 };
+
+        barriers[1].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barriers[1].srcAccessMask = 0;
+        barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barriers[1].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[1].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[1].image = shadowImage;
+        barriers[1].subresourceRange = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, i, 1 };
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+        VkImageCopy region = {};
+        region.srcSubresource = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, i - FIRST_CACHED_CASCADE, 1 };
+        region.dstSubresource = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, i, 1 };
+        region.extent = { resolution, resolution, 1 };
+
+        vkCmdCopyImage(commandBuffer, staticImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, shadowImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+        VkImageMemoryBarrier attachmentBarrier = barriers[1];
+        attachmentBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        attachmentBarrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        attachmentBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        attachmentBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                             0, 0, nullptr, 0, nullptr, 1, &attachmentBarrier);
+
+        // Dynamic casters over the copy
+        renderPassInfo.renderPass = loadPass;
+        renderPassInfo.clearValueCount = 0;
+        renderPassInfo.pClearValues = nullptr;
+
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        recordCasters(commandBuffer, i, false, true);
+        vkCmdEndRenderPass(commandBuffer);
+    }
+}
+
+VkImage ShadowManager::getShadowImage()
+{
+    return shadowImage;
+}
+
+VkImageView ShadowManager::getShadowView()
+{
+    return shadowArrayView;
+}
+
+VkSampler ShadowManager::getSampler()
+{
+    return sampler;
+}
+
+VkBuffer ShadowManager::getUniformBuffer()
+{
+    return uniformBuffer;
+}
+
+VkDeviceSize ShadowManager::getUniformBufferSize()
+{
+    return sizeof(ShadowUbo);
+}
+
+ShadowManager::Stats ShadowManager::getStats()
+{
+    return stats;
+}
+
+void ShadowManager::printStats()
+{
+    std::cout << "Shadows: " << CASCADES << " cascades at " << stats.resolution << "x" << stats.resolution;
+
+    if (stats.cached)
+    {
+        std::cout << ", cascades " << FIRST_CACHED_CASCADE << "-" << CASCADES - 1 << " cached" << std::endl;
+    }
+    else
+    {
+        std::cout << ", no caching" << std::endl;
+    }
+
+    std::cout << "  " << stats.frames << " frames, " << stats.staticRebuilds << " static caster re-renders, "
+              << stats.drawsPerFrame << " draws per frame (" << stats.uncachedDrawsPerFrame << " without caching)" << std::endl;
+}
+
+void ShadowManager::cleanup()
+{
+    VkDevice device = DeviceManager::instance().getDevice();
+
+    // The descriptor set and its layout belong to the descriptor manager
+    vkDestroyPipeline(device, pipeline, nullptr);
+    vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+
+    vkDestroyCommandPool(device, commandPool, nullptr);
+
+    for (VkFramebuffer framebuffer : cascadeFramebuffers)
+    {
+        vkDestroyFramebuffer(device, framebuffer, nullptr);
+    }
+
+    for (VkFramebuffer framebuffer : staticFramebuffers)
+    {
+        vkDestroyFramebuffer(device, framebuffer, nullptr);
+    }
+
+    vkDestroyRenderPass(device, clearPass, nullptr);
+    vkDestroyRenderPass(device, loadPass, nullptr);
+    vkDestroyRenderPass(device, staticPass, nullptr);
+
+    for (VkImageView view : cascadeViews)
+    {
+        vkDestroyImageView(device, view, nullptr);
+    }
+
+    for (VkImageView view : staticViews)
+    {
+        vkDestroyImageView(device, view, nullptr);
+    }
+
+    vkDestroyImageView(device, shadowArrayView, nullptr);
+    vkDestroyImage(device, shadowImage, nullptr);
+    Utils::freeTrackedMemory(shadowMemory);
+
+    vkDestroyImage(device, staticImage, nullptr);
+    Utils::freeTrackedMemory(staticMemory);
+
+    vkDestroySampler(device, sampler, nullptr);
+
+    vkUnmapMemory(device, uniformMemory);
+    vkDestroyBuffer(device, uniformBuffer, nullptr);
+    Utils::freeTrackedMemory(uniformMemory);
+
+    cascadeFramebuffers.clear();
+    staticFramebuffers.clear();
+    cascadeViews.clear();
+    staticViews.clear();
+    uniformData = nullptr;
+}
\ No newline at end of file
@@ -0,0 +1,186 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "GeometryManager.h"
+#include "GpuProfiler.h"
+#include "ShaderManager.h"
+#include "SyncManager.h"
+
+// Cascaded shadow maps for a single directional light
+// Each cascade is an orthographic light projection around a bounding sphere of its slice of the view frustum,
+// snapped to whole texels in a light space fixed to the world so the map doesn't shimmer as the camera moves.
+// Far cascades can be cached: static casters are rendered into a separate image only when the light, the
+// caster set or the cached region changes, and each frame copies that in and draws the dynamic casters on top.
+// Casters are drawn position-only against the shared vertex buffer. Frames don't overlap, so a single set of
+// images and uniforms serves every swapchain image.
+class ShadowManager
+{
+public:
+
+    // Cascade count is fixed by the vec4 of split depths in the shaders
+    static const uint32_t CASCADES = 4;
+
+    // Cascades from this one on are cached when caching is enabled
+    static const uint32_t FIRST_CACHED_CASCADE = 2;
+
+    // An object's draw in the shadow pass, with the dynamic uniform offset of its model matrix
+    struct Caster
+    {
+        MeshHandle mesh;
+        uint32_t dynamicOffset;
+
+        // Moves or animates, so cached cascades draw it every frame
+        bool dynamic;
+    };
+
+    struct Stats
+    {
+        uint32_t resolution;
+        bool cached;
+
+        uint32_t frames;
+        uint32_t staticRebuilds;
+
+        // Draws recorded per frame, and what rendering every caster into every cascade would take
+        uint32_t drawsPerFrame;
+        uint32_t uncachedDrawsPerFrame;
+    };
+
+private:
+
+    ShadowManager() {}
+
+    // Matches ShadowUniformBufferObject in the shaders
+    struct ShadowUbo
+    {
+        // World to cascade clip space, for rendering the maps
+        glm::mat4 lightViewProj[CASCADES];
+        // View to cascade clip space, for sampling them
+        glm::mat4 viewToShadow[CASCADES];
+        // Far depth of each cascade
+        glm::vec4 splits;
+        // World size of a texel in each cascade
+        glm::vec4 texelSizes;
+        // Direction towards the light in view space
+        glm::vec4 lightDirection;
+        // Texel size in UV, normal offset in texels
+        glm::vec4 params;
+    };
+
+    uint32_t resolution = 2048;
+    bool cacheEnabled = true;
+    float sceneRadius = 1.0f;
+
+    // Direction the light travels in, world space
+    glm::vec3 lightDirection = glm::vec3(0.0f, -1.0f, 0.0f);
+
+    // Rotation into light space, fixed to the world so snapping is stable
+    glm::mat4 lightView = glm::mat4(1.0f);
+
+    std::vector<Caster> casters;
+
+    VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+
+    // Sampled cascades, one layer each
+    VkImage shadowImage = VK_NULL_HANDLE;
+    VkDeviceMemory shadowMemory = VK_NULL_HANDLE;
+    VkImageView shadowArrayView = VK_NULL_HANDLE;
+    std::vector<VkImageView> cascadeViews;
+    std::vector<VkFramebuffer> cascadeFramebuffers;
+
+    // Static casters of the cached cascades, copied into the sampled layers every frame
+    VkImage staticImage = VK_NULL_HANDLE;
+    VkDeviceMemory staticMemory = VK_NULL_HANDLE;
+    std::vector<VkImageView> staticViews;
+    std::vector<VkFramebuffer> staticFramebuffers;
+
+    VkSampler sampler = VK_NULL_HANDLE;
+
+    // Clears and leaves a cascade ready to sample, clears a static layer ready to copy, draws over a copied layer
+    VkRenderPass clearPass = VK_NULL_HANDLE;
+    VkRenderPass staticPass = VK_NULL_HANDLE;
+    VkRenderPass loadPass = VK_NULL_HANDLE;
+
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+
+    VkBuffer uniformBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory uniformMemory = VK_NULL_HANDLE;
+    ShadowUbo* uniformData = nullptr;
+
+    // Static casters are re-rendered in their own submission, ahead of the frame that first samples them
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    VkCommandBuffer cacheCommandBuffer = VK_NULL_HANDLE;
+    SyncTicket cacheTicket = 0;
+    ProfilerSlot cacheSlot = 0;
+
+    // Region each cached cascade was last rendered for, and whether it must be rendered again
+    glm::vec3 cachedCenters[CASCADES];
+    float cachedRadii[CASCADES];
+    bool cacheValid[CASCADES];
+
+    Stats stats = {};
+
+    void createImages();
+    void createDepthImage(uint32_t layers, VkImageUsageFlags usage, VkImage& image, VkDeviceMemory& memory);
+    VkImageView createView(VkImage image, VkImageViewType viewType, uint32_t firstLayer, uint32_t layerCount);
+    VkRenderPass createRenderPass(VkAttachmentLoadOp loadOp, VkImageLayout initialLayout, VkImageLayout finalLayout);
+    void createFramebuffers();
+    void createPipeline(const std::vector<char>& vertexCode);
+
+    // Orthographic projection around a light-space sphere, covering every caster between it and the light
+    glm::mat4 getCascadeProjection(const glm::vec3& center, float radius);
+
+    void renderStaticCasters();
+
+    void recordCasters(VkCommandBuffer commandBuffer, uint32_t cascade, bool staticCasters, bool dynamicCasters);
+
+public:
+
+    // Return singleton instance
+    static ShadowManager& instance();
+
+    // Ensure singleton is never copied
+    ShadowManager(ShadowManager const&)     = delete;
+    void operator=(ShadowManager const&)    = delete;
+
+    // Defines of the shading permutation that samples the cascades
+    static ShaderManager::ShaderDefines getShaderDefines();
+
+    // Casters lie within sceneRadius of the origin, vertexCode is shaders/shadow.vert
+    void init(uint32_t resolution, bool cacheEnabled, float sceneRadius, const std::vector<char>& vertexCode);
+
+    // Replaces every caster, cached cascades are re-rendered
+    void setCasters(const std::vector<Caster>& casters);
+
+    // Cached cascades are re-rendered when the direction changes
+    void setLightDirection(const glm::vec3& direction);
+
+    // Fit the cascades to the view, once the previous frame has completed
+    // Re-renders stale cached cascades in a submission of their own
+    void update(const glm::mat4& view, const glm::mat4& proj);
+
+    // Render every cascade, outside a render pass and ahead of the pass sampling them
+    void recordShadowPass(VkCommandBuffer commandBuffer);
+
+    // Every cascade, for the render graph to order sampling after the shadow pass
+    VkImage getShadowImage();
+
+    // Bindings 6 and 7 of the fragment shader
+    VkImageView getShadowView();
+    VkSampler getSampler();
+    VkBuffer getUniformBuffer();
+    VkDeviceSize getUniformBufferSize();
+
+    Stats getStats();
+    void printStats();
+
+    void cleanup();
+};
\ No newline at end of file
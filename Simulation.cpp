@@ -0,0 +1,185 @@
+#include "Simulation.h"
+
+#include "Tracer.h"
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+namespace
+{
+    // Steps further behind the wall clock than this are dropped rather than run back to back
+    const uint64_t MAX_CATCH_UP_STEPS = 5;
+
+    // Blend of two rotation and scale transforms, without a quaternion
+    // Axes are blended separately and made orthonormal again, which stays close to a slerp for the small
+    // rotations of a step
+    glm::mat4 interpolateTransform(const glm::mat4& a, const glm::mat4& b, float alpha)
+    {
+        glm::vec3 scaleA(glm::length(glm::vec3(a[0])), glm::length(glm::vec3(a[1])), glm::length(glm::vec3(a[2])));
+        glm::vec3 scaleB(glm::length(glm::vec3(b[0])), glm::length(glm::vec3(b[1])), glm::length(glm::vec3(b[2])));
+
+        glm::vec3 x = glm::normalize(glm::mix(glm::vec3(a[0]) / scaleA.x, glm::vec3(b[0]) / scaleB.x, alpha));
+        glm::vec3 y = glm::mix(glm::vec3(a[1]) / scaleA.y, glm::vec3(b[1]) / scaleB.y, alpha);
+        glm::vec3 z = glm::normalize(glm::cross(x, y));
+        y = glm::cross(z, x);
+
+        glm::vec3 scale = glm::mix(scaleA, scaleB, alpha);
+
+        glm::mat4 result(1.0f);
+        result[0] = glm::vec4(x * scale.x, 0.0f);
+        result[1] = glm::vec4(y * scale.y, 0.0f);
+        result[2] = glm::vec4(z * scale.z, 0.0f);
+        result[3] = glm::mix(a[3], b[3], alpha);
+
+        return result;
+    }
+}
+
+Simulation::Simulation(double rate, const UpdateFunction& update)
+    : rate(rate), update(update), running(false)
+{
+    timestep = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rate));
+}
+
+Simulation::~Simulation()
+{
+    stop();
+}
+
+void Simulation::start(const glm::mat4& view)
+{
+    setInput(view);
+
+    current.due = Clock::now();
+    current.time = 0.0;
+    step();
+
+    previous = current;
+    publish();
+
+    running = true;
+    worker = std::thread(&Simulation::run, this);
+}
+
+void Simulation::stop()
+{
+    running = false;
+
+    if (worker.joinable())
+    {
+        worker.join();
+    }
+}
+
+double Simulation::getRate() const
+{
+    return rate;
+}
+
+void Simulation::setInput(const glm::mat4& view)
+{
+    Input& input = inputs.getWriteBuffer();
+    input.sampled = Clock::now();
+    input.view = view;
+
+    inputs.publish();
+}
+
+void Simulation::interpolate(State& frame)
+{
+    TRACE_ZONE("interpolateSnapshot");
+
+    frames++;
+
+    if (!snapshots.update())
+    {
+        repeatedFrames++;
+    }
+
+    const Snapshot& snapshot = snapshots.getReadBuffer();
+    const State& from = snapshot.previous;
+    const State& to = snapshot.current;
+
+    // Drawn a step behind, reaching the current state as the step after it falls due
+    double elapsed = std::chrono::duration<double>(Clock::now() - to.due).count();
+    float alpha = static_cast<float>(std::min(std::max(elapsed * rate, 0.0), 1.0));
+
+    frame.time = from.time + (to.time - from.time) * alpha;
+    frame.due = to.due;
+
+    // The oldest input that reached the frame
+    frame.input = from.input;
+
+    // Views are inverted rigid transforms, blend the camera itself so it moves in a straight line
+    frame.view = glm::inverse(interpolateTransform(glm::inverse(from.view), glm::inverse(to.view), alpha));
+
+    frame.models.resize(to.models.size());
+
+    for (size_t i = 0; i < to.models.size(); i++)
+    {
+        frame.models[i] = interpolateTransform(from.models[i], to.models[i], alpha);
+    }
+}
+
+void Simulation::printStats() const
+{
+    std::cout << std::fixed << std::setprecision(1)
+              << "Simulation: " << steps << " steps at " << rate << " Hz, " << skippedSteps << " dropped behind, "
+              << repeatedFrames << " of " << frames << " frames without a new snapshot"
+              << std::defaultfloat << std::setprecision(6) << std::endl;
+}
+
+void Simulation::run()
+{
+    TRACE_THREAD_NAME("Simulation");
+
+    while (running)
+    {
+        Clock::time_point due = current.due + timestep;
+        Clock::time_point now = Clock::now();
+
+        if (now < due)
+        {
+            std::this_thread::sleep_until(due);
+        }
+        else if (now - due > timestep * MAX_CATCH_UP_STEPS)
+        {
+            // Too far behind to catch up, the simulation slows down instead
+            skippedSteps += (now - due) / timestep;
+            due = now;
+        }
+
+        std::swap(previous, current);
+
+        current.due = due;
+        current.time = previous.time + 1.0 / rate;
+        step();
+
+        publish();
+    }
+}
+
+void Simulation::step()
+{
+    TRACE_ZONE("simulationStep");
+
+    inputs.update();
+
+    const Input& input = inputs.getReadBuffer();
+    current.input = input.sampled;
+    current.view = input.view;
+
+    update(current.time, current);
+
+    steps++;
+}
+
+void Simulation::publish()
+{
+    Snapshot& snapshot = snapshots.getWriteBuffer();
+    snapshot.previous = previous;
+    snapshot.current = current;
+
+    snapshots.publish();
+}
\ No newline at end of file
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "TripleBuffer.h"
+
+// Fixed-timestep simulation on its own thread
+// Each step produces an immutable state of the scene - object transforms and the camera - and publishes it with
+// the step before through a triple buffer, so the renderer draws the latest pair interpolated to the present while
+// the simulation keeps stepping at its own rate. Input is still sampled on the main thread and passed in the other
+// direction the same way. Rendering shows the simulation one step behind in exchange for never stalling it.
+class Simulation
+{
+public:
+
+    typedef std::chrono::steady_clock Clock;
+
+    struct State
+    {
+        // Simulated seconds since the start
+        double time;
+
+        // Wall clock time the step was scheduled for
+        Clock::time_point due;
+
+        // When the input the step used was sampled
+        Clock::time_point input;
+
+        glm::mat4 view;
+        std::vector<glm::mat4> models;
+    };
+
+    // Called on the simulation thread with the latest input's view already in the state
+    // It must only read data that stays unchanged while the simulation runs
+    typedef std::function<void(double time, State& state)> UpdateFunction;
+
+    Simulation(double rate, const UpdateFunction& update);
+    ~Simulation();
+
+    Simulation(Simulation const&)       = delete;
+    void operator=(Simulation const&)   = delete;
+
+    // The first state is stepped before this returns, so a frame can always be drawn
+    void start(const glm::mat4& view);
+    void stop();
+
+    double getRate() const;
+
+    // Main thread only
+    void setInput(const glm::mat4& view);
+
+    // Main thread only, the latest two states interpolated to the present
+    void interpolate(State& frame);
+
+    void printStats() const;
+
+private:
+
+    struct Input
+    {
+        Clock::time_point sampled;
+        glm::mat4 view;
+    };
+
+    // A step and the one before, the renderer blends between them
+    struct Snapshot
+    {
+        State previous;
+        State current;
+    };
+
+    double rate;
+    Clock::duration timestep;
+
+    UpdateFunction update;
+
+    TripleBuffer<Input> inputs;
+    TripleBuffer<Snapshot> snapshots;
+
+    std::thread worker;
+    std::atomic<bool> running;
+
+    // Simulation thread only until it is joined
+    State previous;
+    State current;
+    uint64_t steps = 0;
+    uint64_t skippedSteps = 0;
+
+    // Main thread only
+    uint64_t frames = 0;
+    uint64_t repeatedFrames = 0;
+
+    void run();
+    void step();
+    void publish();
+};
\ No newline at end of file
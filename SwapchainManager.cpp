@@ -1,7 +1,10 @@
 #include "SwapchainManager.h"
 
+#include "DeletionQueue.h"
+
 #include <limits>
-#include <array>
+#include <algorithm>
+#include <stdexcept>
 
 VkSurfaceFormatKHR SwapchainManager::chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats)
 {
@@ -21,10 +24,16 @@ VkSurfaceFormatKHR SwapchainManager::chooseSwapSurfaceFormat(const std::vector<V
     return availableFormats[0];
 }
 
-VkPresentModeKHR SwapchainManager::chooseSwapPresentMode(const std::vector<VkPresentModeKHR> availablePresentModes)
+VkPresentModeKHR SwapchainManager::chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes)
 {
+    // FIFO is the only mode every surface supports
     VkPresentModeKHR bestMode = VK_PRESENT_MODE_FIFO_KHR;
 
+    if (presentPolicy != PRESENT_THROUGHPUT)
+    {
+        return bestMode;
+    }
+
     for (const auto& availablePresentMode : availablePresentModes)
     {
         if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR)
@@ -40,6 +49,28 @@ VkPresentModeKHR SwapchainManager::chooseSwapPresentMode(const std::vector<VkPre
     return bestMode;
 }
 
+uint32_t SwapchainManager::chooseImageCount(const VkSurfaceCapabilitiesKHR& capabilities)
+{
+    uint32_t imageCount = requestedImageCount;
+
+    if (imageCount == 0)
+    {
+        // Every queued image is a frame of latency, so low latency keeps to the minimum. Others take one more
+        // (triple buffering with the usual minimum of two) so rendering needn't wait for the display to release one
+        imageCount = presentPolicy == PRESENT_LOW_LATENCY ? capabilities.minImageCount : capabilities.minImageCount + 1;
+    }
+
+    imageCount = std::max(imageCount, capabilities.minImageCount);
+
+    // No maximum is given as 0
+    if (capabilities.maxImageCount > 0)
+    {
+        imageCount = std::min(imageCount, capabilities.maxImageCount);
+    }
+
+    return imageCount;
+}
+
 VkExtent2D SwapchainManager::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities, GLFWwindow* window)
 {
     if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max())
@@ -90,6 +121,47 @@ SwapchainManager& SwapchainManager::instance()
     return instance;
 }
 
+void SwapchainManager::setPresentPolicy(PresentPolicy policy, uint32_t imageCount)
+{
+    presentPolicy = policy;
+    requestedImageCount = imageCount;
+}
+
+SwapchainManager::PresentPolicy SwapchainManager::getPresentPolicy()
+{
+    return presentPolicy;
+}
+
+SwapchainManager::PresentPolicy SwapchainManager::parsePresentPolicy(const std::string& name)
+{
+    if (name == "low-latency")
+    {
+        return PRESENT_LOW_LATENCY;
+    }
+    else if (name == "throughput")
+    {
+        return PRESENT_THROUGHPUT;
+    }
+    else if (name == "vsync")
+    {
+        return PRESENT_VSYNC;
+    }
+
+    throw std::runtime_error("Error: Unknown present mode " + name + ", expected low-latency, throughput or vsync");
+}
+
+const char* SwapchainManager::getPresentModeName(VkPresentModeKHR presentMode)
+{
+    switch (presentMode)
+    {
+    case VK_PRESENT_MODE_IMMEDIATE_KHR:    return "IMMEDIATE";
+    case VK_PRESENT_MODE_MAILBOX_KHR:      return "MAILBOX";
+    case VK_PRESENT_MODE_FIFO_KHR:         return "FIFO";
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "FIFO_RELAXED";
+    default:                               return "other";
+    }
+}
+
 VkSwapchainKHR SwapchainManager::getSwapchain()
 {
     return swapchain;
@@ -105,11 +177,21 @@ VkExtent2D SwapchainManager::getExtent()
     return swapchainExtent;
 }
 
+VkPresentModeKHR SwapchainManager::getPresentMode()
+{
+    return swapchainPresentMode;
+}
+
 std::vector<VkFramebuffer> SwapchainManager::getFramebuffers()
 {
     return swapchainFramebuffers;
 }
 
+std::vector<VkImage> SwapchainManager::getImages()
+{
+    return swapchainImages;
+}
+
 std::vector<VkImageView> SwapchainManager::getImageViews()
 {
     return swapchainImageViews;
@@ -132,12 +214,8 @@ void SwapchainManager::createSwapchain(VkSurfaceKHR surface, GLFWwindow* window)
     VkPresentModeKHR presentMode = chooseSwapPresentMode(swapchainSupport.presentModes);
     VkExtent2D extent = chooseSwapExtent(swapchainSupport.capabilities, window);
 
-    // Set swap chain queue length (minimum +1 for triple buffering) and correct if not supported
-    uint32_t imageCount = swapchainSupport.capabilities.minImageCount + 1;
-    if (swapchainSupport.capabilities.maxImageCount > 0 && imageCount > swapchainSupport.capabilities.maxImageCount)
-    {
-        imageCount = swapchainSupport.capabilities.maxImageCount;
-    }
+    // Swap chain queue length, the implementation may still create more
+    uint32_t imageCount = chooseImageCount(swapchainSupport.capabilities);
 
     // Swap chain creation info struct
     VkSwapchainCreateInfoKHR createInfo = {};
@@ -148,7 +226,8 @@ void SwapchainManager::createSwapchain(VkSurfaceKHR surface, GLFWwindow* window)
     createInfo.imageColorSpace = surfaceFormat.colorSpace;
     createInfo.imageExtent = extent;
     createInfo.imageArrayLayers = 1;
-    createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    // Upscaled frames are blitted in where the surface allows it
+    createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | (swapchainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT);
 
     // Use device queue family indices for swap chain creation
     QueueFamilyIndices indices = QueueFamilyIndices::findQueueFamilies(physicalDevice, surface);
@@ -172,7 +251,9 @@ void SwapchainManager::createSwapchain(VkSurfaceKHR surface, GLFWwindow* window)
     createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     createInfo.presentMode = presentMode;
     createInfo.clipped = VK_TRUE;
-    createInfo.oldSwapchain = VK_NULL_HANDLE;
+
+    // Hand over from the previous swapchain on resize, it is retired but only destroyed once no longer in use
+    createInfo.oldSwapchain = swapchain;
 
     // Create swap chain
     if (vkCreateSwapchainKHR(logicalDevice, &createInfo, nullptr, &swapchain) != VK_SUCCESS)
@@ -185,9 +266,10 @@ void SwapchainManager::createSwapchain(VkSurfaceKHR surface, GLFWwindow* window)
     swapchainImages.resize(imageCount);
     vkGetSwapchainImagesKHR(logicalDevice, swapchain, &imageCount, swapchainImages.data());
 
-    // Store image format and extent
+    // Store image format, extent and present mode
     swapchainImageFormat = surfaceFormat.format;
     swapchainExtent = extent;
+    swapchainPresentMode = presentMode;
 }
 
 void SwapchainManager::createImageViews()
@@ -202,13 +284,18 @@ void SwapchainManager::createImageViews()
     }
 }
 
-void SwapchainManager::createFramebuffers(VkImageView depthImageView, VkRenderPass renderPass)
+void SwapchainManager::createFramebuffers(VkImageView depthImageView, VkImageView multisampleImageView, VkRenderPass renderPass)
 {
     swapchainFramebuffers.resize(swapchainImageViews.size());
 
     for (size_t i=0; i<swapchainImageViews.size(); i++)
     {
-        std::array<VkImageView, 2> attachments = { swapchainImageViews[i], depthImageView };
+        std::vector<VkImageView> attachments = { swapchainImageViews[i], depthImageView };
+
+        if (multisampleImageView != VK_NULL_HANDLE)
+        {
+            attachments.push_back(multisampleImageView);
+        }
 
         VkFramebufferCreateInfo framebufferInfo = {};
         framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
@@ -224,4 +311,14 @@ void SwapchainManager::createFramebuffers(VkImageView depthImageView, VkRenderPa
             throw std::runtime_error("Error: Failed to create framebuffer");
         }
     }
+}
+
+void SwapchainManager::destroyFramebuffers(SyncTicket lastUse)
+{
+    for (VkFramebuffer framebuffer : swapchainFramebuffers)
+    {
+        DeletionQueue::instance().destroyFramebuffer(lastUse, framebuffer);
+    }
+
+    swapchainFramebuffers.clear();
 }
\ No newline at end of file
@@ -4,28 +4,50 @@
 
 #include <GLFW/glfw3.h>
 
+#include <string>
 #include <vector>
 
 #include "DeviceManager.h"
+#include "SyncManager.h"
 #include "SwapchainSupportDetails.h"
 
 class SwapchainManager
 {
+public:
+
+    // How rendered frames queue up for the display
+    enum PresentPolicy
+    {
+        // FIFO with the fewest images, acquires are waited out before input is sampled
+        PRESENT_LOW_LATENCY,
+        // Never waits for vblank - MAILBOX, else IMMEDIATE, else FIFO
+        PRESENT_THROUGHPUT,
+        // FIFO with an image over the minimum
+        PRESENT_VSYNC
+    };
+
 private:
 
     SwapchainManager() {}
 
+    PresentPolicy presentPolicy = PRESENT_THROUGHPUT;
+
+    // 0 leaves the image count to the policy
+    uint32_t requestedImageCount = 0;
+
     // Vulkan swapchain members
-    VkSwapchainKHR swapchain;
+    VkSwapchainKHR swapchain = VK_NULL_HANDLE;
     VkFormat swapchainImageFormat;
     VkExtent2D swapchainExtent;
+    VkPresentModeKHR swapchainPresentMode;
 
     std::vector<VkImage> swapchainImages;
     std::vector<VkFramebuffer> swapchainFramebuffers;
     std::vector<VkImageView> swapchainImageViews;
 
     VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
-    VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR> availablePresentModes);
+    VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
+    uint32_t chooseImageCount(const VkSurfaceCapabilitiesKHR& capabilities);
     VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities, GLFWwindow* window);
     VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags);
 
@@ -38,18 +60,33 @@ public:
     SwapchainManager(SwapchainManager const&)   = delete;
     void operator=(SwapchainManager const&)     = delete;
 
+    // Must precede createSwapchain, an image count of 0 picks the policy's default
+    // Counts outside what the surface supports are clamped
+    void setPresentPolicy(PresentPolicy policy, uint32_t imageCount);
+    PresentPolicy getPresentPolicy();
+
+    // "low-latency", "throughput" or "vsync"
+    static PresentPolicy parsePresentPolicy(const std::string& name);
+    static const char* getPresentModeName(VkPresentModeKHR presentMode);
+
     // Expose class members
     VkSwapchainKHR getSwapchain();
     VkFormat getImageFormat();
     VkExtent2D getExtent();
+    VkPresentModeKHR getPresentMode();
 
-    // Return member framebuffer & image view vectors
+    // Return member framebuffer, image & image view vectors
     std::vector<VkFramebuffer> getFramebuffers();
+    std::vector<VkImage> getImages();
     std::vector<VkImageView> getImageViews();
 
     int getFramebufferSize();
 
     void createSwapchain(VkSurfaceKHR surface, GLFWwindow* window);
     void createImageViews();
-    void createFramebuffers(VkImageView depthImage, VkRenderPass renderPass);
+    // The multisampled colour view is VK_NULL_HANDLE when not multisampling
+    void createFramebuffers(VkImageView depthImage, VkImageView multisampleImage, VkRenderPass renderPass);
+
+    // Released once the submission with lastUse completes
+    void destroyFramebuffers(SyncTicket lastUse);
 };
\ No newline at end of file
@@ -0,0 +1,253 @@
+#include "SwapchainTarget.h"
+
+#include "DeletionQueue.h"
+
+#include <limits>
+
+SwapchainTarget::SwapchainTarget(uint32_t width, uint32_t height)
+    : width(width), height(height)
+{
+}
+
+void SwapchainTarget::init()
+{
+    // Initialise glfw
+    glfwInit();
+
+    // Set window properties
+    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
+
+    // Create GLFWwindow
+    window = glfwCreateWindow(width, height, "Vulkan", nullptr, nullptr);
+}
+
+void SwapchainTarget::cleanup()
+{
+    // Destroy GLFWwindow & terminate GLFW
+    glfwDestroyWindow(window);
+    glfwTerminate();
+}
+
+std::vector<const char*> SwapchainTarget::getRequiredInstanceExtensions()
+{
+    // Get required GLFW extensions
+    uint32_t glfwExtensionCount = 0;
+    const char** glfwExtensions;
+    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+
+    return std::vector<const char*>(glfwExtensions, glfwExtensions + glfwExtensionCount);
+}
+
+void SwapchainTarget::createSurface(VkInstance instance)
+{
+    if (glfwCreateWindowSurface(instance, window, nullptr, &surface) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Error: Failed to create window surface");
+    }
+}
+
+void SwapchainTarget::destroySurface(VkInstance instance)
+{
+    vkDestroySurfaceKHR(instance, surface, nullptr);
+}
+
+VkSurfaceKHR SwapchainTarget::getSurface()
+{
+    return surface;
+}
+
+GLFWwindow* SwapchainTarget::getWindow()
+{
+    return window;
+}
+
+void SwapchainTarget::pollEvents()
+{
+    glfwPollEvents();
+}
+
+bool SwapchainTarget::shouldClose()
+{
+    return glfwWindowShouldClose(window);
+}
+
+void SwapchainTarget::setQueues(VkQueue graphicsQueue, VkQueue presentQueue)
+{
+    this->presentQueue = presentQueue;
+
+#ifdef VK_GOOGLE_display_timing
+    if (DeviceManager::instance().hasDisplayTiming())
+    {
+        getPastPresentationTiming = reinterpret_cast<PFN_vkGetPastPresentationTimingGOOGLE>(
+            vkGetDeviceProcAddr(DeviceManager::instance().getDevice(), "vkGetPastPresentationTimingGOOGLE"));
+    }
+#endif
+}
+
+void SwapchainTarget::createImages()
+{
+    SwapchainManager::instance().createSwapchain(surface, window);
+    SwapchainManager::instance().createImageViews();
+}
+
+void SwapchainTarget::createFramebuffers(VkImageView depthImageView, VkImageView multisampleImageView, VkRenderPass renderPass)
+{
+    SwapchainManager::instance().createFramebuffers(depthImageView, multisampleImageView, renderPass);
+}
+
+void SwapchainTarget::destroyFramebuffers()
+{
+    // Frames already submitted may still render to these, so they go once those frames complete
+    SwapchainManager::instance().destroyFramebuffers(SyncManager::instance().getLastTicket());
+}
+
+void SwapchainTarget::destroyImages()
+{
+    // Frames already submitted may still render to these, so they go once those frames complete
+    SyncTicket lastUse = SyncManager::instance().getLastTicket();
+
+    destroyFramebuffers();
+
+    // Destroy swapchain image views
+    for (auto imageView : SwapchainManager::instance().getImageViews())
+    {
+        DeletionQueue::instance().destroyImageView(lastUse, imageView);
+    }
+
+    // Presentation is not tracked by tickets, so keep the retired swapchain until the next frame completes
+    DeletionQueue::instance().destroySwapchain(lastUse + 1, SwapchainManager::instance().getSwapchain());
+}
+
+VkFormat SwapchainTarget::getImageFormat()
+{
+    return SwapchainManager::instance().getImageFormat();
+}
+
+VkExtent2D SwapchainTarget::getExtent()
+{
+    return SwapchainManager::instance().getExtent();
+}
+
+uint32_t SwapchainTarget::getImageCount()
+{
+    return static_cast<uint32_t>(SwapchainManager::instance().getImageViews().size());
+}
+
+VkFramebuffer SwapchainTarget::getFramebuffer(uint32_t imageIndex)
+{
+    return SwapchainManager::instance().getFramebuffers()[imageIndex];
+}
+
+VkImage SwapchainTarget::getImage(uint32_t imageIndex)
+{
+    return SwapchainManager::instance().getImages()[imageIndex];
+}
+
+VkImageLayout SwapchainTarget::getFinalLayout()
+{
+    return VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+}
+
+VkResult SwapchainTarget::acquireNextImage(VkSemaphore imageAvailable, uint32_t& imageIndex)
+{
+    VkDevice device = DeviceManager::instance().getDevice();
+
+    if (SwapchainManager::instance().getPresentPolicy() != SwapchainManager::PRESENT_LOW_LATENCY)
+    {
+        return vkAcquireNextImageKHR(device, SwapchainManager::instance().getSwapchain(),
+                                     std::numeric_limits<uint64_t>::max(), imageAvailable, VK_NULL_HANDLE, &imageIndex);
+    }
+
+    // The index can come back before the display releases the image. Waiting for the release paces the frame
+    // to the display, so input sampled after this is as fresh as it can be when the frame is shown
+    VkFence fence = SyncManager::instance().acquireFence();
+
+    VkResult result = vkAcquireNextImageKHR(device, SwapchainManager::instance().getSwapchain(),
+                                            std::numeric_limits<uint64_t>::max(), imageAvailable, fence, &imageIndex);
+
+    if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR)
+    {
+        vkWaitForFences(device, 1, &fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+    }
+
+    SyncManager::instance().releaseFence(fence);
+
+    return result;
+}
+
+VkResult SwapchainTarget::present(VkSemaphore renderFinished, uint32_t imageIndex, uint32_t presentId)
+{
+    VkSwapchainKHR swapChains[] = { SwapchainManager::instance().getSwapchain() };
+
+    VkPresentInfoKHR presentInfo = {};
+    presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+    presentInfo.waitSemaphoreCount = 1;
+    presentInfo.pWaitSemaphores = &renderFinished;
+    presentInfo.swapchainCount = 1;
+    presentInfo.pSwapchains = swapChains;
+    presentInfo.pImageIndices = &imageIndex;
+    presentInfo.pResults = nullptr;
+
+#ifdef VK_GOOGLE_display_timing
+    // Tag the present so its display time can be matched up later, as soon as possible
+    VkPresentTimeGOOGLE presentTime = {};
+    presentTime.presentID = presentId;
+    presentTime.desiredPresentTime = 0;
+
+    VkPresentTimesInfoGOOGLE presentTimesInfo = {};
+    presentTimesInfo.sType = VK_STRUCTURE_TYPE_PRESENT_TIMES_INFO_GOOGLE;
+    presentTimesInfo.swapchainCount = 1;
+    presentTimesInfo.pTimes = &presentTime;
+
+    if (getPastPresentationTiming != nullptr)
+    {
+        presentInfo.pNext = &presentTimesInfo;
+    }
+#endif
+
+    return vkQueuePresentKHR(presentQueue, &presentInfo);
+}
+
+void SwapchainTarget::getPresentTimes(std::vector<PresentTime>& times)
+{
+    times.clear();
+
+#ifdef VK_GOOGLE_display_timing
+    if (getPastPresentationTiming == nullptr)
+    {
+        return;
+    }
+
+    VkDevice device = DeviceManager::instance().getDevice();
+    VkSwapchainKHR swapchain = SwapchainManager::instance().getSwapchain();
+
+    uint32_t count = 0;
+    getPastPresentationTiming(device, swapchain, &count, nullptr);
+
+    if (count == 0)
+    {
+        return;
+    }
+
+    std::vector<VkPastPresentationTimingGOOGLE> timings(count);
+
+    // Incomplete results leave the rest for the next call
+    VkResult result = getPastPresentationTiming(device, swapchain, &count, timings.data());
+
+    if (result != VK_SUCCESS && result != VK_INCOMPLETE)
+    {
+        return;
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        // CLOCK_MONOTONIC on Linux, the same clock as std::chrono::steady_clock
+        PresentTime time = {};
+        time.presentId = timings[i].presentID;
+        time.displayedNs = timings[i].actualPresentTime;
+
+        times.push_back(time);
+    }
+#endif
+}
\ No newline at end of file
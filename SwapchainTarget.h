@@ -0,0 +1,64 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+
+#include <GLFW/glfw3.h>
+
+#include "PresentationTarget.h"
+#include "SwapchainManager.h"
+
+// Presents to a GLFW window through the SwapchainManager
+class SwapchainTarget : public PresentationTarget
+{
+private:
+
+    uint32_t width;
+    uint32_t height;
+
+    GLFWwindow* window = nullptr;
+    VkSurfaceKHR surface = VK_NULL_HANDLE;
+    VkQueue presentQueue;
+
+#ifdef VK_GOOGLE_display_timing
+    // Null unless the device has VK_GOOGLE_display_timing
+    PFN_vkGetPastPresentationTimingGOOGLE getPastPresentationTiming = nullptr;
+#endif
+
+public:
+
+    SwapchainTarget(uint32_t width, uint32_t height);
+
+    void init() override;
+    void cleanup() override;
+
+    std::vector<const char*> getRequiredInstanceExtensions() override;
+
+    void createSurface(VkInstance instance) override;
+    void destroySurface(VkInstance instance) override;
+    VkSurfaceKHR getSurface() override;
+
+    GLFWwindow* getWindow() override;
+
+    void pollEvents() override;
+    bool shouldClose() override;
+
+    void setQueues(VkQueue graphicsQueue, VkQueue presentQueue) override;
+
+    void createImages() override;
+    void destroyImages() override;
+
+    void createFramebuffers(VkImageView depthImageView, VkImageView multisampleImageView, VkRenderPass renderPass) override;
+    void destroyFramebuffers() override;
+
+    VkFormat getImageFormat() override;
+    VkExtent2D getExtent() override;
+    uint32_t getImageCount() override;
+    VkFramebuffer getFramebuffer(uint32_t imageIndex) override;
+    VkImage getImage(uint32_t imageIndex) override;
+
+    VkImageLayout getFinalLayout() override;
+
+    VkResult acquireNextImage(VkSemaphore imageAvailable, uint32_t& imageIndex) override;
+    VkResult present(VkSemaphore renderFinished, uint32_t imageIndex, uint32_t presentId) override;
+    void getPresentTimes(std::vector<PresentTime>& times) override;
+};
\ No newline at end of file
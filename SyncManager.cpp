@@ -0,0 +1,169 @@
+#include "SyncManager.h"
+
+#include "DeviceManager.h"
+#include "Queue.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+SyncManager& SyncManager::instance()
+{
+    static SyncManager instance;
+
+    return instance;
+}
+
+void SyncManager::init(bool timelineSemaphores)
+{
+    this->timelineSemaphores = false;
+
+#ifdef VK_KHR_timeline_semaphore
+    if (timelineSemaphores)
+    {
+        VkDevice device = DeviceManager::instance().getDevice();
+
+        getSemaphoreCounterValue = reinterpret_cast<PFN_vkGetSemaphoreCounterValueKHR>(vkGetDeviceProcAddr(device, "vkGetSemaphoreCounterValueKHR"));
+        waitSemaphores = reinterpret_cast<PFN_vkWaitSemaphoresKHR>(vkGetDeviceProcAddr(device, "vkWaitSemaphoresKHR"));
+
+        this->timelineSemaphores = getSemaphoreCounterValue != nullptr && waitSemaphores != nullptr;
+    }
+#endif
+}
+
+bool SyncManager::usesTimelineSemaphores()
+{
+    return timelineSemaphores;
+}
+
+void SyncManager::registerQueue(Queue* queue)
+{
+    if (std::find(queues.begin(), queues.end(), queue) == queues.end())
+    {
+        queues.push_back(queue);
+    }
+}
+
+SyncTicket SyncManager::nextTicket()
+{
+    return ++lastTicket;
+}
+
+SyncTicket SyncManager::getLastTicket()
+{
+    return lastTicket;
+}
+
+SyncTicket SyncManager::getCompletedTicket()
+{
+    SyncTicket completed = lastTicket;
+
+    // Everything before the oldest ticket still running on any queue has completed
+    for (Queue* queue : queues)
+    {
+        SyncTicket oldest = queue->poll();
+
+        if (oldest != 0)
+        {
+            completed = std::min(completed, oldest - 1);
+        }
+    }
+
+    return completed;
+}
+
+bool SyncManager::isComplete(SyncTicket ticket)
+{
+    return ticket <= lastTicket && ticket <= getCompletedTicket();
+}
+
+void SyncManager::wait(SyncTicket ticket)
+{
+    for (Queue* queue : queues)
+    {
+        queue->wait(ticket);
+    }
+}
+
+void SyncManager::waitIdle()
+{
+    wait(lastTicket);
+}
+
+VkFence SyncManager::acquireFence()
+{
+    if (!freeFences.empty())
+    {
+        VkFence fence = freeFences.back();
+        freeFences.pop_back();
+
+        return fence;
+    }
+
+    VkFenceCreateInfo fenceInfo = {};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    VkFence fence;
+
+    if (vkCreateFence(DeviceManager::instance().getDevice(), &fenceInfo, nullptr, &fence) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Error: Failed to create submission fence");
+    }
+
+    return fence;
+}
+
+void SyncManager::releaseFence(VkFence fence)
+{
+    vkResetFences(DeviceManager::instance().getDevice(), 1, &fence);
+    freeFences.push_back(fence);
+}
+
+#ifdef VK_KHR_timeline_semaphore
+uint64_t SyncManager::getCounterValue(VkSemaphore semaphore)
+{
+    uint64_t value = 0;
+
+    if (getSemaphoreCounterValue(DeviceManager::instance().getDevice(), semaphore, &value) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Error: Failed to read timeline semaphore");
+    }
+
+    return value;
+}
+
+void SyncManager::waitCounterValue(VkSemaphore semaphore, uint64_t value)
+{
+    VkSemaphoreWaitInfoKHR waitInfo = {};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &semaphore;
+    waitInfo.pValues = &value;
+
+    if (waitSemaphores(DeviceManager::instance().getDevice(), &waitInfo, std::numeric_limits<uint64_t>::max()) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Error: Failed to wait for timeline semaphore");
+    }
+}
+#endif
+
+void SyncManager::cleanup()
+{
+    waitIdle();
+
+    for (Queue* queue : queues)
+    {
+        queue->cleanup();
+    }
+
+    queues.clear();
+
+    VkDevice device = DeviceManager::instance().getDevice();
+
+    for (VkFence fence : freeFences)
+    {
+        vkDestroyFence(device, fence, nullptr);
+    }
+
+    freeFences.clear();
+}
\ No newline at end of file
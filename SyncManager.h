@@ -0,0 +1,77 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <vector>
+
+class Queue;
+
+// Submission ticket - every queue flush gets the next value, 0 means nothing to wait for
+typedef uint64_t SyncTicket;
+
+// CPU/GPU synchronisation by ticket
+// Each queue signals its tickets in order, on a timeline semaphore where VK_KHR_timeline_semaphore is
+// available and through a pooled fence per submission otherwise. A ticket is complete once every
+// submission with a ticket up to it has completed on every queue, so tagging a resource with the ticket
+// of its last use is enough to know when it can be reused or destroyed. Main thread only.
+class SyncManager
+{
+private:
+
+    SyncManager() {}
+
+    bool timelineSemaphores = false;
+
+    SyncTicket lastTicket = 0;
+
+    std::vector<Queue*> queues;
+    std::vector<VkFence> freeFences;
+
+#ifdef VK_KHR_timeline_semaphore
+    PFN_vkGetSemaphoreCounterValueKHR getSemaphoreCounterValue = nullptr;
+    PFN_vkWaitSemaphoresKHR waitSemaphores = nullptr;
+#endif
+
+public:
+
+    // Return singleton instance
+    static SyncManager& instance();
+
+    // Ensure singleton is never copied
+    SyncManager(SyncManager const&)         = delete;
+    void operator=(SyncManager const&)      = delete;
+
+    // Call once the device exists, timeline semaphores only if the extension was enabled on it
+    void init(bool timelineSemaphores);
+
+    bool usesTimelineSemaphores();
+
+    void registerQueue(Queue* queue);
+
+    SyncTicket nextTicket();
+    SyncTicket getLastTicket();
+
+    // Highest ticket at or below which every submission has completed, without waiting
+    SyncTicket getCompletedTicket();
+
+    bool isComplete(SyncTicket ticket);
+
+    // Block until every submission up to the ticket has completed
+    void wait(SyncTicket ticket);
+
+    void waitIdle();
+
+    // Fence emulation - fences are handed back unsignalled
+    VkFence acquireFence();
+    void releaseFence(VkFence fence);
+
+#ifdef VK_KHR_timeline_semaphore
+    uint64_t getCounterValue(VkSemaphore semaphore);
+    void waitCounterValue(VkSemaphore semaphore, uint64_t value);
+#endif
+
+    void cleanup();
+};
\ No newline at end of file
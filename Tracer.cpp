@@ -0,0 +1,237 @@
+#include "Tracer.h"
+
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <stdexcept>
+
+Tracer& Tracer::instance()
+{
+    static Tracer instance;
+
+    return instance;
+}
+
+Tracer::Tracer()
+{
+    startTicks = now();
+    startTime = std::chrono::steady_clock::now();
+}
+
+Tracer::ThreadBuffer& Tracer::getThreadBuffer()
+{
+    // Owned by the tracer so a thread's zones survive the thread exiting
+    thread_local ThreadBuffer* threadBuffer = nullptr;
+
+    if (threadBuffer == nullptr)
+    {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+
+        std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer());
+        buffer->track = static_cast<uint32_t>(buffers.size()) + 1;
+        buffer->name = "Thread " + std::to_string(buffer->track);
+        buffer->events.resize(RING_CAPACITY);
+        buffer->head = 0;
+        buffer->tail = 0;
+        buffer->dropped = 0;
+
+        threadBuffer = buffer.get();
+        buffers.push_back(std::move(buffer));
+    }
+
+    return *threadBuffer;
+}
+
+void Tracer::record(const char* name, uint64_t start, uint64_t end)
+{
+    ThreadBuffer& buffer = getThreadBuffer();
+
+    uint64_t head = buffer.head.load(std::memory_order_relaxed);
+
+    // Full ring - drop the zone rather than wait for a flush
+    if (head - buffer.tail.load(std::memory_order_acquire) >= RING_CAPACITY)
+    {
+        buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    ZoneEvent& event = buffer.events[head & (RING_CAPACITY - 1)];
+    event.name = name;
+    event.start = start;
+    event.end = end;
+
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+void Tracer::setThreadName(const char* name)
+{
+    ThreadBuffer& buffer = getThreadBuffer();
+
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    buffer.name = name;
+}
+
+void Tracer::calibrate()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    // Assumes an invariant TSC - ticks over the whole run against the steady clock
+    uint64_t ticks = now() - startTicks;
+
+    // A longer span only refines the rate a little, so the clock isn't read again until it at least halves the error
+    if (ticks < 2 * calibratedTicks)
+    {
+        return;
+    }
+
+    double nanoseconds = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - startTime).count();
+
+    if (ticks > 0 && nanoseconds > 0.0)
+    {
+        nanosecondsPerTick = nanoseconds / static_cast<double>(ticks);
+        calibratedTicks = ticks;
+    }
+#endif
+}
+
+uint64_t Tracer::ticksToNanoseconds(uint64_t ticks) const
+{
+    return ticks > startTicks ? static_cast<uint64_t>((ticks - startTicks) * nanosecondsPerTick) : 0;
+}
+
+void Tracer::addGpuZone(const char* name, uint64_t startTicks, uint64_t offsetNs, uint64_t durationNs)
+{
+    if (events.size() >= MAX_EVENTS)
+    {
+        droppedEvents++;
+        return;
+    }
+
+    calibrate();
+
+    TraceEvent event = {};
+    event.name = name;
+    event.track = GPU_TRACK;
+    event.startNs = ticksToNanoseconds(startTicks) + offsetNs;
+    event.durationNs = durationNs;
+
+    events.push_back(event);
+}
+
+void Tracer::flush()
+{
+    calibrate();
+
+    std::lock_guard<std::mutex> lock(buffersMutex);
+
+    for (const std::unique_ptr<ThreadBuffer>& buffer : buffers)
+    {
+        uint64_t tail = buffer->tail.load(std::memory_order_relaxed);
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+
+        for (uint64_t i = tail; i < head; i++)
+        {
+            const ZoneEvent& zone = buffer->events[i & (RING_CAPACITY - 1)];
+
+            if (events.size() >= MAX_EVENTS)
+            {
+                droppedEvents++;
+                continue;
+            }
+
+            TraceEvent event = {};
+            event.name = zone.name;
+            event.track = buffer->track;
+            event.startNs = ticksToNanoseconds(zone.start);
+            event.durationNs = ticksToNanoseconds(zone.end) - event.startNs;
+
+            events.push_back(event);
+        }
+
+        // Hand the slots back to the writer only once they have been copied out
+        buffer->tail.store(head, std::memory_order_release);
+    }
+}
+
+void Tracer::writeChromeTrace(const std::string& path)
+{
+    flush();
+
+    std::ofstream file(path);
+
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Error: Failed to open trace output " + path);
+    }
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << GPU_TRACK << ",\"args\":{\"name\":\"GPU\"}}";
+
+    uint64_t dropped = droppedEvents;
+
+    {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+
+        for (const std::unique_ptr<ThreadBuffer>& buffer : buffers)
+        {
+            file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->track
+                 << ",\"args\":{\"name\":\"" << buffer->name << "\"}}";
+
+            dropped += buffer->dropped.load(std::memory_order_relaxed);
+        }
+    }
+
+    // Complete events, timestamps in microseconds
+    file.setf(std::ios::fixed);
+    file.precision(3);
+
+    for (const TraceEvent& event : events)
+    {
+        file << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.track
+             << ",\"ts\":" << event.startNs / 1000.0 << ",\"dur\":" << event.durationNs / 1000.0 << "}";
+    }
+
+    file << "\n]}\n";
+
+    std::cout << "Trace written to " << path << ": " << events.size() << " zones";
+
+    if (dropped > 0)
+    {
+        std::cout << " (" << dropped << " dropped)";
+    }
+
+    std::cout << std::endl;
+}
+
+double Tracer::measureOverhead(uint32_t iterations)
+{
+    // Flush often enough that the ring never fills and the timing never includes dropped zones
+    const uint32_t batchSize = RING_CAPACITY / 2;
+
+    double totalNanoseconds = 0.0;
+    uint32_t remaining = iterations;
+
+    while (remaining > 0)
+    {
+        uint32_t count = std::min(remaining, batchSize);
+
+        auto batchStart = std::chrono::steady_clock::now();
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            TRACE_ZONE("Overhead");
+        }
+
+        totalNanoseconds += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - batchStart).count();
+        remaining -= count;
+
+        // Measurement zones are not part of the trace
+        std::lock_guard<std::mutex> lock(buffersMutex);
+
+        for (const std::unique_ptr<ThreadBuffer>& buffer : buffers)
+        {
+            buffer->tail.store(buffer->head.load(std::memory_order_acquire), std::memory_order_release);
+        }
+    }
+
+    return iterations > 0 ? totalNanoseconds / iterations : 0.0;
+}
\ No newline at end of file
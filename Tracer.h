@@ -0,0 +1,161 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// CPU zone tracing written out as Chrome trace_event JSON (chrome://tracing, Perfetto)
+// Zones are recorded into a ring per thread that only that thread writes and only flush() reads,
+// so recording takes no locks. Zone names must be string literals or otherwise outlive the tracer.
+//
+// Built without ENABLE_TRACING every TRACE_ macro expands to nothing.
+// With it a zone costs two rdtsc reads and a ring write, measured at about 45 ns on a virtualised
+// x86-64 machine; run with --trace-overhead to measure on others.
+class Tracer
+{
+private:
+
+    Tracer();
+
+    struct ZoneEvent
+    {
+        const char* name;
+        uint64_t start;
+        uint64_t end;
+    };
+
+    // Single producer (owning thread), single consumer (flush)
+    struct ThreadBuffer
+    {
+        uint32_t track;
+        std::string name;
+
+        std::vector<ZoneEvent> events;
+        std::atomic<uint64_t> head;
+        std::atomic<uint64_t> tail;
+        std::atomic<uint64_t> dropped;
+    };
+
+    struct TraceEvent
+    {
+        const char* name;
+        uint32_t track;
+        uint64_t startNs;
+        uint64_t durationNs;
+    };
+
+    // Taken on thread registration and flush, never while recording a zone
+    std::mutex buffersMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+    std::vector<TraceEvent> events;
+    uint64_t droppedEvents = 0;
+
+    // Tick/clock pair at start, compared against the current pair to convert ticks to nanoseconds
+    uint64_t startTicks;
+    std::chrono::steady_clock::time_point startTime;
+    double nanosecondsPerTick = 1.0;
+
+    // Ticks since start when the rate was last measured
+    uint64_t calibratedTicks = 0;
+
+    ThreadBuffer& getThreadBuffer();
+
+    // Remeasure the rate once the run has doubled in length since the last measurement, a cheap no-op otherwise
+    void calibrate();
+
+    uint64_t ticksToNanoseconds(uint64_t ticks) const;
+
+public:
+
+#ifdef ENABLE_TRACING
+    static const bool ENABLED = true;
+#else
+    static const bool ENABLED = false;
+#endif
+
+    // Zones per thread between flushes, power of two
+    static const uint32_t RING_CAPACITY = 64 * 1024;
+
+    // Flushed events kept for export, later ones are counted as dropped
+    static const uint32_t MAX_EVENTS = 4 * 1024 * 1024;
+
+    // Track of GPU zones merged from the GPU profiler
+    static const uint32_t GPU_TRACK = 0;
+
+    class Zone
+    {
+    public:
+
+        explicit Zone(const char* name)
+            : name(name), start(Tracer::now())
+        {
+        }
+
+        ~Zone()
+        {
+            Tracer::instance().record(name, start, Tracer::now());
+        }
+
+        Zone(Zone const&)                   = delete;
+        void operator=(Zone const&)         = delete;
+
+    private:
+
+        const char* name;
+        uint64_t start;
+    };
+
+    // Return singleton instance
+    static Tracer& instance();
+
+    // Ensure singleton is never copied
+    Tracer(Tracer const&)                   = delete;
+    void operator=(Tracer const&)           = delete;
+
+    // Raw timestamp - the time stamp counter where available, steady clock nanoseconds otherwise
+    static uint64_t now()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    void record(const char* name, uint64_t start, uint64_t end);
+
+    void setThreadName(const char* name);
+
+    // Zone measured elsewhere - startTicks is a now() value, offset and duration are in nanoseconds
+    void addGpuZone(const char* name, uint64_t startTicks, uint64_t offsetNs, uint64_t durationNs);
+
+    // Move every thread's recorded zones into the export list
+    void flush();
+
+    void writeChromeTrace(const std::string& path);
+
+    // Average cost of one recorded zone in nanoseconds
+    double measureOverhead(uint32_t iterations);
+};
+
+#ifdef ENABLE_TRACING
+    #define TRACE_CONCAT_IMPL(a, b) a##b
+    #define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+
+    #define TRACE_ZONE(name) Tracer::Zone TRACE_CONCAT(traceZone, __LINE__)(name)
+    #define TRACE_THREAD_NAME(name) Tracer::instance().setThreadName(name)
+    #define TRACE_FLUSH() Tracer::instance().flush()
+#else
+    #define TRACE_ZONE(name)
+    #define TRACE_THREAD_NAME(name)
+    #define TRACE_FLUSH()
+#endif
\ No newline at end of file
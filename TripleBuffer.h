@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single producer, single consumer handoff of the latest value
+// The writer fills its back buffer and publishes it, the reader takes whichever buffer was published last. Neither
+// side ever waits on the other, and a buffer is only touched by the side that currently holds it, so values larger
+// than an atomic can be passed without tearing. Values that are never taken are overwritten by newer ones.
+template <typename T>
+class TripleBuffer
+{
+public:
+
+    TripleBuffer()
+        : shared(1)
+    {
+    }
+
+    TripleBuffer(TripleBuffer const&)   = delete;
+    void operator=(TripleBuffer const&) = delete;
+
+    // Writer only, held until the next publish
+    T& getWriteBuffer()
+    {
+        return buffers[back];
+    }
+
+    // Writer only, hands the write buffer to the reader and takes back the shared one
+    void publish()
+    {
+        back = shared.exchange(back | NEW_VALUE, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    // Reader only, returns false when nothing was published since the last call and the read buffer is unchanged
+    bool update()
+    {
+        if ((shared.load(std::memory_order_relaxed) & NEW_VALUE) == 0)
+        {
+            return false;
+        }
+
+        front = shared.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+
+        return true;
+    }
+
+    // Reader only, held until the next update
+    const T& getReadBuffer() const
+    {
+        return buffers[front];
+    }
+
+private:
+
+    // The shared index carries a flag set by publish and cleared when the reader swaps it out
+    static const uint32_t INDEX_MASK = 3;
+    static const uint32_t NEW_VALUE = 4;
+
+    T buffers[3];
+
+    std::atomic<uint32_t> shared;
+
+    uint32_t back = 0;
+    uint32_t front = 2;
+};
\ No newline at end of file
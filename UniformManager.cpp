@@ -65,7 +65,7 @@ void UniformManager::cleanupUniformBuffers()
     VkDevice device = DeviceManager::instance().getDevice();
 
     vkDestroyBuffer(device, dynamicUniformBuffer, nullptr);
-    vkFreeMemory(device, dynamicMemory, nullptr);
+    Utils::freeTrackedMemory(dynamicMemory);
     vkDestroyBuffer(device, uniformBuffer, nullptr);
-    vkFreeMemory(device, uniformBufferMemory, nullptr);
+    Utils::freeTrackedMemory(uniformBufferMemory);
 }
\ No newline at end of file
@@ -0,0 +1,547 @@
+#include "UploadManager.h"
+
+#include "RuntimeStats.h"
+
+#include <cstring>
+#include <algorithm>
+
+namespace
+{
+    // Don't bother splitting an upload into slivers smaller than this while space is still being reclaimed
+    const VkDeviceSize minChunkSize = 64 * 1024;
+
+    VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+UploadManager& UploadManager::instance()
+{
+    static UploadManager instance;
+
+    return instance;
+}
+
+void UploadManager::init(Queue& uploadQueue, Queue& graphicsQueue, VkDeviceSize arenaSize)
+{
+    this->queue = &uploadQueue;
+    this->graphicsQueue = &graphicsQueue;
+    this->arenaSize = arenaSize;
+
+    separateQueue = !uploadQueue.sharesQueueWith(graphicsQueue);
+    ownershipTransfer = uploadQueue.getFamilyIndex() != graphicsQueue.getFamilyIndex();
+    profilingAvailable = !ownershipTransfer;
+
+    VkDevice device = DeviceManager::instance().getDevice();
+
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = uploadQueue.getFamilyIndex();
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+    if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Error: Failed to create upload command pool");
+    }
+
+    if (ownershipTransfer)
+    {
+        poolInfo.queueFamilyIndex = graphicsQueue.getFamilyIndex();
+
+        if (vkCreateCommandPool(device, &poolInfo, nullptr, &graphicsCommandPool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Error: Failed to create upload acquire command pool");
+        }
+    }
+
+    // Staging arena stays mapped for the lifetime of the manager
+    Utils::createBuffer(arenaSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingMemory);
+
+    void* data;
+    vkMapMemory(device, stagingMemory, 0, arenaSize, 0, &data);
+    stagingData = static_cast<char*>(data);
+
+    profilerSlot = GpuProfiler::instance().createSlot();
+}
+
+VkCommandBuffer UploadManager::getRecordingBuffer()
+{
+    if (recordingBuffer != VK_NULL_HANDLE)
+    {
+        return recordingBuffer;
+    }
+
+    VkCommandBufferAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = commandPool;
+    allocInfo.commandBufferCount = 1;
+
+    if (vkAllocateCommandBuffers(DeviceManager::instance().getDevice(), &allocInfo, &recordingBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Error: Failed to allocate upload command buffer");
+    }
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(recordingBuffer, &beginInfo);
+
+    recordingProfiled = profilingAvailable && !profilerSlotBusy;
+
+    if (recordingProfiled)
+    {
+        GpuProfiler::instance().beginRecording(recordingBuffer, profilerSlot);
+        GpuProfiler::instance().beginScope(recordingBuffer, profilerSlot, "Uploads");
+        profilerSlotBusy = true;
+    }
+
+    return recordingBuffer;
+}
+
+VkCommandBuffer UploadManager::getAcquireBuffer()
+{
+    if (acquireBuffer != VK_NULL_HANDLE)
+    {
+        return acquireBuffer;
+    }
+
+    VkCommandBufferAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = graphicsCommandPool;
+    allocInfo.commandBufferCount = 1;
+
+    if (vkAllocateCommandBuffers(DeviceManager::instance().getDevice(), &allocInfo, &acquireBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Error: Failed to allocate upload acquire command buffer");
+    }
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(acquireBuffer, &beginInfo);
+
+    return acquireBuffer;
+}
+
+void UploadManager::releaseBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size)
+{
+    VkBufferMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = queue->getFamilyIndex();
+    barrier.dstQueueFamilyIndex = graphicsQueue->getFamilyIndex();
+    barrier.buffer = buffer;
+    barrier.offset = offset;
+    barrier.size = size;
+
+    // Release half - transfer writes are made available, the acquire makes them visible
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = 0;
+    vkCmdPipelineBarrier(getRecordingBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+    bufferAcquires.push_back(barrier);
+}
+
+VkDeviceSize UploadManager::allocateStaging(VkDeviceSize maxSize, VkDeviceSize minSize, VkDeviceSize alignment, VkDeviceSize& offset)
+{
+    minSize = std::min(minSize, maxSize);
+
+    if (minSize > arenaSize)
+    {
+        throw std::runtime_error("Error: Upload chunk larger than staging arena");
+    }
+
+    while (true)
+    {
+        uint64_t alignedHead = alignUp(head, alignment);
+        VkDeviceSize physical = alignedHead % arenaSize;
+
+        // Chunks never straddle the end of the arena - skip the tail end if it's too small
+        if (arenaSize - physical < minSize)
+        {
+            alignedHead += arenaSize - physical;
+            physical = 0;
+        }
+
+        VkDeviceSize contiguous = arenaSize - physical;
+        VkDeviceSize freeBytes = arenaSize - static_cast<VkDeviceSize>(alignedHead - tail);
+        VkDeviceSize available = std::min(contiguous, freeBytes);
+
+        if (alignedHead - tail <= arenaSize && available >= minSize)
+        {
+            VkDeviceSize size = std::min(available, maxSize);
+
+            offset = physical;
+            head = alignedHead + size;
+
+            return size;
+        }
+
+        // Arena full - submit what we have, then wait for the oldest batch to free its space
+        stats.stalls++;
+
+        if (recordingBuffer != VK_NULL_HANDLE)
+        {
+            flush();
+        }
+
+        if (inFlight.empty())
+        {
+            // Nothing left to reclaim, so the ring is empty and can restart from the beginning
+            head = tail = 0;
+            continue;
+        }
+
+        waitOldest();
+    }
+}
+
+void UploadManager::uploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size)
+{
+    const char* src = static_cast<const char*>(data);
+    VkDeviceSize uploaded = 0;
+
+    stats.uploads++;
+
+    // Uploads larger than the free space are split into chunks, possibly across several batches
+    while (uploaded < size)
+    {
+        VkDeviceSize remaining = size - uploaded;
+        VkDeviceSize stagingOffset;
+        VkDeviceSize chunkSize = allocateStaging(remaining, std::min(remaining, minChunkSize), 16, stagingOffset);
+
+        memcpy(stagingData + stagingOffset, src + uploaded, static_cast<size_t>(chunkSize));
+
+        VkBufferCopy copyRegion = {};
+        copyRegion.srcOffset = stagingOffset;
+        copyRegion.dstOffset = dstOffset + uploaded;
+        copyRegion.size = chunkSize;
+        vkCmdCopyBuffer(getRecordingBuffer(), stagingBuffer, dstBuffer, 1, &copyRegion);
+
+        uploaded += chunkSize;
+        stats.chunks++;
+    }
+
+    if (ownershipTransfer)
+    {
+        releaseBuffer(dstBuffer, dstOffset, size);
+    }
+
+    stats.bytesUploaded += size;
+    RuntimeStats::instance().add(RuntimeStats::BYTES_UPLOADED, size);
+}
+
+void UploadManager::uploadImage(VkImage dstImage, uint32_t width, uint32_t height, const void* pixels, uint32_t levelCount)
+{
+    const char* src = static_cast<const char*>(pixels);
+    VkDeviceSize imageSize = 0;
+
+    stats.uploads++;
+
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = dstImage;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = levelCount;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+
+    // Transition to transfer destination before the first copy
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(getRecordingBuffer(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    for (uint32_t level = 0; level < levelCount; level++)
+    {
+        uint32_t levelWidth = std::max(width >> level, 1u);
+        uint32_t levelHeight = std::max(height >> level, 1u);
+        VkDeviceSize rowPitch = static_cast<VkDeviceSize>(levelWidth) * 4;
+
+        // Large images are copied in bands of whole rows
+        uint32_t row = 0;
+        while (row < levelHeight)
+        {
+            VkDeviceSize remaining = (levelHeight - row) * rowPitch;
+            VkDeviceSize stagingOffset;
+            VkDeviceSize chunkSize = allocateStaging(remaining, std::max(rowPitch, std::min(remaining, minChunkSize)), 16, stagingOffset);
+
+            uint32_t rows = static_cast<uint32_t>(chunkSize / rowPitch);
+            VkDeviceSize bandSize = rows * rowPitch;
+
+            // Return the partial-row remainder to the ring
+            head -= chunkSize - bandSize;
+
+            memcpy(stagingData + stagingOffset, src + row * rowPitch, static_cast<size_t>(bandSize));
+
+            VkBufferImageCopy region = {};
+            region.bufferOffset = stagingOffset;
+            region.bufferRowLength = 0;
+            region.bufferImageHeight = 0;
+            region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.imageSubresource.mipLevel = level;
+            region.imageSubresource.baseArrayLayer = 0;
+            region.imageSubresource.layerCount = 1;
+            region.imageOffset = { 0, static_cast<int32_t>(row), 0 };
+            region.imageExtent = { levelWidth, rows, 1 };
+
+            vkCmdCopyBufferToImage(getRecordingBuffer(), stagingBuffer, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+            row += rows;
+            stats.chunks++;
+        }
+
+        src += levelHeight * rowPitch;
+        imageSize += levelHeight * rowPitch;
+    }
+
+    // Hand over to the fragment shader once every band has been copied
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    if (ownershipTransfer)
+    {
+        // Release with the layout transition, the graphics queue repeats it in the matching acquire
+        barrier.srcQueueFamilyIndex = queue->getFamilyIndex();
+        barrier.dstQueueFamilyIndex = graphicsQueue->getFamilyIndex();
+        barrier.dstAccessMask = 0;
+        vkCmdPipelineBarrier(getRecordingBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        imageAcquires.push_back(barrier);
+    }
+    else
+    {
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(getRecordingBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+
+    stats.bytesUploaded += imageSize;
+    RuntimeStats::instance().add(RuntimeStats::BYTES_UPLOADED, imageSize);
+}
+
+void UploadManager::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, const std::vector<VkBufferCopy>& regions)
+{
+    if (regions.empty())
+    {
+        return;
+    }
+
+    // Both buffers belong to the graphics family, so the copy runs there after earlier batches are acquired
+    if (ownershipTransfer && recordingBuffer != VK_NULL_HANDLE)
+    {
+        flush();
+    }
+
+    VkCommandBuffer commandBuffer = ownershipTransfer ? getAcquireBuffer() : getRecordingBuffer();
+
+    // Source may have been written by an earlier upload still in flight
+    VkMemoryBarrier memoryBarrier = {};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+    vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, static_cast<uint32_t>(regions.size()), regions.data());
+
+    stats.chunks += regions.size();
+}
+
+SyncTicket UploadManager::flush()
+{
+    if (recordingBuffer == VK_NULL_HANDLE && acquireBuffer == VK_NULL_HANDLE)
+    {
+        return 0;
+    }
+
+    VkDevice device = DeviceManager::instance().getDevice();
+
+    // Device-side copies alone still go through the upload queue, so every batch has its semaphore to wait on
+    getRecordingBuffer();
+
+    // Make every transfer write visible to later vertex/index/shader reads on the queue
+    // A separate queue gets the same guarantee from the semaphore the graphics queue waits on
+    if (!separateQueue)
+    {
+        VkMemoryBarrier memoryBarrier = {};
+        memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        memoryBarrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(recordingBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+    }
+
+    if (recordingProfiled)
+    {
+        GpuProfiler::instance().endScope(recordingBuffer, profilerSlot);
+        GpuProfiler::instance().endRecording(profilerSlot);
+    }
+
+    if (vkEndCommandBuffer(recordingBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Error: Failed to record upload command buffer");
+    }
+
+    Batch batch = {};
+    batch.commandBuffer = recordingBuffer;
+    batch.endHead = head;
+    batch.profiled = recordingProfiled;
+
+    if (!separateQueue)
+    {
+        queue->submit(batch.commandBuffer);
+        batch.ticket = queue->flush();
+    }
+    else
+    {
+        if (!freeSemaphores.empty())
+        {
+            batch.semaphore = freeSemaphores.back();
+            freeSemaphores.pop_back();
+        }
+        else
+        {
+            VkSemaphoreCreateInfo semaphoreInfo = {};
+            semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+            if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &batch.semaphore) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Error: Failed to create upload semaphore");
+            }
+        }
+
+        queue->submit(batch.commandBuffer, std::vector<Queue::Wait>(), batch.semaphore);
+        queue->flush();
+
+        // Acquires and graphics-side copies, after any copies already recorded there
+        if (!bufferAcquires.empty() || !imageAcquires.empty())
+        {
+            vkCmdPipelineBarrier(getAcquireBuffer(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                                 VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                                 0, nullptr,
+                                 static_cast<uint32_t>(bufferAcquires.size()), bufferAcquires.data(),
+                                 static_cast<uint32_t>(imageAcquires.size()), imageAcquires.data());
+
+            bufferAcquires.clear();
+            imageAcquires.clear();
+        }
+
+        if (acquireBuffer != VK_NULL_HANDLE && vkEndCommandBuffer(acquireBuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Error: Failed to record upload acquire command buffer");
+        }
+
+        batch.acquireBuffer = acquireBuffer;
+        acquireBuffer = VK_NULL_HANDLE;
+
+        // Waiting here also orders every later graphics submission after the batch
+        Queue::Wait wait = { batch.semaphore, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT };
+        graphicsQueue->submit(batch.acquireBuffer, std::vector<Queue::Wait>(1, wait));
+        batch.ticket = graphicsQueue->flush();
+    }
+
+    if (batch.profiled)
+    {
+        GpuProfiler::instance().submitted(profilerSlot);
+    }
+
+    inFlight.push_back(batch);
+    recordingBuffer = VK_NULL_HANDLE;
+    stats.batchesSubmitted++;
+
+    return batch.ticket;
+}
+
+void UploadManager::retireBatch(const Batch& batch)
+{
+    VkDevice device = DeviceManager::instance().getDevice();
+
+    vkFreeCommandBuffers(device, commandPool, 1, &batch.commandBuffer);
+
+    if (batch.acquireBuffer != VK_NULL_HANDLE)
+    {
+        vkFreeCommandBuffers(device, graphicsCommandPool, 1, &batch.acquireBuffer);
+    }
+
+    if (batch.semaphore != VK_NULL_HANDLE)
+    {
+        freeSemaphores.push_back(batch.semaphore);
+    }
+
+    tail = batch.endHead;
+
+    // Ticket has completed, so the batch's timestamps are ready
+    if (batch.profiled)
+    {
+        GpuProfiler::instance().collect(profilerSlot);
+        profilerSlotBusy = false;
+    }
+}
+
+void UploadManager::waitOldest()
+{
+    Batch batch = inFlight.front();
+    inFlight.pop_front();
+
+    SyncManager::instance().wait(batch.ticket);
+    retireBatch(batch);
+}
+
+void UploadManager::collect()
+{
+    // Batches complete in submission order, so stop at the first ticket still running
+    while (!inFlight.empty() && SyncManager::instance().isComplete(inFlight.front().ticket))
+    {
+        retireBatch(inFlight.front());
+        inFlight.pop_front();
+    }
+}
+
+void UploadManager::waitIdle()
+{
+    flush();
+
+    while (!inFlight.empty())
+    {
+        waitOldest();
+    }
+}
+
+UploadManager::Stats UploadManager::getStats()
+{
+    return stats;
+}
+
+void UploadManager::cleanup()
+{
+    waitIdle();
+
+    VkDevice device = DeviceManager::instance().getDevice();
+
+    for (auto semaphore : freeSemaphores)
+    {
+        vkDestroySemaphore(device, semaphore, nullptr);
+    }
+
+    freeSemaphores.clear();
+
+    vkUnmapMemory(device, stagingMemory);
+    vkDestroyBuffer(device, stagingBuffer, nullptr);
+    Utils::freeTrackedMemory(stagingMemory);
+
+    vkDestroyCommandPool(device, commandPool, nullptr);
+
+    if (graphicsCommandPool != VK_NULL_HANDLE)
+    {
+        vkDestroyCommandPool(device, graphicsCommandPool, nullptr);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,142 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+
+#include <GLFW/glfw3.h>
+
+#include <deque>
+#include <vector>
+
+#include "Utils.h"
+#include "GpuProfiler.h"
+#include "Queue.h"
+
+// Batches buffer/image uploads through a persistent, ring-allocated staging arena
+// All copies recorded between flushes share one command buffer and one sync ticket
+// On a separate transfer queue each batch signals a semaphore the graphics queue waits on, and
+// resources in another queue family are released by the transfer queue and acquired by graphics
+class UploadManager
+{
+private:
+
+    UploadManager() {}
+
+    struct Batch
+    {
+        VkCommandBuffer commandBuffer;
+
+        // Completes once the uploads are visible to the graphics queue
+        SyncTicket ticket;
+
+        // Graphics side of a batch on a separate queue - ownership acquires, and the semaphore it waits on
+        VkCommandBuffer acquireBuffer;
+        VkSemaphore semaphore;
+
+        // Ring position at submission - staging space before this is free once the ticket completes
+        uint64_t endHead;
+
+        // Timed with the profiler slot, read back when the batch retires
+        bool profiled;
+    };
+
+    Queue* queue;
+    VkCommandPool commandPool;
+
+    // Queue that consumes the uploads
+    Queue* graphicsQueue;
+    VkCommandPool graphicsCommandPool = VK_NULL_HANDLE;
+
+    bool separateQueue = false;
+    bool ownershipTransfer = false;
+
+    // Acquire half of every release recorded into the current batch
+    std::vector<VkBufferMemoryBarrier> bufferAcquires;
+    std::vector<VkImageMemoryBarrier> imageAcquires;
+    VkCommandBuffer acquireBuffer = VK_NULL_HANDLE;
+    std::vector<VkSemaphore> freeSemaphores;
+
+    // Persistently mapped staging arena
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingMemory;
+    char* stagingData;
+    VkDeviceSize arenaSize;
+
+    // Monotonic ring offsets, physical offset is (offset % arenaSize)
+    uint64_t head = 0;
+    uint64_t tail = 0;
+
+    // Batch currently being recorded, and submitted batches in submission order
+    VkCommandBuffer recordingBuffer = VK_NULL_HANDLE;
+    std::deque<Batch> inFlight;
+
+    // One batch at a time is timed, later batches go untimed until it retires
+    ProfilerSlot profilerSlot;
+
+    // Query resets need a graphics or compute queue, so dedicated transfer queues go untimed
+    bool profilingAvailable = false;
+    bool profilerSlotBusy = false;
+    bool recordingProfiled = false;
+
+    VkCommandBuffer getRecordingBuffer();
+
+    // Graphics-family command buffer of the current batch, only used with an ownership transfer
+    VkCommandBuffer getAcquireBuffer();
+
+    // Release a written buffer range to the graphics family, acquired when the batch is flushed
+    void releaseBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size);
+
+    // Reserve up to maxSize contiguous staging bytes (at least minSize), flushing/waiting if the arena is full
+    VkDeviceSize allocateStaging(VkDeviceSize maxSize, VkDeviceSize minSize, VkDeviceSize alignment, VkDeviceSize& offset);
+
+    void retireBatch(const Batch& batch);
+    void waitOldest();
+
+public:
+
+    struct Stats
+    {
+        uint64_t uploads;
+        uint64_t chunks;
+        uint64_t bytesUploaded;
+        uint64_t batchesSubmitted;
+        uint64_t stalls;
+    };
+
+    // Return singleton instance
+    static UploadManager& instance();
+
+    // Ensure singleton is never copied
+    UploadManager(UploadManager const&)     = delete;
+    void operator=(UploadManager const&)    = delete;
+
+    // Uploads run on uploadQueue and are consumed on graphicsQueue, which may be the same queue
+    void init(Queue& uploadQueue, Queue& graphicsQueue, VkDeviceSize arenaSize);
+
+    // Queue a copy of host data into a device buffer
+    void uploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+
+    // Queue a copy of tightly packed RGBA8 pixels into an image, leaving it shader-readable
+    // Mips follow one another from the largest, each half the size of the one before
+    void uploadImage(VkImage dstImage, uint32_t width, uint32_t height, const void* pixels, uint32_t levelCount = 1);
+
+    // Queue a device-side copy between buffers in the current batch
+    void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, const std::vector<VkBufferCopy>& regions);
+
+    // Submit all queued copies as one batch, returning the ticket that completes once they are visible to
+    // the graphics queue, or 0 with nothing queued
+    SyncTicket flush();
+
+    // Release staging space of every batch whose ticket has completed
+    void collect();
+
+    // Block until every submitted batch has completed
+    void waitIdle();
+
+    Stats getStats();
+
+    void cleanup();
+
+private:
+
+    Stats stats = {};
+};
\ No newline at end of file
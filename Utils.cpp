@@ -1,5 +1,11 @@
 #include "Utils.h"
 
+#include "RuntimeStats.h"
+#include "ResidencyManager.h"
+
+#include <stdexcept>
+#include <string>
+
 void Utils::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory)
 {
     VkBufferCreateInfo bufferInfo = {};
@@ -18,15 +24,7 @@ void Utils::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPr
     VkMemoryRequirements memRequirements;
     vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-    if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) 
-    {
-        throw std::runtime_error("Error: Failed to allocate vertex buffer memory");
-    }
+    bufferMemory = allocateTrackedMemory(memRequirements.size, findMemoryType(memRequirements.memoryTypeBits, properties), "buffer");
 
     vkBindBufferMemory(device, buffer, bufferMemory, 0);
 }
@@ -45,4 +43,38 @@ uint32_t Utils::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags proper
     }
 
     throw std::runtime_error("Error: Failed to find suitable memory type");
+}
+
+VkDeviceMemory Utils::allocateMemory(VkDeviceSize size, uint32_t memoryTypeIndex, const char* purpose)
+{
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+    VkDeviceMemory memory;
+
+    if (vkAllocateMemory(DeviceManager::instance().getDevice(), &allocInfo, nullptr, &memory) != VK_SUCCESS)
+    {
+        throw std::runtime_error(std::string("Error: Failed to allocate ") + purpose + " memory");
+    }
+
+    RuntimeStats::instance().add(RuntimeStats::ALLOCATIONS);
+    RuntimeStats::instance().add(RuntimeStats::ALLOCATED_BYTES, size);
+
+    return memory;
+}
+
+VkDeviceMemory Utils::allocateTrackedMemory(VkDeviceSize size, uint32_t memoryTypeIndex, const char* purpose)
+{
+    VkDeviceMemory memory = allocateMemory(size, memoryTypeIndex, purpose);
+    ResidencyManager::instance().allocated(memory, memoryTypeIndex, size);
+
+    return memory;
+}
+
+void Utils::freeTrackedMemory(VkDeviceMemory memory)
+{
+    ResidencyManager::instance().release(memory);
+    vkFreeMemory(DeviceManager::instance().getDevice(), memory, nullptr);
 }
\ No newline at end of file
@@ -17,4 +17,13 @@ public:
                              bufferMemory);
                              
     static uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+
+    // Allocate device memory counted in the runtime stats, purpose names it in the error thrown on failure
+    static VkDeviceMemory allocateMemory(VkDeviceSize size, uint32_t memoryTypeIndex, const char* purpose);
+
+    // Same, and counted against its heap's budget as a fixed allocation until freed
+    static VkDeviceMemory allocateTrackedMemory(VkDeviceSize size, uint32_t memoryTypeIndex, const char* purpose);
+
+    // Free memory from either, the residency manager ignores memory it isn't tracking
+    static void freeTrackedMemory(VkDeviceMemory memory);
 };
\ No newline at end of file
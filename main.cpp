@@ -8,7 +8,7 @@
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtx/hash.hpp>
+#include <glm/gtc/constants.hpp>
 #include <stb_image.h>
 #include <tiny_obj_loader.h>
 
@@ -18,12 +18,35 @@
 #include "SwapchainSupportDetails.h"
 #include "UniformManager.h"
 #include "DeviceManager.h"
-#include "SwapchainManager.h"
+#include "SwapchainTarget.h"
+#include "HeadlessTarget.h"
+#include "DescriptorManager.h"
+#include "UploadManager.h"
+#include "SyncManager.h"
+#include "DeletionQueue.h"
+#include "ShaderManager.h"
+#include "ShaderReflection.h"
+#include "GeometryManager.h"
+#include "AssetManager.h"
+#include "ResidencyManager.h"
+#include "ClusterManager.h"
+#include "LightManager.h"
+#include "ShadowManager.h"
+#include "RenderGraph.h"
+#include "ResolutionScaler.h"
+#include "GpuProfiler.h"
+#include "Tracer.h"
+#include "RuntimeStats.h"
+#include "Benchmark.h"
+#include "LatencyTracker.h"
+#include "Simulation.h"
+#include "CameraPath.h"
 #include "Camera.h"
 
 #include <iostream>
 #include <stdexcept>
 #include <functional>
+#include <memory>
 #include <vector>
 #include <cstring>
 #include <set>
@@ -31,11 +54,35 @@
 #include <fstream>
 #include <array>
 #include <chrono>
-#include <unordered_map>
+#include <cmath>
+#include <cstddef>
 
 const int WIDTH = 800;
 const int HEIGHT = 600;
 
+// Capacity of the shared geometry buffers
+const uint32_t MAX_GEOMETRY_VERTICES = 512 * 1024;
+const uint32_t MAX_GEOMETRY_INDICES_16 = 2 * 1024 * 1024;
+const uint32_t MAX_GEOMETRY_INDICES_32 = 1024 * 1024;
+
+// Geometry is repacked when at least this share of a pool is free but split too finely for its largest mesh,
+// checked every GEOMETRY_DEFRAGMENT_INTERVAL frames as a repack copies the pools and re-records command buffers
+const float GEOMETRY_DEFRAGMENT_FREE_SHARE = 0.25f;
+const uint32_t GEOMETRY_DEFRAGMENT_INTERVAL = 120;
+
+// Meshes with at least this many triangles are split into meshlets and culled per cluster
+const uint32_t CLUSTER_MIN_TRIANGLES = 256;
+
+// Size of the sampled image array in shaders/shader.frag, the descriptors follow the compiled SPIR-V
+const uint32_t MAX_TEXTURES = 32;
+
+// Distance between neighbouring spheres when the scene is scaled up
+const float OBJECT_SPACING = 6.0f;
+
+// Heap budget and length of --residency-sim runs without --residency-budget and --frames
+const VkDeviceSize RESIDENCY_SIM_BUDGET = 128 * 1024 * 1024;
+const uint32_t RESIDENCY_SIM_FRAMES = 2000;
+
 const std::vector<const char*> validationLayers = { "VK_LAYER_LUNARG_standard_validation" };
 
 #ifdef NDEBUG
@@ -77,18 +124,53 @@ void DestroyDebugReportCallbackEXT(
     }
 }
 
-namespace std
+// Scene size, set from the command line so benchmarks can scale the workload
+struct SceneConfig
 {
-    template<> struct hash<Vertex>
-    {
-        size_t operator()(Vertex const& vertex) const
-        {
-            return ((hash<glm::vec3>()(vertex.pos) ^ 
-                    (hash<glm::vec3>()(vertex.color) << 1)) >> 1) ^
-                    (hash<glm::vec2>()(vertex.texCoord) << 1);
-        }
-    };
-}
+    // Spheres on a grid centred on the origin, the first one in the middle
+    uint32_t objectCount = 1;
+
+    // The two textures loaded from disk plus generated ones
+    uint32_t textureCount = 2;
+
+    // Segments around a generated UV sphere, 0 loads models/sphere.obj
+    uint32_t meshDetail = 0;
+};
+
+// Fragment shading, specialization constants plus the light count compiled into a permutation
+struct ShadingConfig
+{
+    bool useTexture = true;
+    bool useSpecular = true;
+    float lightPower = 80.0f;
+    float shininess = 32.0f;
+
+    // LIGHT_COUNT in shaders/shader.frag, other counts compile a permutation
+    uint32_t lightCount = 1;
+
+    // Animated point lights shaded through the cluster grid, 0 leaves clustered lighting out of the shader
+    uint32_t clusteredLights = 0;
+
+    // Bin lights on the CPU even where the compute shader compiles
+    bool cpuLightBinning = false;
+
+    // Cascaded shadows from a directional light, with the far cascades' static casters cached
+    bool shadows = false;
+    bool shadowCache = true;
+    uint32_t shadowResolution = 2048;
+
+    // Requested samples per pixel, lowered to the highest count colour and depth attachments both support
+    uint32_t msaaSamples = 1;
+};
+
+// Specialization data of the fragment shader, constant ids as declared in shaders/shader.frag
+struct FragmentSpecialization
+{
+    VkBool32 useTexture;
+    VkBool32 useSpecular;
+    float lightPower;
+    float shininess;
+};
 
 // class DeviceManager;
 
@@ -96,8 +178,77 @@ class VulkanApplication
 {
 public:
 
+    // Takes ownership of the target frames are rendered to, and of the benchmark if one is given
+    VulkanApplication(PresentationTarget* target, const SceneConfig& scene, Benchmark* benchmark)
+        : target(target), scene(scene), benchmark(benchmark)
+    {
+    }
+
+    // Optional vertex/fragment invocation counts, and a file the GPU profile is written to on exit
+    void setProfilerOptions(bool pipelineStatistics, const std::string& outputPath)
+    {
+        this->pipelineStatistics = pipelineStatistics;
+        profileOutputPath = outputPath;
+    }
+
+    // Chrome trace written on exit, only recorded in builds with ENABLE_TRACING
+    void setTraceOutput(const std::string& outputPath)
+    {
+        traceOutputPath = outputPath;
+    }
+
+    void setStatsOverlay(bool enabled)
+    {
+        statsOverlay = enabled;
+    }
+
+    // Pooled fences instead of timeline semaphores even where the device has them
+    void setSyncFences(bool enabled)
+    {
+        syncFences = enabled;
+    }
+
+    // Recompile and swap in the pipeline when the GLSL sources in shaders/ are edited
+    void setHotReload(bool enabled)
+    {
+        hotReload = enabled;
+    }
+
+    void setShading(const ShadingConfig& shading)
+    {
+        this->shading = shading;
+    }
+
+    // Render at a scale of the target extent that follows the GPU frame time, and upscale into the target
+    void setDynamicResolution(const ResolutionScaler::Config& config)
+    {
+        resolutionScaler.reset(new ResolutionScaler(config));
+    }
+
+    // Step animation and the camera at a fixed rate on a thread of their own, frames draw the latest steps
+    void setSimulation(double rate)
+    {
+        simulationRate = rate;
+    }
+
+    // Text file of mesh (.obj) and texture paths, one per line, loaded once the first frames are under way
+    void setAssetManifest(const std::string& path)
+    {
+        assetManifestPath = path;
+    }
+
+    // Device-local memory loaded assets are kept within, 0 for the driver's budget or a share of the heap
+    void setResidencyBudget(VkDeviceSize bytes)
+    {
+        residencyBudget = bytes;
+    }
+
     void run()
     {
+        TRACE_THREAD_NAME("Main");
+
+        runStartTime = std::chrono::high_resolution_clock::now();
+
         initWindow();
         initVulkan();
 
@@ -109,14 +260,19 @@ public:
 
 private:
 
-    GLFWwindow* window;
+    // Window/swapchain or headless images
+    std::unique_ptr<PresentationTarget> target;
+
+    SceneConfig scene;
+
+    // Scripted fixed-timestep run replacing camera input, null when interactive
+    std::unique_ptr<Benchmark> benchmark;
+    CameraPath cameraPath;
+
     VkInstance instance;
 
     VkDebugReportCallbackEXT callback;
 
-    // Window surface
-    VkSurfaceKHR surface;
-
     // Device queues
     VkQueue graphicsQueue;
     VkQueue presentQueue;
@@ -141,104 +297,344 @@ private:
     VkSemaphore imageAvailableSemaphore;
     VkSemaphore renderFinishedSemaphore;
 
-    // Vertex/index buffer & buffer memory
-    VkBuffer vertexBuffer;
-    VkDeviceMemory vertexBufferMemory;
-    VkBuffer indexBuffer;
-    VkDeviceMemory indexBufferMemory;
-    std::vector<Vertex> vertices;
-    std::vector<uint32_t> indices;
-
-    // Descriptor pool/set
-    VkDescriptorPool descriptorPool;
+    // Descriptor set
     VkDescriptorSet descriptorSet;
 
-    // Textures
-    VkImage mainTextureImage;
-    VkDeviceMemory mainTextureImageMemory;
-    VkImage groundTextureImage;
-    VkDeviceMemory groundTextureImageMemory;
+    // Textures - 0 and 1 are loaded from disk and owned by their assets, any others are generated
+    std::vector<VkImage> textureImages;
+    std::vector<VkDeviceMemory> textureImageMemory;
+    std::vector<AssetManager::Handle> textureAssets;
+
+    // Loaded in parallel with the textures, the sphere only without a generated one
+    AssetManager::Handle sphereAsset;
+    AssetManager::Handle planeAsset;
+
+    // Streamed in while frames render, the continuation of each counts it off
+    std::string assetManifestPath;
+    std::vector<AssetManager::Handle> manifestAssets;
+    uint32_t manifestPending = 0;
+    uint32_t manifestFailed = 0;
+    std::chrono::high_resolution_clock::time_point manifestStartTime;
+    double manifestLoadMs = -1.0;
+
+    VkDeviceSize residencyBudget = 0;
+
+    // From run() to the end of the first drawFrame
+    std::chrono::high_resolution_clock::time_point runStartTime;
+    double firstFrameMs = -1.0;
 
     // Texture image views + sampler
-    VkImageView mainTextureImageView;
-    VkImageView groundTextureImageView;
+    std::vector<VkImageView> textureImageViews;
     VkSampler textureSampler;
 
-    // Depth buffering
-    VkImage depthImage;
-    VkDeviceMemory depthImageMemory;
-    VkImageView depthImageView;
+    // GPU timing queries, one slot per command buffer
+    std::vector<ProfilerSlot> profilerSlots;
+    double lastGpuFrameTime = -1.0;
+    double lastGpuShadowTime = -1.0;
+
+    // Commands recorded into each command buffer, counted every time it is submitted
+    std::vector<RuntimeStats::CommandCounts> commandCounts;
+
+    bool pipelineStatistics = false;
+    std::string profileOutputPath;
+
+    std::string traceOutputPath;
+
+    // Summary of the runtime stats in the window title
+    bool statsOverlay = false;
+    std::string windowTitle;
+
+    // Timeline semaphores and the memory budget need VK_KHR_get_physical_device_properties2 on the instance,
+    // device UUIDs VK_KHR_external_memory_capabilities as well
+    bool syncFences = false;
+    bool deviceProperties2 = false;
+    bool externalMemoryCapabilities = false;
+
+    // Ticket of the last submission that used each command buffer, and of the last frame
+    std::vector<SyncTicket> frameTickets;
+    SyncTicket lastFrameTicket = 0;
+    uint32_t lastFrameImage = 0;
+
+    bool hotReload = false;
+
+    ShadingConfig shading;
+
+    // Descriptor bindings and push constants of the shaders, the pipeline layout is built from it
+    ShaderReflection shaderLayout;
+
+    // Set when the pipeline was swapped, each command buffer is re-recorded once it is next free
+    std::vector<bool> commandBuffersStale;
+
+    // Passes of a frame, the graph owns the depth buffer
+    RenderGraph renderGraph;
+    RenderGraph::Resource depthBuffer;
+
+    // Multisampled colour buffer resolved into the target image, NONE at one sample
+    RenderGraph::Resource multisampleBuffer = RenderGraph::NONE;
+    VkSampleCountFlagBits sampleCount = VK_SAMPLE_COUNT_1_BIT;
+
+    // Set by the M key, applied between frames
+    uint32_t requestedSamples = 0;
+
+    // Null when rendering straight into the target images
+    std::unique_ptr<ResolutionScaler> resolutionScaler;
+
+    // Sized for the largest scale, the main pass renders into its top-left renderExtent
+    RenderGraph::Resource sceneColour = RenderGraph::NONE;
+    VkFramebuffer sceneFramebuffer = VK_NULL_HANDLE;
+    VkExtent2D renderExtent;
+
+    // Input of each frame timed through to its display
+    LatencyTracker latencyTracker;
+    uint32_t latencyFrame = 0;
+
+    // Low-latency presentation acquires, and waits for, the image before input is sampled
+    bool framePacing = false;
+    bool imageAcquired = false;
+    uint32_t acquiredImage = 0;
+
+    // Null when each frame animates the scene itself
+    std::unique_ptr<Simulation> simulation;
+    double simulationRate = 0.0;
+
+    // Interpolated from the simulation's snapshot, its models swap with objectModels
+    Simulation::State simulationFrame;
 
     std::chrono::high_resolution_clock::time_point prevFrameTime;
     std::chrono::high_resolution_clock::time_point currentFrameTime;
 
+    uint32_t framesSinceDefragmentCheck = 0;
+
+    struct Mesh
+    {
+        MeshHandle handle;
+
+        // Furthest vertex from the mesh origin
+        float radius;
+
+        bool clustered;
+        ClusterMeshHandle clusterMesh;
+    };
+
     struct Object
     {
-        uint32_t firstIndex;
-        uint32_t indexCount;
+        MeshHandle mesh;
+
+        // Drawn indirectly from the per-frame culled index stream
+        bool clustered;
+        ClusterHandle cluster;
+
+        // Index into the shader's texture array, passed as a push constant
+        int texture;
+
+        glm::vec3 position;
+        float scale;
+
+        // Bounding sphere radius about the position
+        float radius;
+
+        // Spins about the Y axis over time
+        bool animated;
     };
 
     std::vector<Object> objects;
 
+    // Transforms of the current frame, written before the uniform update and reused for cluster culling
+    std::vector<glm::mat4> objectModels;
+    glm::mat4 viewMatrix;
+    glm::mat4 projMatrix;
+
     Camera camera; 
 
     void initWindow()
     {
-        // Initialise glfw
-        glfwInit();
-
-        // Set window properties
-        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-        glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
+        target->init();
 
-        // Create GLFWwindow
-        window = glfwCreateWindow(WIDTH, HEIGHT, "Vulkan", nullptr, nullptr);
+        // Headless targets have no window to resize
+        GLFWwindow* window = target->getWindow();
 
-        glfwSetWindowUserPointer(window, this);
-        glfwSetWindowSizeCallback(window, VulkanApplication::onWindowResized);
+        if (window != nullptr)
+        {
+            glfwSetWindowUserPointer(window, this);
+            glfwSetWindowSizeCallback(window, VulkanApplication::onWindowResized);
+            glfwSetKeyCallback(window, VulkanApplication::onKey);
+        }
     }
 
     void initVulkan()
     {
+        TRACE_ZONE("initVulkan");
+
         createInstance();
         setupDebugCallback();
-        createSurface();
+        target->createSurface(instance);
 
         // camera = new Camera(window);
 
+        VkSurfaceKHR surface = target->getSurface();
+
+        DeviceManager::instance().allowTimelineSemaphores(deviceProperties2 && !syncFences);
+        DeviceManager::instance().allowMemoryBudget(deviceProperties2);
+        DeviceManager::instance().allowDeviceUuid(deviceProperties2 && externalMemoryCapabilities);
         DeviceManager::instance().pickPhysicalDevice(instance, surface);
         DeviceManager::instance().createLogicalDevice(surface, graphicsQueue, presentQueue, enableValidationLayers, validationLayers);
 
-        SwapchainManager::instance().createSwapchain(surface, window);
-        SwapchainManager::instance().createImageViews();
+        // Before anything allocates, so every allocation is counted
+        ResidencyManager::instance().init(instance, residencyBudget);
+
+        target->setQueues(graphicsQueue, presentQueue);
+        target->createImages();
+
+        if (target->getWindow() != nullptr)
+        {
+            framePacing = SwapchainManager::instance().getPresentPolicy() == SwapchainManager::PRESENT_LOW_LATENCY;
+
+            std::cout << "Swapchain: " << SwapchainManager::getPresentModeName(SwapchainManager::instance().getPresentMode()) << ", "
+                      << target->getImageCount() << " images" << (framePacing ? ", paced" : "") << std::endl;
+        }
+
+        if (resolutionScaler && !supportsUpscale())
+        {
+            std::cout << "Dynamic resolution: target format can't be blitted with linear filtering, disabled" << std::endl;
+            resolutionScaler.reset();
+        }
+
+        updateRenderExtent();
+
+        DescriptorManager::instance().init();
+
+        // Offline-compiled SPIR-V, in the order the pipeline builder expects
+        ShaderManager::instance().init("shaders");
+        ShaderManager::instance().addShader("shader.vert", "vert.spv");
+        // No offline SPIR-V, the fragment shader is always compiled from its source so the specialization constants
+        // and texture array it declares are the ones the pipeline is built for
+        ShaderManager::instance().addShader("shader.frag", "", getFragmentDefines());
+
+        sampleCount = chooseSampleCount(shading.msaaSamples);
+        std::cout << "MSAA: " << sampleCount << "x" << std::endl;
         
         createRenderPass();
         createDescriptorSetLayout();
+
+        auto pipelineStartTime = std::chrono::high_resolution_clock::now();
+
         createGraphicsPipeline();
+
+        double pipelineMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - pipelineStartTime).count();
+        std::cout << "Graphics pipeline built in " << pipelineMs << " ms" << std::endl;
+        ShaderManager::instance().printPermutationStats();
+
         createCommandPool();
-        createDepthResources();
 
-        SwapchainManager::instance().createFramebuffers(depthImageView, renderPass);
-        
-        createTextureImage("textures/texture.jpg", mainTextureImage, mainTextureImageMemory);
-        createTextureImageView(mainTextureImage, mainTextureImageView);
-        createTextureImage("textures/ground.png", groundTextureImage, groundTextureImageMemory);
-        createTextureImageView(groundTextureImage, groundTextureImageView);
-        createTextureSampler();
+        QueueFamilyIndices queueFamilyIndices = QueueFamilyIndices::findQueueFamilies(DeviceManager::instance().getPhysicalDevice(), surface);
+        GpuProfiler::instance().init(queueFamilyIndices.graphicsFamily, pipelineStatistics);
+        // Streaming uploads use the transfer queue, so they overlap rendering where the device has one
+        UploadManager::instance().init(DeviceManager::instance().getTransferQueue(), DeviceManager::instance().getGraphicsQueue(), 32 * 1024 * 1024);
+
+        GeometryManager::instance().init(MAX_GEOMETRY_VERTICES, MAX_GEOMETRY_INDICES_16, MAX_GEOMETRY_INDICES_32);
+        ClusterManager::instance().init(target->getImageCount());
+
+        auto uploadStartTime = std::chrono::high_resolution_clock::now();
+
+        AssetManager::instance().init();
+        loadSceneAssets();
+
+        {
+            TRACE_ZONE("createTextures");
+
+            createTextures();
+            createTextureSampler();
+        }
+
+        {
+            TRACE_ZONE("createScene");
+
+            createScene();
+        }
 
-        loadModel("models/sphere.obj");
-        loadModel("models/plane.obj");
+        // Every cluster instance is known now, so the culled index streams can be sized
+        ClusterManager::instance().createStreams();
 
-        createVertexBuffer();
-        createIndexBuffer();
+        // Submit every startup transfer as a single batch
+        UploadManager::instance().flush();
+        printUploadStats(uploadStartTime);
+        printIndexStats();
 
         UniformManager::instance().createUniformBuffer();
         UniformManager::instance().createDynamicUniformBuffer(dynamicAlignment, objects.size());
 
-        createDescriptorPool();
+        if (shading.clusteredLights > 0)
+        {
+            createLights();
+        }
+
+        if (shading.shadows)
+        {
+            createShadows();
+        }
+
+        createRenderGraph();
+        renderGraph.printPlan();
+
+        createFramebuffers();
+
         createDescriptorSet(descriptorSet);
         createCommandBuffers();
         createSemaphores();
+
+        if (benchmark)
+        {
+            initBenchmark();
+        }
+
+        if (hotReload)
+        {
+            ShaderManager::instance().startWatching();
+        }
+    }
+
+    void initBenchmark()
+    {
+        const Benchmark::Config& config = benchmark->getConfig();
+
+        // One pass of the camera path over the whole run, warmup included
+        cameraPath = CameraPath::fromName(config.cameraPath, (config.warmupFrames + config.frames) * config.timestep);
+
+        uint32_t triangleCount = 0;
+
+        for (const Object& object : objects)
+        {
+            triangleCount += GeometryManager::instance().getMeshRange(object.mesh).indexCount / 3;
+        }
+
+        VkExtent2D extent = target->getExtent();
+
+        benchmark->setDeviceName(DeviceManager::instance().getProperties().deviceName);
+        benchmark->addSceneInfo("objects", objects.size());
+        benchmark->addSceneInfo("textures", textureImages.size());
+        benchmark->addSceneInfo("mesh_detail", scene.meshDetail);
+        benchmark->addSceneInfo("triangles", triangleCount);
+        benchmark->addSceneInfo("width", extent.width);
+        benchmark->addSceneInfo("height", extent.height);
+        benchmark->addSceneInfo("headless", target->getWindow() == nullptr ? 1 : 0);
+        benchmark->addSceneInfo("clustered_lights", shading.clusteredLights);
+        benchmark->addSceneInfo("compute_light_binning", shading.clusteredLights > 0 && LightManager::instance().usesComputeBinning() ? 1 : 0);
+        benchmark->addSceneInfo("shadows", shading.shadows ? 1 : 0);
+        benchmark->addSceneInfo("shadow_cache", shading.shadows && shading.shadowCache ? 1 : 0);
+        benchmark->addSceneInfo("shadow_resolution", shading.shadows ? shading.shadowResolution : 0);
+        benchmark->addSceneInfo("msaa_samples", sampleCount);
+        benchmark->addSceneInfo("dynamic_resolution", resolutionScaler ? 1 : 0);
+        benchmark->addSceneInfo("frame_budget_ms", resolutionScaler ? resolutionScaler->getConfig().budgetMs : 0.0);
+        // VkPresentModeKHR value, -1 when headless
+        benchmark->addSceneInfo("present_mode", target->getWindow() != nullptr ? SwapchainManager::instance().getPresentMode() : -1);
+        benchmark->addSceneInfo("swapchain_images", target->getImageCount());
+        // Steps per second of the simulation thread, 0 for the single-threaded loop
+        benchmark->addSceneInfo("simulation_rate", simulationRate);
+
+        if (!GpuProfiler::instance().isEnabled())
+        {
+            std::cout << "Benchmark: device has no graphics queue timestamps, GPU times not recorded" << std::endl;
+        }
     }
 
     void setupDebugCallback()
@@ -258,36 +654,177 @@ private:
         }
     }
 
-    // Create window surface using GLFW
-    void createSurface()
-    {
-        if (glfwCreateWindowSurface(instance, window, nullptr, &surface) != VK_SUCCESS)
-        {
-            throw std::runtime_error("Error: Failed to create window surface");
-        }
-    }
-
     // Recreate swap chain for window resizing
     void recreateSwapChain()
     {
         int width, height;
-        glfwGetWindowSize(window, &width, &height);
+        glfwGetWindowSize(target->getWindow(), &width, &height);
         
         if (width == 0 || height == 0) return;
-        
-        vkDeviceWaitIdle(DeviceManager::instance().getDevice());
+
+        // No device idle - the old swapchain resources are released once the frames using them complete
+        RuntimeStats::instance().add(RuntimeStats::SWAPCHAIN_RECREATIONS);
+
+        // An image acquired ahead of input goes with the old swapchain. Its acquire was waited for, so the
+        // signalled semaphore can be replaced straight away
+        if (imageAcquired)
+        {
+            VkSemaphoreCreateInfo semaphoreInfo = {};
+            semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+            vkDestroySemaphore(DeviceManager::instance().getDevice(), imageAvailableSemaphore, nullptr);
+
+            if (vkCreateSemaphore(DeviceManager::instance().getDevice(), &semaphoreInfo, nullptr, &imageAvailableSemaphore) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Error: Failed to create semaphores");
+            }
+
+            imageAcquired = false;
+        }
 
         cleanupSwapChain();
 
-        SwapchainManager::instance().createSwapchain(surface, window);
-        SwapchainManager::instance().createImageViews();
+        target->createImages();
+        updateRenderExtent();
 
         createRenderPass();
         createGraphicsPipeline();
-        createDepthResources();
+        createRenderGraph();
+
+        createFramebuffers();
+
+        createCommandBuffers();
+    }
+
+    void createFramebuffers()
+    {
+        VkImageView multisampleView = multisampleBuffer != RenderGraph::NONE ? renderGraph.getImageView(multisampleBuffer) : VK_NULL_HANDLE;
+
+        if (!resolutionScaler)
+        {
+            target->createFramebuffers(renderGraph.getImageView(depthBuffer), multisampleView, renderPass);
+            return;
+        }
+
+        // Every target image is written by the upscale, so a single framebuffer serves them all
+        std::vector<VkImageView> attachments = { renderGraph.getImageView(sceneColour), renderGraph.getImageView(depthBuffer) };
+
+        if (multisampleView != VK_NULL_HANDLE)
+        {
+            attachments.push_back(multisampleView);
+        }
+
+        VkExtent2D extent = resolutionScaler->getMaxExtent();
+
+        VkFramebufferCreateInfo framebufferInfo = {};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass = renderPass;
+        framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        framebufferInfo.pAttachments = attachments.data();
+        framebufferInfo.width = extent.width;
+        framebufferInfo.height = extent.height;
+        framebufferInfo.layers = 1;
 
-        SwapchainManager::instance().createFramebuffers(depthImageView, renderPass);
+        if (vkCreateFramebuffer(DeviceManager::instance().getDevice(), &framebufferInfo, nullptr, &sceneFramebuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Error: Failed to create framebuffer");
+        }
+    }
+
+    void destroyFramebuffers(SyncTicket lastUse)
+    {
+        target->destroyFramebuffers();
+
+        if (sceneFramebuffer != VK_NULL_HANDLE)
+        {
+            DeletionQueue::instance().destroyFramebuffer(lastUse, sceneFramebuffer);
+            sceneFramebuffer = VK_NULL_HANDLE;
+        }
+    }
+
+    // Upscaling blits between images of the target's format with linear filtering
+    bool supportsUpscale()
+    {
+        VkFormatProperties props;
+        vkGetPhysicalDeviceFormatProperties(DeviceManager::instance().getPhysicalDevice(), target->getImageFormat(), &props);
+
+        VkFormatFeatureFlags features = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+
+        return (props.optimalTilingFeatures & features) == features;
+    }
+
+    // Scaled images are sized from the target extent, which changes with the swapchain
+    void updateRenderExtent()
+    {
+        if (resolutionScaler)
+        {
+            resolutionScaler->setTargetExtent(target->getExtent());
+            renderExtent = resolutionScaler->getRenderExtent();
+        }
+        else
+        {
+            renderExtent = target->getExtent();
+        }
+    }
+
+    // Follow the last GPU frame time, each command buffer is re-recorded at a new extent once it is next free
+    void updateRenderScale()
+    {
+        if (resolutionScaler->update(lastGpuFrameTime))
+        {
+            renderExtent = resolutionScaler->getRenderExtent();
+            commandBuffersStale.assign(commandBuffers.size(), true);
+        }
+    }
+
+    // Highest count up to the requested one that colour and depth attachments both support
+    VkSampleCountFlagBits chooseSampleCount(uint32_t requested)
+    {
+        VkPhysicalDeviceLimits limits = DeviceManager::instance().getProperties().limits;
+        VkSampleCountFlags supported = limits.framebufferColorSampleCounts & limits.framebufferDepthSampleCounts;
+
+        VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+
+        for (uint32_t count = VK_SAMPLE_COUNT_2_BIT; count <= VK_SAMPLE_COUNT_64_BIT && count <= requested; count <<= 1)
+        {
+            if (supported & count)
+            {
+                samples = static_cast<VkSampleCountFlagBits>(count);
+            }
+        }
+
+        return samples;
+    }
+
+    // Only the passes, pipeline and attachments depend on the sample count, the target images and everything
+    // else are kept. No device idle, the old objects are released once the frames using them complete
+    void applySampleCount()
+    {
+        VkSampleCountFlagBits samples = chooseSampleCount(requestedSamples);
+        requestedSamples = 0;
+
+        if (samples == sampleCount)
+        {
+            return;
+        }
+
+        sampleCount = samples;
+        std::cout << "MSAA: " << sampleCount << "x" << std::endl;
 
+        SyncTicket lastUse = SyncManager::instance().getLastTicket();
+
+        destroyFramebuffers(lastUse);
+        renderGraph.cleanup(lastUse);
+
+        DeletionQueue::instance().freeCommandBuffers(lastUse, commandPool, commandBuffers);
+        DeletionQueue::instance().destroyPipeline(lastUse, graphicsPipeline);
+        DeletionQueue::instance().destroyPipelineLayout(lastUse, pipelineLayout);
+        DeletionQueue::instance().destroyRenderPass(lastUse, renderPass);
+
+        createRenderPass();
+        createGraphicsPipeline();
+        createRenderGraph();
+        createFramebuffers();
         createCommandBuffers();
     }
 
@@ -295,14 +832,16 @@ private:
     {
         // Colour buffer attachment info
         VkAttachmentDescription colorAttachment = {};
-        colorAttachment.format = SwapchainManager::instance().getImageFormat();
+        colorAttachment.format = target->getImageFormat();
         colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        // When multisampling, the target image is only written by the resolve
+        colorAttachment.loadOp = sampleCount == VK_SAMPLE_COUNT_1_BIT ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
         colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        // The render graph moves the attachments in and out of these layouts, with the barriers around the pass
+        colorAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
         // Reference to colour attachment
         VkAttachmentReference colorAttachmentRef = {};
@@ -311,12 +850,12 @@ private:
 
         VkAttachmentDescription depthAttachment = {};
         depthAttachment.format = findDepthFormat();
-        depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        depthAttachment.samples = sampleCount;
         depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
         depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
         depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
         VkAttachmentReference depthAttachmentRef = {};
@@ -329,24 +868,32 @@ private:
         subpass.pColorAttachments = &colorAttachmentRef;
         subpass.pDepthStencilAttachment = &depthAttachmentRef;
 
-        VkSubpassDependency dependency = {};
-        dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-        dependency.dstSubpass = 0;
-        dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-        dependency.srcAccessMask = 0;
-        dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-        dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        std::vector<VkAttachmentDescription> attachments = { colorAttachment, depthAttachment };
+
+        // Samples are cleared, drawn and resolved into the target image without leaving tile memory
+        VkAttachmentReference resolveAttachmentRef = {};
+
+        if (sampleCount != VK_SAMPLE_COUNT_1_BIT)
+        {
+            VkAttachmentDescription multisampleAttachment = colorAttachment;
+            multisampleAttachment.samples = sampleCount;
+            multisampleAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+            multisampleAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            attachments.push_back(multisampleAttachment);
+
+            colorAttachmentRef.attachment = 2;
 
-        std::array<VkAttachmentDescription, 2> attachments = { colorAttachment, depthAttachment };
+            resolveAttachmentRef.attachment = 0;
+            resolveAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+            subpass.pResolveAttachments = &resolveAttachmentRef;
+        }
 
         VkRenderPassCreateInfo renderPassInfo = {};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-        renderPassInfo.attachmentCount = attachments.size();
+        renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
         renderPassInfo.pAttachments = attachments.data();
         renderPassInfo.subpassCount = 1;
         renderPassInfo.pSubpasses = &subpass;
-        renderPassInfo.dependencyCount = 1;
-        renderPassInfo.pDependencies = &dependency;
 
         if (vkCreateRenderPass(DeviceManager::instance().getDevice(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) 
         {
@@ -354,55 +901,117 @@ private:
         }
     }
 
-    void createDescriptorSetLayout()
+    // Preprocessor defines of the fragment shader permutation, none for the offline SPIR-V
+    ShaderManager::ShaderDefines getFragmentDefines()
     {
-        VkDescriptorSetLayoutBinding staticUboLayoutBinding = {};
-        staticUboLayoutBinding.binding = 0;
-        staticUboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
-        staticUboLayoutBinding.descriptorCount = 1;
-        staticUboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-        staticUboLayoutBinding.pImmutableSamplers = nullptr;
-
-        VkDescriptorSetLayoutBinding dynamicUboLayoutBinding = {};
-        dynamicUboLayoutBinding.binding = 1;
-        dynamicUboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        dynamicUboLayoutBinding.descriptorCount = 1;
-        dynamicUboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-        dynamicUboLayoutBinding.pImmutableSamplers = nullptr;
+        ShaderManager::ShaderDefines defines;
 
-        VkDescriptorSetLayoutBinding samplerLayoutBinding = {};
-        samplerLayoutBinding.binding = 2;
-        samplerLayoutBinding.descriptorCount = 1;
-        samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
-        samplerLayoutBinding.pImmutableSamplers = nullptr;
-        samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-        VkDescriptorSetLayoutBinding textureLayoutBinding = {};
-        textureLayoutBinding.binding = 3;
-        textureLayoutBinding.descriptorCount = 2; // number of textures
-        textureLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-        textureLayoutBinding.pImmutableSamplers = nullptr;
-        textureLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+        if (shading.clusteredLights > 0)
+        {
+            defines = LightManager::getGridDefines();
+            defines["CLUSTERED_LIGHTING"] = "1";
+        }
 
-        std::array<VkDescriptorSetLayoutBinding, 4> bindings = { staticUboLayoutBinding, dynamicUboLayoutBinding, samplerLayoutBinding, textureLayoutBinding};
-        VkDescriptorSetLayoutCreateInfo layoutInfo = {};
-        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-        layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
-        layoutInfo.pBindings = bindings.data();
+        if (shading.shadows)
+        {
+            ShaderManager::ShaderDefines shadowDefines = ShadowManager::getShaderDefines();
+            defines.insert(shadowDefines.begin(), shadowDefines.end());
+        }
 
-        if (vkCreateDescriptorSetLayout(DeviceManager::instance().getDevice(), &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) 
+        if (shading.lightCount != 1)
         {
-            throw std::runtime_error("Error: Failed to create descriptor set layout");
+            defines["LIGHT_COUNT"] = std::to_string(shading.lightCount);
         }
+
+        return defines;
     }
 
-    void createGraphicsPipeline()
+    FragmentSpecialization getFragmentSpecialization()
     {
-        // Read in vertex and fragment shader bytecode
-        auto vertShaderCode = readFile("shaders/vert.spv");
-        auto fragShaderCode = readFile("shaders/frag.spv");
+        FragmentSpecialization specialization = {};
+        specialization.useTexture = shading.useTexture ? VK_TRUE : VK_FALSE;
+        specialization.useSpecular = shading.useSpecular ? VK_TRUE : VK_FALSE;
+        specialization.lightPower = shading.lightPower;
+        specialization.shininess = shading.shininess;
 
-        // Use shader bytecode to create shader modules
+        return specialization;
+    }
+
+    // Resource interface of the vertex and fragment shaders together
+    static ShaderReflection reflectShaders(const std::vector<std::vector<char>>& code)
+    {
+        ShaderReflection reflection = ShaderReflection::reflect(code[0]);
+        reflection.merge(ShaderReflection::reflect(code[1]));
+
+        // Per-object uniforms are bound at dynamic offsets, which SPIR-V can't express
+        reflection.setDynamic(0, 0);
+
+        return reflection;
+    }
+
+    void createDescriptorSetLayout()
+    {
+        shaderLayout = reflectShaders(ShaderManager::instance().getAllCode());
+
+        std::cout << "Shader resources:" << std::endl << shaderLayout.describe();
+
+        if (scene.textureCount > shaderLayout.getDescriptorCount(0, 3))
+        {
+            throw std::runtime_error("Error: Fragment shader samples fewer textures than the scene uses, recompile shaders/shader.frag");
+        }
+
+        std::vector<VkDescriptorSetLayoutBinding> bindings = shaderLayout.getLayoutBindings(0);
+
+        // Layouts are owned and deduplicated by the descriptor manager
+        descriptorSetLayout = DescriptorManager::instance().getLayout(bindings.data(), static_cast<uint32_t>(bindings.size()));
+    }
+
+    void createGraphicsPipeline()
+    {
+        std::vector<VkPushConstantRange> pushConstantRanges = shaderLayout.getPushConstantRanges();
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+        pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
+
+        if (vkCreatePipelineLayout(DeviceManager::instance().getDevice(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) 
+        {
+            throw std::runtime_error("Error: Failed to create pipeline layout");
+        }
+
+        FragmentSpecialization specialization = getFragmentSpecialization();
+
+        // Vertex and fragment shader bytecode, as last compiled
+        graphicsPipeline = buildGraphicsPipeline(ShaderManager::instance().getAllCode(), specialization, renderPass, pipelineLayout, sampleCount);
+
+        // Shader edits are rebuilt against the same state on the reload thread, so capture it by value
+        VkRenderPass pass = renderPass;
+        VkPipelineLayout layout = pipelineLayout;
+        VkSampleCountFlagBits samples = sampleCount;
+        ShaderReflection expectedLayout = shaderLayout;
+
+        ShaderManager::instance().setPipelineBuilder([specialization, pass, layout, samples, expectedLayout](const std::vector<std::vector<char>>& code)
+        {
+            // The descriptor set layout is shared with live descriptor sets, so it can't follow an edit
+            if (!reflectShaders(code).matches(expectedLayout))
+            {
+                throw std::runtime_error("Error: Shader resources changed, restart to apply");
+            }
+
+            return buildGraphicsPipeline(code, specialization, pass, layout, samples);
+        });
+    }
+
+    // Only uses its arguments, so shader reloads can call it from another thread
+    static VkPipeline buildGraphicsPipeline(const std::vector<std::vector<char>>& code, const FragmentSpecialization& specialization, VkRenderPass renderPass, VkPipelineLayout pipelineLayout, VkSampleCountFlagBits samples)
+    {
+        const std::vector<char>& vertShaderCode = code[0];
+        const std::vector<char>& fragShaderCode = code[1];
+
+        // Use shader bytecode to create shader modules
         VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
         VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
 
@@ -420,6 +1029,38 @@ private:
         fragShaderStageInfo.module = fragShaderModule;
         fragShaderStageInfo.pName = "main";
 
+        std::array<VkSpecializationMapEntry, 4> specializationEntries = {};
+        specializationEntries[0] = { 0, offsetof(FragmentSpecialization, useTexture), sizeof(VkBool32) };
+        specializationEntries[1] = { 1, offsetof(FragmentSpecialization, useSpecular), sizeof(VkBool32) };
+        specializationEntries[2] = { 2, offsetof(FragmentSpecialization, lightPower), sizeof(float) };
+        specializationEntries[3] = { 3, offsetof(FragmentSpecialization, shininess), sizeof(float) };
+
+        // Drivers ignore constant ids a module doesn't declare, which would drop the shading options silently
+        std::vector<ShaderReflection::SpecializationConstant> fragConstants = ShaderReflection::reflect(fragShaderCode).specializationConstants;
+
+        for (const VkSpecializationMapEntry& entry : specializationEntries)
+        {
+            bool declared = false;
+
+            for (const ShaderReflection::SpecializationConstant& constant : fragConstants)
+            {
+                declared = declared || constant.id == entry.constantID;
+            }
+
+            if (!declared)
+            {
+                throw std::runtime_error("Error: Fragment shader declares no specialization constant " + std::to_string(entry.constantID) + ", recompile shaders/shader.frag");
+            }
+        }
+
+        VkSpecializationInfo specializationInfo = {};
+        specializationInfo.mapEntryCount = static_cast<uint32_t>(specializationEntries.size());
+        specializationInfo.pMapEntries = specializationEntries.data();
+        specializationInfo.dataSize = sizeof(FragmentSpecialization);
+        specializationInfo.pData = &specialization;
+
+        fragShaderStageInfo.pSpecializationInfo = &specializationInfo;
+
         // Create array to hold vertex & fragment shader module stage info
         VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
 
@@ -440,29 +1081,11 @@ private:
         inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
         inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-        VkExtent2D swapchainExtent = SwapchainManager::instance().getExtent();
-
-        // Viewport settings
-        VkViewport viewport = {};
-        viewport.x = 0.0f;
-        viewport.y = 0.0f;
-        viewport.width = (float) swapchainExtent.width;
-        viewport.height = (float) swapchainExtent.height;
-        viewport.minDepth = 0.0f;
-        viewport.maxDepth = 1.0f;
-
-        // Viewport scissor for rasteriser pixel discarding, set up to cover entire framebuffer
-        VkRect2D scissor = {};
-        scissor.offset = {0, 0};
-        scissor.extent = swapchainExtent;
-
-        // Use viewport and scissor to set up viewport state
+        // Viewport and scissor are set when recording, so the render extent can change without a rebuild
         VkPipelineViewportStateCreateInfo viewportState = {};
         viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
         viewportState.viewportCount = 1;
-        viewportState.pViewports = &viewport;
         viewportState.scissorCount = 1;
-        viewportState.pScissors = &scissor;
 
         // Rasteriser settings
         VkPipelineRasterizationStateCreateInfo rasterizer = {};
@@ -482,7 +1105,7 @@ private:
         VkPipelineMultisampleStateCreateInfo multisampling = {};
         multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
         multisampling.sampleShadingEnable = VK_FALSE;
-        multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+        multisampling.rasterizationSamples = samples;
         multisampling.minSampleShading = 1.0f;
         multisampling.pSampleMask = nullptr;
         multisampling.alphaToCoverageEnable = VK_FALSE;
@@ -510,7 +1133,7 @@ private:
         colorBlending.blendConstants[2] = 0.0f;
         colorBlending.blendConstants[3] = 0.0f;
 
-        VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_LINE_WIDTH };
+        VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
 
         VkPipelineDynamicStateCreateInfo dynamicState = {};
         dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
@@ -529,25 +1152,8 @@ private:
         depthStencil.front = {};
         depthStencil.back = {};
 
-        VkPushConstantRange pushConstantRange = {};
-        pushConstantRange.offset = 0;
-        pushConstantRange.size = sizeof(int);
-        pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-        VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
-        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutInfo.setLayoutCount = 1;
-        pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
-        pipelineLayoutInfo.pushConstantRangeCount = 1;
-        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-
         VkDevice device = DeviceManager::instance().getDevice();
 
-        if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) 
-        {
-            throw std::runtime_error("Error: Failed to create pipeline layout");
-        }
-
         VkGraphicsPipelineCreateInfo pipelineInfo = {};
         pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
         pipelineInfo.stageCount = 2;
@@ -559,30 +1165,37 @@ private:
         pipelineInfo.pMultisampleState = &multisampling;
         pipelineInfo.pDepthStencilState = &depthStencil;
         pipelineInfo.pColorBlendState = &colorBlending;
-        pipelineInfo.pDynamicState = nullptr; // Optional
+        pipelineInfo.pDynamicState = &dynamicState;
         pipelineInfo.layout = pipelineLayout;
         pipelineInfo.renderPass = renderPass;
         pipelineInfo.subpass = 0;
         pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
         pipelineInfo.basePipelineIndex = -1; // Optional
 
-        if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
+        VkPipeline graphicsPipeline;
+        VkResult result = vkCreateGraphicsPipelines(device, ShaderManager::instance().getPipelineCache(), 1, &pipelineInfo, nullptr, &graphicsPipeline);
+
+        vkDestroyShaderModule(device, vertShaderModule, nullptr);
+        vkDestroyShaderModule(device, fragShaderModule, nullptr);
+
+        if (result != VK_SUCCESS)
         {
             throw std::runtime_error("Error: Failed to creat graphics pipeline");
         }
 
-        vkDestroyShaderModule(device, vertShaderModule, nullptr);
-        vkDestroyShaderModule(device, fragShaderModule, nullptr);
+        return graphicsPipeline;
     }
 
     void createCommandPool()
     {
-        QueueFamilyIndices queueFamilyIndices = QueueFamilyIndices::findQueueFamilies(DeviceManager::instance().getPhysicalDevice(), surface);
+        QueueFamilyIndices queueFamilyIndices = QueueFamilyIndices::findQueueFamilies(DeviceManager::instance().getPhysicalDevice(), target->getSurface());
 
         VkCommandPoolCreateInfo poolInfo = {};
         poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
         poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily;
-        poolInfo.flags = 0;
+
+        // Command buffers are re-recorded one at a time when the pipeline is swapped
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
         if (vkCreateCommandPool(DeviceManager::instance().getDevice(), &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
         {
@@ -590,16 +1203,157 @@ private:
         }
     }
 
-    void createDepthResources()
+    // Passes of a frame in submission order, the graph works out the barriers between them
+    // Rebuilt with the swapchain, as the target images and the depth buffer's size change with it
+    void createRenderGraph()
+    {
+        std::vector<VkImage> targetImages;
+
+        for (uint32_t i = 0; i < target->getImageCount(); i++)
+        {
+            targetImages.push_back(target->getImage(i));
+        }
+
+        // Acquire semaphores are waited on at colour output, so the first transition waits there too
+        RenderGraph::Resource targetImage = renderGraph.importImage("Target", targetImages, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+                                                                    target->getFinalLayout(), VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+        renderGraph.setOutput(targetImage);
+
+        RenderGraph::ImageDesc depthDesc = {};
+        depthDesc.format = findDepthFormat();
+        depthDesc.extent = getSceneExtent();
+        depthDesc.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+        depthDesc.aspect = VK_IMAGE_ASPECT_DEPTH_BIT | (hasStencilComponent(depthDesc.format) ? VK_IMAGE_ASPECT_STENCIL_BIT : 0);
+        depthDesc.samples = sampleCount;
+        // Cleared on load and never stored
+        depthDesc.lazy = true;
+
+        depthBuffer = renderGraph.createImage("Depth", depthDesc);
+        multisampleBuffer = RenderGraph::NONE;
+        sceneColour = RenderGraph::NONE;
+
+        if (resolutionScaler)
+        {
+            RenderGraph::ImageDesc colourDesc = {};
+            colourDesc.format = target->getImageFormat();
+            colourDesc.extent = getSceneExtent();
+            colourDesc.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+            colourDesc.aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+
+            sceneColour = renderGraph.createImage("Scene colour", colourDesc);
+        }
+
+        if (sampleCount != VK_SAMPLE_COUNT_1_BIT)
+        {
+            RenderGraph::ImageDesc multisampleDesc = {};
+            multisampleDesc.format = target->getImageFormat();
+            multisampleDesc.extent = getSceneExtent();
+            multisampleDesc.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+            multisampleDesc.aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+            multisampleDesc.samples = sampleCount;
+            // Resolved within the pass, so the samples never need to be stored
+            multisampleDesc.lazy = true;
+
+            multisampleBuffer = renderGraph.createImage("Multisampled colour", multisampleDesc);
+        }
+
+        RenderGraph::Resource clusters = RenderGraph::NONE;
+        RenderGraph::Resource shadowMap = RenderGraph::NONE;
+
+        if (shading.clusteredLights > 0 && LightManager::instance().usesComputeBinning())
+        {
+            clusters = renderGraph.importBuffer("Light clusters", LightManager::instance().getClusterBuffer());
+
+            uint32_t binningPass = renderGraph.addPass("Light binning", [this](VkCommandBuffer commandBuffer, uint32_t imageIndex)
+            {
+                GpuProfiler::Scope scope(commandBuffer, profilerSlots[imageIndex], "Light binning");
+                LightManager::instance().recordBinning(commandBuffer);
+            });
+
+            renderGraph.write(binningPass, clusters, RenderGraph::STORAGE_WRITE_COMPUTE);
+        }
+
+        if (shading.shadows)
+        {
+            std::vector<VkImage> shadowImage(1, ShadowManager::instance().getShadowImage());
+            shadowMap = renderGraph.importImage("Shadow map", shadowImage, VK_IMAGE_ASPECT_DEPTH_BIT,
+                                                VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_UNDEFINED);
+
+            // Cascades are drawn and copied within render passes that leave them read-only for sampling
+            RenderGraph::Access shadowAccess = {};
+            shadowAccess.stage = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+            shadowAccess.access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+            shadowAccess.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+            uint32_t shadowPass = renderGraph.addPass("Shadows", [this](VkCommandBuffer commandBuffer, uint32_t imageIndex)
+            {
+                GpuProfiler::Scope scope(commandBuffer, profilerSlots[imageIndex], "Shadows");
+                ShadowManager::instance().recordShadowPass(commandBuffer);
+            });
+
+            renderGraph.write(shadowPass, shadowMap, shadowAccess);
+        }
+
+        uint32_t mainPass = renderGraph.addPass("Main pass", [this](VkCommandBuffer commandBuffer, uint32_t imageIndex)
+        {
+            recordMainPass(commandBuffer, imageIndex);
+        });
+
+        renderGraph.write(mainPass, sceneColour != RenderGraph::NONE ? sceneColour : targetImage, RenderGraph::COLOR_ATTACHMENT);
+        renderGraph.write(mainPass, depthBuffer, RenderGraph::DEPTH_ATTACHMENT);
+
+        if (multisampleBuffer != RenderGraph::NONE)
+        {
+            renderGraph.write(mainPass, multisampleBuffer, RenderGraph::COLOR_ATTACHMENT);
+        }
+
+        if (clusters != RenderGraph::NONE)
+        {
+            renderGraph.read(mainPass, clusters, RenderGraph::STORAGE_READ_FRAGMENT);
+        }
+
+        if (shadowMap != RenderGraph::NONE)
+        {
+            renderGraph.read(mainPass, shadowMap, RenderGraph::DEPTH_SAMPLED_FRAGMENT);
+        }
+
+        if (sceneColour != RenderGraph::NONE)
+        {
+            RenderGraph::Resource source = sceneColour;
+
+            uint32_t upscalePass = renderGraph.addPass("Upscale", [this, source, targetImage](VkCommandBuffer commandBuffer, uint32_t imageIndex)
+            {
+                GpuProfiler::Scope scope(commandBuffer, profilerSlots[imageIndex], "Upscale");
+                recordUpscale(commandBuffer, renderGraph.getImage(source, imageIndex), renderGraph.getImage(targetImage, imageIndex));
+            });
+
+            renderGraph.read(upscalePass, sceneColour, RenderGraph::TRANSFER_SRC);
+            renderGraph.write(upscalePass, targetImage, RenderGraph::TRANSFER_DST);
+        }
+
+        renderGraph.createResources();
+    }
+
+    // Extent of the depth and colour attachments the scene is drawn into
+    VkExtent2D getSceneExtent()
     {
-        VkFormat depthFormat = findDepthFormat();
+        return resolutionScaler ? resolutionScaler->getMaxExtent() : target->getExtent();
+    }
 
-        VkExtent2D swapchainExtent = SwapchainManager::instance().getExtent();
+    // Stretch the rendered top-left renderExtent of the scene colour over the whole target image
+    void recordUpscale(VkCommandBuffer commandBuffer, VkImage source, VkImage destination)
+    {
+        VkExtent2D targetExtent = target->getExtent();
 
-        createImage(swapchainExtent.width, swapchainExtent.height, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageMemory);
-        depthImageView = createImageView(depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
+        VkImageBlit blit = {};
+        blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.srcSubresource.layerCount = 1;
+        blit.srcOffsets[1] = { static_cast<int32_t>(renderExtent.width), static_cast<int32_t>(renderExtent.height), 1 };
+        blit.dstSubresource = blit.srcSubresource;
+        blit.dstOffsets[1] = { static_cast<int32_t>(targetExtent.width), static_cast<int32_t>(targetExtent.height), 1 };
 
-        transitionImageLayout(depthImage, depthFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+        vkCmdBlitImage(commandBuffer, source, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, destination, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                       1, &blit, VK_FILTER_LINEAR);
     }
 
     void createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory)
@@ -630,58 +1384,103 @@ private:
         VkMemoryRequirements memRequirements;
         vkGetImageMemoryRequirements(device, image, &memRequirements);
 
-        VkMemoryAllocateInfo allocInfo = {};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = Utils::findMemoryType(memRequirements.memoryTypeBits, properties);
+        imageMemory = Utils::allocateTrackedMemory(memRequirements.size, Utils::findMemoryType(memRequirements.memoryTypeBits, properties), "image");
+
+        vkBindImageMemory(device, image, imageMemory, 0);
+    }
+
+    // Checkerboard with a colour picked from the seed, standing in for extra scene textures
+    void createCheckerTexture(uint32_t seed, VkImage &image, VkDeviceMemory &imageMemory)
+    {
+        const uint32_t size = 256;
+        const uint32_t checkSize = 32;
+
+        std::vector<uint8_t> pixels(size * size * 4);
 
-        if (vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
+        uint8_t red = static_cast<uint8_t>(64 + (seed * 97) % 192);
+        uint8_t green = static_cast<uint8_t>(64 + (seed * 57) % 192);
+        uint8_t blue = static_cast<uint8_t>(64 + (seed * 31) % 192);
+
+        for (uint32_t y = 0; y < size; y++)
         {
-            throw std::runtime_error("Error: Failed to allocate image memory");
+            for (uint32_t x = 0; x < size; x++)
+            {
+                bool light = ((x / checkSize) + (y / checkSize)) % 2 == 0;
+                uint8_t* pixel = &pixels[(y * size + x) * 4];
+
+                pixel[0] = light ? red : red / 4;
+                pixel[1] = light ? green : green / 4;
+                pixel[2] = light ? blue : blue / 4;
+                pixel[3] = 255;
+            }
         }
 
-        vkBindImageMemory(device, image, imageMemory, 0);
+        createImage(size, size, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, imageMemory);
+
+        UploadManager::instance().uploadImage(image, size, size, pixels.data());
     }
 
-    void createTextureImage(std::string filepath, VkImage &image, VkDeviceMemory &imageMemory)
+    void createTextureImageView(VkImage &textureImage, VkImageView &dstImageView)
     {
-        int texWidth, texHeight, texChannels;
-        stbi_uc* pixels = stbi_load(filepath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+        dstImageView = createImageView(textureImage, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
+    }
 
-        // 4 bytes per pixel
-        VkDeviceSize imageSize = texWidth * texHeight * 4;
+    // Start reading the scene's files, they decode alongside each other and the generated assets
+    void loadSceneAssets()
+    {
+        textureAssets.push_back(AssetManager::instance().loadTexture("textures/texture.jpg"));
+        textureAssets.push_back(AssetManager::instance().loadTexture("textures/ground.png"));
 
-        if (!pixels)
+        // Clusters are built from the decoded geometry
+        if (scene.meshDetail == 0)
         {
-            throw std::runtime_error("Error: Failed to load texture image");
+            sphereAsset = AssetManager::instance().loadMesh("models/sphere.obj", true);
         }
 
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
-        createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+        planeAsset = AssetManager::instance().loadMesh("models/plane.obj", true);
+    }
 
-        VkDevice device = DeviceManager::instance().getDevice();
+    void requestSceneAssets()
+    {
+        for (const AssetManager::Handle& asset : textureAssets)
+        {
+            asset.request();
+        }
 
-        void* data;
-        vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
-        memcpy(data, pixels, static_cast<size_t>(imageSize));
-        vkUnmapMemory(device, stagingBufferMemory);
+        if (sphereAsset.isValid())
+        {
+            sphereAsset.request();
+        }
 
-        stbi_image_free(pixels);
+        planeAsset.request();
+    }
 
-        createImage(texWidth, texHeight, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, imageMemory);
-    
-        transitionImageLayout(image, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-        copyBufferToImage(stagingBuffer, image, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-        transitionImageLayout(image, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-    
-        vkDestroyBuffer(device, stagingBuffer, nullptr);
-        vkFreeMemory(device, stagingBufferMemory, nullptr);
+    void waitForAsset(const AssetManager::Handle& asset)
+    {
+        if (AssetManager::instance().wait(asset) == AssetManager::FAILED)
+        {
+            throw std::runtime_error("Error: Failed to load " + asset.getPath() + ": " + asset.getError());
+        }
     }
 
-    void createTextureImageView(VkImage &textureImage, VkImageView &dstImageView)
+    void createTextures()
     {
-        dstImageView = createImageView(textureImage, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
+        textureImages.resize(scene.textureCount);
+        textureImageMemory.resize(scene.textureCount);
+        textureImageViews.resize(scene.textureCount);
+
+        // Generated while the loaded textures decode
+        for (uint32_t i = static_cast<uint32_t>(textureAssets.size()); i < scene.textureCount; i++)
+        {
+            createCheckerTexture(i, textureImages[i], textureImageMemory[i]);
+            createTextureImageView(textureImages[i], textureImageViews[i]);
+        }
+
+        for (size_t i = 0; i < textureAssets.size(); i++)
+        {
+            waitForAsset(textureAssets[i]);
+            textureImageViews[i] = textureAssets[i].getTexture().view;
+        }
     }
 
     void createTextureSampler()
@@ -702,7 +1501,8 @@ private:
         samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
         samplerInfo.mipLodBias = 0.0f;
         samplerInfo.minLod = 0.0f;
-        samplerInfo.maxLod = 0.0f;
+        // Loaded textures carry full mip chains, the generated ones a single level
+        samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
 
         if (vkCreateSampler(DeviceManager::instance().getDevice(), &samplerInfo, nullptr, &textureSampler) != VK_SUCCESS)
         {
@@ -710,204 +1510,166 @@ private:
         }
     }
 
-    void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout)
+    // UV sphere of unit radius with the given number of segments around and segments / 2 rings
+    Mesh createSphereMesh(uint32_t segments)
     {
-        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        uint32_t rings = std::max(segments / 2, 2u);
+        segments = std::max(segments, 3u);
 
-        VkPipelineStageFlags sourceStage;
-        VkPipelineStageFlags destinationStage;
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
 
-        VkImageMemoryBarrier barrier = {};
-        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        barrier.oldLayout = oldLayout;
-        barrier.newLayout = newLayout;
-        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier.image = image;
-        barrier.subresourceRange.baseMipLevel = 0;
-        barrier.subresourceRange.levelCount = 1;
-        barrier.subresourceRange.baseArrayLayer = 0;
-        barrier.subresourceRange.layerCount = 1;
-
-        if (newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) 
+        for (uint32_t ring = 0; ring <= rings; ring++)
         {
-            barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+            float theta = glm::pi<float>() * ring / rings;
 
-            if (hasStencilComponent(format)) 
+            for (uint32_t segment = 0; segment <= segments; segment++)
             {
-                barrier.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
-            }
-        } 
-        else 
-        {
-            barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        }
+                float phi = 2.0f * glm::pi<float>() * segment / segments;
 
-        if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
-        {
-            barrier.srcAccessMask = 0;
-            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                Vertex vertex = {};
+                vertex.pos = { std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi) };
+                vertex.normal = vertex.pos;
+                vertex.texCoord = { static_cast<float>(segment) / segments, static_cast<float>(ring) / rings };
+                vertex.color = { 1.0f, 1.0f, 1.0f };
 
-            sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-            destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+                vertices.push_back(vertex);
+            }
         }
-        else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
-        {
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
-            sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-            destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-        }
-        else if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
+        // Counter-clockwise from outside, skipping the degenerate triangle of each quad at the poles
+        for (uint32_t ring = 0; ring < rings; ring++)
         {
-            barrier.srcAccessMask = 0;
-            barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+            for (uint32_t segment = 0; segment < segments; segment++)
+            {
+                uint32_t a = ring * (segments + 1) + segment;
+                uint32_t b = a + segments + 1;
+                uint32_t c = b + 1;
+                uint32_t d = a + 1;
 
-            sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-            destinationStage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-        }
-        else
-        {
-            throw std::invalid_argument("Error: Unsupported layout transition");
+                if (ring != rings - 1)
+                {
+                    indices.insert(indices.end(), { a, c, b });
+                }
+
+                if (ring != 0)
+                {
+                    indices.insert(indices.end(), { a, d, c });
+                }
+            }
         }
 
-        vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+        return uploadMesh(vertices, indices);
+    }
 
-        endSingleTimeCommands(commandBuffer);
+    Mesh uploadMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+    {
+        return createMesh(GeometryManager::instance().loadMesh(vertices, indices), vertices, indices);
     }
 
-    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory)
+    // Scene mesh of a loaded asset, clustered from the geometry it kept
+    Mesh getAssetMesh(const AssetManager::Handle& asset)
     {
-        VkBufferCreateInfo bufferInfo = {};
-        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-        bufferInfo.size = size;
-        bufferInfo.usage = usage;
-        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        waitForAsset(asset);
 
-        VkDevice device = DeviceManager::instance().getDevice();
+        const AssetManager::Mesh& loaded = asset.getMesh();
 
-        if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) 
-        {
-            throw std::runtime_error("Error: Failed to create vertex buffer");
-        }
+        return createMesh(loaded.handle, loaded.vertices, loaded.indices);
+    }
 
-        VkMemoryRequirements memRequirements;
-        vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+    Mesh createMesh(MeshHandle handle, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+    {
+        Mesh mesh = {};
+        mesh.handle = handle;
 
-        VkMemoryAllocateInfo allocInfo = {};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = Utils::findMemoryType(memRequirements.memoryTypeBits, properties);
+        for (const Vertex& vertex : vertices)
+        {
+            mesh.radius = std::max(mesh.radius, glm::length(vertex.pos));
+        }
 
-        if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) 
+        if (indices.size() / 3 >= CLUSTER_MIN_TRIANGLES)
         {
-            throw std::runtime_error("Error: Failed to allocate vertex buffer memory");
+            mesh.clustered = true;
+            mesh.clusterMesh = ClusterManager::instance().addMesh(mesh.handle, vertices, indices);
         }
 
-        vkBindBufferMemory(device, buffer, bufferMemory, 0);
+        return mesh;
     }
 
-    void loadModel(std::string filepath)
+    void addObject(const Mesh& mesh, int texture, glm::vec3 position, float scale, bool animated)
     {
-        // Load using tinyobj containers
-        tinyobj::attrib_t attrib;
-        std::vector<tinyobj::shape_t> shapes;
-        std::vector<tinyobj::material_t> materials;
-        std::string err;
-
-        // Load obj from file
-        if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, filepath.c_str())) 
+        Object object = {};
+        object.mesh = mesh.handle;
+        object.texture = texture;
+        object.position = position;
+        object.scale = scale;
+        object.radius = mesh.radius * scale;
+        object.animated = animated;
+
+        // Each clustered object culls into its own region of the index stream
+        if (mesh.clustered)
         {
-            throw std::runtime_error(err);
+            object.clustered = true;
+            object.cluster = ClusterManager::instance().addInstance(mesh.clusterMesh);
         }
 
-        // Map vertex to index
-        std::unordered_map<Vertex, uint32_t> uniqueVertices = {};
+        objects.push_back(object);
+    }
 
-        Object object;
+    void createScene()
+    {
+        Mesh sphere = scene.meshDetail > 0 ? createSphereMesh(scene.meshDetail) : getAssetMesh(sphereAsset);
+        Mesh plane = getAssetMesh(planeAsset);
 
-        object.firstIndex = static_cast<uint32_t>(indices.size());
+        // Smallest odd grid holding every sphere, so the first can sit at the origin
+        int gridSize = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(scene.objectCount))));
+        gridSize += 1 - gridSize % 2;
 
-        for (const auto& shape : shapes)
-        {
-            for (const auto& index : shape.mesh.indices) 
-            {
-                Vertex vertex = {};
+        int halfGrid = gridSize / 2;
 
-                vertex.pos = { attrib.vertices[3 * index.vertex_index + 0], // Single strip values - index * 3
-                               attrib.vertices[3 * index.vertex_index + 1],
-                               attrib.vertices[3 * index.vertex_index + 2] };
+        // Fill the grid outwards ring by ring, so any object count stays centred
+        std::vector<glm::ivec2> cells;
 
-                vertex.normal = {attrib.normals[3 * index.normal_index + 0],
-                                 attrib.normals[3 * index.normal_index + 1],
-                                 attrib.normals[3 * index.normal_index + 2]};
+        for (int z = -halfGrid; z <= halfGrid; z++)
+        {
+            for (int x = -halfGrid; x <= halfGrid; x++)
+            {
+                cells.push_back(glm::ivec2(x, z));
+            }
+        }
 
-                vertex.texCoord = { attrib.texcoords.at(2 * index.texcoord_index + 0),
-                                    1.0f - attrib.texcoords.at(2 * index.texcoord_index + 1) };
+        std::stable_sort(cells.begin(), cells.end(), [](const glm::ivec2& a, const glm::ivec2& b)
+        {
+            return std::max(std::abs(a.x), std::abs(a.y)) < std::max(std::abs(b.x), std::abs(b.y));
+        });
 
-                vertex.color = { 1.0f, 1.0f, 1.0f };
+        // Default scene is the spinning sphere above the ground plane (20 units across)
+        addObject(sphere, 0, glm::vec3(0.0f), 2.0f, true);
+        addObject(plane, 1, glm::vec3(0.0f, -3.0f, 0.0f), std::max(1.0f, (halfGrid * OBJECT_SPACING + 3.0f) / 10.0f), false);
 
-                if (uniqueVertices.count(vertex) == 0)
-                {
-                    // Push current vector size (ie index) to uniqueVertices and push vertex to vertex array
-                    uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex);
-                }
+        for (uint32_t i = 1; i < scene.objectCount; i++)
+        {
+            glm::vec3 position(cells[i].x * OBJECT_SPACING, 0.0f, cells[i].y * OBJECT_SPACING);
 
-                // Retrieve unique vertex index from map
-                indices.push_back(uniqueVertices[vertex]);
-            }
+            addObject(sphere, static_cast<int>(i % scene.textureCount), position, 2.0f, true);
         }
-
-        object.indexCount = static_cast<uint32_t>(indices.size());
-        objects.push_back(object);
     }
 
-    void createVertexBuffer()
+    void printUploadStats(std::chrono::high_resolution_clock::time_point startTime)
     {
-        VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
-
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
-        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-        VkDevice device = DeviceManager::instance().getDevice();
-
-        void* data;
-        vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-        memcpy(data, vertices.data(), (size_t) bufferSize);
-        vkUnmapMemory(device, stagingBufferMemory);
-
-        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferMemory);
+        UploadManager::Stats stats = UploadManager::instance().getStats();
+        float elapsed = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - startTime).count();
 
-        copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
-
-        vkDestroyBuffer(device, stagingBuffer, nullptr);
-        vkFreeMemory(device, stagingBufferMemory, nullptr);
+        std::cout << "Startup uploads: " << stats.uploads << " assets, " << stats.bytesUploaded << " bytes in "
+                  << stats.chunks << " copies, " << stats.batchesSubmitted << " submissions (" << elapsed << " ms)" << std::endl;
     }
 
-    void createIndexBuffer()
+    void printIndexStats()
     {
-        VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
-
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
-        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-        VkDevice device = DeviceManager::instance().getDevice();
-
-        void* data;
-        vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-        memcpy(data, indices.data(), (size_t) bufferSize);
-        vkUnmapMemory(device, stagingBufferMemory);
+        GeometryManager::IndexStats stats = GeometryManager::instance().getIndexStats();
 
-        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferMemory);
-
-        copyBuffer(stagingBuffer, indexBuffer, bufferSize);
-
-        vkDestroyBuffer(device, stagingBuffer, nullptr);
-        vkFreeMemory(device, stagingBufferMemory, nullptr);
+        std::cout << "Index pools: " << stats.meshes16 << " meshes 16-bit, " << stats.meshes32 << " meshes 32-bit, "
+                  << stats.indexBytes << " bytes (" << stats.bytesSaved << " bytes saved over 32-bit)" << std::endl;
     }
 
     // void createUniformBuffer() 
@@ -932,50 +1694,59 @@ private:
     //     createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, dynamicUniformBuffer, dynamicMemory);
     // }
 
-    void createDescriptorPool()
+    // Lights orbit over the whole scene, binned by the compute shader unless it fails to compile
+    void createLights()
     {
-        std::array<VkDescriptorPoolSize, 4> poolSizes = {};
-        poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
-        poolSizes[0].descriptorCount = 1;
-
-        poolSizes[1].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        poolSizes[1].descriptorCount = 1;
-
-        poolSizes[2].type = VK_DESCRIPTOR_TYPE_SAMPLER;
-        poolSizes[2].descriptorCount = 1;
+        std::vector<char> computeCode;
 
-        poolSizes[3].type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-        poolSizes[3].descriptorCount = 2;
+        if (!shading.cpuLightBinning)
+        {
+            try
+            {
+                computeCode = ShaderManager::instance().getPermutation("cluster.comp", LightManager::getGridDefines());
+            }
+            catch (const std::runtime_error& e)
+            {
+                std::cerr << e.what() << std::endl << "Clustered lighting: falling back to CPU binning" << std::endl;
+            }
+        }
 
-        VkDescriptorPoolCreateInfo poolInfo = {};
-        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-        poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-        poolInfo.pPoolSizes = poolSizes.data();
-        poolInfo.maxSets = 1;
+        float sceneRadius = 0.0f;
 
-        if (vkCreateDescriptorPool(DeviceManager::instance().getDevice(), &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+        for (const Object& object : objects)
         {
-            throw std::runtime_error("Error: Failed to create descriptor pool");
+            sceneRadius = std::max(sceneRadius, glm::length(object.position));
         }
+
+        LightManager::instance().init(shading.clusteredLights, sceneRadius + OBJECT_SPACING, computeCode);
     }
 
-    void createDescriptorSet(VkDescriptorSet &descriptorSet)
+    // Every object casts, animated ones are redrawn into the cached cascades each frame
+    void createShadows()
     {
-        VkDescriptorSetLayout layouts[] = {descriptorSetLayout, descriptorSetLayout};
+        std::vector<char> vertexCode = ShaderManager::instance().getPermutation("shadow.vert", ShaderManager::ShaderDefines());
 
-        VkDescriptorSetAllocateInfo allocInfo = {};
-        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-        allocInfo.descriptorPool = descriptorPool;
-        allocInfo.descriptorSetCount = 1;
-        allocInfo.pSetLayouts = layouts;
+        float sceneRadius = 0.0f;
+        std::vector<ShadowManager::Caster> casters;
 
-        VkDevice device = DeviceManager::instance().getDevice();
-
-        if (vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet) != VK_SUCCESS)
+        for (size_t j = 0; j < objects.size(); j++)
         {
-            throw std::runtime_error("Error: Failed to allocate descriptor set");
+            sceneRadius = std::max(sceneRadius, glm::length(objects[j].position) + objects[j].radius);
+
+            ShadowManager::Caster caster = {};
+            caster.mesh = objects[j].mesh;
+            caster.dynamicOffset = static_cast<uint32_t>(j * dynamicAlignment);
+            caster.dynamic = objects[j].animated;
+
+            casters.push_back(caster);
         }
 
+        ShadowManager::instance().init(shading.shadowResolution, shading.shadowCache, sceneRadius, vertexCode);
+        ShadowManager::instance().setCasters(casters);
+    }
+
+    void createDescriptorSet(VkDescriptorSet &descriptorSet)
+    {
         VkDescriptorBufferInfo dynamicBufferInfo = {};
         dynamicBufferInfo.buffer = UniformManager::instance().getDynamicUniformBuffer();
         dynamicBufferInfo.offset = 0;
@@ -989,24 +1760,20 @@ private:
         VkDescriptorImageInfo samplerInfo = {};
         samplerInfo.sampler = textureSampler;
 
-        VkDescriptorImageInfo mainImageInfo = {};
-        mainImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        mainImageInfo.imageView = mainTextureImageView;
-        mainImageInfo.sampler = textureSampler;
+        // Every element of the array must be valid, so unused slots repeat the loaded textures
+        uint32_t textureSlots = shaderLayout.getDescriptorCount(0, 3);
+        std::vector<VkDescriptorImageInfo> imageInfo(textureSlots);
 
-        VkDescriptorImageInfo groundImageInfo = {};
-        groundImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        groundImageInfo.imageView = groundTextureImageView;
-        groundImageInfo.sampler = textureSampler;
-
-        VkDescriptorImageInfo imageInfo[2];
-        imageInfo[0] = mainImageInfo;
-        imageInfo[1] = groundImageInfo;
+        for (uint32_t i = 0; i < textureSlots; i++)
+        {
+            imageInfo[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            imageInfo[i].imageView = textureImageViews[i % textureImageViews.size()];
+            imageInfo[i].sampler = textureSampler;
+        }
 
-        std::array<VkWriteDescriptorSet, 4> descriptorWrites = {};
+        std::vector<VkWriteDescriptorSet> descriptorWrites(4);
 
         descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[0].dstSet = descriptorSet;
         descriptorWrites[0].dstBinding = 0;
         descriptorWrites[0].dstArrayElement = 0;
         descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
@@ -1014,7 +1781,6 @@ private:
         descriptorWrites[0].pBufferInfo = &dynamicBufferInfo;
 
         descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[1].dstSet = descriptorSet;
         descriptorWrites[1].dstBinding = 1;
         descriptorWrites[1].dstArrayElement = 0;
         descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
@@ -1022,7 +1788,6 @@ private:
         descriptorWrites[1].pBufferInfo = &staticBufferInfo;
 
         descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[2].dstSet = descriptorSet;
         descriptorWrites[2].dstBinding = 2;
         descriptorWrites[2].dstArrayElement = 0;
         descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
@@ -1030,52 +1795,92 @@ private:
         descriptorWrites[2].pImageInfo = &samplerInfo;
 
         descriptorWrites[3].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[3].dstSet = descriptorSet;
         descriptorWrites[3].dstBinding = 3;
         descriptorWrites[3].dstArrayElement = 0;
         descriptorWrites[3].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-        descriptorWrites[3].descriptorCount = 2; // Number of textures
-        descriptorWrites[3].pImageInfo = imageInfo;
+        descriptorWrites[3].descriptorCount = textureSlots;
+        descriptorWrites[3].pImageInfo = imageInfo.data();
 
-        vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
-    }
+        VkDescriptorBufferInfo lightBufferInfo = {};
+        VkDescriptorBufferInfo clusterBufferInfo = {};
 
-    void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
-    {
-        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        // Only the clustered lighting permutation declares the light buffers
+        if (shaderLayout.getDescriptorCount(0, 4) > 0)
+        {
+            lightBufferInfo.buffer = LightManager::instance().getLightBuffer();
+            lightBufferInfo.offset = 0;
+            lightBufferInfo.range = LightManager::instance().getLightBufferSize();
+
+            clusterBufferInfo.buffer = LightManager::instance().getClusterBuffer();
+            clusterBufferInfo.offset = 0;
+            clusterBufferInfo.range = LightManager::instance().getClusterBufferSize();
+
+            descriptorWrites.resize(6);
+
+            descriptorWrites[4].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[4].dstBinding = 4;
+            descriptorWrites[4].dstArrayElement = 0;
+            descriptorWrites[4].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            descriptorWrites[4].descriptorCount = 1;
+            descriptorWrites[4].pBufferInfo = &lightBufferInfo;
+
+            descriptorWrites[5].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[5].dstBinding = 5;
+            descriptorWrites[5].dstArrayElement = 0;
+            descriptorWrites[5].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            descriptorWrites[5].descriptorCount = 1;
+            descriptorWrites[5].pBufferInfo = &clusterBufferInfo;
+        }
+
+        VkDescriptorImageInfo shadowImageInfo = {};
+        VkDescriptorBufferInfo shadowBufferInfo = {};
 
-        VkBufferCopy copyRegion = {};
-        copyRegion.srcOffset = 0;
-        copyRegion.dstOffset = 0;
-        copyRegion.size = size;
-        vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+        // Only the shadowed permutation declares the cascades
+        if (shaderLayout.getDescriptorCount(0, 6) > 0)
+        {
+            shadowImageInfo.sampler = ShadowManager::instance().getSampler();
+            shadowImageInfo.imageView = ShadowManager::instance().getShadowView();
+            shadowImageInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+            shadowBufferInfo.buffer = ShadowManager::instance().getUniformBuffer();
+            shadowBufferInfo.offset = 0;
+            shadowBufferInfo.range = ShadowManager::instance().getUniformBufferSize();
+
+            VkWriteDescriptorSet shadowWrite = {};
+            shadowWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            shadowWrite.dstBinding = 6;
+            shadowWrite.dstArrayElement = 0;
+            shadowWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            shadowWrite.descriptorCount = 1;
+            shadowWrite.pImageInfo = &shadowImageInfo;
+
+            descriptorWrites.push_back(shadowWrite);
+
+            shadowWrite.dstBinding = 7;
+            shadowWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            shadowWrite.pImageInfo = nullptr;
+            shadowWrite.pBufferInfo = &shadowBufferInfo;
+
+            descriptorWrites.push_back(shadowWrite);
+        }
 
-        endSingleTimeCommands(commandBuffer);
+        // Allocated and written on first request, shared by any later request with identical contents
+        descriptorSet = DescriptorManager::instance().getCachedSet(descriptorSetLayout, descriptorWrites.data(), static_cast<uint32_t>(descriptorWrites.size()));
     }
 
-    void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height)
+    void createCommandBuffers()
     {
-        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
-        VkBufferImageCopy region = {};
-        region.bufferOffset = 0;
-        region.bufferRowLength = 0;
-        region.bufferImageHeight = 0;
-        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        region.imageSubresource.mipLevel = 0;
-        region.imageSubresource.baseArrayLayer = 0;
-        region.imageSubresource.layerCount = 1;
-        region.imageOffset = { 0, 0, 0 };
-        region.imageExtent = { width, height, 1 };
+        commandBuffers.resize(target->getImageCount());
+        commandCounts.assign(commandBuffers.size(), RuntimeStats::CommandCounts());
 
-        vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+        // Per-image resources may still be in use by frames from before a resize
+        frameTickets.assign(commandBuffers.size(), SyncManager::instance().getLastTicket());
 
-        endSingleTimeCommands(commandBuffer);
-    }
-
-    void createCommandBuffers()
-    {
-        commandBuffers.resize(SwapchainManager::instance().getFramebufferSize());
+        // Slots outlive command buffer re-recording, only new images need one
+        while (profilerSlots.size() < commandBuffers.size())
+        {
+            profilerSlots.push_back(GpuProfiler::instance().createSlot());
+        }
 
         VkCommandBufferAllocateInfo allocInfo = {};
         allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -1088,137 +1893,197 @@ private:
             throw std::runtime_error("Error: Failed to allocate command buffers");
         }
 
+        commandBuffersStale.assign(commandBuffers.size(), false);
+
         for (size_t i = 0; i < commandBuffers.size(); i++) 
         {
-            VkCommandBufferBeginInfo beginInfo = {};
-            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
-            beginInfo.pInheritanceInfo = nullptr;
+            recordCommandBuffer(i);
+        }
+    }
 
-            vkBeginCommandBuffer(commandBuffers[i], &beginInfo);
+    // The command buffer must not be pending on the GPU
+    void recordCommandBuffer(size_t i)
+    {
+        commandCounts[i] = RuntimeStats::CommandCounts();
 
-            std::array<VkClearValue, 2> clearValues = {};
-            clearValues[0].color = { 0.2f, 0.2f, 0.2f, 1.0f };
-            clearValues[1].depthStencil = { 1.0f, 0 };
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+        beginInfo.pInheritanceInfo = nullptr;
 
-            std::vector<VkFramebuffer> swapchainFramebuffers = SwapchainManager::instance().getFramebuffers();
-            VkExtent2D swapchainExtent = SwapchainManager::instance().getExtent();
+        vkBeginCommandBuffer(commandBuffers[i], &beginInfo);
 
-            VkRenderPassBeginInfo renderPassInfo = {};
-            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-            renderPassInfo.renderPass = renderPass;
-            renderPassInfo.framebuffer = swapchainFramebuffers[i];
-            renderPassInfo.renderArea.offset = {0, 0};
-            renderPassInfo.renderArea.extent = swapchainExtent;
-            renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-            renderPassInfo.pClearValues = clearValues.data();
+        // Queries are reset outside the render pass each time the buffer runs
+        GpuProfiler::instance().beginRecording(commandBuffers[i], profilerSlots[i]);
 
-            vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-            vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+        {
+            // Top of pipe, so the frame scope includes any wait on the acquired image
+            GpuProfiler::Scope frameScope(commandBuffers[i], profilerSlots[i], "Frame");
 
-            VkBuffer vertexBuffers[] = {vertexBuffer};
-            VkDeviceSize offsets[] = {0};
+            renderGraph.execute(commandBuffers[i], static_cast<uint32_t>(i));
+        }
 
-            // Bind vertex and index buffers
-            vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, vertexBuffers, offsets);
-            vkCmdBindIndexBuffer(commandBuffers[i], indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+        GpuProfiler::instance().endRecording(profilerSlots[i]);
 
-            // Loop through objects and bind descriptor set to draw call
-            // This uses a dynamic offset to select what data from the uniform buffer each draw call requires
-            for (size_t j = 0; j < objects.size(); j++)
-            {
-                uint32_t dynamicOffset = j * static_cast<uint32_t>(dynamicAlignment);
+        if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Error: Failed to record command buffer");
+        }
+    }
 
-                int index = j;
-                vkCmdPushConstants(commandBuffers[i], pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(int), (void*)&index);
-                vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 1, &dynamicOffset);
+    // Swap in a pipeline rebuilt from edited shaders, at the frame boundary
+    void applyShaderReload()
+    {
+        VkPipeline pipeline = ShaderManager::instance().takePipeline();
 
-                // Draw single object using vertex count and object first index
-                vkCmdDrawIndexed(commandBuffers[i], objects[j].indexCount, 1, objects[j].firstIndex, 0, 0);
-            }
-            
-            // End render pass and command buffer
-            vkCmdEndRenderPass(commandBuffers[i]);
-            if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS)
-            {
-                throw std::runtime_error("Error: Failed to record command buffer");
-            }
+        if (pipeline == VK_NULL_HANDLE)
+        {
+            return;
         }
+
+        // Frames in flight still use the old pipeline
+        DeletionQueue::instance().destroyPipeline(SyncManager::instance().getLastTicket(), graphicsPipeline);
+        graphicsPipeline = pipeline;
+
+        commandBuffersStale.assign(commandBuffers.size(), true);
     }
 
-    void createSemaphores()
+    void recordMainPass(VkCommandBuffer commandBuffer, size_t imageIndex)
     {
-        VkSemaphoreCreateInfo semaphoreInfo = {};
-        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        // Statistics cover the whole pass, so the query begins and ends outside it
+        GpuProfiler::Scope scope(commandBuffer, profilerSlots[imageIndex], "Main pass", true);
+
+        // The multisampled colour buffer is cleared in place of the target image
+        std::array<VkClearValue, 3> clearValues = {};
+        clearValues[0].color = { 0.2f, 0.2f, 0.2f, 1.0f };
+        clearValues[1].depthStencil = { 1.0f, 0 };
+        clearValues[2].color = clearValues[0].color;
+
+        VkRenderPassBeginInfo renderPassInfo = {};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = renderPass;
+        renderPassInfo.framebuffer = resolutionScaler ? sceneFramebuffer : target->getFramebuffer(imageIndex);
+        renderPassInfo.renderArea.offset = {0, 0};
+        renderPassInfo.renderArea.extent = renderExtent;
+        renderPassInfo.clearValueCount = sampleCount == VK_SAMPLE_COUNT_1_BIT ? 2 : 3;
+        renderPassInfo.pClearValues = clearValues.data();
+
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+        commandCounts[imageIndex].pipelineBinds++;
 
-        VkDevice device = DeviceManager::instance().getDevice();
+        VkViewport viewport = {};
+        viewport.width = static_cast<float>(renderExtent.width);
+        viewport.height = static_cast<float>(renderExtent.height);
+        viewport.maxDepth = 1.0f;
 
-        if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphore) != VK_SUCCESS ||
-            vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphore) != VK_SUCCESS) 
-        {
+        VkRect2D scissor = {};
+        scissor.extent = renderExtent;
 
-            throw std::runtime_error("Error: Failed to create semaphores");
-        }
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+        VkBuffer vertexBuffers[] = {GeometryManager::instance().getVertexBuffer()};
+        VkDeviceSize offsets[] = {0};
+
+        // Bind the shared vertex buffer once, meshes are selected per draw
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+
+        recordMeshDraws(commandBuffer, imageIndex);
+        recordClusterDraws(commandBuffer, imageIndex);
+
+        vkCmdEndRenderPass(commandBuffer);
     }
 
-    VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats)
+    void recordMeshDraws(VkCommandBuffer commandBuffer, size_t imageIndex)
     {
-        if (availableFormats.size() == 1 && availableFormats[0].format == VK_FORMAT_UNDEFINED)
-        {
-            return { VK_FORMAT_B8G8R8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR };
-        }
+        GpuProfiler::Scope scope(commandBuffer, profilerSlots[imageIndex], "Meshes");
 
-        for (const auto& availableFormat : availableFormats)
+        // Draw objects batched by index width so each index pool is bound once
+        const VkIndexType indexTypes[] = { VK_INDEX_TYPE_UINT16, VK_INDEX_TYPE_UINT32 };
+
+        for (VkIndexType indexType : indexTypes)
         {
-            if (availableFormat.format == VK_FORMAT_B8G8R8A8_UNORM && availableFormat.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR)
+            bool indexBufferBound = false;
+
+            // Loop through objects and bind descriptor set to draw call
+            // This uses a dynamic offset to select what data from the uniform buffer each draw call requires
+            for (size_t j = 0; j < objects.size(); j++)
             {
-                return availableFormat;
+                GeometryManager::MeshRange mesh = GeometryManager::instance().getMeshRange(objects[j].mesh);
+
+                if (objects[j].clustered || mesh.indexType != indexType)
+                {
+                    continue;
+                }
+
+                if (!indexBufferBound)
+                {
+                    vkCmdBindIndexBuffer(commandBuffer, GeometryManager::instance().getIndexBuffer(indexType), 0, indexType);
+                    indexBufferBound = true;
+                }
+
+                uint32_t dynamicOffset = j * static_cast<uint32_t>(dynamicAlignment);
+
+                int index = objects[j].texture;
+                vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(int), (void*)&index);
+                vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 1, &dynamicOffset);
+
+                // Draw single object from its sub-allocated index and vertex ranges
+                vkCmdDrawIndexed(commandBuffer, mesh.indexCount, 1, mesh.firstIndex, mesh.vertexOffset, 0);
+
+                commandCounts[imageIndex].descriptorBinds++;
+                commandCounts[imageIndex].drawCalls++;
             }
         }
-
-        return availableFormats[0];
     }
 
-    VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR> availablePresentModes)
+    void recordClusterDraws(VkCommandBuffer commandBuffer, size_t imageIndex)
     {
-        VkPresentModeKHR bestMode = VK_PRESENT_MODE_FIFO_KHR;
+        GpuProfiler::Scope scope(commandBuffer, profilerSlots[imageIndex], "Clusters");
 
-        for (const auto& availablePresentMode : availablePresentModes)
+        // Clustered objects draw whatever survived this frame's meshlet culling
+        // Counts and vertex offsets are written to the indirect buffer each frame, so recording stays static
+        for (size_t j = 0; j < objects.size(); j++)
         {
-            if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR)
-            {
-                return availablePresentMode;
-            }
-            else if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR)
+            if (!objects[j].clustered)
             {
-                bestMode = availablePresentMode;
+                continue;
             }
-        }
 
-        return bestMode;
+            ClusterHandle cluster = objects[j].cluster;
+
+            vkCmdBindIndexBuffer(commandBuffer, ClusterManager::instance().getIndexBuffer(imageIndex), ClusterManager::instance().getIndexOffset(cluster), ClusterManager::instance().getIndexType(cluster));
+
+            uint32_t dynamicOffset = j * static_cast<uint32_t>(dynamicAlignment);
+
+            int index = objects[j].texture;
+            vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(int), (void*)&index);
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 1, &dynamicOffset);
+
+            vkCmdDrawIndexedIndirect(commandBuffer, ClusterManager::instance().getIndirectBuffer(imageIndex), ClusterManager::instance().getIndirectOffset(cluster), 1, sizeof(VkDrawIndexedIndirectCommand));
+
+            commandCounts[imageIndex].descriptorBinds++;
+            commandCounts[imageIndex].drawCalls++;
+        }
     }
 
-    VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities)
+    void createSemaphores()
     {
-        if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max())
-        {
-            return capabilities.currentExtent;
-        }
-        else
-        {
-            int width, height;
-            glfwGetWindowSize(window, &width, &height);
+        VkSemaphoreCreateInfo semaphoreInfo = {};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-            VkExtent2D actualExtent = { (uint32_t)width, (uint32_t)height };
+        VkDevice device = DeviceManager::instance().getDevice();
 
-            actualExtent.width = std::max(capabilities.minImageExtent.width, std::min(capabilities.maxImageExtent.width, actualExtent.width));
-            actualExtent.height = std::max(capabilities.minImageExtent.height, std::min(capabilities.maxImageExtent.height, actualExtent.height));
+        if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphore) != VK_SUCCESS ||
+            vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphore) != VK_SUCCESS) 
+        {
 
-            return actualExtent;
+            throw std::runtime_error("Error: Failed to create semaphores");
         }
     }
 
-    VkShaderModule createShaderModule(const std::vector<char>& code)
+    static VkShaderModule createShaderModule(const std::vector<char>& code)
     {
         VkShaderModuleCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
@@ -1258,25 +2123,6 @@ private:
         return imageView;
     }
 
-    VkCommandBuffer beginSingleTimeCommands()
-    {
-        VkCommandBufferAllocateInfo allocInfo = {};
-        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandPool = commandPool;
-        allocInfo.commandBufferCount = 1;
-
-        VkCommandBuffer commandBuffer;
-        vkAllocateCommandBuffers(DeviceManager::instance().getDevice(), &allocInfo, &commandBuffer);
-
-        VkCommandBufferBeginInfo beginInfo = {};
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-        vkBeginCommandBuffer(commandBuffer, &beginInfo);
-
-        return commandBuffer;
-    }
-
     VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features)
     {
         for (VkFormat format : candidates) 
@@ -1305,52 +2151,353 @@ private:
         );
     }
 
-    void endSingleTimeCommands(VkCommandBuffer commandBuffer)
+    void mainLoop()
     {
-        vkEndCommandBuffer(commandBuffer);
+        auto startTime = std::chrono::high_resolution_clock::now();
 
-        VkSubmitInfo submitInfo = {};
-        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &commandBuffer;
-
-        vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-        vkQueueWaitIdle(graphicsQueue);
+        if (simulationRate > 0.0)
+        {
+            startSimulation();
+        }
 
-        vkFreeCommandBuffers(DeviceManager::instance().getDevice(), commandPool, 1, &commandBuffer);
-    }
+        if (!assetManifestPath.empty())
+        {
+            loadManifest();
+        }
 
-    void mainLoop()
-    {
-        // Poll events while window open
-        while (!glfwWindowShouldClose(window))
+        // Poll events while window open (or until the headless frame count is reached)
+        while (!target->shouldClose() && !(benchmark && benchmark->isComplete()))
         {
-            glfwPollEvents();
+            TRACE_ZONE("Frame");
+
+            if (framePacing)
+            {
+                acquireImage();
+            }
+
+            {
+                TRACE_ZONE("pollEvents");
+
+                target->pollEvents();
+            }
+
+            // Input is read from the events just polled, a simulated frame is timed from the input of the steps it draws
+            if (!simulation)
+            {
+                latencyFrame = latencyTracker.beginFrame();
+            }
+
+            if (hotReload)
+            {
+                applyShaderReload();
+            }
+
+            if (requestedSamples != 0)
+            {
+                applySampleCount();
+            }
 
             currentFrameTime = std::chrono::high_resolution_clock::now();
             float time = std::chrono::duration<float, std::chrono::seconds::period>(currentFrameTime - prevFrameTime).count();
 
-            camera.updateCamera(window, time);
-            updateUniformBuffer();
+            if (benchmark)
+            {
+                benchmark->beginFrame();
+            }
+            else if (target->getWindow() != nullptr)
+            {
+                // Input only exists with a window
+                TRACE_ZONE("updateCamera");
+
+                camera.updateCamera(target->getWindow(), time);
+            }
+
+            if (simulation)
+            {
+                updateFromSimulation();
+            }
+            else if (benchmark)
+            {
+                // Scripted run - animation and camera follow the fixed timestep, not the wall clock
+                float benchmarkTime = benchmark->getTime();
+
+                animateObjects(benchmarkTime, objectModels);
+                updateUniformBuffer(benchmarkTime, cameraPath.getViewMatrix(benchmarkTime));
+            }
+            else
+            {
+                float elapsed = std::chrono::duration<float, std::chrono::seconds::period>(currentFrameTime - startTime).count();
+
+                animateObjects(elapsed, objectModels);
+                updateUniformBuffer(elapsed, camera.getViewMatrix());
+            }
+
             drawFrame();
 
+            if (firstFrameMs < 0.0)
+            {
+                firstFrameMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - runStartTime).count();
+                std::cout << "First frame after " << firstFrameMs << " ms" << std::endl;
+            }
+
+            if (benchmark)
+            {
+                if (shading.shadows)
+                {
+                    benchmark->addPassTime("shadows", lastGpuShadowTime);
+                }
+
+                benchmark->endFrame(lastGpuFrameTime);
+
+                // Keep warmup frames out of the profiler's averages as well
+                if (benchmark->getFrameIndex() == benchmark->getConfig().warmupFrames)
+                {
+                    GpuProfiler::instance().resetResults();
+                    ClusterManager::instance().resetCullStats();
+                    latencyTracker.reset();
+                }
+            }
+
             prevFrameTime = currentFrameTime;
+
+            // Reclaim staging space from completed uploads
+            {
+                TRACE_ZONE("collectUploads");
+
+                UploadManager::instance().collect();
+            }
+
+            // Destroy resources replaced while frames that used them were still in flight
+            DeletionQueue::instance().collect();
+
+            // Upload whatever finished decoding, its uploads go out with the next frame
+            AssetManager::instance().update();
+
+            // Assets whose last handle went this frame are released once the frames drawing them complete
+            AssetManager::instance().evictUnused();
+
+            // The scene's own assets are drawn every frame, so only the rest is trimmed to fit the budget
+            requestSceneAssets();
+            ResidencyManager::instance().enforce();
+
+            // Unloaded meshes leave holes in the geometry pools, repacking them replaces the bound buffers
+            if (++framesSinceDefragmentCheck >= GEOMETRY_DEFRAGMENT_INTERVAL)
+            {
+                framesSinceDefragmentCheck = 0;
+
+                if (GeometryManager::instance().isDefragmentWorthwhile(GEOMETRY_DEFRAGMENT_FREE_SHARE))
+                {
+                    TRACE_ZONE("defragmentGeometry");
+
+                    GeometryManager::instance().defragment();
+                }
+            }
+
+            // Also catches repacks a mesh load did to make room for itself
+            if (GeometryManager::instance().takeRepacked())
+            {
+                commandBuffersStale.assign(commandBuffers.size(), true);
+            }
+
+            RuntimeStats::instance().endFrame(time * 1000.0);
+
+            if (statsOverlay && target->getWindow() != nullptr)
+            {
+                updateWindowTitle();
+            }
+
+            // Drain this frame's zones so the rings never fill
+            TRACE_FLUSH();
+        }
+
+        // Loads outlasting the run are waited out, so the manifest's load time is always reported
+        for (const AssetManager::Handle& asset : manifestAssets)
+        {
+            AssetManager::instance().wait(asset);
         }
 
         vkDeviceWaitIdle(DeviceManager::instance().getDevice());
+
+        if (!manifestAssets.empty())
+        {
+            std::cout << "Asset manifest: " << manifestAssets.size() << " assets (" << manifestFailed << " failed) loaded in "
+                      << manifestLoadMs << " ms" << std::endl;
+        }
+
+        if (simulation)
+        {
+            simulation->stop();
+            simulation->printStats();
+        }
+
+        if (resolutionScaler)
+        {
+            resolutionScaler->printStats();
+        }
+
+        updateLatency();
+        latencyTracker.printSummary();
+
+        if (benchmark)
+        {
+            for (uint32_t stage = 0; stage < LatencyTracker::STAGE_COUNT; stage++)
+            {
+                benchmark->addLatencySamples(LatencyTracker::getStageName(static_cast<LatencyTracker::Stage>(stage)),
+                                             latencyTracker.getSamples(static_cast<LatencyTracker::Stage>(stage)));
+            }
+
+            benchmark->addSceneInfo("first_frame_ms", firstFrameMs);
+            benchmark->addSceneInfo("manifest_assets", manifestAssets.size());
+            benchmark->addSceneInfo("manifest_load_ms", manifestLoadMs);
+
+            // Share of the clustered meshes' triangles culled after warmup
+            ClusterManager::Stats clusterStats = ClusterManager::instance().getStats();
+            benchmark->addSceneInfo("culled_triangle_ratio", clusterStats.trianglesTested > 0 ?
+                                    static_cast<double>(clusterStats.trianglesTested - clusterStats.trianglesDrawn) / clusterStats.trianglesTested : 0.0);
+
+            benchmark->printSummary();
+            benchmark->writeResults();
+        }
+    }
+
+    void updateWindowTitle()
+    {
+        std::string title = "Vulkan | " + RuntimeStats::instance().getOverlayText();
+
+        // Only touch the window when the summary has been refreshed
+        if (title != windowTitle)
+        {
+            glfwSetWindowTitle(target->getWindow(), title.c_str());
+            windowTitle = title;
+        }
+    }
+
+    // Queue every asset in the manifest, the loads finish over the following frames
+    void loadManifest()
+    {
+        std::ifstream file(assetManifestPath);
+
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Error: Failed to open asset manifest " + assetManifestPath);
+        }
+
+        manifestStartTime = std::chrono::high_resolution_clock::now();
+
+        std::string path;
+
+        while (std::getline(file, path))
+        {
+            if (path.empty() || path[0] == '#')
+            {
+                continue;
+            }
+
+            bool mesh = path.size() > 4 && path.compare(path.size() - 4, 4, ".obj") == 0;
+
+            AssetManager::Handle asset = mesh ? AssetManager::instance().loadMesh(path) : AssetManager::instance().loadTexture(path);
+            manifestAssets.push_back(asset);
+            manifestPending++;
+
+            asset.then([this](const AssetManager::Handle& loaded)
+            {
+                if (loaded.getState() == AssetManager::FAILED)
+                {
+                    manifestFailed++;
+                }
+
+                if (--manifestPending == 0)
+                {
+                    manifestLoadMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - manifestStartTime).count();
+                }
+            });
+        }
+
+        std::cout << "Asset manifest: loading " << manifestAssets.size() << " assets from " << assetManifestPath << std::endl;
+    }
+
+    // Starts from the camera's current view, scripted runs replace it with the camera path at each step's time
+    void startSimulation()
+    {
+        bool scripted = benchmark != nullptr;
+
+        // Objects and the camera path are left alone once the loop starts, so the thread can read them
+        simulation.reset(new Simulation(simulationRate, [this, scripted](double time, Simulation::State& state)
+        {
+            animateObjects(static_cast<float>(time), state.models);
+
+            if (scripted)
+            {
+                state.view = cameraPath.getViewMatrix(static_cast<float>(time));
+            }
+        }));
+
+        simulation->start(camera.getViewMatrix());
+    }
+
+    // Pass the input just read to the simulation, and update uniforms from its latest steps
+    void updateFromSimulation()
+    {
+        simulation->setInput(camera.getViewMatrix());
+        simulation->interpolate(simulationFrame);
+
+        latencyFrame = latencyTracker.beginFrame(simulationFrame.input);
+
+        objectModels.swap(simulationFrame.models);
+        updateUniformBuffer(static_cast<float>(simulationFrame.time), simulationFrame.view);
+    }
+
+    // Model matrices at a point in time - animated objects rotate 90 degrees per second
+    // Also runs on the simulation thread, so it only reads objects
+    void animateObjects(float time, std::vector<glm::mat4>& models) const
+    {
+        TRACE_ZONE("animateObjects");
+
+        models.resize(objects.size());
+
+        for (size_t i = 0; i < objects.size(); i++)
+        {
+            const Object& object = objects[i];
+
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), object.position);
+
+            if (object.animated)
+            {
+                model = glm::rotate(model, time * glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+            }
+
+            models[i] = glm::scale(model, glm::vec3(object.scale));
+        }
     }
 
-    void updateUniformBuffer()
+    // Object transforms are taken from objectModels
+    void updateUniformBuffer(float time, const glm::mat4& view)
     {
-        // Get elapsed time per frame for time-based transforms
-        static auto startTime = std::chrono::high_resolution_clock::now();
-        auto currentTime = std::chrono::high_resolution_clock::now();
-        float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+        TRACE_ZONE("updateUniformBuffer");
 
-        VkExtent2D swapchainExtent = SwapchainManager::instance().getExtent();
+        // Uniform buffers are shared by every frame, so the previous frame must be done reading them
+        {
+            TRACE_ZONE("waitPreviousFrame");
 
-        // View matrix
-        glm::mat4 view = camera.getViewMatrix();
+            SyncManager::instance().wait(lastFrameTicket);
+        }
+
+        updateLatency();
+
+        // Its queries are ready too - GPU time is reported a frame behind
+        if (lastFrameTicket != 0 && GpuProfiler::instance().collect(profilerSlots[lastFrameImage]))
+        {
+            lastGpuFrameTime = GpuProfiler::instance().getLastTime("Frame");
+            lastGpuShadowTime = GpuProfiler::instance().getLastTime("Shadows");
+        }
+
+        // Before anything reads this frame's render extent
+        if (resolutionScaler)
+        {
+            updateRenderScale();
+        }
+
+        VkExtent2D swapchainExtent = target->getExtent();
 
         // Projection matrix - 45 degree fov, aspect ratio and near/far planes
         glm::mat4 proj = glm::perspective(glm::radians(45.0f), 
@@ -1360,111 +2507,171 @@ private:
         // GLM designed for OpenGL - must flip Y coordinate of clip coords
         proj[1][1] *= -1;
 
-
-        UniformManager::DynamicUbo dynamicUbos[2];
-
-        // Model matrix - rotate main model 45 degrees per second
-        UniformManager::DynamicUbo ubo1 = UniformManager::createDynamicUbo(glm::rotate(glm::mat4(1.0f), 
-                                                                                       time * glm::radians(90.0f), 
-                                                                                       glm::vec3(0.0f, 1.0f, 0.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(2.0f, 2.0f, 2.0f)), 
-                                                                           view);
-
-        // Model matrix - translate ground plane below main model
-        UniformManager::DynamicUbo ubo2 = UniformManager::createDynamicUbo(glm::translate(glm::mat4(1.0f), 
-                                                                                          glm::vec3(0.0f, -3.0f, 0.0f)), 
-                                                                           view);
-
-        dynamicUbos[0] = ubo1;
-        dynamicUbos[1] = ubo2;
+        viewMatrix = view;
+        projMatrix = proj;
 
         // Get device handle and buffer memories
         VkDevice device = DeviceManager::instance().getDevice();
         VkDeviceMemory dynamicMemory = UniformManager::instance().getDynamicMemory();
         VkDeviceMemory uniformBufferMemory = UniformManager::instance().getCoherentMemory();
 
-        // Set up memory range object for flushing specific parts of dynamic uniform buffer
-        VkMappedMemoryRange memoryRange;
+        // Map the dynamic uniform buffer once for every object rather than once per object
+        void* dynamicData;
+        vkMapMemory(device, dynamicMemory, 0, objects.size() * dynamicAlignment, 0, &dynamicData);
+
+        for (size_t i = 0; i < objects.size(); i++)
+        {
+            UniformManager::DynamicUbo dynamicUbo = UniformManager::createDynamicUbo(objectModels[i], view);
+            memcpy(static_cast<char*>(dynamicData) + i * dynamicAlignment, &dynamicUbo, sizeof(dynamicUbo));
+        }
+
+        // Flush modified memory range and unmap memory
+        VkMappedMemoryRange memoryRange = {};
         memoryRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        memoryRange.pNext = nullptr;
         memoryRange.memory = dynamicMemory;
-        memoryRange.size = sizeof(UniformManager::DynamicUbo);
+        memoryRange.offset = 0;
+        memoryRange.size = VK_WHOLE_SIZE;
+
+        vkFlushMappedMemoryRanges(device, 1, &memoryRange);
+        vkUnmapMemory(device, dynamicMemory);
+        
+        // Update static uniform buffer data
+        UniformManager::StaticUbo ubo;
+
+        ubo.view = view;
+        ubo.proj = proj;
+
+        void* data;
+        vkMapMemory(device, uniformBufferMemory, 0, sizeof(ubo), 0, &data);
+        memcpy(data, &ubo, sizeof(ubo));
+        vkUnmapMemory(device, uniformBufferMemory);
+
+        if (shading.clusteredLights > 0)
+        {
+            // Tiles are found from fragment coordinates, which span the render extent
+            LightManager::instance().update(time, view, proj, renderExtent);
+        }
+
+        if (shading.shadows)
+        {
+            ShadowManager::instance().update(view, proj);
+        }
+    }
+
+    void cullClusters(uint32_t frameIndex)
+    {
+        TRACE_ZONE("cullClusters");
+
+        for (size_t i = 0; i < objects.size(); i++)
+        {
+            if (objects[i].clustered)
+            {
+                ClusterManager::instance().cull(frameIndex, objects[i].cluster, objectModels[i], viewMatrix, projMatrix);
+            }
+        }
+    }
+
+    // False when the swapchain was out of date and has been recreated instead
+    bool acquireImage()
+    {
+        VkResult result;
+
+        // The previous submit waits on the one acquire semaphore, so it has to be done with it before the semaphore
+        // is signalled again - paced frames acquire before updateUniformBuffer waits for them
+        {
+            TRACE_ZONE("waitPreviousFrame");
+
+            SyncManager::instance().wait(lastFrameTicket);
+        }
 
-        // Update dynamic uniform buffer data
-        for (int i = 0; i < objects.size(); i++)
         {
-            // Calculate memory range offset
-            memoryRange.offset = i * dynamicAlignment;
+            TRACE_ZONE("acquireNextImage");
 
-            // Map memory and copy data to mapping
-            void* data;
-            vkMapMemory(device, dynamicMemory, i * dynamicAlignment, dynamicAlignment, 0, &data);
-            memcpy(data, &dynamicUbos[i], sizeof(dynamicUbos[i]));
+            result = target->acquireNextImage(imageAvailableSemaphore, acquiredImage);
+        }
 
-            // Flush modified memory ranges and unmap memory
-            vkFlushMappedMemoryRanges(device, 1, &memoryRange);
-            vkUnmapMemory(device, dynamicMemory);
+        if (result == VK_ERROR_OUT_OF_DATE_KHR) 
+        {
+            recreateSwapChain();
+            return false;
+        } 
+        else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) 
+        {
+            throw std::runtime_error("Error: Failed to acquire swap chain image");
         }
-        
-        // Update static uniform buffer data
-        UniformManager::StaticUbo ubo;
 
-        ubo.view = view;
-        ubo.proj = proj;
+        imageAcquired = true;
 
-        void* data;
-        vkMapMemory(device, uniformBufferMemory, 0, sizeof(ubo), 0, &data);
-        memcpy(data, &ubo, sizeof(ubo));
-        vkUnmapMemory(device, uniformBufferMemory);
+        return true;
+    }
+
+    // Record submissions that completed and frames the target saw displayed
+    void updateLatency()
+    {
+        std::vector<PresentTime> presentTimes;
+        target->getPresentTimes(presentTimes);
+
+        latencyTracker.update(presentTimes);
     }
 
     void drawFrame()
     {
-        uint32_t imageIndex;
-        VkDevice device = DeviceManager::instance().getDevice();
-        VkSwapchainKHR swapchain = SwapchainManager::instance().getSwapchain();
-        VkResult result = vkAcquireNextImageKHR(device, swapchain, std::numeric_limits<uint64_t>::max(), imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+        TRACE_ZONE("drawFrame");
 
-        if (result == VK_ERROR_OUT_OF_DATE_KHR) 
+        // Paced frames acquired theirs before sampling input
+        if (!imageAcquired && !acquireImage())
         {
-            recreateSwapChain();
             return;
-        } 
-        else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) 
+        }
+
+        uint32_t imageIndex = acquiredImage;
+        imageAcquired = false;
+
+        VkResult result;
+
+        // Last submission using this image's command buffer must be done before it is re-recorded or resubmitted
+        SyncManager::instance().wait(frameTickets[imageIndex]);
+
+        if (commandBuffersStale[imageIndex])
         {
-            throw std::runtime_error("Error: Failed to acquire swap chain image");
+            TRACE_ZONE("recordCommandBuffer");
+
+            recordCommandBuffer(imageIndex);
+            commandBuffersStale[imageIndex] = false;
         }
 
-        VkSemaphore waitSemaphores[] = {imageAvailableSemaphore};
-        VkSemaphore signalSemaphores[] = {renderFinishedSemaphore};
-        VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+        // Fill this image's cluster index stream and indirect commands
+        cullClusters(imageIndex);
 
-        VkSubmitInfo submitInfo = {};
-        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        submitInfo.waitSemaphoreCount = 1;
-        submitInfo.pWaitSemaphores = waitSemaphores;
-        submitInfo.pWaitDstStageMask = waitStages;
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &commandBuffers[imageIndex];
-        submitInfo.signalSemaphoreCount = 1;
-        submitInfo.pSignalSemaphores = signalSemaphores;
+        // Colour writes wait for the acquired image, earlier stages can start straight away
+        std::vector<Queue::Wait> waits(1);
+        waits[0].semaphore = imageAvailableSemaphore;
+        waits[0].stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 
-        if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
         {
-            throw std::runtime_error("Error: Failed to submit draw command buffer");
+            TRACE_ZONE("vkQueueSubmit");
+
+            // Goes out together with anything else queued for graphics this frame
+            Queue& queue = DeviceManager::instance().getGraphicsQueue();
+            queue.submit(commandBuffers[imageIndex], waits, renderFinishedSemaphore);
+            frameTickets[imageIndex] = queue.flush();
         }
 
-        VkSwapchainKHR swapChains[] = {swapchain};
+        latencyTracker.submitted(latencyFrame, frameTickets[imageIndex]);
+
+        lastFrameTicket = frameTickets[imageIndex];
+        lastFrameImage = imageIndex;
+
+        GpuProfiler::instance().submitted(profilerSlots[imageIndex]);
+        RuntimeStats::instance().addCommands(commandCounts[imageIndex]);
+
+        {
+            TRACE_ZONE("present");
 
-        VkPresentInfoKHR presentInfo = {};
-        presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-        presentInfo.waitSemaphoreCount = 1;
-        presentInfo.pWaitSemaphores = signalSemaphores;
-        presentInfo.swapchainCount = 1;
-        presentInfo.pSwapchains = swapChains;
-        presentInfo.pImageIndices = &imageIndex;
-        presentInfo.pResults = nullptr;
+            result = target->present(renderFinishedSemaphore, imageIndex, latencyFrame);
+        }
 
-        result = vkQueuePresentKHR(presentQueue, &presentInfo);
+        latencyTracker.presented(latencyFrame);
 
         if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) 
         {
@@ -1474,43 +2681,83 @@ private:
         {
             throw std::runtime_error("Error: Failed to acquire swap chain image");
         }
-
-        vkQueueWaitIdle(presentQueue);
     }
 
     void cleanup()
     {
         VkDevice device = DeviceManager::instance().getDevice();
 
+        // Stop shader reloads first, a build may be using the render pass
+        ShaderManager::instance().cleanup();
+
         cleanupSwapChain();
 
-        // Destroy descriptor set pool/layout
-        vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
-        vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+        // Release deferred destructions while the pools and swapchain they came from still exist
+        DeletionQueue::instance().flush();
+
+        // Destroy descriptor pools/layouts
+        DescriptorManager::instance().printStats();
+        DescriptorManager::instance().cleanup();
 
         // Destroy uniform buffers
         UniformManager::instance().cleanupUniformBuffers();
 
-        // Destroy index buffer
-        vkDestroyBuffer(device, indexBuffer, nullptr);
-        vkFreeMemory(device, indexBufferMemory, nullptr);
+        // Destroy staging arena
+        UploadManager::instance().cleanup();
+
+        // Destroy timing queries once every profiled submission has been read
+        GpuProfiler::instance().printResults();
+
+        if (!profileOutputPath.empty())
+        {
+            GpuProfiler::instance().exportResults(profileOutputPath);
+        }
+
+        GpuProfiler::instance().cleanup();
+
+        // GPU scopes have all been merged by now
+        if (!traceOutputPath.empty())
+        {
+            Tracer::instance().writeChromeTrace(traceOutputPath);
+        }
+
+        // Destroy cluster index streams
+        ClusterManager::instance().printStats();
+        ClusterManager::instance().cleanup();
+
+        // Destroy light buffers and the binning pipeline
+        if (shading.clusteredLights > 0)
+        {
+            LightManager::instance().printStats();
+            LightManager::instance().cleanup();
+        }
+
+        // Destroy shadow maps and the depth-only pipeline
+        if (shading.shadows)
+        {
+            ShadowManager::instance().printStats();
+            ShadowManager::instance().cleanup();
+        }
+
+        // Stop the loader threads and destroy loaded meshes and textures
+        AssetManager::instance().cleanup();
 
-        // Destroy vertex buffer
-        vkDestroyBuffer(device, vertexBuffer, nullptr);
-        vkFreeMemory(device, vertexBufferMemory, nullptr);
+        // Report memory use against the budget, later frees are no longer tracked
+        ResidencyManager::instance().cleanup();
+
+        // Destroy shared vertex/index buffers
+        GeometryManager::instance().cleanup();
 
         // Destroy texture sampler
         vkDestroySampler(device, textureSampler, nullptr);
 
-        // Destroy image view
-        vkDestroyImageView(device, mainTextureImageView, nullptr);
-        vkDestroyImageView(device, groundTextureImageView, nullptr);
-
-        // Destroy textures
-        vkDestroyImage(device, mainTextureImage, nullptr);
-        vkFreeMemory(device, mainTextureImageMemory, nullptr);
-        vkDestroyImage(device, groundTextureImage, nullptr);
-        vkFreeMemory(device, groundTextureImageMemory, nullptr);
+        // Destroy image views and generated textures
+        for (size_t i = textureAssets.size(); i < textureImages.size(); i++)
+        {
+            vkDestroyImageView(device, textureImageViews[i], nullptr);
+            vkDestroyImage(device, textureImages[i], nullptr);
+            Utils::freeTrackedMemory(textureImageMemory[i]);
+        }
 
         // Destroy debug report callback on cleanup
         DestroyDebugReportCallbackEXT(instance, callback, nullptr);
@@ -1518,6 +2765,9 @@ private:
         // Destroy command pool
         vkDestroyCommandPool(device, commandPool, nullptr);
 
+        // Retire outstanding tickets and destroy the queues' sync objects
+        SyncManager::instance().cleanup();
+
         // Destroy semaphores
         vkDestroySemaphore(device, renderFinishedSemaphore, nullptr);
         vkDestroySemaphore(device, imageAvailableSemaphore, nullptr);
@@ -1526,53 +2776,37 @@ private:
         vkDestroyDevice(device, nullptr);
 
         // Destroy window surface
-        vkDestroySurfaceKHR(instance, surface, nullptr);
+        target->destroySurface(instance);
 
         // Destroy Vulkan instance, ignore registering callback
         vkDestroyInstance(instance, nullptr);
 
         // Destroy GLFWwindow & terminate GLFW
-        glfwDestroyWindow(window);
-        glfwTerminate();
+        target->cleanup();
     }
 
     void cleanupSwapChain()
     {
-        VkDevice device = DeviceManager::instance().getDevice();
-
-        VkSwapchainKHR swapchain = SwapchainManager::instance().getSwapchain();
-        std::vector<VkFramebuffer> swapchainFramebuffers = SwapchainManager::instance().getFramebuffers();
-        std::vector<VkImageView> swapchainImageViews = SwapchainManager::instance().getImageViews();
-
-        for (auto framebuffer : swapchainFramebuffers)
-        {
-            vkDestroyFramebuffer(device, framebuffer, nullptr);
-        }
+        // Anything submitted so far may use these, so they are destroyed once it has all completed
+        SyncTicket lastUse = SyncManager::instance().getLastTicket();
 
-        // Destroy swapchain image views
-        for (auto imageView : swapchainImageViews)
-        {
-            vkDestroyImageView(device, imageView, nullptr);
-        }
+        // Destroy framebuffers, image views and swapchain/offscreen images
+        destroyFramebuffers(lastUse);
+        target->destroyImages();
 
-        // Destroy depth resources
-        vkDestroyImageView(device, depthImageView, nullptr);
-        vkDestroyImage(device, depthImage, nullptr);
-        vkFreeMemory(device, depthImageMemory, nullptr);
+        // Destroy the depth buffer and anything else the render graph created
+        renderGraph.cleanup(lastUse);
 
-        vkFreeCommandBuffers(device, commandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
+        DeletionQueue::instance().freeCommandBuffers(lastUse, commandPool, commandBuffers);
 
         // Destroy graphics pipeline
-        vkDestroyPipeline(device, graphicsPipeline, nullptr);
+        DeletionQueue::instance().destroyPipeline(lastUse, graphicsPipeline);
 
         // Destroy pipeline layout
-        vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+        DeletionQueue::instance().destroyPipelineLayout(lastUse, pipelineLayout);
 
         // Destroy render pass
-        vkDestroyRenderPass(device, renderPass, nullptr);
-
-        // Destroy swapchain
-        vkDestroySwapchainKHR(device, swapchain, nullptr);
+        DeletionQueue::instance().destroyRenderPass(lastUse, renderPass);
     }
 
     bool checkValidationLayerSupport()
@@ -1616,13 +2850,8 @@ private:
 
     std::vector<const char*> getRequiredExtensions()
     {
-        // Get required GLFW extensions
-        uint32_t glfwExtensionCount = 0;
-        const char** glfwExtensions;
-        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-        // Populate required glfw extension vector
-        std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+        // Get extensions required by the presentation target (GLFW surface extensions when windowed)
+        std::vector<const char*> extensions = target->getRequiredInstanceExtensions();
 
         // Enable debug report extension (optional)
         if (enableValidationLayers)
@@ -1630,6 +2859,28 @@ private:
             extensions.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
         }
 
+        // Needed to query timeline semaphore support, which is optional, the memory budget and device UUIDs
+        uint32_t extensionCount = 0;
+        vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+        std::vector<VkExtensionProperties> available(extensionCount);
+        vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, available.data());
+
+        for (const auto& extension : available)
+        {
+            if (strcmp(extension.extensionName, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) == 0)
+            {
+                extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+                deviceProperties2 = true;
+            }
+#ifdef VK_KHR_external_memory_capabilities
+            else if (strcmp(extension.extensionName, VK_KHR_EXTERNAL_MEMORY_CAPABILITIES_EXTENSION_NAME) == 0)
+            {
+                extensions.push_back(VK_KHR_EXTERNAL_MEMORY_CAPABILITIES_EXTENSION_NAME);
+                externalMemoryCapabilities = true;
+            }
+#endif
+        }
+
         return extensions;
     }
 
@@ -1712,26 +2963,25 @@ private:
         app->recreateSwapChain();
     }
 
-    static std::vector<char> readFile(const std::string& filename)
+    // M steps through the supported sample counts, wrapping back to one
+    static void onKey(GLFWwindow* window, int key, int scancode, int action, int mods)
     {
-        // Open file and start at end
-        std::ifstream file(filename, std::ios::ate | std::ios::binary);
-
-        if (!file.is_open())
+        if (key != GLFW_KEY_M || action != GLFW_PRESS)
         {
-            throw std::runtime_error("Error: Failed to open file");
+            return;
         }
 
-        // Use end position to get size of file for buffer allocation
-        size_t fileSize = (size_t) file.tellg();
-        std::vector<char> buffer(fileSize);
-
-        // Seek back to beginning of file, read data and close
-        file.seekg(0);
-        file.read(buffer.data(), fileSize);
-        file.close();
+        VulkanApplication* app = reinterpret_cast<VulkanApplication*>(glfwGetWindowUserPointer(window));
+        app->requestedSamples = 1;
 
-        return buffer;
+        for (uint32_t count = app->sampleCount * 2; count <= VK_SAMPLE_COUNT_64_BIT; count <<= 1)
+        {
+            if (app->chooseSampleCount(count) == count)
+            {
+                app->requestedSamples = count;
+                break;
+            }
+        }
     }
 
     // Debug callback returns messages from validation layers
@@ -1751,13 +3001,396 @@ private:
     }
 };
 
-int main()
+int main(int argc, char* argv[])
 {
-    VulkanApplication app;
+    // [--headless] [--width W] [--height H] [--frames N] [--capture file.ppm]
+    // [--bench] [--warmup N] [--timestep S] [--output file.json|file.csv] [--camera-path orbit|flythrough]
+    // [--objects N] [--textures N] [--mesh-detail N]
+    // [--pipeline-stats] [--profile-output file.json|file.csv]
+    // [--trace file.json] [--trace-overhead]
+    // [--stats-interval S] [--stats-output file.json] [--stats-overlay]
+    // [--device index|uuid|name] (or VULKAN_DEVICE) [--sync-fences] [--hot-reload]
+    // [--no-texture] [--no-specular] [--light-power P] [--shininess S] [--lights N]
+    // [--clustered-lights N] [--cpu-light-binning] [--shadows] [--no-shadow-cache] [--shadow-resolution N]
+    // [--msaa 1|2|4|8] [--dynamic-resolution] [--frame-budget MS] [--min-scale S] [--max-scale S]
+    // [--present-mode low-latency|throughput|vsync] [--swapchain-images N] [--sim-thread] [--sim-rate HZ]
+    // [--asset-manifest file.txt] [--residency-budget MB]
+    // --residency-sim [--residency-budget MB] [--frames N]
+    // --compare base.json new.json [--threshold percent]
+    bool headless = false;
+    bool bench = false;
+    uint32_t width = WIDTH;
+    uint32_t height = HEIGHT;
+    uint32_t frames = 100;
+    bool framesSet = false;
+    std::string capturePath;
+
+    Benchmark::Config benchConfig;
+    SceneConfig scene;
+
+    bool pipelineStatistics = false;
+    std::string profileOutputPath;
+
+    std::string traceOutputPath;
+    bool traceOverhead = false;
+
+    std::string deviceOverride;
+
+    double statsInterval = 0.0;
+    std::string statsOutputPath;
+    bool statsOverlay = false;
+
+    bool syncFences = false;
+    bool hotReload = false;
+
+    ShadingConfig shading;
+
+    bool dynamicResolution = false;
+    ResolutionScaler::Config resolutionConfig;
+
+    SwapchainManager::PresentPolicy presentPolicy = SwapchainManager::PRESENT_THROUGHPUT;
+    uint32_t swapchainImages = 0;
+
+    bool simThread = false;
+    double simRate = 60.0;
+
+    std::string assetManifestPath;
+
+    VkDeviceSize residencyBudget = 0;
+    bool residencySim = false;
+
+    std::string compareBase;
+    std::string compareNew;
+    double threshold = 5.0;
+
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+
+            if (arg == "--headless")
+            {
+                headless = true;
+            }
+            else if (arg == "--width" && hasValue)
+            {
+                width = static_cast<uint32_t>(std::stoul(argv[++i]));
+            }
+            else if (arg == "--height" && hasValue)
+            {
+                height = static_cast<uint32_t>(std::stoul(argv[++i]));
+            }
+            else if (arg == "--frames" && hasValue)
+            {
+                frames = static_cast<uint32_t>(std::stoul(argv[++i]));
+                framesSet = true;
+            }
+            else if (arg == "--capture" && hasValue)
+            {
+                capturePath = argv[++i];
+            }
+            else if (arg == "--bench")
+            {
+                bench = true;
+            }
+            else if (arg == "--warmup" && hasValue)
+            {
+                benchConfig.warmupFrames = static_cast<uint32_t>(std::stoul(argv[++i]));
+            }
+            else if (arg == "--timestep" && hasValue)
+            {
+                benchConfig.timestep = std::stof(argv[++i]);
+            }
+            else if (arg == "--output" && hasValue)
+            {
+                benchConfig.outputPath = argv[++i];
+            }
+            else if (arg == "--camera-path" && hasValue)
+            {
+                benchConfig.cameraPath = argv[++i];
+            }
+            else if (arg == "--objects" && hasValue)
+            {
+                scene.objectCount = std::max(static_cast<uint32_t>(std::stoul(argv[++i])), 1u);
+            }
+            else if (arg == "--textures" && hasValue)
+            {
+                scene.textureCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+            }
+            else if (arg == "--mesh-detail" && hasValue)
+            {
+                scene.meshDetail = static_cast<uint32_t>(std::stoul(argv[++i]));
+            }
+            else if (arg == "--pipeline-stats")
+            {
+                pipelineStatistics = true;
+            }
+            else if (arg == "--profile-output" && hasValue)
+            {
+                profileOutputPath = argv[++i];
+            }
+            else if (arg == "--trace" && hasValue)
+            {
+                traceOutputPath = argv[++i];
+            }
+            else if (arg == "--trace-overhead")
+            {
+                traceOverhead = true;
+            }
+            else if (arg == "--device" && hasValue)
+            {
+                deviceOverride = argv[++i];
+            }
+            else if (arg == "--stats-interval" && hasValue)
+            {
+                statsInterval = std::stod(argv[++i]);
+            }
+            else if (arg == "--stats-output" && hasValue)
+            {
+                statsOutputPath = argv[++i];
+            }
+            else if (arg == "--stats-overlay")
+            {
+                statsOverlay = true;
+            }
+            else if (arg == "--sync-fences")
+            {
+                syncFences = true;
+            }
+            else if (arg == "--hot-reload")
+            {
+                hotReload = true;
+            }
+            else if (arg == "--no-texture")
+            {
+                shading.useTexture = false;
+            }
+            else if (arg == "--no-specular")
+            {
+                shading.useSpecular = false;
+            }
+            else if (arg == "--light-power" && hasValue)
+            {
+                shading.lightPower = std::stof(argv[++i]);
+            }
+            else if (arg == "--shininess" && hasValue)
+            {
+                shading.shininess = std::stof(argv[++i]);
+            }
+            else if (arg == "--lights" && hasValue)
+            {
+                shading.lightCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+            }
+            else if (arg == "--clustered-lights" && hasValue)
+            {
+                shading.clusteredLights = static_cast<uint32_t>(std::stoul(argv[++i]));
+            }
+            else if (arg == "--cpu-light-binning")
+            {
+                shading.cpuLightBinning = true;
+            }
+            else if (arg == "--shadows")
+            {
+                shading.shadows = true;
+            }
+            else if (arg == "--no-shadow-cache")
+            {
+                shading.shadowCache = false;
+            }
+            else if (arg == "--shadow-resolution" && hasValue)
+            {
+                shading.shadowResolution = std::max(static_cast<uint32_t>(std::stoul(argv[++i])), 64u);
+            }
+            else if (arg == "--msaa" && hasValue)
+            {
+                shading.msaaSamples = std::max(static_cast<uint32_t>(std::stoul(argv[++i])), 1u);
+            }
+            else if (arg == "--dynamic-resolution")
+            {
+                dynamicResolution = true;
+            }
+            else if (arg == "--frame-budget" && hasValue)
+            {
+                resolutionConfig.budgetMs = std::stod(argv[++i]);
+            }
+            else if (arg == "--min-scale" && hasValue)
+            {
+                resolutionConfig.minScale = std::stof(argv[++i]);
+            }
+            else if (arg == "--max-scale" && hasValue)
+            {
+                resolutionConfig.maxScale = std::stof(argv[++i]);
+            }
+            else if (arg == "--present-mode" && hasValue)
+            {
+                presentPolicy = SwapchainManager::parsePresentPolicy(argv[++i]);
+            }
+            else if (arg == "--swapchain-images" && hasValue)
+            {
+                swapchainImages = static_cast<uint32_t>(std::stoul(argv[++i]));
+            }
+            else if (arg == "--sim-thread")
+            {
+                simThread = true;
+            }
+            else if (arg == "--sim-rate" && hasValue)
+            {
+                simRate = std::stod(argv[++i]);
+                simThread = true;
+            }
+            else if (arg == "--asset-manifest" && hasValue)
+            {
+                assetManifestPath = argv[++i];
+            }
+            else if (arg == "--residency-budget" && hasValue)
+            {
+                residencyBudget = static_cast<VkDeviceSize>(std::stoull(argv[++i])) * 1024 * 1024;
+            }
+            else if (arg == "--residency-sim")
+            {
+                residencySim = true;
+            }
+            else if (arg == "--compare" && i + 2 < argc)
+            {
+                compareBase = argv[++i];
+                compareNew = argv[++i];
+            }
+            else if (arg == "--threshold" && hasValue)
+            {
+                threshold = std::stod(argv[++i]);
+            }
+            else
+            {
+                std::cerr << "Unknown argument: " << arg << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+
+        // Comparing results needs no device, exit status reports whether the new run regressed
+        if (!compareBase.empty())
+        {
+            return Benchmark::compare(compareBase, compareNew, threshold) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+
+        // Cost of one zone on this machine, no device needed either
+        if (traceOverhead)
+        {
+            if (!Tracer::ENABLED)
+            {
+                std::cerr << "Tracing is compiled out, rebuild with TRACE=1" << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            std::cout << "Trace zone overhead: " << Tracer::instance().measureOverhead(10000000) << " ns" << std::endl;
+            return EXIT_SUCCESS;
+        }
+
+        // Hit rate and bytes streamed of the residency policy under simulated access patterns, no device needed
+        if (residencySim)
+        {
+            ResidencyManager::simulate(residencyBudget > 0 ? residencyBudget : RESIDENCY_SIM_BUDGET, framesSet ? frames : RESIDENCY_SIM_FRAMES);
+            return EXIT_SUCCESS;
+        }
+
+        if (!traceOutputPath.empty() && !Tracer::ENABLED)
+        {
+            std::cerr << "Warning: tracing is compiled out, rebuild with TRACE=1 to record zones" << std::endl;
+        }
+
+        if (scene.textureCount < 2 || scene.textureCount > MAX_TEXTURES)
+        {
+            std::cerr << "Texture count must be between 2 and " << MAX_TEXTURES << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        if (shading.lightCount < 1)
+        {
+            std::cerr << "Light count must be at least 1" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        if (simRate <= 0.0)
+        {
+            std::cerr << "Simulation rate must be positive" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        // Validate the path name before creating a window
+        CameraPath::fromName(benchConfig.cameraPath, 1.0f);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    Benchmark* benchmark = nullptr;
+
+    if (bench)
+    {
+        if (framesSet)
+        {
+            benchConfig.frames = frames;
+        }
+
+        // Headless runs stop on the frame limit, so it covers warmup too
+        frames = benchConfig.warmupFrames + benchConfig.frames;
+        benchmark = new Benchmark(benchConfig);
+    }
+
+    PresentationTarget* target;
+
+    if (headless)
+    {
+        target = new HeadlessTarget(width, height, frames, capturePath);
+    }
+    else
+    {
+        target = new SwapchainTarget(width, height);
+    }
+
+    // SIGUSR1 dumps to the output path, which is also written on exit if one was given
+    RuntimeStats::instance().init(statsInterval, statsOutputPath.empty() ? "stats.json" : statsOutputPath);
+    RuntimeStats::instance().installSignalHandler();
+
+    DeviceManager::instance().setDeviceOverride(deviceOverride);
+    SwapchainManager::instance().setPresentPolicy(presentPolicy, swapchainImages);
+
+    VulkanApplication app(target, scene, benchmark);
+    app.setProfilerOptions(pipelineStatistics, profileOutputPath);
+    app.setTraceOutput(traceOutputPath);
+    app.setStatsOverlay(statsOverlay);
+    app.setSyncFences(syncFences);
+    app.setHotReload(hotReload);
+    app.setShading(shading);
+
+    if (dynamicResolution)
+    {
+        app.setDynamicResolution(resolutionConfig);
+    }
+
+    if (simThread)
+    {
+        app.setSimulation(simRate);
+    }
+
+    if (!assetManifestPath.empty())
+    {
+        app.setAssetManifest(assetManifestPath);
+    }
+
+    app.setResidencyBudget(residencyBudget);
 
     try
     {
         app.run();
+
+        if (!statsOutputPath.empty())
+        {
+            RuntimeStats::instance().writeJson(statsOutputPath);
+        }
     }
     catch (const std::runtime_error& e)
     {
@@ -1766,4 +3399,4 @@ int main()
     }
 
     return EXIT_SUCCESS;
-}
+}
\ No newline at end of file
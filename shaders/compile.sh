@@ -1,2 +1,5 @@
-/home/joshua/Software/VulkanSDK/1.0.65.0/x86_64/bin/glslangValidator -V shader.vert myconfig.conf
-/home/joshua/Software/VulkanSDK/1.0.65.0/x86_64/bin/glslangValidator -V shader.frag myconfig.conf
+# Same compiler the app uses for --hot-reload when GLSLANG_VALIDATOR is set
+GLSLANG_VALIDATOR=${GLSLANG_VALIDATOR:-/home/joshua/Software/VulkanSDK/1.0.65.0/x86_64/bin/glslangValidator}
+
+# shader.frag has no offline SPIR-V, the app compiles it through its permutation cache
+$GLSLANG_VALIDATOR -V shader.vert myconfig.conf
@@ -2,13 +2,60 @@
 #extension GL_ARB_separate_shader_objects : enable
 
 layout(binding = 2) uniform sampler texSampler;
-layout(binding = 3) uniform texture2D textures[2];
+layout(binding = 3) uniform texture2D textures[32];
 
 layout(push_constant) uniform PER_OBJECT
 {
     int imageIndex;
 } pushconst;
 
+#ifdef CLUSTERED_LIGHTING
+#ifndef MAX_CLUSTER_LIGHTS
+#define MAX_CLUSTER_LIGHTS 255
+#endif
+
+// Written by LightManager, lights are in view space
+struct PointLight
+{
+    vec4 positionRadius;
+    vec4 colorPower;
+};
+
+layout(std430, binding = 4) readonly buffer LightBuffer
+{
+    // P[0][0], P[1][1], near and far plane
+    vec4 projection;
+    // Grid size and light count
+    uvec4 grid;
+    // Framebuffer size, first exponential slice and slices per log depth
+    vec4 screen;
+    PointLight lights[];
+} lightBuffer;
+
+// Per cluster a count followed by MAX_CLUSTER_LIGHTS light indices
+layout(std430, binding = 5) readonly buffer ClusterBuffer
+{
+    uint clusterLights[];
+} clusterBuffer;
+#endif
+
+#ifdef SHADOWS
+layout(binding = 6) uniform sampler2DArrayShadow shadowMap;
+
+// Matches ShadowUbo in ShadowManager.h
+layout(binding = 7) uniform ShadowUniformBufferObject
+{
+    mat4 lightViewProj[4];
+    mat4 viewToShadow[4];
+    vec4 splits;
+    vec4 texelSizes;
+    vec4 lightDirection;
+    vec4 params;
+} shadowUbo;
+
+const vec3 sunColor = vec3(0.6, 0.6, 0.6);
+#endif
+
 layout(location = 0) in vec3 fragPosition;
 layout(location = 1) in vec3 fragNormal;
 layout(location = 2) in vec3 fragColor;
@@ -16,13 +63,31 @@ layout(location = 3) in vec2 fragTexCoord;
 
 layout(location = 0) out vec4 outColor;
 
+// Set per pipeline through VkSpecializationInfo, the ids match FragmentSpecialization in main.cpp
+layout(constant_id = 0) const bool useTexture = true;
+layout(constant_id = 1) const bool useSpecular = true;
+layout(constant_id = 2) const float lightPower = 80.0;
+layout(constant_id = 3) const float shininess = 32.0;
+
+// Compile-time permutation, lights are spread evenly around the first one and share its power
+#ifndef LIGHT_COUNT
+#define LIGHT_COUNT 1
+#endif
+
 const vec3 lightPos = vec3(2.0, 0.0, 1.0);
 const vec3 lightColor = vec3(1.0, 1.0, 1.0);
-const float lightPower = 80.0;
 const vec3 ambientTerm = vec3(0.2, 0.2, 0.2);
 const vec3 diffuseColor = vec3(0.0, 1.0, 0.0);
 const vec3 specColor = vec3(0.0, 1.0, 0.0);
-const float shininess = 32.0;
+
+vec3 getLightPosition(int index)
+{
+    float angle = 6.28318530718 * float(index) / float(LIGHT_COUNT);
+    float s = sin(angle);
+    float c = cos(angle);
+
+    return vec3(c * lightPos.x + s * lightPos.z, lightPos.y, c * lightPos.z - s * lightPos.x);
+}
 
 vec3 getSpecularTerm(vec3 lightDir, vec3 normal, float lightDist)
 {
@@ -32,28 +97,138 @@ vec3 getSpecularTerm(vec3 lightDir, vec3 normal, float lightDist)
     float specularAngle = max(dot(halfDir, normal), 0.0);
     float specular = pow(specularAngle, shininess);
 
-    return specColor * specular * lightColor * lightPower / lightDist;
+    return specColor * specular * lightColor * lightPower / (lightDist * float(LIGHT_COUNT));
+}
+
+#ifdef SHADOWS
+// Fraction of the sun reaching the fragment, 3x3 comparisons each filtered over 2x2 texels
+float getShadow(vec3 normal)
+{
+    float depth = -fragPosition.z;
+
+    if (depth > shadowUbo.splits[3])
+    {
+        return 1.0;
+    }
+
+    int cascade = 0;
+
+    for (int i = 0; i < 3; i++)
+    {
+        if (depth > shadowUbo.splits[i])
+        {
+            cascade = i + 1;
+        }
+    }
+
+    vec3 position = fragPosition + normal * shadowUbo.texelSizes[cascade] * shadowUbo.params.y;
+    vec4 coord = shadowUbo.viewToShadow[cascade] * vec4(position, 1.0);
+    vec2 uv = coord.xy * 0.5 + 0.5;
+
+    float lit = 0.0;
+
+    for (int y = -1; y <= 1; y++)
+    {
+        for (int x = -1; x <= 1; x++)
+        {
+            lit += texture(shadowMap, vec4(uv + vec2(x, y) * shadowUbo.params.x, float(cascade), coord.z));
+        }
+    }
+
+    return lit / 9.0;
 }
+#endif
 
 void main()
 {
     vec3 normal = normalize(fragNormal);
-    vec3 lightDir = lightPos - fragPosition;
-    float lightDist = length(lightDir);
 
-    lightDist = lightDist * lightDist;
-    lightDir = normalize(lightDir);
+    vec3 diffuseTerm = vec3(0.0, 0.0, 0.0);
+    vec3 specularTerm = vec3(0.0, 0.0, 0.0);
+
+    for (int i = 0; i < LIGHT_COUNT; i++)
+    {
+        vec3 lightDir = getLightPosition(i) - fragPosition;
+        float lightDist = length(lightDir);
 
-    float lambertian = max(dot(lightDir, normal), 0.0);
+        lightDist = lightDist * lightDist;
+        lightDir = normalize(lightDir);
 
-    vec3 diffuseTerm = diffuseColor * lambertian * lightColor * lightPower / lightDist;
+        float lambertian = max(dot(lightDir, normal), 0.0);
 
-    vec3 specularTerm = vec3(0.0, 0.0, 0.0);
-    if (lambertian > 0.0)
+        diffuseTerm += diffuseColor * lambertian * lightColor * lightPower / (lightDist * float(LIGHT_COUNT));
+
+        // Specialization constants fold away the disabled branch when the pipeline is built
+        if (useSpecular && lambertian > 0.0)
+        {
+            specularTerm += getSpecularTerm(lightDir, normal, lightDist);
+        }
+    }
+
+#ifdef SHADOWS
+    vec3 sunDir = shadowUbo.lightDirection.xyz;
+    float sunLambertian = max(dot(sunDir, normal), 0.0);
+
+    if (sunLambertian > 0.0)
+    {
+        vec3 sunRadiance = sunColor * getShadow(normal);
+
+        diffuseTerm += diffuseColor * sunLambertian * sunRadiance;
+
+        if (useSpecular)
+        {
+            specularTerm += specColor * pow(max(dot(normalize(sunDir + normalize(-fragPosition)), normal), 0.0), shininess) * sunRadiance;
+        }
+    }
+#endif
+
+#ifdef CLUSTERED_LIGHTING
+    // Same slicing as LightManager and shaders/cluster.comp
+    float depth = -fragPosition.z;
+    uint slice = 0;
+
+    if (depth >= lightBuffer.screen.z)
+    {
+        slice = min(1u + uint(log(depth / lightBuffer.screen.z) * lightBuffer.screen.w), lightBuffer.grid.z - 1u);
+    }
+
+    uvec2 tile = min(uvec2(gl_FragCoord.xy / lightBuffer.screen.xy * vec2(lightBuffer.grid.xy)), lightBuffer.grid.xy - 1u);
+    uint base = ((slice * lightBuffer.grid.y + tile.y) * lightBuffer.grid.x + tile.x) * (MAX_CLUSTER_LIGHTS + 1u);
+    uint count = clusterBuffer.clusterLights[base];
+
+    vec3 viewDir = normalize(-fragPosition);
+
+    for (uint i = 0u; i < count; i++)
+    {
+        PointLight light = lightBuffer.lights[clusterBuffer.clusterLights[base + 1u + i]];
+
+        vec3 toLight = light.positionRadius.xyz - fragPosition;
+        float lightDist = dot(toLight, toLight);
+        float radius = light.positionRadius.w;
+
+        // Smooth falloff to zero at the radius the light was binned with
+        float falloff = max(1.0 - lightDist / (radius * radius), 0.0);
+        vec3 radiance = light.colorPower.rgb * light.colorPower.w * falloff * falloff / (lightDist + 1.0);
+
+        vec3 lightDir = toLight * inversesqrt(max(lightDist, 0.0001));
+        float lambertian = max(dot(lightDir, normal), 0.0);
+
+        diffuseTerm += diffuseColor * lambertian * radiance;
+
+        if (useSpecular && lambertian > 0.0)
+        {
+            specularTerm += specColor * pow(max(dot(normalize(lightDir + viewDir), normal), 0.0), shininess) * radiance;
+        }
+    }
+#endif
+
+    vec3 albedo = vec3(1.0, 1.0, 1.0);
+
+    if (useTexture)
     {
-        specularTerm = getSpecularTerm(lightDir, normal, lightDist);
+        albedo = texture(sampler2D(textures[pushconst.imageIndex], texSampler), fragTexCoord).rgb;
     }
 
-    outColor = vec4((ambientTerm + diffuseTerm + specularTerm) * texture(sampler2D(textures[pushconst.imageIndex], texSampler), fragTexCoord).rgb, 1.0);
+    outColor = vec4((ambientTerm + diffuseTerm + specularTerm) * albedo, 1.0);
     // outColor = vec4(fragColor * texture(texSampler, fragTexCoord).rgb, 1.0);
 }
\ No newline at end of file
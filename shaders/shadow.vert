@@ -0,0 +1,39 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Depth-only cascade rendering for ShadowManager, positions are the only attribute fetched
+
+// Dynamic uniform data, shared with the main pass
+layout(binding = 0) uniform DynamicUniformBufferObject
+{
+    mat4 model;
+    mat4 norm;
+} dynamicUbo;
+
+// Matches ShadowUbo in ShadowManager.h
+layout(binding = 1) uniform ShadowUniformBufferObject
+{
+    mat4 lightViewProj[4];
+    mat4 viewToShadow[4];
+    vec4 splits;
+    vec4 texelSizes;
+    vec4 lightDirection;
+    vec4 params;
+} shadowUbo;
+
+layout(push_constant) uniform PER_CASCADE
+{
+    uint cascade;
+} pushconst;
+
+layout(location = 0) in vec3 inPosition;
+
+out gl_PerVertex
+{
+    vec4 gl_Position;
+};
+
+void main()
+{
+    gl_Position = shadowUbo.lightViewProj[pushconst.cascade] * dynamicUbo.model * vec4(inPosition, 1.0);
+}
\ No newline at end of file
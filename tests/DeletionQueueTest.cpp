@@ -0,0 +1,173 @@
+#include "Tests.h"
+
+#include "DeletionQueue.h"
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+
+namespace
+{
+    // Randomized part of the test
+    const uint32_t TEST_ROUNDS = 1000;
+    const uint32_t TEST_MAX_ENQUEUED = 16;
+
+    // How far ahead of the completed ticket entries are queued, frames in flight plus resources queued late
+    const SyncTicket TEST_TICKET_SPREAD = 8;
+}
+
+bool testDeletionQueue()
+{
+    auto fail = [](const std::string& message)
+    {
+        std::cerr << "DeletionQueue test failed: " << message << std::endl;
+        return false;
+    };
+
+    auto toString = [](const std::vector<uint32_t>& entries)
+    {
+        std::string text;
+
+        for (uint32_t entry : entries)
+        {
+            text += (text.empty() ? "" : " ") + std::to_string(entry);
+        }
+
+        return "[" + text + "]";
+    };
+
+    // Entries record their index when released
+    std::vector<uint32_t> releasedEntries;
+
+    // The queue is the process-wide one, so counts are taken relative to where it starts
+    DeletionQueue& queue = DeletionQueue::instance();
+    queue.collect(std::numeric_limits<SyncTicket>::max());
+
+    {
+        const SyncTicket tickets[] = { 5, 2, 8, 2, 3, 7, 1, 5 };
+
+        for (uint32_t i = 0; i < sizeof(tickets) / sizeof(tickets[0]); i++)
+        {
+            queue.enqueue(tickets[i], [&releasedEntries, i]()
+            {
+                releasedEntries.push_back(i);
+            });
+        }
+
+        // Completed ticket, entries expected to be released in queue order and the count left pending
+        struct Step
+        {
+            SyncTicket completed;
+            std::vector<uint32_t> expected;
+            size_t pending;
+        };
+
+        const Step steps[] =
+        {
+            { 0, {}, 8 },
+            { 2, { 1, 3, 6 }, 5 },
+            { 2, {}, 5 },
+            { 5, { 0, 4, 7 }, 2 },
+            { 6, {}, 2 },
+            { std::numeric_limits<SyncTicket>::max(), { 2, 5 }, 0 }
+        };
+
+        uint64_t expectedReleased = queue.getReleasedCount();
+
+        for (const Step& step : steps)
+        {
+            releasedEntries.clear();
+            size_t count = queue.collect(step.completed);
+            expectedReleased += step.expected.size();
+
+            std::string at = "collecting up to ticket " + std::to_string(step.completed) + " ";
+
+            if (releasedEntries != step.expected)
+            {
+                return fail(at + "released " + toString(releasedEntries) + ", expected " + toString(step.expected));
+            }
+
+            if (count != step.expected.size() || queue.getReleasedCount() != expectedReleased)
+            {
+                return fail(at + "counted " + std::to_string(count) + " released, " + std::to_string(queue.getReleasedCount()) + " in total");
+            }
+
+            if (queue.getPendingCount() != step.pending)
+            {
+                return fail(at + "left " + std::to_string(queue.getPendingCount()) + " pending, expected " + std::to_string(step.pending));
+            }
+        }
+    }
+
+    // Entries queued every round ahead of a completed ticket that only moves forward, some behind it already
+    std::mt19937 random(1);
+    std::uniform_int_distribution<uint32_t> enqueuedCount(0, TEST_MAX_ENQUEUED);
+    std::uniform_int_distribution<SyncTicket> ticketOffset(0, TEST_TICKET_SPREAD);
+    std::uniform_int_distribution<SyncTicket> completedStep(0, 2);
+
+    uint64_t releasedBefore = queue.getReleasedCount();
+    std::vector<SyncTicket> entryTickets;
+    std::vector<uint32_t> releaseCounts;
+    SyncTicket completed = 0;
+
+    for (uint32_t round = 0; round < TEST_ROUNDS; round++)
+    {
+        uint32_t count = enqueuedCount(random);
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            uint32_t entry = static_cast<uint32_t>(entryTickets.size());
+
+            entryTickets.push_back(completed + ticketOffset(random) - std::min(completed, TEST_TICKET_SPREAD / 2));
+            releaseCounts.push_back(0);
+
+            queue.enqueue(entryTickets[entry], [&releasedEntries, &releaseCounts, entry]()
+            {
+                releasedEntries.push_back(entry);
+                releaseCounts[entry]++;
+            });
+        }
+
+        completed += completedStep(random);
+
+        releasedEntries.clear();
+        size_t released = queue.collect(completed);
+
+        if (released != releasedEntries.size() || !std::is_sorted(releasedEntries.begin(), releasedEntries.end()))
+        {
+            return fail("round " + std::to_string(round) + " released " + toString(releasedEntries) + " out of queue order or miscounted");
+        }
+
+        // Everything at or below the completed ticket has gone exactly once, nothing above it has
+        size_t pending = 0;
+
+        for (uint32_t entry = 0; entry < entryTickets.size(); entry++)
+        {
+            bool due = entryTickets[entry] <= completed;
+
+            if (releaseCounts[entry] != (due ? 1u : 0u))
+            {
+                return fail("round " + std::to_string(round) + " released entry " + std::to_string(entry) + " with ticket " + std::to_string(entryTickets[entry]) +
+                            " " + std::to_string(releaseCounts[entry]) + " times at completed ticket " + std::to_string(completed));
+            }
+
+            pending += due ? 0 : 1;
+        }
+
+        if (queue.getPendingCount() != pending || queue.getReleasedCount() - releasedBefore != entryTickets.size() - pending)
+        {
+            return fail("round " + std::to_string(round) + " counted " + std::to_string(queue.getPendingCount()) + " pending and " +
+                        std::to_string(queue.getReleasedCount() - releasedBefore) + " released, expected " + std::to_string(pending) + " pending");
+        }
+    }
+
+    std::cout << "DeletionQueue test passed: " << entryTickets.size() << " entries over " << TEST_ROUNDS << " rounds, "
+              << queue.getPendingCount() << " still pending" << std::endl;
+
+    // What's left refers to this function's locals
+    queue.collect(std::numeric_limits<SyncTicket>::max());
+
+    return true;
+}
\ No newline at end of file
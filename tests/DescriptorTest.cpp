@@ -0,0 +1,249 @@
+#include "Tests.h"
+
+#include "DescriptorManager.h"
+
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+    // Handles the stubs hand out, never dereferenced
+    template<typename Handle>
+    Handle fakeHandle(uint64_t value)
+    {
+        return (Handle) static_cast<uintptr_t>(value);
+    }
+}
+
+bool testDescriptors()
+{
+    auto fail = [](const std::string& message)
+    {
+        std::cerr << "Descriptor test failed: " << message << std::endl;
+        return false;
+    };
+
+    auto counts = [](const DescriptorCacheStats& stats)
+    {
+        return std::to_string(stats.hits) + " hits in " + std::to_string(stats.requests) + " requests";
+    };
+
+    uint64_t nextHandle = 1;
+
+    // Layouts are shared by bindings, whatever order they are listed in
+    uint32_t layoutsCreated = 0;
+    uint32_t layoutsDestroyed = 0;
+
+    DescriptorLayoutCache layoutCache(
+        [&](const DescriptorLayoutKey&)
+        {
+            layoutsCreated++;
+            return fakeHandle<VkDescriptorSetLayout>(nextHandle++);
+        },
+        [&](VkDescriptorSetLayout)
+        {
+            layoutsDestroyed++;
+        });
+
+    VkDescriptorSetLayoutBinding bindings[2] = {};
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[1].descriptorCount = 2;
+    bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    VkDescriptorSetLayoutBinding reversed[2] = { bindings[1], bindings[0] };
+
+    VkDescriptorSetLayout layout = layoutCache.getLayout(bindings, 2);
+    VkDescriptorSetLayout reversedLayout = layoutCache.getLayout(reversed, 2);
+
+    bindings[0].stageFlags |= VK_SHADER_STAGE_FRAGMENT_BIT;
+    VkDescriptorSetLayout otherLayout = layoutCache.getLayout(bindings, 2);
+
+    if (reversedLayout != layout || otherLayout == layout || layoutsCreated != 2 || layoutCache.size() != 2 ||
+        layoutCache.getStats().requests != 3 || layoutCache.getStats().hits != 1)
+    {
+        return fail("layout cache created " + std::to_string(layoutsCreated) + " layouts with " + counts(layoutCache.getStats()) + ", expected 2 with 1 hit in 3");
+    }
+
+    // Pools that hold as many sets as they were created for, with every call recorded
+    struct Pool
+    {
+        uint32_t capacity;
+        uint32_t used;
+        uint32_t resets;
+        bool destroyed;
+    };
+
+    std::map<VkDescriptorPool, Pool> pools;
+    std::vector<uint32_t> poolSizes;
+
+    DescriptorAllocator::PoolFuncs poolFuncs;
+
+    poolFuncs.create = [&](uint32_t setCount)
+    {
+        VkDescriptorPool pool = fakeHandle<VkDescriptorPool>(nextHandle++);
+        pools[pool] = { setCount, 0, 0, false };
+        poolSizes.push_back(setCount);
+
+        return pool;
+    };
+
+    poolFuncs.allocate = [&](VkDescriptorPool pool, VkDescriptorSetLayout, VkDescriptorSet& descriptorSet)
+    {
+        if (pools[pool].used == pools[pool].capacity)
+        {
+            return false;
+        }
+
+        pools[pool].used++;
+        descriptorSet = fakeHandle<VkDescriptorSet>(nextHandle++);
+
+        return true;
+    };
+
+    poolFuncs.reset = [&](VkDescriptorPool pool)
+    {
+        pools[pool].used = 0;
+        pools[pool].resets++;
+    };
+
+    poolFuncs.destroy = [&](VkDescriptorPool pool)
+    {
+        if (pools[pool].destroyed)
+        {
+            throw std::runtime_error("Error: Descriptor pool destroyed twice");
+        }
+
+        pools[pool].destroyed = true;
+    };
+
+    // Pools double from 2 sets up to 8, so 22 sets fill exactly four
+    DescriptorAllocator allocator;
+    allocator.init(2, 8, poolFuncs);
+
+    for (uint32_t i = 0; i < 22; i++)
+    {
+        allocator.allocate(layout);
+    }
+
+    if (poolSizes != std::vector<uint32_t>({ 2, 4, 8, 8 }) || allocator.poolsCreated != 4 || allocator.getPoolCount() != 4 || allocator.setsAllocated != 22)
+    {
+        return fail(std::to_string(allocator.poolsCreated) + " pools created for " + std::to_string(allocator.setsAllocated) + " sets, expected 2, 4, 8 and 8 sets");
+    }
+
+    for (const std::pair<const VkDescriptorPool, Pool>& pool : pools)
+    {
+        if (pool.second.used != pool.second.capacity)
+        {
+            return fail("a pool was chained past before it was full");
+        }
+    }
+
+    // Resetting returns every pool for reuse, so the same sets need no new ones
+    allocator.reset();
+
+    for (uint32_t i = 0; i < 22; i++)
+    {
+        allocator.allocate(layout);
+    }
+
+    if (allocator.poolsCreated != 4 || allocator.poolResets != 4 || allocator.getPoolCount() != 4)
+    {
+        return fail(std::to_string(allocator.poolsCreated) + " pools created and " + std::to_string(allocator.poolResets) + " reset after reuse, expected 4 and 4");
+    }
+
+    allocator.allocate(layout);
+
+    if (allocator.poolsCreated != 5 || poolSizes.back() != 8)
+    {
+        return fail("the chain did not grow by a pool of the maximum size once every reused pool was full");
+    }
+
+    // Sets are shared by contents: array writes match the same descriptors written one at a time
+    uint32_t setsWritten = 0;
+
+    DescriptorSetCache setCache(
+        [&](VkDescriptorSetLayout setLayout)
+        {
+            return allocator.allocate(setLayout);
+        },
+        [&](VkDescriptorSet, const VkWriteDescriptorSet*, uint32_t)
+        {
+            setsWritten++;
+        });
+
+    VkDescriptorBufferInfo bufferInfo = {};
+    bufferInfo.buffer = fakeHandle<VkBuffer>(nextHandle++);
+    bufferInfo.range = 256;
+
+    VkDescriptorImageInfo imageInfos[2] = {};
+    imageInfos[0].imageView = fakeHandle<VkImageView>(nextHandle++);
+    imageInfos[0].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageInfos[1].imageView = fakeHandle<VkImageView>(nextHandle++);
+    imageInfos[1].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    VkWriteDescriptorSet writes[3] = {};
+
+    for (VkWriteDescriptorSet& write : writes)
+    {
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.descriptorCount = 1;
+    }
+
+    writes[0].dstBinding = 0;
+    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    writes[0].pBufferInfo = &bufferInfo;
+
+    writes[1].dstBinding = 1;
+    writes[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    writes[1].descriptorCount = 2;
+    writes[1].pImageInfo = imageInfos;
+
+    VkDescriptorSet set = setCache.getSet(layout, writes, 2);
+
+    writes[1].descriptorCount = 1;
+    writes[2] = writes[1];
+    writes[2].dstArrayElement = 1;
+    writes[2].pImageInfo = &imageInfos[1];
+
+    VkDescriptorSet splitSet = setCache.getSet(layout, writes, 3);
+
+    bufferInfo.offset = 256;
+    VkDescriptorSet offsetSet = setCache.getSet(layout, writes, 3);
+    VkDescriptorSet otherLayoutSet = setCache.getSet(otherLayout, writes, 3);
+
+    if (splitSet != set || offsetSet == set || otherLayoutSet == offsetSet || setsWritten != 3 || setCache.size() != 3 ||
+        setCache.getStats().requests != 4 || setCache.getStats().hits != 1)
+    {
+        return fail("set cache wrote " + std::to_string(setsWritten) + " sets with " + counts(setCache.getStats()) + ", expected 3 with 1 hit in 4");
+    }
+
+    // Every pool goes exactly once, the cached sets with them
+    setCache.clear();
+    allocator.cleanup();
+    layoutCache.cleanup();
+
+    for (const std::pair<const VkDescriptorPool, Pool>& pool : pools)
+    {
+        if (!pool.second.destroyed)
+        {
+            return fail("a pool was not destroyed");
+        }
+    }
+
+    if (layoutsDestroyed != 2 || layoutCache.size() != 0)
+    {
+        return fail(std::to_string(layoutsDestroyed) + " layouts destroyed, expected 2");
+    }
+
+    std::cout << "Descriptor test passed: " << allocator.poolsCreated << " pools for " << allocator.setsAllocated << " sets, layout cache "
+              << counts(layoutCache.getStats()) << ", set cache " << counts(setCache.getStats()) << std::endl;
+
+    return true;
+}
\ No newline at end of file
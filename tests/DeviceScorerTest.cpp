@@ -0,0 +1,201 @@
+#include "Tests.h"
+
+#include "DeviceScorer.h"
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+namespace
+{
+    const VkDeviceSize MB = 1024 * 1024;
+
+    // Suitable windowed device with one graphics queue that presents and one device-local heap
+    DeviceCandidate makeCandidate(const char* name, VkPhysicalDeviceType type, VkDeviceSize deviceLocalBytes)
+    {
+        DeviceCandidate candidate = {};
+
+        std::snprintf(candidate.properties.deviceName, sizeof(candidate.properties.deviceName), "%s", name);
+        candidate.properties.deviceType = type;
+        candidate.properties.limits.maxImageDimension2D = 16384;
+        candidate.properties.limits.maxSamplerAnisotropy = 16.0f;
+
+        candidate.memoryProperties.memoryHeapCount = 2;
+        candidate.memoryProperties.memoryHeaps[0].size = deviceLocalBytes;
+        candidate.memoryProperties.memoryHeaps[0].flags = VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+        candidate.memoryProperties.memoryHeaps[1].size = 16384 * MB;
+
+        candidate.features.samplerAnisotropy = VK_TRUE;
+
+        VkQueueFamilyProperties graphics = {};
+        graphics.queueFlags = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT;
+        graphics.queueCount = 1;
+
+        candidate.queueFamilies.push_back(graphics);
+        candidate.presentSupport.push_back(true);
+
+        candidate.extensionsSupported = true;
+        candidate.swapchainAdequate = true;
+
+        return candidate;
+    }
+
+    void addQueueFamily(DeviceCandidate& candidate, VkQueueFlags flags)
+    {
+        VkQueueFamilyProperties family = {};
+        family.queueFlags = flags;
+        family.queueCount = 1;
+
+        candidate.queueFamilies.push_back(family);
+        candidate.presentSupport.push_back(false);
+    }
+}
+
+bool testDeviceScorer()
+{
+    auto fail = [](const std::string& message)
+    {
+        std::cerr << "DeviceScorer test failed: " << message << std::endl;
+        return false;
+    };
+
+    // Type comes first, an integrated GPU with more memory than any discrete one still ranks below it
+    DeviceCandidate discrete = makeCandidate("Discrete GPU", VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 4096 * MB);
+    DeviceCandidate integrated = makeCandidate("Integrated GPU", VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU, 65536 * MB);
+    DeviceCandidate cpu = makeCandidate("Software Rasterizer", VK_PHYSICAL_DEVICE_TYPE_CPU, 65536 * MB);
+
+    DeviceScore discreteScore = DeviceScorer::score(discrete);
+    DeviceScore integratedScore = DeviceScorer::score(integrated);
+    DeviceScore cpuScore = DeviceScorer::score(cpu);
+
+    if (!discreteScore.suitable || !integratedScore.suitable || !cpuScore.suitable)
+    {
+        return fail("a device meeting every requirement was rejected");
+    }
+
+    if (discreteScore.score <= integratedScore.score || integratedScore.score <= cpuScore.score)
+    {
+        return fail("scores " + std::to_string(discreteScore.score) + ", " + std::to_string(integratedScore.score) + " and " +
+                    std::to_string(cpuScore.score) + " don't rank discrete over integrated over CPU");
+    }
+
+    // Memory counts until the cap, then stops
+    DeviceCandidate smaller = makeCandidate("Smaller GPU", VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 2048 * MB);
+    DeviceCandidate capped = makeCandidate("Capped GPU", VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 65536 * MB);
+    DeviceCandidate beyondCap = makeCandidate("Beyond Cap GPU", VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 131072 * MB);
+
+    if (DeviceScorer::score(smaller).score >= discreteScore.score || DeviceScorer::score(capped).score != DeviceScorer::score(beyondCap).score)
+    {
+        return fail("device-local memory is not scored up to a cap");
+    }
+
+    if (DeviceScorer::getDeviceLocalBytes(discrete.memoryProperties) != 4096 * MB)
+    {
+        return fail("host heap counted as device-local");
+    }
+
+    // Queues that can run alongside rendering add to the score
+    DeviceCandidate queues = discrete;
+    addQueueFamily(queues, VK_QUEUE_TRANSFER_BIT);
+    addQueueFamily(queues, VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT);
+
+    if (DeviceScorer::score(queues).score <= discreteScore.score)
+    {
+        return fail("dedicated transfer and async compute queues scored nothing");
+    }
+
+    // Each missing requirement rejects the device, whatever else it has
+    DeviceCandidate noGraphics = discrete;
+    noGraphics.queueFamilies[0].queueFlags = VK_QUEUE_COMPUTE_BIT;
+
+    DeviceCandidate noPresent = discrete;
+    noPresent.presentSupport[0] = false;
+
+    DeviceCandidate noSwapchain = discrete;
+    noSwapchain.extensionsSupported = false;
+
+    DeviceCandidate noFormats = discrete;
+    noFormats.swapchainAdequate = false;
+
+    DeviceCandidate noAnisotropy = discrete;
+    noAnisotropy.features.samplerAnisotropy = VK_FALSE;
+
+    const DeviceCandidate* rejected[] = { &noGraphics, &noPresent, &noSwapchain, &noFormats, &noAnisotropy };
+
+    for (const DeviceCandidate* candidate : rejected)
+    {
+        DeviceScore score = DeviceScorer::score(*candidate);
+
+        if (score.suitable || score.notes.size() != 1)
+        {
+            return fail("a device missing one requirement was accepted or rejected for " + std::to_string(score.notes.size()) + " reasons");
+        }
+    }
+
+    // Without a surface, presenting and the swapchain don't matter
+    DeviceCandidate headless = noPresent;
+    headless.headless = true;
+    headless.extensionsSupported = false;
+    headless.swapchainAdequate = false;
+    headless.presentSupport.clear();
+
+    if (!DeviceScorer::score(headless).suitable)
+    {
+        return fail("a headless device was rejected for what it can't present");
+    }
+
+    // Overrides by index, name or device UUID
+    std::string uuid = "00112233-4455-6677-8899-aabbccddeeff";
+
+    DeviceCandidate identified = discrete;
+    identified.hasDeviceUuid = true;
+
+    for (uint32_t i = 0; i < VK_UUID_SIZE; i++)
+    {
+        identified.deviceUuid[i] = static_cast<uint8_t>(i * 0x11);
+    }
+
+    if (DeviceScorer::getUuid(identified) != "00112233445566778899aabbccddeeff" || !DeviceScorer::getUuid(discrete).empty())
+    {
+        return fail("device UUID formatted as " + DeviceScorer::getUuid(identified));
+    }
+
+    struct Override
+    {
+        const DeviceCandidate* candidate;
+        uint32_t index;
+        std::string deviceOverride;
+        bool matches;
+    };
+
+    const Override overrides[] =
+    {
+        { &discrete, 1, "1", true },
+        { &discrete, 0, "1", false },
+        { &discrete, 0, "discrete", true },
+        { &discrete, 0, "INTEGRATED", false },
+        { &integrated, 3, "Integrated GPU", true },
+        { &discrete, 0, "", false },
+        { &identified, 0, uuid, true },
+        { &identified, 0, "00112233445566778899AABBCCDDEEFF", true },
+        { &identified, 0, "00112233-4455-6677-8899-aabbccddeefe", false },
+
+        // Without a device UUID only the index and name can match
+        { &discrete, 0, uuid, false }
+    };
+
+    for (const Override& entry : overrides)
+    {
+        if (DeviceScorer::matchesOverride(*entry.candidate, entry.index, entry.deviceOverride) != entry.matches)
+        {
+            return fail("override \"" + entry.deviceOverride + "\" " + (entry.matches ? "didn't match " : "matched ") +
+                        entry.candidate->properties.deviceName + " at index " + std::to_string(entry.index));
+        }
+    }
+
+    std::cout << "DeviceScorer test passed: discrete " << discreteScore.score << ", integrated " << integratedScore.score << ", CPU "
+              << cpuScore.score << ", " << sizeof(rejected) / sizeof(rejected[0]) << " rejections and "
+              << sizeof(overrides) / sizeof(overrides[0]) << " overrides checked" << std::endl;
+
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,166 @@
+#include "Tests.h"
+
+#include "RangeAllocator.h"
+
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+
+namespace
+{
+    // Resource small enough that allocations regularly run out of space
+    const uint32_t TEST_SIZE = 1024 * 1024;
+    const uint32_t TEST_MAX_ALLOCATIONS = 4096;
+    const uint32_t TEST_ITERATIONS = 200000;
+
+    // Mostly mesh-sized ranges with the occasional large one
+    const uint32_t TEST_SMALL_SIZE = 256;
+    const uint32_t TEST_LARGE_SIZE = 64 * 1024;
+
+    // Iterations between comparing every free range against the gaps in the model
+    const uint32_t TEST_CHECK_INTERVAL = 64;
+}
+
+bool testRangeAllocator()
+{
+    // Same sequence for every run
+    std::mt19937 random(1);
+    std::uniform_int_distribution<uint32_t> percent(0, 99);
+    std::uniform_int_distribution<uint32_t> smallSize(1, TEST_SMALL_SIZE);
+    std::uniform_int_distribution<uint32_t> largeSize(TEST_SMALL_SIZE + 1, TEST_LARGE_SIZE);
+
+    RangeAllocator allocator(TEST_SIZE, TEST_MAX_ALLOCATIONS);
+
+    // Sizes of the live ranges by offset, and the allocations to pick frees from
+    std::map<uint32_t, uint32_t> ranges;
+    std::vector<RangeAllocator::Allocation> live;
+    uint32_t usedSize = 0;
+
+    uint32_t allocations = 0;
+    uint32_t outOfSpace = 0;
+    size_t peakRanges = 0;
+
+    auto fail = [](uint32_t iteration, const std::string& message)
+    {
+        std::cerr << "RangeAllocator test failed at iteration " << iteration << ": " << message << std::endl;
+        return false;
+    };
+
+    for (uint32_t iteration = 0; iteration < TEST_ITERATIONS; iteration++)
+    {
+        // Slightly more allocations than frees, so the resource fills up and stays near full
+        if (live.empty() || percent(random) < 55)
+        {
+            uint32_t size = percent(random) < 80 ? smallSize(random) : largeSize(random);
+            RangeAllocator::Allocation allocation = allocator.allocate(size);
+
+            if (!allocation.isValid())
+            {
+                outOfSpace++;
+                continue;
+            }
+
+            if (allocation.offset + size > TEST_SIZE || allocator.allocationSize(allocation) != size)
+            {
+                return fail(iteration, "range of " + std::to_string(size) + " at " + std::to_string(allocation.offset) + " is out of bounds or resized");
+            }
+
+            std::map<uint32_t, uint32_t>::iterator next = ranges.lower_bound(allocation.offset);
+
+            bool overlapsNext = next != ranges.end() && next->first < allocation.offset + size;
+            bool overlapsPrevious = next != ranges.begin() && std::prev(next)->first + std::prev(next)->second > allocation.offset;
+
+            if (overlapsNext || overlapsPrevious)
+            {
+                return fail(iteration, "range at " + std::to_string(allocation.offset) + " overlaps a live range");
+            }
+
+            ranges[allocation.offset] = size;
+            live.push_back(allocation);
+            usedSize += size;
+
+            allocations++;
+            peakRanges = std::max(peakRanges, live.size());
+        }
+        else
+        {
+            size_t index = std::uniform_int_distribution<size_t>(0, live.size() - 1)(random);
+            RangeAllocator::Allocation allocation = live[index];
+
+            usedSize -= ranges[allocation.offset];
+            ranges.erase(allocation.offset);
+            allocator.free(allocation);
+
+            live[index] = live.back();
+            live.pop_back();
+        }
+
+        RangeAllocator::StorageReport report = allocator.getStorageReport();
+
+        if (report.totalFree != TEST_SIZE - usedSize)
+        {
+            return fail(iteration, std::to_string(report.totalFree) + " free, expected " + std::to_string(TEST_SIZE - usedSize));
+        }
+
+        if (iteration % TEST_CHECK_INTERVAL != 0)
+        {
+            continue;
+        }
+
+        // Coalesced free ranges are exactly the gaps between live ones
+        uint32_t gaps = 0;
+        uint32_t largestGap = 0;
+        uint32_t end = 0;
+
+        for (const std::pair<const uint32_t, uint32_t>& range : ranges)
+        {
+            if (range.first > end)
+            {
+                gaps++;
+                largestGap = std::max(largestGap, range.first - end);
+            }
+
+            end = range.first + range.second;
+        }
+
+        if (end < TEST_SIZE)
+        {
+            gaps++;
+            largestGap = std::max(largestGap, TEST_SIZE - end);
+        }
+
+        if (report.freeRanges != gaps || report.largestFree != largestGap)
+        {
+            return fail(iteration, std::to_string(report.freeRanges) + " free ranges, largest " + std::to_string(report.largestFree) +
+                        ", expected " + std::to_string(gaps) + ", largest " + std::to_string(largestGap));
+        }
+    }
+
+    // Freed in any order, everything has to merge back into the one range it started as
+    std::shuffle(live.begin(), live.end(), random);
+
+    for (const RangeAllocator::Allocation& allocation : live)
+    {
+        allocator.free(allocation);
+    }
+
+    RangeAllocator::StorageReport report = allocator.getStorageReport();
+
+    if (report.totalFree != TEST_SIZE || report.freeRanges != 1 || report.largestFree != TEST_SIZE)
+    {
+        return fail(TEST_ITERATIONS, "free ranges did not coalesce once everything was freed");
+    }
+
+    if (!allocator.allocate(TEST_SIZE).isValid())
+    {
+        return fail(TEST_ITERATIONS, "the whole resource could not be allocated once everything was freed");
+    }
+
+    std::cout << "RangeAllocator test passed: " << TEST_ITERATIONS << " iterations, " << allocations << " allocations, "
+              << outOfSpace << " out of space, peak " << peakRanges << " live ranges" << std::endl;
+
+    return true;
+}
\ No newline at end of file
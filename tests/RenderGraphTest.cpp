@@ -0,0 +1,213 @@
+#include "Tests.h"
+
+#include "RenderGraph.h"
+
+#include <iostream>
+#include <string>
+
+bool testRenderGraph()
+{
+    auto fail = [](const std::string& message)
+    {
+        std::cerr << "RenderGraph test failed: " << message << std::endl;
+        return false;
+    };
+
+    auto findBarrier = [](const RenderGraph::Step& step, RenderGraph::Resource resource) -> const RenderGraph::Barrier*
+    {
+        for (const RenderGraph::Barrier& barrier : step.barriers)
+        {
+            if (barrier.resource == resource)
+            {
+                return &barrier;
+            }
+        }
+
+        return nullptr;
+    };
+
+    auto requirements = [](VkDeviceSize size)
+    {
+        VkMemoryRequirements memRequirements = {};
+        memRequirements.size = size;
+        memRequirements.alignment = 256;
+        memRequirements.memoryTypeBits = 0xff;
+
+        return memRequirements;
+    };
+
+    RenderGraph::RecordFunc record = [](VkCommandBuffer, uint32_t) {};
+
+    // Produce writes Data and A, Consume reads them into Sum, Stale writes B only for Overwrite to replace it,
+    // Overwrite writes Data again and B, Resolve reads everything into Out and Debug writes C that nothing reads
+    RenderGraph graph;
+
+    RenderGraph::Resource data = graph.importBuffer("Data", VK_NULL_HANDLE);
+    RenderGraph::Resource sum = graph.importBuffer("Sum", VK_NULL_HANDLE);
+    RenderGraph::Resource out = graph.importBuffer("Out", VK_NULL_HANDLE);
+    graph.setOutput(out);
+
+    RenderGraph::ImageDesc desc = {};
+    RenderGraph::Resource a = graph.createImage("A", desc);
+    RenderGraph::Resource b = graph.createImage("B", desc);
+    RenderGraph::Resource c = graph.createImage("C", desc);
+    graph.setMemoryRequirements(a, requirements(1024 * 1024));
+    graph.setMemoryRequirements(b, requirements(512 * 1024));
+    graph.setMemoryRequirements(c, requirements(256 * 1024));
+
+    uint32_t produce = graph.addPass("Produce", record);
+    graph.write(produce, data, RenderGraph::STORAGE_WRITE_COMPUTE);
+    graph.write(produce, a, RenderGraph::COLOR_ATTACHMENT);
+
+    uint32_t consume = graph.addPass("Consume", record);
+    graph.read(consume, data, RenderGraph::STORAGE_READ_COMPUTE);
+    graph.read(consume, a, RenderGraph::SAMPLED_COMPUTE);
+    graph.write(consume, sum, RenderGraph::STORAGE_WRITE_COMPUTE);
+
+    uint32_t stale = graph.addPass("Stale", record);
+    graph.write(stale, b, RenderGraph::COLOR_ATTACHMENT);
+
+    uint32_t overwrite = graph.addPass("Overwrite", record);
+    graph.write(overwrite, data, RenderGraph::STORAGE_WRITE_COMPUTE);
+    graph.write(overwrite, b, RenderGraph::COLOR_ATTACHMENT);
+
+    uint32_t resolve = graph.addPass("Resolve", record);
+    graph.read(resolve, data, RenderGraph::STORAGE_READ_COMPUTE);
+    graph.read(resolve, sum, RenderGraph::STORAGE_READ_COMPUTE);
+    graph.read(resolve, b, RenderGraph::SAMPLED_COMPUTE);
+    graph.write(resolve, out, RenderGraph::STORAGE_WRITE_COMPUTE);
+
+    uint32_t debug = graph.addPass("Debug", record);
+    graph.read(debug, a, RenderGraph::SAMPLED_FRAGMENT);
+    graph.write(debug, c, RenderGraph::COLOR_ATTACHMENT);
+
+    const RenderGraph::Plan& plan = graph.compile();
+
+    if (plan.culledPasses != std::vector<uint32_t>({ stale, debug }))
+    {
+        return fail("expected Stale and Debug to be culled, " + std::to_string(plan.culledPasses.size()) + " passes were");
+    }
+
+    // No imported images, so no final transitions either
+    const uint32_t expectedPasses[] = { produce, consume, overwrite, resolve };
+
+    if (plan.steps.size() != 4)
+    {
+        return fail(std::to_string(plan.steps.size()) + " steps, expected 4");
+    }
+
+    for (uint32_t step = 0; step < plan.steps.size(); step++)
+    {
+        if (plan.steps[step].pass != expectedPasses[step])
+        {
+            return fail("step " + std::to_string(step) + " runs pass " + std::to_string(plan.steps[step].pass));
+        }
+    }
+
+    // A transient's first use waits for nothing, but is transitioned out of the undefined layout
+    const RenderGraph::Barrier* barrier = findBarrier(plan.steps[0], a);
+
+    if (plan.steps[0].barriers.size() != 1 || barrier == nullptr || barrier->oldLayout != VK_IMAGE_LAYOUT_UNDEFINED ||
+        barrier->newLayout != VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL || barrier->srcStage != VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT)
+    {
+        return fail("Produce should only transition A out of the undefined layout");
+    }
+
+    // Read after write waits for the write and makes it visible
+    barrier = findBarrier(plan.steps[1], data);
+
+    if (barrier == nullptr || barrier->srcStage != VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT || barrier->srcAccess != VK_ACCESS_SHADER_WRITE_BIT ||
+        barrier->dstStage != VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT || barrier->dstAccess != VK_ACCESS_SHADER_READ_BIT)
+    {
+        return fail("Consume reading Data has no read-after-write barrier");
+    }
+
+    barrier = findBarrier(plan.steps[1], a);
+
+    if (barrier == nullptr || barrier->srcStage != VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT || barrier->srcAccess != VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT ||
+        barrier->oldLayout != VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL || barrier->newLayout != VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+    {
+        return fail("Consume sampling A has no read-after-write transition");
+    }
+
+    // Write after read only waits for the reads to finish, there is nothing to make visible
+    barrier = findBarrier(plan.steps[2], data);
+
+    if (barrier == nullptr || barrier->srcStage != VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT || barrier->srcAccess != 0 ||
+        barrier->dstAccess != VK_ACCESS_SHADER_WRITE_BIT)
+    {
+        return fail("Overwrite writing Data has no write-after-read barrier");
+    }
+
+    // B takes over A's memory once A's last reader, Consume, is done with it
+    barrier = findBarrier(plan.steps[2], b);
+
+    if (barrier == nullptr || barrier->oldLayout != VK_IMAGE_LAYOUT_UNDEFINED || (barrier->srcStage & VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT) == 0)
+    {
+        return fail("Overwrite's first use of B does not wait for A, whose memory it reuses");
+    }
+
+    barrier = findBarrier(plan.steps[3], sum);
+
+    if (barrier == nullptr || barrier->srcAccess != VK_ACCESS_SHADER_WRITE_BIT || barrier->dstAccess != VK_ACCESS_SHADER_READ_BIT)
+    {
+        return fail("Resolve reading Sum has no read-after-write barrier");
+    }
+
+    // A lives in steps 0-1 and B in 2-3, the culled passes using them don't extend either lifetime
+    const RenderGraph::Placement& placementA = plan.placements[a];
+    const RenderGraph::Placement& placementB = plan.placements[b];
+
+    if (placementA.firstStep != 0 || placementA.lastStep != 1 || placementB.firstStep != 2 || placementB.lastStep != 3)
+    {
+        return fail("A or B has the wrong lifetime");
+    }
+
+    if (placementB.block != placementA.block || placementB.offset != placementA.offset || placementB.aliases != std::vector<RenderGraph::Resource>(1, a) ||
+        !placementA.aliases.empty())
+    {
+        return fail("B does not alias A");
+    }
+
+    if (plan.placements[c].block != RenderGraph::NONE)
+    {
+        return fail("C is placed although only a culled pass uses it");
+    }
+
+    if (plan.blocks.size() != 1 || plan.transientBytes != placementA.size || plan.unaliasedBytes != placementA.size + placementB.size)
+    {
+        return fail(std::to_string(plan.transientBytes) + " transient bytes in " + std::to_string(plan.blocks.size()) + " blocks, expected A's size in one");
+    }
+
+    // Same transients alive at once get separate memory
+    RenderGraph overlapping;
+
+    a = overlapping.createImage("A", desc);
+    b = overlapping.createImage("B", desc);
+    out = overlapping.importBuffer("Out", VK_NULL_HANDLE);
+    overlapping.setOutput(out);
+    overlapping.setMemoryRequirements(a, requirements(1024 * 1024));
+    overlapping.setMemoryRequirements(b, requirements(512 * 1024));
+
+    uint32_t draw = overlapping.addPass("Draw", record);
+    overlapping.write(draw, a, RenderGraph::COLOR_ATTACHMENT);
+    overlapping.write(draw, b, RenderGraph::COLOR_ATTACHMENT);
+
+    uint32_t combine = overlapping.addPass("Combine", record);
+    overlapping.read(combine, a, RenderGraph::SAMPLED_COMPUTE);
+    overlapping.read(combine, b, RenderGraph::SAMPLED_COMPUTE);
+    overlapping.write(combine, out, RenderGraph::STORAGE_WRITE_COMPUTE);
+
+    const RenderGraph::Plan& overlappingPlan = overlapping.compile();
+
+    if (!overlappingPlan.placements[a].aliases.empty() || !overlappingPlan.placements[b].aliases.empty() ||
+        overlappingPlan.transientBytes != overlappingPlan.unaliasedBytes)
+    {
+        return fail("transients alive at the same time share memory");
+    }
+
+    std::cout << "RenderGraph test passed: " << plan.steps.size() << " steps with " << plan.barrierCount << " barriers, "
+              << plan.culledPasses.size() << " passes culled, " << plan.unaliasedBytes - plan.transientBytes << " bytes saved by aliasing" << std::endl;
+
+    return true;
+}
\ No newline at end of file
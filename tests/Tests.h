@@ -0,0 +1,23 @@
+#pragma once
+
+// CPU-side tests, each prints what it checked or its first failure
+// None of them create a device, the device entry points the tested sources reference are stubbed out
+
+// Random allocations and frees checked against a model of the live ranges: no overlaps, exact free space
+// and neighbouring free ranges always coalesced
+bool testRangeAllocator();
+
+// Entries queued with tickets out of order and collected against fake completed tickets, checking which
+// entries are released, in what order and how many remain
+bool testDeletionQueue();
+
+// Synthetic graphs compiled and checked for the culled passes, the barriers for read-after-write and
+// write-after-read hazards and the aliasing of transients with disjoint lifetimes
+bool testRenderGraph();
+
+// Synthetic devices ranked and rejected, and overrides matched by index, name and device UUID
+bool testDeviceScorer();
+
+// The layout and set caches and a pool chain driven through stub callbacks, checking hit and miss counts and
+// how pools are chained, grown and reused
+bool testDescriptors();
\ No newline at end of file
@@ -0,0 +1,80 @@
+#include "Tests.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+namespace
+{
+    struct Test
+    {
+        const char* name;
+        bool (*run)();
+    };
+
+    const Test tests[] =
+    {
+        { "range-allocator", testRangeAllocator },
+        { "deletion-queue", testDeletionQueue },
+        { "render-graph", testRenderGraph },
+        { "descriptors", testDescriptors },
+        { "device-scorer", testDeviceScorer }
+    };
+}
+
+// Usage: VulkanTests [name...]
+// Runs the named tests, or all of them, and fails if any of them does
+int main(int argc, char* argv[])
+{
+    uint32_t run = 0;
+    uint32_t failed = 0;
+
+    for (const Test& test : tests)
+    {
+        bool selected = argc == 1;
+
+        for (int i = 1; i < argc; i++)
+        {
+            selected = selected || test.name == std::string(argv[i]);
+        }
+
+        if (!selected)
+        {
+            continue;
+        }
+
+        bool passed = false;
+
+        // A test that reaches a stubbed device entry point throws
+        try
+        {
+            passed = test.run();
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << test.name << " threw: " << e.what() << std::endl;
+        }
+
+        run++;
+        failed += passed ? 0 : 1;
+    }
+
+    if (run == 0)
+    {
+        std::cerr << "No test matches, tests are:";
+
+        for (const Test& test : tests)
+        {
+            std::cerr << " " << test.name;
+        }
+
+        std::cerr << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << run - failed << " of " << run << " tests passed" << std::endl;
+
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
\ No newline at end of file